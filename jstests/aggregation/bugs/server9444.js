@@ -44,7 +44,8 @@ var groupCode = 16945;
 var sortCode = 16819;
 var sortLimitCode = 16820;
 
-test([{$group: {_id: '$_id', bigStr: {$first: '$bigStr'}}}], groupCode);
+// grouping by _id would stream over the _id index, holding only one group at a time
+test([{$group: {_id: '$random', bigStr: {$first: '$bigStr'}}}], groupCode);
 
 // sorting with _id would use index which doesn't require extsort
 test([{$sort: {random: 1}}], sortCode);
@@ -54,10 +55,10 @@ test([{$sort: {bigStr: 1}}], sortCode); // big key and value
 test([{$sort: {bigStr: 1}}, {$limit:1000*1000*1000}], sortLimitCode);
 
 // test combining two extSorts in both same and different orders
-test([{$group: {_id: '$_id', bigStr: {$first: '$bigStr'}}}, {$sort: {_id:1}}], groupCode);
-test([{$group: {_id: '$_id', bigStr: {$first: '$bigStr'}}}, {$sort: {_id:-1}}], groupCode);
-test([{$group: {_id: '$_id', bigStr: {$first: '$bigStr'}}}, {$sort: {random:1}}], groupCode);
-test([{$sort: {random:1}}, {$group: {_id: '$_id', bigStr: {$first: '$bigStr'}}}], sortCode);
+test([{$group: {_id: '$random', bigStr: {$first: '$bigStr'}}}, {$sort: {_id:1}}], groupCode);
+test([{$group: {_id: '$random', bigStr: {$first: '$bigStr'}}}, {$sort: {_id:-1}}], groupCode);
+test([{$group: {_id: '$random', bigStr: {$first: '$bigStr'}}}, {$sort: {random:1}}], groupCode);
+test([{$sort: {random:1}}, {$group: {_id: '$random', bigStr: {$first: '$bigStr'}}}], sortCode);
 
 var origDB = db;
 if (sharded) {
@@ -0,0 +1,118 @@
+// Tests for the $lookup stage, which joins against another collection in the same database.
+
+var local = db.agg_lookup_local;
+var foreign = db.agg_lookup_foreign;
+local.drop();
+foreign.drop();
+
+assert.writeOK(local.insert({_id: 0, a: 1}));
+assert.writeOK(local.insert({_id: 1, a: 2}));
+assert.writeOK(local.insert({_id: 2, a: null}));
+assert.writeOK(local.insert({_id: 3}));
+assert.writeOK(local.insert({_id: 4, a: [1, 2]}));
+
+assert.writeOK(foreign.insert({_id: 0, b: 1}));
+assert.writeOK(foreign.insert({_id: 1, b: 1.0}));
+assert.writeOK(foreign.insert({_id: 2, b: [2, 3]}));
+assert.writeOK(foreign.insert({_id: 3, b: null}));
+assert.writeOK(foreign.insert({_id: 4}));
+assert.writeOK(foreign.insert({_id: 5, b: [1, 2]}));
+
+var lookup = {$lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "c"}};
+
+function runLookup() {
+    var res = local.aggregate([lookup, {$sort: {_id: 1}}]).toArray();
+    // Order of the matches is unspecified, so compare them by _id.
+    res.forEach(function(doc) {
+        doc.c = doc.c.map(function(f) {
+                         return f._id;
+                     }).sort();
+    });
+    return res;
+}
+
+function getStrategy() {
+    var explain = local.aggregate([lookup], {explain: true});
+    var stages = explain.stages.filter(function(stage) {
+        return stage.$lookup;
+    });
+    assert.eq(1, stages.length, tojson(explain));
+    return stages[0].$lookup.strategy;
+}
+
+var expected = [
+    {_id: 0, a: 1, c: [0, 1, 5]},
+    {_id: 1, a: 2, c: [2, 5]},
+    {_id: 2, a: null, c: [3, 4]},
+    {_id: 3, c: [3, 4]},
+    {_id: 4, a: [1, 2], c: [5]},
+];
+
+// Without an index on the foreign field the foreign collection is hashed.
+assert.eq("hash", getStrategy());
+assert.eq(expected, runLookup());
+
+// A sparse index can't answer a query for null, so it isn't used.
+assert.commandWorked(foreign.ensureIndex({b: 1}, {sparse: true}));
+assert.eq("hash", getStrategy());
+assert.commandWorked(foreign.dropIndex({b: 1}));
+
+// With an index, each input document probes it.
+assert.commandWorked(foreign.ensureIndex({b: 1}));
+assert.eq("indexNestedLoop", getStrategy());
+assert.eq(expected, runLookup());
+
+// A missing foreign collection joins with nothing.
+foreign.drop();
+assert.eq([{_id: 0, a: 1, c: []}], local.aggregate([{$match: {_id: 0}}, lookup]).toArray());
+
+// A null or missing local value joins every foreign document a query for null matches, including
+// those with an array element that lacks the rest of the foreign field's path.
+local.drop();
+foreign.drop();
+assert.writeOK(local.insert({_id: 0, a: null}));
+assert.writeOK(local.insert({_id: 1}));
+assert.writeOK(local.insert({_id: 2, a: 1}));
+assert.writeOK(foreign.insert({_id: 0, b: [{x: 1}, {y: 2}]}));
+assert.writeOK(foreign.insert({_id: 1, b: [{x: 1}]}));
+assert.writeOK(foreign.insert({_id: 2, b: {x: null}}));
+assert.writeOK(foreign.insert({_id: 3, b: 5}));
+assert.writeOK(foreign.insert({_id: 4}));
+
+lookup = {$lookup: {from: foreign.getName(), localField: "a", foreignField: "b.x", as: "c"}};
+expected = [
+    {_id: 0, a: null, c: [0, 2, 3, 4]},
+    {_id: 1, c: [0, 2, 3, 4]},
+    {_id: 2, a: 1, c: [0, 1]},
+];
+assert.eq("hash", getStrategy());
+assert.eq(expected, runLookup());
+assert.commandWorked(foreign.ensureIndex({"b.x": 1}));
+assert.eq("indexNestedLoop", getStrategy());
+assert.eq(expected, runLookup());
+
+// The joined documents must fit in the output document.
+local.drop();
+foreign.drop();
+assert.writeOK(local.insert({_id: 0, a: 1}));
+var bigStr = new Array(1024 * 1024).toString();
+for (var i = 0; i < 17; i++) {
+    assert.writeOK(foreign.insert({_id: i, b: 1, bigStr: bigStr}));
+}
+lookup = {$lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "c"}};
+assert.eq("hash", getStrategy());
+assert.commandFailedWithCode(local.runCommand("aggregate", {pipeline: [lookup]}), 28733);
+assert.commandWorked(foreign.ensureIndex({b: 1}));
+assert.commandFailedWithCode(local.runCommand("aggregate", {pipeline: [lookup]}), 28733);
+foreign.drop();
+
+// Invalid specifications.
+function assertLookupFails(spec) {
+    assert.throws(function() {
+        local.aggregate([{$lookup: spec}]);
+    });
+}
+assertLookupFails("foo");
+assertLookupFails({from: foreign.getName(), localField: "a", foreignField: "b"});
+assertLookupFails({from: foreign.getName(), localField: "a", foreignField: "b", as: 1});
+assertLookupFails({from: foreign.getName(), localField: "a", foreignField: "b", as: "c", x: "y"});
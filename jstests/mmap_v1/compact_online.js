@@ -0,0 +1,44 @@
+// Tests compact with online:true, which moves documents from the end of a collection into free
+// space in small batches and gives back the extents it empties.
+
+var mydb = db.getSiblingDB('compact_online');
+var t = mydb.compactonline;
+t.drop();
+
+var big = new Array(1000).join('x');
+var bulk = t.initializeUnorderedBulkOp();
+for (var i = 0; i < 2000; i++) {
+    bulk.insert({_id: i, x: i % 100, big: big});
+}
+assert.writeOK(bulk.execute());
+assert.commandWorked(t.ensureIndex({x: 1}));
+
+// Free up space at the start of the collection.
+assert.writeOK(t.remove({_id: {$lt: 1000}}));
+
+var before = t.stats();
+var res = mydb.runCommand({compact: t.getName(), online: true, batchSize: 10});
+printjson(res);
+assert.commandWorked(res);
+assert.gt(res.documentsMoved, 0);
+assert.gt(res.bytesFreed, 0);
+
+var after = t.stats();
+assert.lt(after.numExtents, before.numExtents);
+assert.eq(before.storageSize - res.bytesFreed, after.storageSize);
+
+// Documents and indexes are intact.
+assert.eq(1000, t.count());
+assert.eq(1000, t.find().hint({x: 1}).itcount());
+assert.eq(10, t.find({x: 7}).itcount());
+var v = t.validate(true);
+assert(v.valid, tojson(v));
+
+// Padding options only apply to a regular compact.
+assert.commandFailed(mydb.runCommand({compact: t.getName(), online: true, paddingFactor: 1.5}));
+assert.commandFailed(mydb.runCommand({compact: t.getName(), online: true, batchSize: 0}));
+
+// Capped collections can't be compacted.
+mydb.compactonline_capped.drop();
+assert.commandWorked(mydb.createCollection('compactonline_capped', {capped: true, size: 4096}));
+assert.commandFailed(mydb.runCommand({compact: 'compactonline_capped', online: true}));
@@ -0,0 +1,48 @@
+// Tests that the ASIO network interface pools its connections, and sets them up, including
+// authenticating as the internal user, without the blocking connection pool.
+(function() {
+    "use strict";
+
+    var keyFile = "jstests/libs/key1";
+    var rs = new ReplSetTest({name: "asio_connection_pool",
+                              nodes: 2,
+                              keyFile: keyFile,
+                              nodeOptions: {setParameter: "outboundNetworkImpl=ASIO"}});
+    rs.startSet();
+    rs.initiate();
+
+    var primary = rs.getPrimary();
+    var secondary = rs.getSecondary();
+
+    function getPoolMetrics(conn) {
+        var metrics;
+        authutil.asCluster(conn, keyFile, function() {
+            var res = conn.getDB("admin").runCommand({serverStatus: 1});
+            assert.commandWorked(res);
+            metrics = res.metrics.network.asio.connectionPool;
+        });
+        return metrics;
+    }
+
+    // Heartbeats go through the network interface, so both nodes connected and authenticated to
+    // each other, and keep reusing those connections rather than opening new ones.
+    [primary, secondary].forEach(function(conn) {
+        var before = getPoolMetrics(conn);
+        assert.gt(before.created, 0, tojson(before));
+
+        assert.soon(function() {
+            var after = getPoolMetrics(conn);
+            return after.reused > before.reused + 2;
+        }, "connections are not being reused", 30 * 1000);
+
+        var after = getPoolMetrics(conn);
+        assert.lte(after.created, before.created + 1, tojson(after));
+    });
+
+    // Replication still works
+    authutil.asCluster(rs.nodes, keyFile, function() {
+        assert.writeOK(primary.getDB("test").foo.insert({a: 1}, {writeConcern: {w: 2}}));
+    });
+
+    rs.stopSet();
+})();
@@ -0,0 +1,51 @@
+// Tests that the ASIO network interface works with its io_service running on several threads, and
+// that it reports how long handlers wait for one of them.
+(function() {
+    "use strict";
+
+    var name = "asio_reactor_threads";
+    var ports = allocatePorts(2);
+    var nodes = ports.map(function(port, i) {
+        var dbpath = MongoRunner.dataPath + name + "-" + i;
+        resetDbpath(dbpath);
+        return startMongoProgram("mongod",
+                                 "--port", port,
+                                 "--dbpath", dbpath,
+                                 "--replSet", name,
+                                 "--setParameter", "outboundNetworkImpl=ASIO",
+                                 "--setParameter", "asioReactorThreads=4");
+    });
+
+    var hostName = getHostName();
+    assert.commandWorked(nodes[0].adminCommand({
+        replSetInitiate: {
+            _id: name,
+            members: [
+                {_id: 0, host: hostName + ":" + ports[0]},
+                {_id: 1, host: hostName + ":" + ports[1], priority: 0},
+            ]
+        }
+    }));
+
+    assert.soon(function() {
+        return nodes[0].adminCommand({isMaster: 1}).ismaster;
+    }, "node 0 did not become primary", 60 * 1000);
+
+    // Heartbeats go through the network interface while the set replicates some writes.
+    var coll = nodes[0].getDB("test").foo;
+    for (var i = 0; i < 100; i++) {
+        assert.writeOK(coll.insert({a: i}, {writeConcern: {w: 2, wtimeout: 60 * 1000}}));
+    }
+
+    nodes.forEach(function(conn) {
+        var res = conn.adminCommand({serverStatus: 1});
+        assert.commandWorked(res);
+        var latency = res.metrics.network.asio.reactorLatency;
+        assert.gt(latency.ops, 0, tojson(latency));
+        assert.lte(latency.p50, latency.p99, tojson(latency));
+    });
+
+    ports.forEach(function(port) {
+        MongoRunner.stopMongod(port);
+    });
+})();
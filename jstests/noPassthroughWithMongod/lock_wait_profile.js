@@ -0,0 +1,44 @@
+// Tests that the lockWaitProfile command reports sampled lock waits and whom they waited for.
+
+var admin = db.getSiblingDB("admin");
+var t = db.lock_wait_profile;
+t.drop();
+
+var res = admin.runCommand({getParameter: 1, lockWaitProfilerSampleRate: 1});
+assert.commandWorked(res);
+var originalSampleRate = res.lockWaitProfilerSampleRate;
+
+// Sample every wait, starting from a clean slate
+assert.commandWorked(admin.runCommand({setParameter: 1, lockWaitProfilerSampleRate: 1}));
+assert.commandWorked(admin.runCommand({lockWaitProfile: 1, clear: true}));
+
+// Hold the global lock exclusively for a while, so that the insert below has to wait for it
+var awaitSleep = startParallelShell("db.adminCommand({sleep: 1, w: true, secs: 2});");
+
+var holder;
+assert.soon(function() {
+    db.currentOp().inprog.forEach(function(op) {
+        if (op.query && op.query.sleep) {
+            holder = op;
+        }
+    });
+    return holder;
+});
+assert.writeOK(t.insert({a: 1}));
+awaitSleep();
+
+res = admin.runCommand({lockWaitProfile: 1, clear: true});
+assert.commandWorked(res);
+assert.gt(res.numRecorded, 0, tojson(res));
+
+var samples = res.samples.filter(function(sample) {
+    return sample.holder.lockerId == holder.lockerId;
+});
+assert.gt(samples.length, 0, tojson(res));
+assert.eq("Global", samples[0].resourceType, tojson(samples[0]));
+assert.eq("X", samples[0].holder.mode, tojson(samples[0]));
+assert.eq("granted", samples[0].result, tojson(samples[0]));
+assert.gt(samples[0].waitMicros, 0, tojson(samples[0]));
+
+assert.commandWorked(
+    admin.runCommand({setParameter: 1, lockWaitProfilerSampleRate: originalSampleRate}));
@@ -0,0 +1,51 @@
+// Tests that the slowOps command reports recent slow operations without the profiler.
+
+var admin = db.getSiblingDB("admin");
+var t = db.slow_ops;
+t.drop();
+
+var res = admin.runCommand({getParameter: 1, slowOpProfilerSampleRate: 1});
+assert.commandWorked(res);
+var originalSampleRate = res.slowOpProfilerSampleRate;
+var originalSlowMS = db.getProfilingStatus().slowms;
+
+// Record every slow operation, starting from a clean slate
+assert.commandWorked(admin.runCommand({setParameter: 1, slowOpProfilerSampleRate: 1}));
+assert.commandWorked(admin.runCommand({slowOps: 1, clear: true}));
+assert.commandWorked(db.setProfilingLevel(0, 10));
+
+for (var i = 0; i < 100; i++) {
+    assert.writeOK(t.insert({a: i}));
+}
+assert.eq(1, t.find({a: 50, $where: "sleep(50); return true;"}).itcount());
+
+res = admin.runCommand({slowOps: 1, ns: t.getFullName()});
+assert.commandWorked(res);
+assert.gt(res.numRecorded, 0, tojson(res));
+
+var ops = res.ops.filter(function(op) {
+    return op.op == "query" && op.query.$where;
+});
+assert.eq(1, ops.length, tojson(res));
+assert.eq(100, ops[0].nscannedObjects, tojson(ops[0]));
+assert.eq("COLLSCAN", ops[0].planSummary, tojson(ops[0]));
+assert(ops[0].locks.Global, tojson(ops[0]));
+assert.gte(ops[0].millis, 10, tojson(ops[0]));
+
+// Nothing went to system.profile
+assert.eq(0, db.system.profile.find({ns: t.getFullName()}).itcount());
+
+// Other namespaces are filtered out
+res = admin.runCommand({slowOps: 1, ns: "test.nonexistent"});
+assert.commandWorked(res);
+assert.eq(0, res.ops.length, tojson(res));
+
+// A sample rate of zero stops recording
+assert.commandWorked(admin.runCommand({setParameter: 1, slowOpProfilerSampleRate: 0}));
+assert.commandWorked(admin.runCommand({slowOps: 1, clear: true}));
+assert.eq(1, t.find({a: 50, $where: "sleep(50); return true;"}).itcount());
+assert.eq(0, admin.runCommand({slowOps: 1, ns: t.getFullName()}).ops.length);
+
+assert.commandWorked(db.setProfilingLevel(0, originalSlowMS));
+assert.commandWorked(
+    admin.runCommand({setParameter: 1, slowOpProfilerSampleRate: originalSampleRate}));
@@ -0,0 +1,58 @@
+// Tests that initial sync copies several collections of a database at once, and builds all of
+// their indexes, including unique and sparse ones, while copying the documents.
+(function() {
+    "use strict";
+
+    var rst = new ReplSetTest({name: "initial_sync_parallel_clone",
+                               nodes: 1,
+                               nodeOptions: {setParameter: "initialSyncCollectionCloneThreads=3"}});
+    rst.startSet();
+    rst.initiate();
+
+    var primaryDB = rst.getPrimary().getDB("test");
+    var numColls = 5;
+    for (var c = 0; c < numColls; c++) {
+        var coll = primaryDB["coll" + c];
+        var bulk = coll.initializeUnorderedBulkOp();
+        for (var i = 0; i < 1000; i++) {
+            var doc = {_id: i, a: i % 10, u: i};
+            if (i % 2) {
+                doc.s = i;
+            }
+            bulk.insert(doc);
+        }
+        assert.writeOK(bulk.execute());
+        assert.commandWorked(coll.ensureIndex({a: 1}));
+        assert.commandWorked(coll.ensureIndex({u: 1}, {unique: true}));
+        assert.commandWorked(coll.ensureIndex({s: 1}, {sparse: true}));
+    }
+    assert.commandWorked(primaryDB.createCollection("noIdIndex", {autoIndexId: false}));
+    assert.writeOK(primaryDB.noIdIndex.insert({_id: 1}));
+
+    var secondary = rst.add({setParameter: "initialSyncCollectionCloneThreads=3"});
+    rst.reInitiate();
+    rst.awaitSecondaryNodes();
+    rst.awaitReplication();
+
+    var secondaryDB = secondary.getDB("test");
+    secondary.setSlaveOk();
+    for (var c = 0; c < numColls; c++) {
+        var name = "coll" + c;
+        assert.eq(1000, secondaryDB[name].find().itcount(), name);
+
+        var indexNames = secondaryDB[name].getIndexes().map(function(spec) {
+            return spec.name;
+        }).sort();
+        assert.eq(["_id_", "a_1", "s_1", "u_1"], indexNames, name);
+
+        // The index can answer queries on the secondary.
+        var explain = secondaryDB[name].find({u: 17}).explain();
+        assert.eq("IXSCAN", explain.queryPlanner.winningPlan.inputStage.stage, tojson(explain));
+    }
+
+    // As before, the secondary gets an _id index even where the primary has none.
+    assert.eq(1, secondaryDB.noIdIndex.find().itcount());
+    assert.eq(1, secondaryDB.noIdIndex.getIndexes().length);
+
+    rst.stopSet();
+})();
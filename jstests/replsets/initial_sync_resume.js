@@ -0,0 +1,53 @@
+// Tests that an initial sync which fails part way through copying a collection carries on from
+// the last document it copied on its next attempt, rather than starting over.
+(function() {
+    "use strict";
+
+    var rst = new ReplSetTest({name: "initial_sync_resume", nodes: 1});
+    rst.startSet();
+    rst.initiate();
+
+    var primaryDB = rst.getPrimary().getDB("test");
+    var bulk = primaryDB.coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < 5000; i++) {
+        bulk.insert({_id: i, a: i % 10, u: i});
+    }
+    assert.writeOK(bulk.execute());
+    assert.commandWorked(primaryDB.coll.ensureIndex({a: 1}));
+    assert.commandWorked(primaryDB.coll.ensureIndex({u: 1}, {unique: true}));
+
+    // Capped collections can't be copied in _id order, so they are copied again from the start.
+    assert.commandWorked(primaryDB.createCollection("capped", {capped: true, size: 100000}));
+    for (var i = 0; i < 100; i++) {
+        assert.writeOK(primaryDB.capped.insert({_id: i}));
+    }
+
+    // Fail the first attempt after it has copied the first batch of documents. The new member
+    // doesn't start initial sync until it is in the config.
+    var secondary = rst.add({setParameter: "initialSyncCollectionCloneThreads=1"});
+    assert.commandWorked(secondary.getDB("admin").runCommand(
+        {configureFailPoint: "failClonerAfterCheckpoint", mode: {times: 1}}));
+    rst.reInitiate();
+
+    assert.soon(function() {
+        return rawMongoProgramOutput().match(/initial sync resuming the attempt which started/);
+    }, "initial sync did not resume", 60 * 1000);
+    rst.awaitSecondaryNodes();
+    rst.awaitReplication();
+    assert(rawMongoProgramOutput().match(/resuming clone of .* after/),
+           "no collection clone was resumed");
+
+    var secondaryDB = secondary.getDB("test");
+    secondary.setSlaveOk();
+    assert.eq(5000, secondaryDB.coll.find().itcount());
+    assert.eq(100, secondaryDB.capped.find().itcount());
+    var indexNames = secondaryDB.coll.getIndexes().map(function(spec) {
+        return spec.name;
+    }).sort();
+    assert.eq(["_id_", "a_1", "u_1"], indexNames);
+
+    // The progress is forgotten once initial sync is done.
+    assert.eq(0, secondary.getDB("local").replset.initialSyncProgress.find().itcount());
+
+    rst.stopSet();
+})();
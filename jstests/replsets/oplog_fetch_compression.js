@@ -0,0 +1,33 @@
+// Tests that a secondary can fetch the oplog in snappy compressed batches of a configured size,
+// and that it reports the compressed bytes and getMore latencies in serverStatus.
+(function() {
+    "use strict";
+
+    var rs = new ReplSetTest({name: "oplog_fetch_compression",
+                              nodes: 2,
+                              nodeOptions: {setParameter: "replOplogFetchCompression=snappy"}});
+    rs.startSet();
+    rs.initiate();
+
+    var primary = rs.getPrimary();
+    var secondary = rs.getSecondary();
+    assert.commandWorked(
+        secondary.adminCommand({setParameter: 1, replOplogFetchMaxEntriesPerBatch: 50}));
+    var coll = primary.getDB("test").foo;
+
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < 1000; i++) {
+        bulk.insert({_id: i, x: "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"});
+    }
+    assert.writeOK(bulk.execute({w: 2}));
+    assert.eq(1000, secondary.getDB("test").foo.count());
+
+    var res = secondary.getDB("admin").runCommand({serverStatus: 1});
+    assert.commandWorked(res);
+    var network = res.metrics.repl.network;
+    assert.gt(network.compressedBytes, 0, tojson(network));
+    assert.lt(network.compressedBytes, network.bytes, tojson(network));
+    assert.gt(network.getmoreLatency.count, 0, tojson(network));
+
+    rs.stopSet();
+})();
@@ -51,6 +51,10 @@ var runTest = function(testDB, primaryConn) {
     assert.gt(res.waitedMS, 0);
 
     insertFunc();
+
+    // The read that waited is counted in the wait times
+    var metrics = assert.commandWorked(testDB.adminCommand({ serverStatus: 1 })).metrics;
+    assert.gte(metrics.repl.readAfterOpTime.waits.ops, 1, tojson(metrics.repl));
 };
 
 var primary = replTest.getPrimary();
@@ -35,6 +35,10 @@
 #include "mongo/platform/basic.h"
 
 #include "mongo/client/connpool.h"
+
+#include <algorithm>
+#include <functional>
+
 #include "mongo/client/global_conn_pool.h"
 #include "mongo/client/replica_set_monitor.h"
 #include "mongo/client/syncclusterconnection.h"
@@ -64,7 +68,49 @@ void PoolForHost::clear() {
     }
 }
 
+void PoolForHost::checkOut(Milliseconds timeout, stdx::unique_lock<stdx::mutex>& lk) {
+    if (_maxInUse == kPoolSizeUnlimited || (_waiters.empty() && _checkedOut < _maxInUse)) {
+        _checkedOut++;
+        return;
+    }
+
+    // Waiters are served in the order they arrived, so a burst of new checkouts can't starve
+    // those already waiting.
+    const uint64_t ticket = _nextTicket++;
+    _waiters.push_back(ticket);
+    const bool ready = _waitersCondition.wait_for(
+        lk, timeout, [&] { return _waiters.front() == ticket && _checkedOut < _maxInUse; });
+
+    if (!ready) {
+        _waiters.erase(std::find(_waiters.begin(), _waiters.end(), ticket));
+        _waitersCondition.notify_all();
+        uasserted(ErrorCodes::ExceededTimeLimit,
+                  str::stream() << "Timed out after " << timeout.count()
+                                << "ms waiting for one of the " << _maxInUse
+                                << " connections in use to " << _hostName);
+    }
+
+    _waiters.pop_front();
+    _checkedOut++;
+    if (!_waiters.empty()) {
+        _waitersCondition.notify_all();
+    }
+}
+
+void PoolForHost::checkedOutGone() {
+    // Connections which did not come from the pool may be handed to it
+    if (_checkedOut > 0) {
+        _checkedOut--;
+    }
+
+    if (!_waiters.empty()) {
+        _waitersCondition.notify_all();
+    }
+}
+
 void PoolForHost::done(DBConnectionPool* pool, DBClientBase* c) {
+    checkedOutGone();
+
     bool isFailed = c->isFailed();
 
     // Remember that this host had a broken connection for later
@@ -178,32 +224,60 @@ const int PoolForHost::kPoolSizeUnlimited(-1);
 DBConnectionPool::DBConnectionPool()
     : _name("dbconnectionpool"),
       _maxPoolSize(PoolForHost::kPoolSizeUnlimited),
+      _maxInUse(PoolForHost::kPoolSizeUnlimited),
+      _waitTimeout(0),
       _hooks(new list<DBConnectionHook*>()) {}
 
-DBClientBase* DBConnectionPool::_get(const string& ident, double socketTimeout) {
-    uassert(17382, "Can't use connection pool during shutdown", !inShutdown());
-    stdx::lock_guard<stdx::mutex> L(_mutex);
-    PoolForHost& p = _pools[PoolKey(ident, socketTimeout)];
+DBConnectionPool::Stripe& DBConnectionPool::_getStripe(const string& ident) {
+    // Hosts that serverNameCompare considers equal, such as a replica set name with or without
+    // its seed list, must end up in the same stripe.
+    const size_t hash = std::hash<string>()(ident.substr(0, ident.find('/')));
+    return _stripes[hash % kNumStripes];
+}
+
+PoolForHost& DBConnectionPool::_getPool_inlock(Stripe* stripe,
+                                               const string& ident,
+                                               double socketTimeout) {
+    PoolForHost& p = stripe->pools[PoolKey(ident, socketTimeout)];
     p.setMaxPoolSize(_maxPoolSize);
+    p.setMaxInUse(_maxInUse);
     p.initializeHostName(ident);
-    return p.get(this, socketTimeout);
+    return p;
+}
+
+DBClientBase* DBConnectionPool::_get(const string& ident,
+                                     double socketTimeout,
+                                     const Timer& timer) {
+    uassert(17382, "Can't use connection pool during shutdown", !inShutdown());
+    Stripe& stripe = _getStripe(ident);
+    stdx::unique_lock<stdx::mutex> lk(stripe.mutex);
+    PoolForHost& p = _getPool_inlock(&stripe, ident, socketTimeout);
+    p.checkOut(_waitTimeout, lk);
+
+    DBClientBase* c = p.get(this, socketTimeout);
+    if (c) {
+        p.recordCheckoutLatency(timer.micros());
+    }
+    return c;
 }
 
 DBClientBase* DBConnectionPool::_finishCreate(const string& host,
                                               double socketTimeout,
-                                              DBClientBase* conn) {
+                                              DBClientBase* conn,
+                                              const Timer& timer) {
     {
-        stdx::lock_guard<stdx::mutex> L(_mutex);
-        PoolForHost& p = _pools[PoolKey(host, socketTimeout)];
-        p.setMaxPoolSize(_maxPoolSize);
-        p.initializeHostName(host);
+        Stripe& stripe = _getStripe(host);
+        stdx::lock_guard<stdx::mutex> L(stripe.mutex);
+        PoolForHost& p = _getPool_inlock(&stripe, host, socketTimeout);
         p.createdOne(conn);
+        p.recordCheckoutLatency(timer.micros());
     }
 
     try {
         onCreate(conn);
         onHandedOut(conn);
     } catch (std::exception&) {
+        _checkedOutGone(host, socketTimeout);
         delete conn;
         throw;
     }
@@ -211,12 +285,20 @@ DBClientBase* DBConnectionPool::_finishCreate(const string& host,
     return conn;
 }
 
+void DBConnectionPool::_checkedOutGone(const string& host, double socketTimeout) {
+    Stripe& stripe = _getStripe(host);
+    stdx::lock_guard<stdx::mutex> L(stripe.mutex);
+    _getPool_inlock(&stripe, host, socketTimeout).checkedOutGone();
+}
+
 DBClientBase* DBConnectionPool::get(const ConnectionString& url, double socketTimeout) {
-    DBClientBase* c = _get(url.toString(), socketTimeout);
+    Timer timer;
+    DBClientBase* c = _get(url.toString(), socketTimeout, timer);
     if (c) {
         try {
             onHandedOut(c);
         } catch (std::exception&) {
+            _checkedOutGone(url.toString(), socketTimeout);
             delete c;
             throw;
         }
@@ -224,34 +306,50 @@ DBClientBase* DBConnectionPool::get(const ConnectionString& url, double socketTi
     }
 
     string errmsg;
-    c = url.connect(errmsg, socketTimeout);
+    try {
+        c = url.connect(errmsg, socketTimeout);
+    } catch (...) {
+        _checkedOutGone(url.toString(), socketTimeout);
+        throw;
+    }
+    if (!c) {
+        _checkedOutGone(url.toString(), socketTimeout);
+    }
     uassert(13328, _name + ": connect failed " + url.toString() + " : " + errmsg, c);
 
-    return _finishCreate(url.toString(), socketTimeout, c);
+    return _finishCreate(url.toString(), socketTimeout, c, timer);
 }
 
 DBClientBase* DBConnectionPool::get(const string& host, double socketTimeout) {
-    DBClientBase* c = _get(host, socketTimeout);
+    Timer timer;
+    DBClientBase* c = _get(host, socketTimeout, timer);
     if (c) {
         try {
             onHandedOut(c);
         } catch (std::exception&) {
+            _checkedOutGone(host, socketTimeout);
             delete c;
             throw;
         }
         return c;
     }
 
-    const ConnectionString cs(uassertStatusOK(ConnectionString::parse(host)));
-
     string errmsg;
-    c = cs.connect(errmsg, socketTimeout);
-    if (!c)
+    try {
+        const ConnectionString cs(uassertStatusOK(ConnectionString::parse(host)));
+        c = cs.connect(errmsg, socketTimeout);
+    } catch (...) {
+        _checkedOutGone(host, socketTimeout);
+        throw;
+    }
+    if (!c) {
+        _checkedOutGone(host, socketTimeout);
         throw SocketException(SocketException::CONNECT_ERROR,
                               host,
                               11002,
                               str::stream() << _name << " error: " << errmsg);
-    return _finishCreate(host, socketTimeout, c);
+    }
+    return _finishCreate(host, socketTimeout, c, timer);
 }
 
 void DBConnectionPool::onRelease(DBClientBase* conn) {
@@ -267,8 +365,17 @@ void DBConnectionPool::onRelease(DBClientBase* conn) {
 void DBConnectionPool::release(const string& host, DBClientBase* c) {
     onRelease(c);
 
-    stdx::lock_guard<stdx::mutex> L(_mutex);
-    _pools[PoolKey(host, c->getSoTimeout())].done(this, c);
+    Stripe& stripe = _getStripe(host);
+    stdx::lock_guard<stdx::mutex> L(stripe.mutex);
+    _getPool_inlock(&stripe, host, c->getSoTimeout()).done(this, c);
+}
+
+void DBConnectionPool::decrementEgress(const string& host, DBClientBase* c) {
+    if (!c) {
+        return;
+    }
+
+    _checkedOutGone(host, c->getSoTimeout());
 }
 
 
@@ -277,25 +384,32 @@ DBConnectionPool::~DBConnectionPool() {
 }
 
 void DBConnectionPool::flush() {
-    stdx::lock_guard<stdx::mutex> L(_mutex);
-    for (PoolMap::iterator i = _pools.begin(); i != _pools.end(); i++) {
-        PoolForHost& p = i->second;
-        p.flush();
+    for (size_t n = 0; n < kNumStripes; n++) {
+        stdx::lock_guard<stdx::mutex> L(_stripes[n].mutex);
+        PoolMap& pools = _stripes[n].pools;
+        for (PoolMap::iterator i = pools.begin(); i != pools.end(); i++) {
+            PoolForHost& p = i->second;
+            p.flush();
+        }
     }
 }
 
 void DBConnectionPool::clear() {
-    stdx::lock_guard<stdx::mutex> L(_mutex);
     LOG(2) << "Removing connections on all pools owned by " << _name << endl;
-    for (PoolMap::iterator iter = _pools.begin(); iter != _pools.end(); ++iter) {
-        iter->second.clear();
+    for (size_t n = 0; n < kNumStripes; n++) {
+        stdx::lock_guard<stdx::mutex> L(_stripes[n].mutex);
+        PoolMap& pools = _stripes[n].pools;
+        for (PoolMap::iterator iter = pools.begin(); iter != pools.end(); ++iter) {
+            iter->second.clear();
+        }
     }
 }
 
 void DBConnectionPool::removeHost(const string& host) {
-    stdx::lock_guard<stdx::mutex> L(_mutex);
     LOG(2) << "Removing connections from all pools for host: " << host << endl;
-    for (PoolMap::iterator i = _pools.begin(); i != _pools.end(); ++i) {
+    Stripe& stripe = _getStripe(host);
+    stdx::lock_guard<stdx::mutex> L(stripe.mutex);
+    for (PoolMap::iterator i = stripe.pools.begin(); i != stripe.pools.end(); ++i) {
         const string& poolHost = i->first.ident;
         if (!serverNameCompare()(host, poolHost) && !serverNameCompare()(poolHost, host)) {
             // hosts are the same
@@ -338,14 +452,18 @@ void DBConnectionPool::onDestroy(DBClientBase* conn) {
 void DBConnectionPool::appendInfo(BSONObjBuilder& b) {
     int avail = 0;
     long long created = 0;
+    int inUse = 0;
+    int waiting = 0;
+    LatencyHistogram checkoutLatency;
 
 
     map<ConnectionString::ConnectionType, long long> createdByType;
 
     BSONObjBuilder bb(b.subobjStart("hosts"));
-    {
-        stdx::lock_guard<stdx::mutex> lk(_mutex);
-        for (PoolMap::iterator i = _pools.begin(); i != _pools.end(); ++i) {
+    for (size_t n = 0; n < kNumStripes; n++) {
+        stdx::lock_guard<stdx::mutex> lk(_stripes[n].mutex);
+        PoolMap& pools = _stripes[n].pools;
+        for (PoolMap::iterator i = pools.begin(); i != pools.end(); ++i) {
             if (i->second.numCreated() == 0)
                 continue;
 
@@ -354,10 +472,19 @@ void DBConnectionPool::appendInfo(BSONObjBuilder& b) {
             BSONObjBuilder temp(bb.subobjStart(s));
             temp.append("available", i->second.numAvailable());
             temp.appendNumber("created", i->second.numCreated());
+            temp.append("inUse", i->second.numInUse());
+            temp.append("waiting", i->second.numWaiting());
+            {
+                BSONObjBuilder latency(temp.subobjStart("checkoutLatency"));
+                i->second.getCheckoutLatency().append(&latency, false);
+            }
             temp.done();
 
             avail += i->second.numAvailable();
             created += i->second.numCreated();
+            inUse += i->second.numInUse();
+            waiting += i->second.numWaiting();
+            checkoutLatency.merge(i->second.getCheckoutLatency());
 
             long long& x = createdByType[i->second.type()];
             x += i->second.numCreated();
@@ -382,6 +509,12 @@ void DBConnectionPool::appendInfo(BSONObjBuilder& b) {
 
     b.append("totalAvailable", avail);
     b.appendNumber("totalCreated", created);
+    b.append("totalInUse", inUse);
+    b.append("totalWaiting", waiting);
+
+    BSONObjBuilder latencyBuilder(b.subobjStart("checkoutLatency"));
+    checkoutLatency.append(&latencyBuilder, true);
+    latencyBuilder.done();
 }
 
 bool DBConnectionPool::serverNameCompare::operator()(const string& a, const string& b) const {
@@ -430,8 +563,9 @@ bool DBConnectionPool::isConnectionGood(const string& hostName, DBClientBase* co
     }
 
     {
-        stdx::lock_guard<stdx::mutex> sl(_mutex);
-        PoolForHost& pool = _pools[PoolKey(hostName, conn->getSoTimeout())];
+        Stripe& stripe = _getStripe(hostName);
+        stdx::lock_guard<stdx::mutex> sl(stripe.mutex);
+        PoolForHost& pool = _getPool_inlock(&stripe, hostName, conn->getSoTimeout());
         if (pool.isBadSocketCreationTime(conn->getSockCreationMicroSec())) {
             return false;
         }
@@ -443,11 +577,13 @@ bool DBConnectionPool::isConnectionGood(const string& hostName, DBClientBase* co
 void DBConnectionPool::taskDoWork() {
     vector<DBClientBase*> toDelete;
 
-    {
-        // we need to get the connections inside the lock
-        // but we can actually delete them outside
-        stdx::lock_guard<stdx::mutex> lk(_mutex);
-        for (PoolMap::iterator i = _pools.begin(); i != _pools.end(); ++i) {
+    // we need to get the connections inside the lock
+    // but we can actually delete them outside
+    // Only one stripe is locked at a time, so checkouts from the others carry on meanwhile.
+    for (size_t n = 0; n < kNumStripes; n++) {
+        stdx::lock_guard<stdx::mutex> lk(_stripes[n].mutex);
+        PoolMap& pools = _stripes[n].pools;
+        for (PoolMap::iterator i = pools.begin(); i != pools.end(); ++i) {
             i->second.getStaleConnections(toDelete);
         }
     }
@@ -485,6 +621,12 @@ void ScopedDbConnection::done() {
     _conn = NULL;
 }
 
+void ScopedDbConnection::kill() {
+    globalConnPool.decrementEgress(_host, _conn);
+    delete _conn;
+    _conn = 0;
+}
+
 void ScopedDbConnection::_setSocketTimeout() {
     if (!_conn)
         return;
@@ -30,12 +30,17 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <stack>
 
 #include "mongo/client/dbclientinterface.h"
+#include "mongo/db/stats/latency_histogram.h"
 #include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
 #include "mongo/util/background.h"
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/time_support.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -43,7 +48,8 @@ class DBConnectionPool;
 
 /**
  * not thread safe
- * thread safety is handled by DBConnectionPool
+ * thread safety is handled by DBConnectionPool, which guards each PoolForHost with the mutex of
+ * the stripe it lives in
  */
 class PoolForHost {
 public:
@@ -54,15 +60,23 @@ public:
         : _created(0),
           _minValidCreationTimeMicroSec(0),
           _type(ConnectionString::INVALID),
-          _maxPoolSize(kPoolSizeUnlimited) {}
+          _maxPoolSize(kPoolSizeUnlimited),
+          _checkedOut(0),
+          _maxInUse(kPoolSizeUnlimited),
+          _nextTicket(0) {}
 
     PoolForHost(const PoolForHost& other)
         : _created(other._created),
           _minValidCreationTimeMicroSec(other._minValidCreationTimeMicroSec),
           _type(other._type),
-          _maxPoolSize(other._maxPoolSize) {
+          _maxPoolSize(other._maxPoolSize),
+          _checkedOut(other._checkedOut),
+          _maxInUse(other._maxInUse),
+          _nextTicket(other._nextTicket) {
         verify(_created == 0);
         verify(other._pool.size() == 0);
+        verify(_checkedOut == 0);
+        verify(other._waiters.empty());
     }
 
     ~PoolForHost();
@@ -81,10 +95,30 @@ public:
         _maxPoolSize = maxPoolSize;
     }
 
+    /**
+     * Sets the maximum number of connections that may be checked out at once, past which
+     * checkouts wait in line for one to come back.
+     */
+    void setMaxInUse(int maxInUse) {
+        _maxInUse = maxInUse;
+    }
+
     int numAvailable() const {
         return (int)_pool.size();
     }
 
+    int numInUse() const {
+        return _checkedOut;
+    }
+
+    int numWaiting() const {
+        return (int)_waiters.size();
+    }
+
+    const LatencyHistogram& getCheckoutLatency() const {
+        return _checkoutLatency;
+    }
+
     void createdOne(DBClientBase* base);
     long long numCreated() const {
         return _created;
@@ -95,6 +129,25 @@ public:
         return _type;
     }
 
+    /**
+     * Waits, in first come first served order, until fewer than the maximum number of
+     * connections are checked out, then counts one more as checked out. Throws with
+     * ExceededTimeLimit if that takes longer than 'timeout'.
+     *
+     * 'lk' must hold the mutex guarding this pool.
+     */
+    void checkOut(Milliseconds timeout, stdx::unique_lock<stdx::mutex>& lk);
+
+    /**
+     * Counts a connection as no longer checked out, without returning it to the pool. Used when
+     * checked out connections are destroyed, or were never created.
+     */
+    void checkedOutGone();
+
+    void recordCheckoutLatency(uint64_t micros) {
+        _checkoutLatency.record(micros);
+    }
+
     /**
      * gets a connection or return NULL
      */
@@ -103,6 +156,9 @@ public:
     // Deletes all connections in the pool
     void clear();
 
+    /**
+     * Takes back a checked out connection.
+     */
     void done(DBConnectionPool* pool, DBClientBase* c);
 
     void flush();
@@ -145,6 +201,19 @@ private:
 
     // The maximum number of connections we'll save in the pool
     int _maxPoolSize;
+
+    // Connections handed out, or being created to be handed out, and not yet returned
+    int _checkedOut;
+
+    // The maximum value of _checkedOut, or kPoolSizeUnlimited
+    int _maxInUse;
+
+    // Tickets of the threads waiting in checkOut(), in arrival order
+    uint64_t _nextTicket;
+    std::deque<uint64_t> _waiters;
+    stdx::condition_variable _waitersCondition;
+
+    LatencyHistogram _checkoutLatency;
 };
 
 class DBConnectionHook {
@@ -201,6 +270,21 @@ public:
         _maxPoolSize = maxPoolSize;
     }
 
+    /**
+     * Sets the maximum number of connections per host that may be in use at once. Once a host
+     * reaches it, checkouts wait in line until a connection is returned, for at most the given
+     * timeout.
+     *
+     * As with the pool size, the limit is kept per PoolForHost, so a host used with several
+     * socket timeouts may have that many connections in use for each. Connections which a
+     * caller holds on to between uses, like ShardConnection's thread local cache does, count
+     * as in use until they are released.
+     */
+    void setMaxInUse(int maxInUse, Milliseconds waitTimeout) {
+        _maxInUse = maxInUse;
+        _waitTimeout = waitTimeout;
+    }
+
     void onCreate(DBClientBase* conn);
     void onHandedOut(DBClientBase* conn);
     void onDestroy(DBClientBase* conn);
@@ -213,6 +297,12 @@ public:
 
     void release(const std::string& host, DBClientBase* c);
 
+    /**
+     * Must be called instead of release() for connections that came from this pool, but are
+     * being destroyed rather than returned, so that they no longer count as in use.
+     */
+    void decrementEgress(const std::string& host, DBClientBase* c);
+
     void addHook(DBConnectionHook* hook);  // we take ownership
     void appendInfo(BSONObjBuilder& b);
 
@@ -248,9 +338,19 @@ public:
 private:
     DBConnectionPool(DBConnectionPool& p);
 
-    DBClientBase* _get(const std::string& ident, double socketTimeout);
+    /**
+     * Checks out a connection from the pool for 'ident', or returns NULL after reserving the
+     * right to create one. Either way, the caller must eventually release() or
+     * decrementEgress() it.
+     */
+    DBClientBase* _get(const std::string& ident, double socketTimeout, const Timer& timer);
 
-    DBClientBase* _finishCreate(const std::string& ident, double socketTimeout, DBClientBase* conn);
+    DBClientBase* _finishCreate(const std::string& ident,
+                                double socketTimeout,
+                                DBClientBase* conn,
+                                const Timer& timer);
+
+    void _checkedOutGone(const std::string& ident, double socketTimeout);
 
     struct PoolKey {
         PoolKey(const std::string& i, double t) : ident(i), timeout(t) {}
@@ -264,7 +364,25 @@ private:
 
     typedef std::map<PoolKey, PoolForHost, poolKeyCompare> PoolMap;  // servername -> pool
 
-    stdx::mutex _mutex;
+    /**
+     * The pools are spread over stripes by host, so that threads using different hosts don't
+     * contend for a lock.
+     */
+    struct Stripe {
+        stdx::mutex mutex;
+        PoolMap pools;
+    };
+
+    static const size_t kNumStripes = 16;
+
+    Stripe& _getStripe(const std::string& ident);
+
+    /**
+     * Returns the pool for the given key, creating it if needed. The stripe's mutex must be held.
+     */
+    PoolForHost& _getPool_inlock(Stripe* stripe, const std::string& ident, double socketTimeout);
+
+    Stripe _stripes[kNumStripes];
     std::string _name;
 
     // The maximum number of connections we'll save in the pool per-host
@@ -272,7 +390,10 @@ private:
     // 0 effectively disables the pool
     int _maxPoolSize;
 
-    PoolMap _pools;
+    // The maximum number of connections in use per host, and how long to wait for one when a
+    // host is at its maximum
+    int _maxInUse;
+    Milliseconds _waitTimeout;
 
     // pointers owned by me, right now they leak on shutdown
     // _hooks itself also leaks because it creates a shutdown race condition
@@ -363,10 +484,7 @@ public:
     /** Force closure of the connection.  You should call this if you leave it in
         a bad state.  Destructor will do this too, but it is verbose.
     */
-    void kill() {
-        delete _conn;
-        _conn = 0;
-    }
+    void kill();
 
     /** Call this when you are done with the connection.
 
@@ -144,6 +144,9 @@ DBClientReplicaSet::DBClientReplicaSet(const string& name,
 DBClientReplicaSet::~DBClientReplicaSet() {
     if (_lastSlaveOkConn.get() == _master.get()) {
         _lastSlaveOkConn.release();
+    } else {
+        // The pooled secondary connection is destroyed rather than returned
+        globalConnPool.decrementEgress(_lastSlaveOkHost.toString(), _lastSlaveOkConn.get());
     }
 }
 
@@ -33,6 +33,7 @@
 
 namespace mongo {
 class BSONObj;
+class SaslClientSession;
 
 /**
  * Attempts to authenticate "client" using the SASL protocol.
@@ -69,6 +70,19 @@ class BSONObj;
 extern Status (*saslClientAuthenticate)(DBClientWithCommands* client,
                                         const BSONObj& saslParameters);
 
+/**
+ * Configures "session" to perform the client side of a SASL conversation with the server on
+ * "hostname", authenticating against "targetDatabase", and initializes it. "saslParameters" is
+ * as for saslClientAuthenticate().
+ *
+ * For clients which run the saslStart and saslContinue commands themselves, such as
+ * asynchronous ones, rather than through saslClientAuthenticate().
+ */
+Status saslConfigureClientSession(SaslClientSession* session,
+                                  const std::string& hostname,
+                                  const std::string& targetDatabase,
+                                  const BSONObj& saslParameters);
+
 /**
  * Extracts the payload field from "cmdObj", and store it into "*payload".
  *
@@ -105,18 +105,12 @@ Status extractPassword(const BSONObj& saslParameters,
     return Status::OK();
 }
 
-/**
- * Configures "session" to perform the client side of a SASL conversation over connection
- * "client".
- *
- * "saslParameters" is a BSON document providing the necessary configuration information.
- *
- * Returns Status::OK() on success.
- */
-Status configureSession(SaslClientSession* session,
-                        DBClientWithCommands* client,
-                        const std::string& targetDatabase,
-                        const BSONObj& saslParameters) {
+}  // namespace
+
+Status saslConfigureClientSession(SaslClientSession* session,
+                                  const std::string& hostname,
+                                  const std::string& targetDatabase,
+                                  const BSONObj& saslParameters) {
     std::string mechanism;
     Status status =
         bsonExtractStringField(saslParameters, saslCommandMechanismFieldName, &mechanism);
@@ -131,10 +125,8 @@ Status configureSession(SaslClientSession* session,
         return status;
     session->setParameter(SaslClientSession::parameterServiceName, value);
 
-    status = bsonExtractStringFieldWithDefault(saslParameters,
-                                               saslCommandServiceHostnameFieldName,
-                                               HostAndPort(client->getServerAddress()).host(),
-                                               &value);
+    status = bsonExtractStringFieldWithDefault(
+        saslParameters, saslCommandServiceHostnameFieldName, hostname, &value);
     if (!status.isOK())
         return status;
     session->setParameter(SaslClientSession::parameterServiceHostname, value);
@@ -163,6 +155,8 @@ Status configureSession(SaslClientSession* session,
     return session->initialize();
 }
 
+namespace {
+
 /**
  * Driver for the client side of a sasl authentication session, conducted synchronously over
  * "client".
@@ -188,7 +182,10 @@ Status saslClientAuthenticateImpl(DBClientWithCommands* client, const BSONObj& s
     }
 
     std::unique_ptr<SaslClientSession> session(SaslClientSession::create(mechanism));
-    status = configureSession(session.get(), client, targetDatabase, saslParameters);
+    status = saslConfigureClientSession(session.get(),
+                                        HostAndPort(client->getServerAddress()).host(),
+                                        targetDatabase,
+                                        saslParameters);
 
     if (!status.isOK())
         return status;
@@ -34,6 +34,7 @@
 
 #include "mongo/base/parse_number.h"
 #include "mongo/client/sasl_client_session.h"
+#include "mongo/client/scram_sha1_client_cache.h"
 #include "mongo/platform/random.h"
 #include "mongo/util/base64.h"
 #include "mongo/util/mongoutils/str.h"
@@ -50,8 +51,8 @@ SaslSCRAMSHA1ClientConversation::SaslSCRAMSHA1ClientConversation(
     : SaslClientConversation(saslClientSession), _step(0), _authMessage(""), _clientNonce("") {}
 
 SaslSCRAMSHA1ClientConversation::~SaslSCRAMSHA1ClientConversation() {
-    // clear the _saltedPassword memory
-    memset(_saltedPassword, 0, scram::hashSize);
+    // clear the _secrets memory
+    memset(&_secrets, 0, sizeof(_secrets));
 }
 
 StatusWith<bool> SaslSCRAMSHA1ClientConversation::step(StringData inputData,
@@ -178,14 +179,25 @@ StatusWith<bool> SaslSCRAMSHA1ClientConversation::_secondStep(const std::vector<
         return StatusWith<bool>(ex.toStatus());
     }
 
-    scram::generateSaltedPassword(
-        _saslClientSession->getParameter(SaslClientSession::parameterPassword),
-        reinterpret_cast<const unsigned char*>(decodedSalt.c_str()),
-        decodedSalt.size(),
-        iterationCount,
-        _saltedPassword);
+    // Deriving the keys is deliberately expensive, so reuse them when this process already
+    // authenticated the same user with the same salt and iteration count.
+    StringData user = _saslClientSession->getParameter(SaslClientSession::parameterUser);
+    StringData password = _saslClientSession->getParameter(SaslClientSession::parameterPassword);
+    SCRAMSHA1ClientCache* cache = getGlobalSCRAMSHA1ClientCache();
+    if (!cache->getCachedSecrets(user, password, salt, iterationCount, &_secrets)) {
+        unsigned char saltedPassword[scram::hashSize];
+        scram::generateSaltedPassword(password,
+                                      reinterpret_cast<const unsigned char*>(decodedSalt.c_str()),
+                                      decodedSalt.size(),
+                                      iterationCount,
+                                      saltedPassword);
+        scram::generateClientAndServerKeys(saltedPassword, &_secrets);
+        memset(saltedPassword, 0, scram::hashSize);
+
+        cache->setCachedSecrets(user, password, salt, iterationCount, _secrets);
+    }
 
-    std::string clientProof = scram::generateClientProof(_saltedPassword, _authMessage);
+    std::string clientProof = scram::generateClientProof(_secrets.clientKey, _authMessage);
 
     StringBuilder sb;
     sb << "c=biws,r=" << nonce << ",p=" << clientProof;
@@ -224,7 +236,7 @@ StatusWith<bool> SaslSCRAMSHA1ClientConversation::_thirdStep(const std::vector<s
     }
 
     bool validServerSignature =
-        scram::verifyServerSignature(_saltedPassword, _authMessage, input[0].substr(2));
+        scram::verifyServerSignature(_secrets.serverKey, _authMessage, input[0].substr(2));
 
     if (!validServerSignature) {
         *outputData = "e=Invalid server signature";
@@ -79,7 +79,7 @@ private:
 
     int _step;
     std::string _authMessage;
-    unsigned char _saltedPassword[scram::hashSize];
+    scram::SCRAMSecrets _secrets;
 
     // client and server nonce concatenated
     std::string _clientNonce;
@@ -257,6 +257,7 @@ public:
         delete _dummyServer;
 
         globalConnPool.setMaxPoolSize(_maxPoolSizePerHost);
+        globalConnPool.setMaxInUse(PoolForHost::kPoolSizeUnlimited, Milliseconds(0));
     }
 
 protected:
@@ -268,6 +269,12 @@ protected:
         ASSERT_NOT_EQUALS(a, b);
     }
 
+    static BSONObj getPoolStats() {
+        BSONObjBuilder builder;
+        globalConnPool.appendInfo(builder);
+        return builder.obj();
+    }
+
     /**
      * Tries to grab a series of connections from the pool, perform checks on
      * them, then put them back into the globalConnPool. After that, it checks these
@@ -436,5 +443,68 @@ TEST_F(DummyServerFixture, DontReturnConnGoneBadToPool) {
     conn1Again.done();
 }
 
+TEST_F(DummyServerFixture, CheckoutTimesOutAtMaxInUse) {
+    globalConnPool.setMaxInUse(1, Milliseconds(10));
+
+    ScopedDbConnection conn1(TARGET_HOST);
+    ASSERT_THROWS_CODE(
+        ScopedDbConnection(TARGET_HOST), UserException, ErrorCodes::ExceededTimeLimit);
+    ASSERT_EQUALS(0, getPoolStats()["totalWaiting"].numberInt());
+
+    conn1.done();
+
+    ScopedDbConnection conn2(TARGET_HOST);
+    conn2.done();
+}
+
+TEST_F(DummyServerFixture, WaiterGetsReturnedConnection) {
+    globalConnPool.setMaxInUse(1, Milliseconds(20 * 1000));
+
+    ScopedDbConnection conn1(TARGET_HOST);
+    DBClientBase* conn1Ptr = conn1.get();
+
+    DBClientBase* waiterConnPtr = NULL;
+    stdx::thread waiter([&waiterConnPtr] {
+        ScopedDbConnection conn2(TARGET_HOST);
+        waiterConnPtr = conn2.get();
+        conn2.done();
+    });
+
+    Timer timer;
+    while (getPoolStats()["totalWaiting"].numberInt() == 0) {
+        ASSERT_LESS_THAN(timer.seconds(), 20);
+        sleepmillis(1);
+    }
+
+    conn1.done();
+    waiter.join();
+
+    ASSERT_EQUALS(conn1Ptr, waiterConnPtr);
+    ASSERT_EQUALS(0, getPoolStats()["totalInUse"].numberInt());
+}
+
+TEST_F(DummyServerFixture, KilledConnectionIsNoLongerInUse) {
+    globalConnPool.setMaxInUse(1, Milliseconds(10));
+
+    {
+        ScopedDbConnection conn1(TARGET_HOST);
+        conn1.kill();
+    }
+
+    ScopedDbConnection conn2(TARGET_HOST);
+    conn2.done();
+}
+
+TEST_F(DummyServerFixture, ReportsCheckoutLatency) {
+    const long long before = getPoolStats()["checkoutLatency"]["ops"].numberLong();
+
+    ScopedDbConnection conn1(TARGET_HOST);
+    conn1.done();
+    ScopedDbConnection conn2(TARGET_HOST);
+    conn2.done();
+
+    ASSERT_EQUALS(before + 2, getPoolStats()["checkoutLatency"]["ops"].numberLong());
+}
+
 }  // namespace
 }  // namespace mongo
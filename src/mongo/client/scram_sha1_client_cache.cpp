@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/client/scram_sha1_client_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mongo {
+namespace {
+
+SCRAMSHA1ClientCache globalSCRAMSHA1ClientCache;
+
+}  // namespace
+
+const size_t SCRAMSHA1ClientCache::kMaxEntries;
+
+SCRAMSHA1ClientCache::Entry::~Entry() {
+    memset(&secrets, 0, sizeof(secrets));
+    std::fill(hashedPassword.begin(), hashedPassword.end(), '\0');
+}
+
+bool SCRAMSHA1ClientCache::getCachedSecrets(StringData user,
+                                            StringData hashedPassword,
+                                            StringData salt,
+                                            int iterationCount,
+                                            scram::SCRAMSecrets* secrets) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    EntryMap::const_iterator it =
+        _entries.find(Key(user.toString(), salt.toString(), iterationCount));
+    if (it == _entries.end() || hashedPassword != it->second.hashedPassword) {
+        return false;
+    }
+    _lruKeys.splice(_lruKeys.begin(), _lruKeys, it->second.lruPosition);
+    *secrets = it->second.secrets;
+    return true;
+}
+
+void SCRAMSHA1ClientCache::setCachedSecrets(StringData user,
+                                            StringData hashedPassword,
+                                            StringData salt,
+                                            int iterationCount,
+                                            const scram::SCRAMSecrets& secrets) {
+    Key key(user.toString(), salt.toString(), iterationCount);
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    EntryMap::iterator it = _entries.find(key);
+    if (it == _entries.end()) {
+        if (_entries.size() >= kMaxEntries) {
+            _entries.erase(_lruKeys.back());
+            _lruKeys.pop_back();
+        }
+        it = _entries.insert(EntryMap::value_type(key, Entry())).first;
+        it->second.lruPosition = _lruKeys.insert(_lruKeys.begin(), key);
+    } else {
+        _lruKeys.splice(_lruKeys.begin(), _lruKeys, it->second.lruPosition);
+        std::fill(it->second.hashedPassword.begin(), it->second.hashedPassword.end(), '\0');
+    }
+    it->second.hashedPassword = hashedPassword.toString();
+    it->second.secrets = secrets;
+}
+
+void SCRAMSHA1ClientCache::clear() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _entries.clear();
+    _lruKeys.clear();
+}
+
+size_t SCRAMSHA1ClientCache::size() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _entries.size();
+}
+
+SCRAMSHA1ClientCache* getGlobalSCRAMSHA1ClientCache() {
+    return &globalSCRAMSHA1ClientCache;
+}
+
+}  // namespace mongo
@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/crypto/mechanism_scram.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+/**
+ * Cache of the ClientKey and ServerKey a client derived for SCRAM-SHA-1 conversations.
+ *
+ * Deriving the keys runs PBKDF2 with the user's iteration count, which dominates the client
+ * side cost of authenticating. Servers send the same salt and iteration count for a user until
+ * the user's credentials change, so a client that reconnects repeatedly, such as a mongos or a
+ * driver with a connection storm after a restart, can reuse the keys it already derived.
+ *
+ * Entries are keyed on user name, salt and iteration count, and also remember the password
+ * digest they were derived from, so that a changed password is never answered from the cache.
+ * The secrets and digest of an entry are zeroed when it is replaced, evicted or cleared.
+ *
+ * This type is thread-safe.
+ */
+class SCRAMSHA1ClientCache {
+    MONGO_DISALLOW_COPYING(SCRAMSHA1ClientCache);
+
+public:
+    /**
+     * Beyond this many entries, storing new secrets evicts the least recently used entry.
+     */
+    static const size_t kMaxEntries = 100;
+
+    SCRAMSHA1ClientCache() = default;
+
+    /**
+     * Copies the secrets cached for these credentials into "secrets" and returns true, or
+     * returns false if there are none.
+     */
+    bool getCachedSecrets(StringData user,
+                          StringData hashedPassword,
+                          StringData salt,
+                          int iterationCount,
+                          scram::SCRAMSecrets* secrets) const;
+
+    /**
+     * Caches "secrets" for these credentials, replacing any existing entry for the same user,
+     * salt and iteration count.
+     */
+    void setCachedSecrets(StringData user,
+                          StringData hashedPassword,
+                          StringData salt,
+                          int iterationCount,
+                          const scram::SCRAMSecrets& secrets);
+
+    /**
+     * Forgets all cached secrets.
+     */
+    void clear();
+
+    size_t size() const;
+
+private:
+    typedef std::tuple<std::string, std::string, int> Key;
+
+    struct Entry {
+        ~Entry();
+
+        std::string hashedPassword;
+        scram::SCRAMSecrets secrets;
+
+        // Where the entry's key is in _lruKeys
+        std::list<Key>::iterator lruPosition;
+    };
+
+    typedef std::map<Key, Entry> EntryMap;
+
+    mutable stdx::mutex _mutex;
+    EntryMap _entries;
+
+    // The keys of all entries, most recently used first
+    mutable std::list<Key> _lruKeys;
+};
+
+/**
+ * Returns the cache shared by all SCRAM-SHA-1 client conversations in this process.
+ */
+SCRAMSHA1ClientCache* getGlobalSCRAMSHA1ClientCache();
+
+}  // namespace mongo
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/client/scram_sha1_client_cache.h"
+
+#include <cstring>
+
+#include "mongo/client/scram_sha1_client_test_utils.h"
+#include "mongo/crypto/mechanism_scram.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/password_digest.h"
+
+namespace mongo {
+namespace {
+
+scram::SCRAMSecrets makeSecrets(unsigned char fill) {
+    scram::SCRAMSecrets secrets;
+    memset(secrets.clientKey, fill, scram::hashSize);
+    memset(secrets.serverKey, fill + 1, scram::hashSize);
+    return secrets;
+}
+
+void assertSecretsEqual(const scram::SCRAMSecrets& expected, const scram::SCRAMSecrets& actual) {
+    ASSERT_EQUALS(0, memcmp(expected.clientKey, actual.clientKey, scram::hashSize));
+    ASSERT_EQUALS(0, memcmp(expected.serverKey, actual.serverKey, scram::hashSize));
+}
+
+TEST(SCRAMSHA1ClientCache, ReturnsSecretsForMatchingCredentials) {
+    SCRAMSHA1ClientCache cache;
+    scram::SCRAMSecrets secrets;
+    ASSERT_FALSE(cache.getCachedSecrets("user", "digest", "salt", 10000, &secrets));
+
+    const scram::SCRAMSecrets stored = makeSecrets(1);
+    cache.setCachedSecrets("user", "digest", "salt", 10000, stored);
+    ASSERT_TRUE(cache.getCachedSecrets("user", "digest", "salt", 10000, &secrets));
+    assertSecretsEqual(stored, secrets);
+}
+
+TEST(SCRAMSHA1ClientCache, MissesOnAnyCredentialChange) {
+    SCRAMSHA1ClientCache cache;
+    cache.setCachedSecrets("user", "digest", "salt", 10000, makeSecrets(1));
+
+    scram::SCRAMSecrets secrets;
+    ASSERT_FALSE(cache.getCachedSecrets("other", "digest", "salt", 10000, &secrets));
+    ASSERT_FALSE(cache.getCachedSecrets("user", "newDigest", "salt", 10000, &secrets));
+    ASSERT_FALSE(cache.getCachedSecrets("user", "digest", "newSalt", 10000, &secrets));
+    ASSERT_FALSE(cache.getCachedSecrets("user", "digest", "salt", 20000, &secrets));
+}
+
+TEST(SCRAMSHA1ClientCache, NewPasswordReplacesEntry) {
+    SCRAMSHA1ClientCache cache;
+    cache.setCachedSecrets("user", "digest", "salt", 10000, makeSecrets(1));
+    const scram::SCRAMSecrets stored = makeSecrets(5);
+    cache.setCachedSecrets("user", "newDigest", "salt", 10000, stored);
+    ASSERT_EQUALS(1U, cache.size());
+
+    scram::SCRAMSecrets secrets;
+    ASSERT_FALSE(cache.getCachedSecrets("user", "digest", "salt", 10000, &secrets));
+    ASSERT_TRUE(cache.getCachedSecrets("user", "newDigest", "salt", 10000, &secrets));
+    assertSecretsEqual(stored, secrets);
+}
+
+TEST(SCRAMSHA1ClientCache, SizeIsBounded) {
+    SCRAMSHA1ClientCache cache;
+    for (size_t i = 0; i < SCRAMSHA1ClientCache::kMaxEntries * 2; ++i) {
+        cache.setCachedSecrets("user", "digest", "salt", static_cast<int>(i), makeSecrets(1));
+    }
+    ASSERT_EQUALS(SCRAMSHA1ClientCache::kMaxEntries, cache.size());
+
+    cache.clear();
+    ASSERT_EQUALS(0U, cache.size());
+}
+
+TEST(SCRAMSHA1ClientCache, EvictsLeastRecentlyUsed) {
+    SCRAMSHA1ClientCache cache;
+    for (size_t i = 0; i < SCRAMSHA1ClientCache::kMaxEntries; ++i) {
+        cache.setCachedSecrets("user", "digest", "salt", static_cast<int>(i), makeSecrets(1));
+    }
+
+    // Using the oldest entry keeps it, so the next oldest goes instead.
+    scram::SCRAMSecrets secrets;
+    ASSERT_TRUE(cache.getCachedSecrets("user", "digest", "salt", 0, &secrets));
+    cache.setCachedSecrets("user", "digest", "salt", -1, makeSecrets(1));
+
+    ASSERT_EQUALS(SCRAMSHA1ClientCache::kMaxEntries, cache.size());
+    ASSERT_TRUE(cache.getCachedSecrets("user", "digest", "salt", 0, &secrets));
+    ASSERT_FALSE(cache.getCachedSecrets("user", "digest", "salt", 1, &secrets));
+    ASSERT_TRUE(cache.getCachedSecrets("user", "digest", "salt", 2, &secrets));
+    ASSERT_TRUE(cache.getCachedSecrets("user", "digest", "salt", -1, &secrets));
+}
+
+TEST(SCRAMSHA1ClientCache, ConversationReusesDerivedKeys) {
+    SCRAMSHA1ClientCache* cache = getGlobalSCRAMSHA1ClientCache();
+    cache->clear();
+
+    const std::string digest = createPasswordDigest("user", "pencil");
+    const BSONObj creds = scram::generateCredentials(digest, 10000);
+    ASSERT_OK(runSCRAMSHA1Conversation("user", digest, creds));
+    ASSERT_EQUALS(1U, cache->size());
+
+    ASSERT_OK(runSCRAMSHA1Conversation("user", digest, creds));
+    ASSERT_EQUALS(1U, cache->size());
+
+    // New credentials for the same user get a new salt, so they never hit the old entry.
+    const BSONObj newCreds = scram::generateCredentials(digest, 10000);
+    ASSERT_OK(runSCRAMSHA1Conversation("user", digest, newCreds));
+    ASSERT_EQUALS(2U, cache->size());
+
+    cache->clear();
+}
+
+TEST(SCRAMSHA1ClientCache, ConversationWithWrongPasswordFails) {
+    const BSONObj creds =
+        scram::generateCredentials(createPasswordDigest("user", "pencil"), 10000);
+    ASSERT_NOT_OK(runSCRAMSHA1Conversation("user", createPasswordDigest("user", "crayon"), creds));
+    getGlobalSCRAMSHA1ClientCache()->clear();
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/client/scram_sha1_client_test_utils.h"
+
+#include <string>
+
+#include "mongo/client/native_sasl_client_session.h"
+#include "mongo/crypto/mechanism_scram.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/base64.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+Status runSCRAMSHA1Conversation(StringData user,
+                                StringData hashedPassword,
+                                const BSONObj& creds) {
+    NativeSaslClientSession session;
+    session.setParameter(SaslClientSession::parameterServiceName, "mongodb");
+    session.setParameter(SaslClientSession::parameterServiceHostname, "localhost");
+    session.setParameter(SaslClientSession::parameterMechanism, "SCRAM-SHA-1");
+    session.setParameter(SaslClientSession::parameterUser, user);
+    session.setParameter(SaslClientSession::parameterPassword, hashedPassword);
+    Status status = session.initialize();
+    if (!status.isOK()) {
+        return status;
+    }
+
+    std::string clientFirst;
+    status = session.step("", &clientFirst);
+    if (!status.isOK()) {
+        return status;
+    }
+    const std::string clientFirstBare = clientFirst.substr(3);
+    const std::string nonce = clientFirstBare.substr(clientFirstBare.find(",r=") + 3) + "srv";
+
+    const std::string serverFirst = str::stream()
+        << "r=" << nonce << ",s=" << creds[scram::saltFieldName].String()
+        << ",i=" << creds[scram::iterationCountFieldName].Int();
+    std::string clientFinal;
+    status = session.step(serverFirst, &clientFinal);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    const std::string authMessage = clientFirstBare + "," + serverFirst + "," +
+        clientFinal.substr(0, clientFinal.find(",p="));
+    const std::string serverKey = base64::decode(creds[scram::serverKeyFieldName].String());
+    const std::string serverFinal = "v=" +
+        scram::generateServerSignature(reinterpret_cast<const unsigned char*>(serverKey.c_str()),
+                                       authMessage);
+    std::string output;
+    return session.step(serverFinal, &output);
+}
+
+}  // namespace mongo
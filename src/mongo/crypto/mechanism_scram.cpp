@@ -94,40 +94,47 @@ void generateSaltedPassword(StringData hashedPassword,
                   saltedPassword);
 }
 
-void generateSecrets(const std::string& hashedPassword,
-                     const unsigned char salt[],
-                     size_t saltLen,
-                     size_t iterationCount,
-                     unsigned char storedKey[hashSize],
-                     unsigned char serverKey[hashSize]) {
-    unsigned char saltedPassword[hashSize];
-    unsigned char clientKey[hashSize];
+void generateClientAndServerKeys(const unsigned char saltedPassword[hashSize],
+                                 SCRAMSecrets* secrets) {
     unsigned int hashLen = 0;
 
-    generateSaltedPassword(hashedPassword, salt, saltLen, iterationCount, saltedPassword);
-
     // clientKey = HMAC(saltedPassword, "Client Key")
     fassert(17498,
             crypto::hmacSha1(saltedPassword,
                              hashSize,
                              reinterpret_cast<const unsigned char*>(clientKeyConst.data()),
                              clientKeyConst.size(),
-                             clientKey,
+                             secrets->clientKey,
                              &hashLen));
 
-    // storedKey = H(clientKey)
-    fassert(17499, crypto::sha1(clientKey, hashSize, storedKey));
-
     // serverKey = HMAC(saltedPassword, "Server Key")
     fassert(17500,
             crypto::hmacSha1(saltedPassword,
                              hashSize,
                              reinterpret_cast<const unsigned char*>(serverKeyConst.data()),
                              serverKeyConst.size(),
-                             serverKey,
+                             secrets->serverKey,
                              &hashLen));
 }
 
+void generateSecrets(const std::string& hashedPassword,
+                     const unsigned char salt[],
+                     size_t saltLen,
+                     size_t iterationCount,
+                     unsigned char storedKey[hashSize],
+                     unsigned char serverKey[hashSize]) {
+    unsigned char saltedPassword[hashSize];
+    SCRAMSecrets secrets;
+
+    generateSaltedPassword(hashedPassword, salt, saltLen, iterationCount, saltedPassword);
+    generateClientAndServerKeys(saltedPassword, &secrets);
+
+    // storedKey = H(clientKey)
+    fassert(17499, crypto::sha1(secrets.clientKey, hashSize, storedKey));
+
+    memcpy(serverKey, secrets.serverKey, hashSize);
+}
+
 BSONObj generateCredentials(const std::string& hashedPassword, int iterationCount) {
     const int saltLenQWords = 2;
 
@@ -160,18 +167,9 @@ BSONObj generateCredentials(const std::string& hashedPassword, int iterationCoun
                                         << serverKeyFieldName << encodedServerKey);
 }
 
-std::string generateClientProof(const unsigned char saltedPassword[hashSize],
+std::string generateClientProof(const unsigned char clientKey[hashSize],
                                 const std::string& authMessage) {
-    // ClientKey := HMAC(saltedPassword, "Client Key")
-    unsigned char clientKey[hashSize];
     unsigned int hashLen = 0;
-    fassert(18689,
-            crypto::hmacSha1(saltedPassword,
-                             hashSize,
-                             reinterpret_cast<const unsigned char*>(clientKeyConst.data()),
-                             clientKeyConst.size(),
-                             clientKey,
-                             &hashLen));
 
     // StoredKey := H(clientKey)
     unsigned char storedKey[hashSize];
@@ -196,19 +194,9 @@ std::string generateClientProof(const unsigned char saltedPassword[hashSize],
     return base64::encode(reinterpret_cast<char*>(clientProof), hashSize);
 }
 
-bool verifyServerSignature(const unsigned char saltedPassword[hashSize],
-                           const std::string& authMessage,
-                           const std::string& receivedServerSignature) {
-    // ServerKey       := HMAC(SaltedPassword, "Server Key")
+std::string generateServerSignature(const unsigned char serverKey[hashSize],
+                                    const std::string& authMessage) {
     unsigned int hashLen;
-    unsigned char serverKey[hashSize];
-    fassert(18703,
-            crypto::hmacSha1(saltedPassword,
-                             hashSize,
-                             reinterpret_cast<const unsigned char*>(serverKeyConst.data()),
-                             serverKeyConst.size(),
-                             serverKey,
-                             &hashLen));
 
     // ServerSignature := HMAC(ServerKey, AuthMessage)
     unsigned char serverSignature[hashSize];
@@ -220,9 +208,13 @@ bool verifyServerSignature(const unsigned char saltedPassword[hashSize],
                              serverSignature,
                              &hashLen));
 
-    std::string encodedServerSignature =
-        base64::encode(reinterpret_cast<char*>(serverSignature), sizeof(serverSignature));
-    return (receivedServerSignature == encodedServerSignature);
+    return base64::encode(reinterpret_cast<char*>(serverSignature), sizeof(serverSignature));
+}
+
+bool verifyServerSignature(const unsigned char serverKey[hashSize],
+                           const std::string& authMessage,
+                           const std::string& receivedServerSignature) {
+    return (receivedServerSignature == generateServerSignature(serverKey, authMessage));
 }
 
 }  // namespace scram
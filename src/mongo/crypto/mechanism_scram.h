@@ -45,6 +45,15 @@ const std::string saltFieldName = "salt";
 const std::string storedKeyFieldName = "storedKey";
 const std::string serverKeyFieldName = "serverKey";
 
+/*
+ * The ClientKey and ServerKey derived from a SaltedPassword. Together they are all a client
+ * needs to take part in a SCRAM conversation, so they should be treated like the password.
+ */
+struct SCRAMSecrets {
+    unsigned char clientKey[hashSize];
+    unsigned char serverKey[hashSize];
+};
+
 /*
  * Computes the SaltedPassword from password, salt and iterationCount.
  */
@@ -54,6 +63,12 @@ void generateSaltedPassword(StringData hashedPassword,
                             const int iterationCount,
                             unsigned char saltedPassword[hashSize]);
 
+/*
+ * Computes the ClientKey and ServerKey from SaltedPassword (client side).
+ */
+void generateClientAndServerKeys(const unsigned char saltedPassword[hashSize],
+                                 SCRAMSecrets* secrets);
+
 /*
  * Computes the SCRAM secrets storedKey and serverKey using the salt 'salt'
  * and iteration count 'iterationCount' as defined in RFC5802 (server side).
@@ -72,9 +87,9 @@ void generateSecrets(const std::string& hashedPassword,
 BSONObj generateCredentials(const std::string& hashedPassword, int iterationCount);
 
 /*
- * Computes the ClientProof from SaltedPassword and authMessage (client side).
+ * Computes the ClientProof from ClientKey and authMessage (client side).
  */
-std::string generateClientProof(const unsigned char saltedPassword[hashSize],
+std::string generateClientProof(const unsigned char clientKey[hashSize],
                                 const std::string& authMessage);
 
 /*
@@ -87,9 +102,15 @@ bool validatePassword(const std::string& hashedPassword,
                       const std::string& storedKey);
 
 /*
- * Verifies ServerSignature (client side).
+ * Computes the base64 encoded ServerSignature from ServerKey and authMessage.
+ */
+std::string generateServerSignature(const unsigned char serverKey[hashSize],
+                                    const std::string& authMessage);
+
+/*
+ * Verifies ServerSignature against ServerKey and authMessage (client side).
  */
-bool verifyServerSignature(const unsigned char saltedPassword[hashSize],
+bool verifyServerSignature(const unsigned char serverKey[hashSize],
                            const std::string& authMessage,
                            const std::string& serverSignature);
 }  // namespace scram
@@ -36,6 +36,7 @@
 #include <string>
 #include <vector>
 
+#include "mongo/base/counter.h"
 #include "mongo/base/init.h"
 #include "mongo/base/status.h"
 #include "mongo/bson/mutable/document.h"
@@ -52,14 +53,19 @@
 #include "mongo/db/auth/user_document_parser.h"
 #include "mongo/db/auth/user_name.h"
 #include "mongo/db/auth/user_name_hash.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/latency_histogram_metric.h"
 #include "mongo/platform/compiler.h"
 #include "mongo/platform/unordered_map.h"
+#include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -114,136 +120,54 @@ const int AuthorizationManager::schemaVersion26Final;
 const int AuthorizationManager::schemaVersion28SCRAM;
 #endif
 
-/**
- * Guard object for synchronizing accesses to data cached in AuthorizationManager instances.
- * This guard allows one thread to access the cache at a time, and provides an exception-safe
- * mechanism for a thread to release the cache mutex while performing network or disk operations
- * while allowing other readers to proceed.
- *
- * There are two ways to use this guard.  One may simply instantiate the guard like a
- * std::lock_guard, and perform reads or writes of the cache.
- *
- * Alternatively, one may instantiate the guard, examine the cache, and then enter into an
- * update mode by first wait()ing until otherUpdateInFetchPhase() is false, and then
- * calling beginFetchPhase().  At this point, other threads may acquire the guard in the simple
- * manner and do reads, but other threads may not enter into a fetch phase.  During the fetch
- * phase, the thread should perform required network or disk activity to determine what update
- * it will make to the cache.  Then, it should call endFetchPhase(), to reacquire the user cache
- * mutex.  At that point, the thread can make its modifications to the cache and let the guard
- * go out of scope.
- *
- * All updates by guards using a fetch-phase are totally ordered with respect to one another,
- * and all guards using no fetch phase are totally ordered with respect to one another, but
- * there is not a total ordering among all guard objects.
- *
- * The cached data has an associated counter, called the cache generation.  If the cache
- * generation changes while a guard is in fetch phase, the fetched data should not be stored
- * into the cache, because some invalidation event occurred during the fetch phase.
- *
- * NOTE: It is not safe to enter fetch phase while holding a database lock.  Fetch phase
- * operations are allowed to acquire database locks themselves, so entering fetch while holding
- * a database lock may lead to deadlock.
- */
-class AuthorizationManager::CacheGuard {
-    MONGO_DISALLOW_COPYING(CacheGuard);
-
-public:
-    enum FetchSynchronization { fetchSynchronizationAutomatic, fetchSynchronizationManual };
-
-    /**
-     * Constructs a cache guard, locking the mutex that synchronizes user cache accesses.
-     */
-    CacheGuard(AuthorizationManager* authzManager,
-               const FetchSynchronization sync = fetchSynchronizationAutomatic)
-        : _isThisGuardInFetchPhase(false),
-          _authzManager(authzManager),
-          _lock(authzManager->_cacheMutex) {
-        if (fetchSynchronizationAutomatic == sync) {
-            synchronizeWithFetchPhase();
-        }
-    }
+namespace {
 
-    /**
-     * Releases the mutex that synchronizes user cache access, if held, and notifies
-     * any threads waiting for their own opportunity to update the user cache.
-     */
-    ~CacheGuard() {
-        if (!_lock.owns_lock()) {
-            _lock.lock();
-        }
-        if (_isThisGuardInFetchPhase) {
-            fassert(17190, _authzManager->_isFetchPhaseBusy);
-            _authzManager->_isFetchPhaseBusy = false;
-            _authzManager->_fetchPhaseIsReady.notify_all();
-        }
-    }
+// Cached users older than this are reread before being handed out. 0 means they never expire.
+MONGO_EXPORT_SERVER_PARAMETER(userCacheMaxAgeSecs, int, 0);
+
+Counter64 userCacheHits;
+Counter64 userCacheMisses;
+Counter64 userCacheFetchWaits;
+Counter64 userCacheRefreshes;
+Counter64 userCacheExpirations;
+
+ServerStatusMetricField<Counter64> displayUserCacheHits("userCache.hits", &userCacheHits);
+ServerStatusMetricField<Counter64> displayUserCacheMisses("userCache.misses", &userCacheMisses);
+ServerStatusMetricField<Counter64> displayUserCacheFetchWaits("userCache.fetchWaits",
+                                                              &userCacheFetchWaits);
+ServerStatusMetricField<Counter64> displayUserCacheRefreshes("userCache.refreshes",
+                                                             &userCacheRefreshes);
+ServerStatusMetricField<Counter64> displayUserCacheExpirations("userCache.expirations",
+                                                               &userCacheExpirations);
 
-    /**
-     * Returns true of the authzManager reports that it is in fetch phase.
-     */
-    bool otherUpdateInFetchPhase() {
-        return _authzManager->_isFetchPhaseBusy;
-    }
-
-    /**
-     * Waits on the _authzManager->_fetchPhaseIsReady condition.
-     */
-    void wait() {
-        fassert(17222, !_isThisGuardInFetchPhase);
-        _authzManager->_fetchPhaseIsReady.wait(_lock);
-    }
-
-    /**
-     * Enters fetch phase, releasing the _authzManager->_cacheMutex after recording the current
-     * cache generation.
-     */
-    void beginFetchPhase() {
-        fassert(17191, !_authzManager->_isFetchPhaseBusy);
-        _isThisGuardInFetchPhase = true;
-        _authzManager->_isFetchPhaseBusy = true;
-        _startGeneration = _authzManager->_cacheGeneration;
-        _lock.unlock();
-    }
-
-    /**
-     * Exits the fetch phase, reacquiring the _authzManager->_cacheMutex.
-     */
-    void endFetchPhase() {
-        _lock.lock();
-        // We do not clear _authzManager->_isFetchPhaseBusy or notify waiters until
-        // ~CacheGuard(), for two reasons.  First, there's no value to notifying the waiters
-        // before you're ready to release the mutex, because they'll just go to sleep on the
-        // mutex.  Second, in order to meaningfully check the preconditions of
-        // isSameCacheGeneration(), we need a state that means "fetch phase was entered and now
-        // has been exited."  That state is _isThisGuardInFetchPhase == true and
-        // _lock.owns_lock() == true.
-    }
-
-    /**
-     * Returns true if _authzManager->_cacheGeneration remained the same while this guard was
-     * in fetch phase.  Behavior is undefined if this guard never entered fetch phase.
-     *
-     * If this returns true, do not update the cached data with this
-     */
-    bool isSameCacheGeneration() const {
-        fassert(17223, _isThisGuardInFetchPhase);
-        fassert(17231, _lock.owns_lock());
-        return _startGeneration == _authzManager->_cacheGeneration;
-    }
-
-private:
-    void synchronizeWithFetchPhase() {
-        while (otherUpdateInFetchPhase())
-            wait();
-        fassert(17192, !_authzManager->_isFetchPhaseBusy);
-        _isThisGuardInFetchPhase = true;
-        _authzManager->_isFetchPhaseBusy = true;
-    }
-
-    OID _startGeneration;
-    bool _isThisGuardInFetchPhase;
-    AuthorizationManager* _authzManager;
-    stdx::unique_lock<stdx::mutex> _lock;
+// Latencies of reading user descriptions, both for cache misses and refreshes
+LatencyHistogramMetric fetchLatency("userCache.fetchLatency");
+
+}  // namespace
+
+struct AuthorizationManager::UserFetch {
+    explicit UserFetch(uint64_t generation)
+        : fullInvalidationGeneration(generation),
+          invalidated(false),
+          done(false),
+          numWaiters(0),
+          status(Status::OK()),
+          user(NULL) {}
+
+    // _fullInvalidationGeneration when the read started
+    const uint64_t fullInvalidationGeneration;
+
+    // Set if the user is invalidated by name while being read
+    bool invalidated;
+
+    bool done;
+    int numWaiters;
+    Status status;
+
+    // On success, holds a reference for each waiter
+    User* user;
+
+    stdx::condition_variable doneCondition;
 };
 
 AuthorizationManager::AuthorizationManager(std::unique_ptr<AuthzManagerExternalState> externalState)
@@ -251,15 +175,14 @@ AuthorizationManager::AuthorizationManager(std::unique_ptr<AuthzManagerExternalS
       _privilegeDocsExist(false),
       _externalState(std::move(externalState)),
       _version(schemaVersionInvalid),
-      _isFetchPhaseBusy(false) {
+      _fullInvalidationGeneration(0) {
     _updateCacheGeneration_inlock();
 }
 
 AuthorizationManager::~AuthorizationManager() {
-    for (unordered_map<UserName, User*>::iterator it = _userCache.begin(); it != _userCache.end();
-         ++it) {
-        fassert(17265, it->second != internalSecurity.user);
-        delete it->second;
+    for (UserCache::iterator it = _userCache.begin(); it != _userCache.end(); ++it) {
+        fassert(17265, it->second.user != internalSecurity.user);
+        delete it->second.user;
     }
 }
 
@@ -269,14 +192,13 @@ std::unique_ptr<AuthorizationSession> AuthorizationManager::makeAuthorizationSes
 }
 
 Status AuthorizationManager::getAuthorizationVersion(OperationContext* txn, int* version) {
-    CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
+    stdx::unique_lock<stdx::mutex> lk(_cacheMutex);
     int newVersion = _version;
     if (schemaVersionInvalid == newVersion) {
-        while (guard.otherUpdateInFetchPhase())
-            guard.wait();
-        guard.beginFetchPhase();
+        const uint64_t startGeneration = _fullInvalidationGeneration;
+        lk.unlock();
         Status status = _externalState->getStoredAuthorizationVersion(txn, &newVersion);
-        guard.endFetchPhase();
+        lk.lock();
         if (!status.isOK()) {
             warning() << "Problem fetching the stored schema version of authorization data: "
                       << status;
@@ -284,7 +206,7 @@ Status AuthorizationManager::getAuthorizationVersion(OperationContext* txn, int*
             return status;
         }
 
-        if (guard.isSameCacheGeneration()) {
+        if (startGeneration == _fullInvalidationGeneration) {
             _version = newVersion;
         }
     }
@@ -293,7 +215,7 @@ Status AuthorizationManager::getAuthorizationVersion(OperationContext* txn, int*
 }
 
 OID AuthorizationManager::getCacheGeneration() {
-    CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
+    stdx::lock_guard<stdx::mutex> lk(_cacheMutex);
     return _cacheGeneration;
 }
 
@@ -435,51 +357,119 @@ Status AuthorizationManager::acquireUser(OperationContext* txn,
         return Status::OK();
     }
 
-    unordered_map<UserName, User*>::iterator it;
+    stdx::unique_lock<stdx::mutex> lk(_cacheMutex);
+    UserCache::iterator it = _userCache.find(userName);
+    if (it != _userCache.end()) {
+        User* user = it->second.user;
+        fassert(16914, user);
+        fassert(17003, user->isValid());
+        fassert(17008, user->getRefCount() > 0);
+
+        const int maxAgeSecs = userCacheMaxAgeSecs;
+        if (maxAgeSecs <= 0 || Date_t::now() - it->second.fetched < Seconds(maxAgeSecs)) {
+            userCacheHits.increment();
+            user->incrementRefCount();
+            *acquiredUser = user;
+            return Status::OK();
+        }
 
-    CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
-    while ((_userCache.end() == (it = _userCache.find(userName))) &&
-           guard.otherUpdateInFetchPhase()) {
-        guard.wait();
+        // refreshUsers() could not reread it in time
+        userCacheExpirations.increment();
+        _invalidateUser_inlock(it);
     }
 
-    if (it != _userCache.end()) {
-        fassert(16914, it->second);
-        fassert(17003, it->second->isValid());
-        fassert(17008, it->second->getRefCount() > 0);
-        it->second->incrementRefCount();
-        *acquiredUser = it->second;
+    const auto fetchIt = _userFetches.find(userName);
+    if (fetchIt != _userFetches.end()) {
+        const std::shared_ptr<UserFetch> fetch = fetchIt->second;
+        userCacheFetchWaits.increment();
+        fetch->numWaiters++;
+        fetch->doneCondition.wait(lk, [&fetch] { return fetch->done; });
+        if (!fetch->status.isOK()) {
+            return fetch->status;
+        }
+        *acquiredUser = fetch->user;
         return Status::OK();
     }
 
+    userCacheMisses.increment();
+    const auto fetch = std::make_shared<UserFetch>(_fullInvalidationGeneration);
+    _userFetches[userName] = fetch;
+    int authzVersion = _version;
+    lk.unlock();
+
     std::unique_ptr<User> user;
+    BSONObj description;
+    Status status = Status::OK();
+    const Timer timer;
+    try {
+        status = _fetchUser(txn, userName, &authzVersion, &user, &description);
+    } catch (const DBException& ex) {
+        // Threads waiting for this fetch must not be left waiting
+        status = ex.toStatus();
+    }
+    fetchLatency.record(timer.micros());
 
-    int authzVersion = _version;
-    guard.beginFetchPhase();
+    lk.lock();
+    // NOTE: It is not safe to throw an exception from here to the end of the method.
+    _userFetches.erase(userName);
+    fetch->status = status;
+    fetch->done = true;
+    fetch->doneCondition.notify_all();
+
+    if (!status.isOK()) {
+        return status;
+    }
+
+    // One reference for this thread, and one for each waiter
+    for (int i = 0; i <= fetch->numWaiters; ++i) {
+        user->incrementRefCount();
+    }
+
+    if (!fetch->invalidated && fetch->fullInvalidationGeneration == _fullInvalidationGeneration) {
+        CachedUser cached = {user.get(), description, Date_t::now()};
+        _userCache.insert(std::make_pair(userName, cached));
+        if (_version == schemaVersionInvalid)
+            _version = authzVersion;
+    } else {
+        // If the user was invalidated while this thread was fetching it, the data associated
+        // with the user may now be invalid, so we must mark it as such.  The caller may still
+        // opt to use the information for a short while, but not indefinitely.
+        user->invalidate();
+    }
+    fetch->user = user.release();
+    *acquiredUser = fetch->user;
 
+    return Status::OK();
+}
+
+Status AuthorizationManager::_fetchUser(OperationContext* txn,
+                                        const UserName& userName,
+                                        int* authzVersion,
+                                        std::unique_ptr<User>* acquiredUser,
+                                        BSONObj* description) {
     // Number of times to retry a user document that fetches due to transient
     // AuthSchemaIncompatible errors.  These errors should only ever occur during and shortly
     // after schema upgrades.
     static const int maxAcquireRetries = 2;
     Status status = Status::OK();
     for (int i = 0; i < maxAcquireRetries; ++i) {
-        if (authzVersion == schemaVersionInvalid) {
-            Status status = _externalState->getStoredAuthorizationVersion(txn, &authzVersion);
+        if (*authzVersion == schemaVersionInvalid) {
+            Status status = _externalState->getStoredAuthorizationVersion(txn, authzVersion);
             if (!status.isOK())
                 return status;
         }
 
-        switch (authzVersion) {
+        switch (*authzVersion) {
             default:
                 status = Status(ErrorCodes::BadValue,
                                 mongoutils::str::stream()
                                     << "Illegal value for authorization data schema version, "
-                                    << authzVersion);
+                                    << *authzVersion);
                 break;
             case schemaVersion28SCRAM:
             case schemaVersion26Final:
             case schemaVersion26Upgrade:
-                status = _fetchUserV2(txn, userName, &user);
+                status = _fetchUserV2(txn, userName, acquiredUser, description);
                 break;
             case schemaVersion24:
                 status = Status(ErrorCodes::AuthSchemaIncompatible,
@@ -493,33 +483,15 @@ Status AuthorizationManager::acquireUser(OperationContext* txn,
         if (status != ErrorCodes::AuthSchemaIncompatible)
             return status;
 
-        authzVersion = schemaVersionInvalid;
+        *authzVersion = schemaVersionInvalid;
     }
-    if (!status.isOK())
-        return status;
-
-    guard.endFetchPhase();
-
-    user->incrementRefCount();
-    // NOTE: It is not safe to throw an exception from here to the end of the method.
-    if (guard.isSameCacheGeneration()) {
-        _userCache.insert(std::make_pair(userName, user.get()));
-        if (_version == schemaVersionInvalid)
-            _version = authzVersion;
-    } else {
-        // If the cache generation changed while this thread was in fetch mode, the data
-        // associated with the user may now be invalid, so we must mark it as such.  The caller
-        // may still opt to use the information for a short while, but not indefinitely.
-        user->invalidate();
-    }
-    *acquiredUser = user.release();
-
-    return Status::OK();
+    return status;
 }
 
 Status AuthorizationManager::_fetchUserV2(OperationContext* txn,
                                           const UserName& userName,
-                                          std::unique_ptr<User>* acquiredUser) {
+                                          std::unique_ptr<User>* acquiredUser,
+                                          BSONObj* description) {
     BSONObj userObj;
     Status status = getUserDescription(txn, userName, &userObj);
     if (!status.isOK()) {
@@ -535,6 +507,7 @@ Status AuthorizationManager::_fetchUserV2(OperationContext* txn,
         return status;
     }
     acquiredUser->reset(user.release());
+    *description = userObj.getOwned();
     return Status::OK();
 }
 
@@ -543,7 +516,7 @@ void AuthorizationManager::releaseUser(User* user) {
         return;
     }
 
-    CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
+    stdx::lock_guard<stdx::mutex> lk(_cacheMutex);
     user->decrementRefCount();
     if (user->getRefCount() == 0) {
         // If it's been invalidated then it's not in the _userCache anymore.
@@ -556,27 +529,35 @@ void AuthorizationManager::releaseUser(User* user) {
 }
 
 void AuthorizationManager::invalidateUserByName(const UserName& userName) {
-    CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
+    stdx::lock_guard<stdx::mutex> lk(_cacheMutex);
     _updateCacheGeneration_inlock();
-    unordered_map<UserName, User*>::iterator it = _userCache.find(userName);
+
+    const auto fetchIt = _userFetches.find(userName);
+    if (fetchIt != _userFetches.end()) {
+        fetchIt->second->invalidated = true;
+    }
+
+    UserCache::iterator it = _userCache.find(userName);
     if (it == _userCache.end()) {
         return;
     }
-
-    User* user = it->second;
-    _userCache.erase(it);
-    user->invalidate();
+    _invalidateUser_inlock(it);
 }
 
 void AuthorizationManager::invalidateUsersFromDB(const std::string& dbname) {
-    CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
+    stdx::lock_guard<stdx::mutex> lk(_cacheMutex);
     _updateCacheGeneration_inlock();
-    unordered_map<UserName, User*>::iterator it = _userCache.begin();
+
+    for (auto fetchIt = _userFetches.begin(); fetchIt != _userFetches.end(); ++fetchIt) {
+        if (fetchIt->first.getDB() == dbname) {
+            fetchIt->second->invalidated = true;
+        }
+    }
+
+    UserCache::iterator it = _userCache.begin();
     while (it != _userCache.end()) {
-        User* user = it->second;
-        if (user->getName().getDB() == dbname) {
-            _userCache.erase(it++);
-            user->invalidate();
+        if (it->first.getDB() == dbname) {
+            _invalidateUser_inlock(it++);
         } else {
             ++it;
         }
@@ -584,16 +565,16 @@ void AuthorizationManager::invalidateUsersFromDB(const std::string& dbname) {
 }
 
 void AuthorizationManager::invalidateUserCache() {
-    CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
+    stdx::lock_guard<stdx::mutex> lk(_cacheMutex);
     _invalidateUserCache_inlock();
 }
 
 void AuthorizationManager::_invalidateUserCache_inlock() {
     _updateCacheGeneration_inlock();
-    for (unordered_map<UserName, User*>::iterator it = _userCache.begin(); it != _userCache.end();
-         ++it) {
-        fassert(17266, it->second != internalSecurity.user);
-        it->second->invalidate();
+    ++_fullInvalidationGeneration;
+    for (UserCache::iterator it = _userCache.begin(); it != _userCache.end(); ++it) {
+        fassert(17266, it->second.user != internalSecurity.user);
+        it->second.user->invalidate();
     }
     _userCache.clear();
 
@@ -601,6 +582,72 @@ void AuthorizationManager::_invalidateUserCache_inlock() {
     _version = schemaVersionInvalid;
 }
 
+void AuthorizationManager::_invalidateUser_inlock(UserCache::iterator it) {
+    User* user = it->second.user;
+    _userCache.erase(it);
+    user->invalidate();
+}
+
+void AuthorizationManager::refreshUsers(OperationContext* txn) {
+    const int maxAgeSecs = userCacheMaxAgeSecs;
+    if (maxAgeSecs <= 0) {
+        return;
+    }
+    const Seconds maxAge(maxAgeSecs);
+
+    // Each user is held while being refreshed, so it can't be deleted in the meantime.
+    vector<CachedUser> toRefresh;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_cacheMutex);
+        const Date_t now = Date_t::now();
+        for (UserCache::iterator it = _userCache.begin(); it != _userCache.end(); ++it) {
+            if (now - it->second.fetched >= maxAge / 2) {
+                it->second.user->incrementRefCount();
+                toRefresh.push_back(it->second);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < toRefresh.size(); ++i) {
+        User* user = toRefresh[i].user;
+        const UserName& userName = user->getName();
+
+        BSONObj description;
+        Status status = Status::OK();
+        const Timer timer;
+        try {
+            status = getUserDescription(txn, userName, &description);
+        } catch (const DBException& ex) {
+            status = ex.toStatus();
+        }
+        fetchLatency.record(timer.micros());
+        userCacheRefreshes.increment();
+
+        {
+            stdx::lock_guard<stdx::mutex> lk(_cacheMutex);
+            UserCache::iterator it = _userCache.find(userName);
+            // Skip users invalidated, and possibly reread, in the meantime
+            if (it != _userCache.end() && it->second.user == user) {
+                if (status.isOK() && description.binaryEqual(it->second.description)) {
+                    it->second.fetched = Date_t::now();
+                } else if (status.isOK() || status == ErrorCodes::UserNotFound) {
+                    LOG(1) << "Invalidating user " << userName
+                           << " whose description changed while cached";
+                    _updateCacheGeneration_inlock();
+                    _invalidateUser_inlock(it);
+                } else if (Date_t::now() - it->second.fetched >= maxAge) {
+                    warning() << "Invalidating user " << userName
+                              << " after failing to reread it before it expired: " << status;
+                    userCacheExpirations.increment();
+                    _invalidateUser_inlock(it);
+                }
+            }
+        }
+
+        releaseUser(user);
+    }
+}
+
 Status AuthorizationManager::initialize(OperationContext* txn) {
     invalidateUserCache();
     Status status = _externalState->initialize(txn);
@@ -44,9 +44,9 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/platform/unordered_map.h"
-#include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/stdx/mutex.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -257,8 +257,10 @@ public:
      *  If the user cache already has a user object for this user, it increments the refcount
      *  on that object and gives out a pointer to it.  If no user object for this user name
      *  exists yet in the cache, reads the user's privilege document from disk, builds up
-     *  a User object, sets the refcount to 1, and gives that out.  The returned user may
-     *  be invalid by the time the caller gets access to it.
+     *  a User object, sets the refcount to 1, and gives that out.  Threads acquiring the same
+     *  user while it is being read wait for that read rather than repeating it, but reads of
+     *  different users proceed in parallel.  The returned user may be invalid by the time the
+     *  caller gets access to it.
      *  The AuthorizationManager retains ownership of the returned User object.
      *  On non-OK Status return values, acquiredUser will not be modified.
      */
@@ -292,6 +294,15 @@ public:
      */
     void invalidateUserCache();
 
+    /**
+     * Rereads the descriptions of the cached users that are past half of userCacheMaxAgeSecs,
+     * so that users in use are kept fresh without their holders ever waiting for a read.
+     * Users whose description changed or who no longer exist are invalidated, as are users
+     * past the maximum age whose description could not be read.  Does nothing if
+     * userCacheMaxAgeSecs is 0.
+     */
+    void refreshUsers(OperationContext* txn);
+
     /**
      * Parses privDoc and fully initializes the user object (credentials, roles, and privileges)
      * with the information extracted from the privilege document.
@@ -312,10 +323,22 @@ public:
 
 private:
     /**
-     * Type used to guard accesses and updates to the user cache.
+     * A User in the cache, along with the description it was built from and when that
+     * description was read.
      */
-    class CacheGuard;
-    friend class AuthorizationManager::CacheGuard;
+    struct CachedUser {
+        User* user;
+        BSONObj description;
+        Date_t fetched;
+    };
+
+    typedef unordered_map<UserName, CachedUser> UserCache;
+
+    /**
+     * Read of a user missing from the cache, which other threads acquiring the same user wait
+     * on.
+     */
+    struct UserFetch;
 
     /**
      * Invalidates all User objects in the cache and removes them from the cache.
@@ -323,6 +346,12 @@ private:
      */
     void _invalidateUserCache_inlock();
 
+    /**
+     * Invalidates the given cached user and removes it from the cache.  Should only be called
+     * when already holding _cacheMutex.
+     */
+    void _invalidateUser_inlock(UserCache::iterator it);
+
     /**
      * Given the objects describing an oplog entry that affects authorization data, invalidates
      * the portion of the user cache that is affected by that operation.  Should only be called
@@ -338,13 +367,28 @@ private:
      */
     void _updateCacheGeneration_inlock();
 
+    /**
+     * Fetches user information for the named user according to the authorization schema
+     * version in *authzVersion, which is read first if it is schemaVersionInvalid and updated
+     * if the schema turns out to have changed.  Stores a pointer to a new user object into
+     * *acquiredUser, and the description it was built from into *description, on success.
+     *
+     * Must not be called while holding _cacheMutex.
+     */
+    Status _fetchUser(OperationContext* txn,
+                      const UserName& userName,
+                      int* authzVersion,
+                      std::unique_ptr<User>* acquiredUser,
+                      BSONObj* description);
+
     /**
      * Fetches user information from a v2-schema user document for the named user,
      * and stores a pointer to a new user object into *acquiredUser on success.
      */
     Status _fetchUserV2(OperationContext* txn,
                         const UserName& userName,
-                        std::unique_ptr<User>* acquiredUser);
+                        std::unique_ptr<User>* acquiredUser,
+                        BSONObj* description);
 
     /**
      * True if access control enforcement is enabled in this AuthorizationManager.
@@ -370,7 +414,7 @@ private:
      * May be set by acquireUser() and getAuthorizationVersion().  Invalidated by
      * invalidateUserCache().
      *
-     * Reads and writes guarded by CacheGuard.
+     * Guarded by _cacheMutex.
      */
     int _version;
 
@@ -380,33 +424,31 @@ private:
      * has a reference count - the AuthorizationManager must not delete a User object in the
      * cache unless its reference count is zero.
      */
-    unordered_map<UserName, User*> _userCache;
+    UserCache _userCache;
 
     /**
-     * Current generation of cached data.  Updated every time part of the cache gets
-     * invalidated.  Protected by CacheGuard.
+     * Reads in progress of users missing from _userCache.
      */
-    OID _cacheGeneration;
+    unordered_map<UserName, std::shared_ptr<UserFetch>> _userFetches;
 
     /**
-     * True if there is an update to the _userCache in progress, and that update is currently in
-     * the "fetch phase", during which it does not hold the _cacheMutex.
-     *
-     * Manipulated via CacheGuard.
+     * Current generation of cached data.  Updated every time part of the cache gets
+     * invalidated.
      */
-    bool _isFetchPhaseBusy;
+    OID _cacheGeneration;
 
     /**
-     * Protects _userCache, _cacheGeneration, _version and _isFetchPhaseBusy.  Manipulated
-     * via CacheGuard.
+     * Incremented every time the whole cache is invalidated.  Users read while it changed, or
+     * while they were invalidated by name, are not cached.
      */
-    stdx::mutex _cacheMutex;
+    uint64_t _fullInvalidationGeneration;
 
     /**
-     * Condition used to signal that it is OK for another CacheGuard to enter a fetch phase.
-     * Manipulated via CacheGuard.
+     * Protects _userCache, _userFetches, _cacheGeneration, _fullInvalidationGeneration, _version,
+     * and the reference counts of the cached users.  It is never held while reading user or
+     * schema information.
      */
-    stdx::condition_variable _fetchPhaseIsReady;
+    stdx::mutex _cacheMutex;
 };
 
 }  // namespace mongo
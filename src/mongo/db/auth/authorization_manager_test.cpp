@@ -39,6 +39,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context_noop.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/map_util.h"
@@ -229,5 +230,137 @@ TEST_F(AuthorizationManagerTest, testAcquireV2User) {
     authzManager->releaseUser(v2cluster);
 }
 
+class UserCacheTest : public AuthorizationManagerTest {
+public:
+    void setUp() {
+        AuthorizationManagerTest::setUp();
+        ASSERT_OK(externalState->insertPrivilegeDocument(
+            &txn,
+            BSON("_id"
+                 << "test.v2read"
+                 << "user"
+                 << "v2read"
+                 << "db"
+                 << "test"
+                 << "credentials" << BSON("MONGODB-CR"
+                                          << "password") << "roles"
+                 << BSON_ARRAY(BSON("role"
+                                    << "read"
+                                    << "db"
+                                    << "test"))),
+            BSONObj()));
+    }
+
+    void tearDown() {
+        setMaxAgeSecs("0");
+    }
+
+    // With a maximum age of 1 second, every cached user is due for a refresh.
+    static void setMaxAgeSecs(StringData value) {
+        ServerParameter* param =
+            ServerParameterSet::getGlobal()->getMap().find("userCacheMaxAgeSecs")->second;
+        ASSERT_OK(param->setFromString(value.toString()));
+    }
+
+    OperationContextNoop txn;
+};
+
+TEST_F(UserCacheTest, AcquireUserTwiceSharesCachedUser) {
+    User* first;
+    ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &first));
+    User* second;
+    ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &second));
+
+    ASSERT_EQUALS(first, second);
+    ASSERT_EQUALS(2U, first->getRefCount());
+
+    authzManager->releaseUser(first);
+    authzManager->releaseUser(second);
+}
+
+TEST_F(UserCacheTest, InvalidateUserByNameOnlyAffectsThatUser) {
+    ASSERT_OK(externalState->insertPrivilegeDocument(&txn,
+                                                     BSON("_id"
+                                                          << "test.other"
+                                                          << "user"
+                                                          << "other"
+                                                          << "db"
+                                                          << "test"
+                                                          << "credentials"
+                                                          << BSON("MONGODB-CR"
+                                                                  << "password") << "roles"
+                                                          << BSONArray()),
+                                                     BSONObj()));
+
+    User* v2read;
+    ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &v2read));
+    User* other;
+    ASSERT_OK(authzManager->acquireUser(&txn, UserName("other", "test"), &other));
+
+    authzManager->invalidateUserByName(UserName("other", "test"));
+    ASSERT_TRUE(v2read->isValid());
+    ASSERT_FALSE(other->isValid());
+
+    authzManager->releaseUser(v2read);
+    authzManager->releaseUser(other);
+}
+
+TEST_F(UserCacheTest, RefreshKeepsUnchangedUser) {
+    setMaxAgeSecs("1");
+
+    User* user;
+    ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &user));
+
+    authzManager->refreshUsers(&txn);
+    ASSERT_TRUE(user->isValid());
+    ASSERT_EQUALS(1U, user->getRefCount());
+
+    authzManager->releaseUser(user);
+}
+
+TEST_F(UserCacheTest, RefreshInvalidatesRemovedUser) {
+    setMaxAgeSecs("1");
+
+    User* user;
+    ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &user));
+
+    // Remove the user without the AuthorizationManager noticing, as could happen on a mongos
+    // between checks with the config servers.
+    externalState->setAuthorizationManager(NULL);
+    int numRemoved;
+    ASSERT_OK(externalState->remove(&txn,
+                                    AuthorizationManager::usersCollectionNamespace,
+                                    BSON("_id"
+                                         << "test.v2read"),
+                                    BSONObj(),
+                                    &numRemoved));
+    ASSERT_EQUALS(1, numRemoved);
+
+    authzManager->refreshUsers(&txn);
+    ASSERT_FALSE(user->isValid());
+    authzManager->releaseUser(user);
+
+    ASSERT_EQUALS(ErrorCodes::UserNotFound,
+                  authzManager->acquireUser(&txn, UserName("v2read", "test"), &user));
+}
+
+TEST_F(UserCacheTest, RefreshDoesNothingWithoutMaxAge) {
+    User* user;
+    ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &user));
+
+    externalState->setAuthorizationManager(NULL);
+    int numRemoved;
+    ASSERT_OK(externalState->remove(&txn,
+                                    AuthorizationManager::usersCollectionNamespace,
+                                    BSON("_id"
+                                         << "test.v2read"),
+                                    BSONObj(),
+                                    &numRemoved));
+
+    authzManager->refreshUsers(&txn);
+    ASSERT_TRUE(user->isValid());
+    authzManager->releaseUser(user);
+}
+
 }  // namespace
 }  // namespace mongo
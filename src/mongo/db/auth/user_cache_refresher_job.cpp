@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kAccessControl
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/auth/user_cache_refresher_job.h"
+
+#include "mongo/db/auth/authorization_manager.h"
+#include "mongo/db/client.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+namespace {
+
+// How often to look for users to refresh.  Users are refreshed once they are past half of
+// userCacheMaxAgeSecs, so this only needs to be well under that.
+const int kRefreshCheckIntervalSecs = 10;
+
+}  // namespace
+
+UserCacheRefresher::UserCacheRefresher(AuthorizationManager* authzManager)
+    : BackgroundJob(true /* selfDelete */), _authzManager(authzManager) {}
+
+void UserCacheRefresher::run() {
+    Client::initThread("UserCacheRefresher");
+
+    while (true) {
+        sleepsecs(kRefreshCheckIntervalSecs);
+        if (inShutdown()) {
+            break;
+        }
+
+        try {
+            auto txn = cc().makeOperationContext();
+            _authzManager->refreshUsers(txn.get());
+        } catch (const DBException& ex) {
+            warning() << "Failed to refresh the user cache: " << ex.toStatus();
+        }
+    }
+}
+
+std::string UserCacheRefresher::name() const {
+    return "UserCacheRefresherThread";
+}
+
+}  // namespace mongo
@@ -95,9 +95,15 @@ struct CompactOptions {
 struct CompactStats {
     CompactStats() {
         corruptDocuments = 0;
+        documentsMoved = 0;
+        bytesFreed = 0;
     }
 
     long long corruptDocuments;
+
+    // only used by online compaction
+    long long documentsMoved;
+    long long bytesFreed;
 };
 
 /**
@@ -273,6 +279,15 @@ public:
 
     StatusWith<CompactStats> compact(OperationContext* txn, const CompactOptions* options);
 
+    /**
+     * Moves up to 'batchSize' documents from the end of the collection into free space nearer
+     * the start, updating indexes as it goes, and releases storage left empty. Meant to be
+     * called repeatedly, yielding locks between calls, until it returns true. Call
+     * compactOnlineStop() when finished, even after an error.
+     */
+    StatusWith<bool> compactOnline(OperationContext* txn, int batchSize, CompactStats* stats);
+    void compactOnlineStop(OperationContext* txn);
+
     /**
      * removes all documents as fast as possible
      * indexes before and after will be the same
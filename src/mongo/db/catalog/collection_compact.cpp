@@ -95,6 +95,33 @@ private:
 
     MultiIndexBlock* _multiIndexBlock;
 };
+
+/**
+ * Indexes documents at the location online compaction moved them to. The record store has
+ * already removed them from the indexes at their old location, through the UpdateNotifier.
+ */
+class OnlineCompactAdaptor : public RecordStoreCompactAdaptor {
+public:
+    OnlineCompactAdaptor(OperationContext* txn, Collection* collection)
+        : _txn(txn), _collection(collection) {}
+
+    virtual bool isDataValid(const RecordData& recData) {
+        return recData.toBson().valid();
+    }
+
+    virtual size_t dataSize(const RecordData& recData) {
+        return recData.toBson().objsize();
+    }
+
+    virtual void inserted(const RecordData& recData, const RecordId& newLocation) {
+        uassertStatusOK(
+            _collection->getIndexCatalog()->indexRecord(_txn, recData.toBson(), newLocation));
+    }
+
+private:
+    OperationContext* const _txn;
+    Collection* const _collection;
+};
 }
 
 
@@ -194,4 +221,34 @@ StatusWith<CompactStats> Collection::compact(OperationContext* txn,
     return StatusWith<CompactStats>(stats);
 }
 
+StatusWith<bool> Collection::compactOnline(OperationContext* txn,
+                                           int batchSize,
+                                           CompactStats* stats) {
+    dassert(txn->lockState()->isCollectionLockedForMode(ns().toString(), MODE_IX));
+
+    if (!_recordStore->compactSupported() || !_recordStore->compactOnlineSupported())
+        return StatusWith<bool>(ErrorCodes::CommandNotSupported,
+                                str::stream()
+                                    << "cannot compact online collection with record store: "
+                                    << _recordStore->name());
+
+    if (_indexCatalog.numIndexesInProgress(txn))
+        return StatusWith<bool>(ErrorCodes::BadValue, "cannot compact when indexes in progress");
+
+    OnlineCompactAdaptor adaptor(txn, this);
+    bool done = false;
+    Status status = _recordStore->compactOnline(txn, &adaptor, this, batchSize, stats, &done);
+    if (!status.isOK())
+        return StatusWith<bool>(status);
+
+    return StatusWith<bool>(done);
+}
+
+void Collection::compactOnlineStop(OperationContext* txn) {
+    dassert(txn->lockState()->isCollectionLockedForMode(ns().toString(), MODE_IX));
+
+    if (_recordStore->compactSupported() && _recordStore->compactOnlineSupported())
+        _recordStore->compactOnlineStop(txn);
+}
+
 }  // namespace mongo
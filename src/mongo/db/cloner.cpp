@@ -34,6 +34,7 @@
 
 #include "mongo/db/cloner.h"
 
+#include <algorithm>
 
 #include "mongo/base/status.h"
 #include "mongo/bson/util/builder.h"
@@ -44,7 +45,9 @@
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/document_validation.h"
 #include "mongo/db/catalog/index_create.h"
+#include "mongo/db/client.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/copydb.h"
 #include "mongo/db/commands/rename_collection.h"
@@ -52,17 +55,25 @@
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/service_context.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/index_builder.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/op_observer.h"
+#include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/isself.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/assert_util.h"
+#include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/scopeguard.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -75,8 +86,57 @@ using std::vector;
 
 MONGO_EXPORT_SERVER_PARAMETER(skipCorruptDocumentsWhenCloning, bool, false);
 
+// Failpoint which fails a clone after it checkpoints its progress.
+MONGO_FP_DECLARE(failClonerAfterCheckpoint);
+
 BSONElement getErrField(const BSONObj& o);
 
+namespace {
+
+/**
+ * Connects to 'source', authenticating as the internal user if auth is enabled.
+ */
+Status connectToSource(const ConnectionString& source, unique_ptr<DBClientBase>* conn) {
+    std::string errmsg;
+    unique_ptr<DBClientBase> con(source.connect(errmsg));
+    if (!con.get()) {
+        return Status(ErrorCodes::HostUnreachable, errmsg);
+    }
+
+    if (getGlobalAuthorizationManager()->isAuthEnabled() && !authenticateInternalUser(con.get())) {
+        return Status(ErrorCodes::AuthenticationFailed, "Unable to authenticate as internal user");
+    }
+
+    *conn = std::move(con);
+    return Status::OK();
+}
+
+long long bytesPerSecond(long long bytes, long long millis) {
+    return bytes * 1000 / std::max(millis, 1LL);
+}
+
+/**
+ * Deletes the documents the _id index build rejected as duplicates. Must be done before the
+ * indexer is committed; see the comment about dupsAllowed in IndexCatalog::_unindexRecord and
+ * SERVER-17487.
+ */
+void dropDuplicates(OperationContext* txn, Collection* collection, const set<RecordId>& dups) {
+    for (set<RecordId>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
+        WriteUnitOfWork wunit(txn);
+        BSONObj id;
+
+        collection->deleteDocument(
+            txn, *it, true, true, txn->writesAreReplicated() ? &id : nullptr);
+        wunit.commit();
+    }
+
+    if (!dups.empty()) {
+        log() << "index build dropped: " << dups.size() << " dups";
+    }
+}
+
+}  // namespace
+
 /* for index info object:
      { "name" : "name_1" , "ns" : "foo.index3" , "key" :  { "name" : 1.0 } }
    we need to fix up the value in the "ns" parameter so that the name prefix is correct on a
@@ -114,14 +174,21 @@ BSONObj fixindex(const string& newDbName, BSONObj o) {
 Cloner::Cloner() {}
 
 struct Cloner::Fun {
-    Fun(OperationContext* txn, const string& dbName) : lastLog(0), txn(txn), _dbName(dbName) {}
+    Fun(OperationContext* txn, const string& dbName)
+        : lastLog(0),
+          txn(txn),
+          _dbName(dbName),
+          numBytes(0),
+          idIndexer(NULL),
+          indexer(NULL),
+          progress(NULL) {}
 
     void operator()(DBClientCursorBatchIterator& i) {
         invariant(from_collection.coll() != "system.indexes");
 
-        // XXX: can probably take dblock instead
-        unique_ptr<ScopedTransaction> scopedXact(new ScopedTransaction(txn, MODE_X));
-        unique_ptr<Lock::GlobalWrite> globalWriteLock(new Lock::GlobalWrite(txn->lockState()));
+        unique_ptr<ScopedTransaction> scopedXact(new ScopedTransaction(txn, MODE_IX));
+        unique_ptr<Lock::DBLock> dbWriteLock(
+            new Lock::DBLock(txn->lockState(), _dbName, MODE_X));
         uassert(ErrorCodes::NotMaster,
                 str::stream() << "Not primary while cloning collection " << from_collection.ns()
                               << " to " << to_collection.ns(),
@@ -139,7 +206,7 @@ struct Cloner::Fun {
             massert(17321,
                     str::stream() << "collection dropped during clone [" << to_collection.ns()
                                   << "]",
-                    !createdCollection);
+                    !createdCollection && !idIndexer);
             MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
                 WriteUnitOfWork wunit(txn);
                 Status s = userCreateNS(txn, db, to_collection.toString(), from_options, false);
@@ -149,13 +216,19 @@ struct Cloner::Fun {
             MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createCollection", to_collection.ns());
         }
 
+        // Documents are inserted in batches of up to 128, one unit of work per batch.
+        vector<BSONObj> docs;
         while (i.moreInCurrentBatch()) {
             if (numSeen % 128 == 127) {
+                insertDocuments(collection, &docs);
+
                 time_t now = time(0);
                 if (now - lastLog >= 60) {
                     // report progress
                     if (lastLog)
-                        log() << "clone " << to_collection << ' ' << numSeen << endl;
+                        log() << "clone " << to_collection << ' ' << numSeen << ", "
+                              << bytesPerSecond(numBytes, timer.millis()) << " bytes/sec"
+                              << endl;
                     lastLog = now;
                 }
 
@@ -164,13 +237,13 @@ struct Cloner::Fun {
                 }
 
                 if (_mayYield) {
+                    dbWriteLock.reset();
                     scopedXact.reset();
-                    globalWriteLock.reset();
 
                     CurOp::get(txn)->yielded();
 
-                    scopedXact.reset(new ScopedTransaction(txn, MODE_X));
-                    globalWriteLock.reset(new Lock::GlobalWrite(txn->lockState()));
+                    scopedXact.reset(new ScopedTransaction(txn, MODE_IX));
+                    dbWriteLock.reset(new Lock::DBLock(txn->lockState(), _dbName, MODE_X));
 
                     // Check if everything is still all right.
                     if (txn->writesAreReplicated()) {
@@ -210,24 +283,87 @@ struct Cloner::Fun {
                 msgasserted(28531, ss);
             }
 
+            // A resumed copy starts at the last document that was copied before.
+            if (!resumeAfterId.isEmpty()) {
+                const bool alreadyCopied =
+                    tmp["_id"].woCompare(resumeAfterId.firstElement(), false) == 0;
+                resumeAfterId = BSONObj();
+                if (alreadyCopied) {
+                    continue;
+                }
+            }
+
             ++numSeen;
-            MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
-                WriteUnitOfWork wunit(txn);
+            numBytes += tmp.objsize();
+            docs.push_back(tmp);
+
+            RARELY if (time(0) - saveLast > 60) {
+                log() << numSeen << " objects cloned so far from collection " << from_collection;
+                saveLast = time(0);
+            }
+        }
+
+        insertDocuments(collection, &docs);
+    }
 
-                BSONObj doc = tmp;
-                StatusWith<RecordId> loc = collection->insertDocument(txn, doc, true);
+    /**
+     * Inserts 'docs' into 'collection' in a single unit of work, and clears 'docs'.
+     *
+     * When the indexes are being built in the same pass, the documents are inserted through
+     * 'idIndexer' and then handed to 'indexer', if any. A write conflict can't be retried then,
+     * because the bulk index builders have already seen the documents; it fails the clone
+     * instead. That can only happen if something else writes to the new collection.
+     *
+     * With 'progress', the _id of the last document is checkpointed in the same unit of work.
+     */
+    void insertDocuments(Collection* collection, vector<BSONObj>* docs) {
+        if (docs->empty())
+            return;
+
+        if (idIndexer) {
+            WriteUnitOfWork wunit(txn);
+            for (vector<BSONObj>::const_iterator it = docs->begin(); it != docs->end(); ++it) {
+                StatusWith<RecordId> loc = collection->insertDocument(txn, *it, idIndexer, true);
                 if (!loc.isOK()) {
                     error() << "error: exception cloning object in " << from_collection << ' '
-                            << loc.getStatus() << " obj:" << doc;
+                            << loc.getStatus() << " obj:" << *it;
                 }
                 uassertStatusOK(loc.getStatus());
+                if (indexer) {
+                    uassertStatusOK(indexer->insert(*it, loc.getValue()));
+                }
+            }
+            checkpoint(docs->back());
+            wunit.commit();
+        } else {
+            MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                WriteUnitOfWork wunit(txn);
+                for (vector<BSONObj>::const_iterator it = docs->begin(); it != docs->end(); ++it) {
+                    StatusWith<RecordId> loc = collection->insertDocument(txn, *it, true);
+                    if (!loc.isOK()) {
+                        error() << "error: exception cloning object in " << from_collection
+                                << ' ' << loc.getStatus() << " obj:" << *it;
+                    }
+                    uassertStatusOK(loc.getStatus());
+                }
+                checkpoint(docs->back());
                 wunit.commit();
             }
             MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "cloner insert", to_collection.ns());
-            RARELY if (time(0) - saveLast > 60) {
-                log() << numSeen << " objects cloned so far from collection " << from_collection;
-                saveLast = time(0);
-            }
+        }
+
+        docs->clear();
+
+        if (progress && MONGO_FAIL_POINT(failClonerAfterCheckpoint)) {
+            uasserted(ErrorCodes::InternalError,
+                      str::stream() << "failClonerAfterCheckpoint failpoint while cloning "
+                                    << to_collection.ns());
+        }
+    }
+
+    void checkpoint(const BSONObj& lastDoc) {
+        if (progress) {
+            progress->setLastId(txn, to_collection, lastDoc["_id"].wrap());
         }
     }
 
@@ -236,6 +372,12 @@ struct Cloner::Fun {
     const string _dbName;
 
     int64_t numSeen;
+    long long numBytes;
+    Timer timer;
+    MultiIndexBlock* idIndexer;
+    MultiIndexBlock* indexer;
+    CloneProgress* progress;
+    BSONObj resumeAfterId;
     NamespaceString from_collection;
     BSONObj from_options;
     NamespaceString to_collection;
@@ -255,7 +397,11 @@ void Cloner::copy(OperationContext* txn,
                   bool slaveOk,
                   bool mayYield,
                   bool mayBeInterrupted,
-                  Query query) {
+                  Query query,
+                  MultiIndexBlock* idIndexer,
+                  MultiIndexBlock* indexer,
+                  CloneProgress* progress,
+                  const BSONObj& resumeAfterId) {
     LOG(2) << "\t\tcloning collection " << from_collection << " to " << to_collection << " on "
            << _conn->getServerAddress() << " with filter " << query.toString() << endl;
 
@@ -267,17 +413,29 @@ void Cloner::copy(OperationContext* txn,
     f.saveLast = time(0);
     f._mayYield = mayYield;
     f._mayBeInterrupted = mayBeInterrupted;
+    invariant(idIndexer || !indexer);
+    f.idIndexer = idIndexer;
+    f.indexer = indexer;
+    f.progress = progress;
+    f.resumeAfterId = resumeAfterId;
 
     int options = QueryOption_NoCursorTimeout | (slaveOk ? QueryOption_SlaveOk : 0);
     {
         Lock::TempRelease tempRelease(txn->lockState());
-        _conn->query(stdx::function<void(DBClientCursorBatchIterator&)>(f),
+        // Pass 'f' by reference so that its counters are still available afterwards.
+        _conn->query(stdx::function<void(DBClientCursorBatchIterator&)>(
+                         [&f](DBClientCursorBatchIterator& i) { f(i); }),
                      from_collection.ns(),
                      query,
                      0,
                      options);
     }
 
+    const long long millis = f.timer.millis();
+    log() << "cloned " << f.numSeen << " documents (" << f.numBytes << " bytes) from "
+          << from_collection << " in " << millis << "ms, "
+          << bytesPerSecond(f.numBytes, millis) << " bytes/sec";
+
     uassert(ErrorCodes::NotMaster,
             str::stream() << "Not primary while cloning collection " << from_collection.ns()
                           << " to " << to_collection.ns() << " with filter " << query.toString(),
@@ -419,7 +577,11 @@ bool Cloner::copyCollection(OperationContext* txn,
          true,
          mayYield,
          mayBeInterrupted,
-         Query(query).snapshot());
+         Query(query).snapshot(),
+         NULL,
+         NULL,
+         NULL,
+         BSONObj());
 
     /* TODO : copyIndexes bool does not seem to be implemented! */
     if (!shouldCopyIndexes) {
@@ -440,6 +602,406 @@ bool Cloner::copyCollection(OperationContext* txn,
     return true;
 }
 
+Status Cloner::cloneCollection(OperationContext* txn,
+                               const string& toDBName,
+                               const BSONObj& collectionInfo,
+                               const CloneOptions& opts,
+                               bool masterSameProcess) {
+    LOG(2) << "  really will clone: " << collectionInfo << endl;
+    const char* collectionName = collectionInfo["name"].valuestr();
+    BSONObj options = collectionInfo.getObjectField("options");
+
+    const NamespaceString from_name(opts.fromDB, collectionName);
+    const NamespaceString to_name(toDBName, collectionName);
+
+    CloneProgress* const progress = opts.progress;
+    invariant(!progress || opts.syncIndexes);
+    if (progress && progress->isDone(txn, to_name)) {
+        log() << "skipping " << to_name << ", which was already cloned";
+        return Status::OK();
+    }
+
+    // Fetch the source's index specs up front, so that the indexes can be built with bulk
+    // builders while the documents are copied, rather than in another scan afterwards.
+    vector<BSONObj> indexesToBuild;
+    bool haveIdIndexSpec = false;
+    if (opts.syncIndexes) {
+        Lock::TempRelease tempRelease(txn->lockState());
+        list<BSONObj> sourceIndexes =
+            _conn->getIndexSpecs(from_name.ns(), opts.slaveOk ? QueryOption_SlaveOk : 0);
+        for (list<BSONObj>::const_iterator it = sourceIndexes.begin(); it != sourceIndexes.end();
+             ++it) {
+            indexesToBuild.push_back(fixindex(toDBName, *it));
+            haveIdIndexSpec =
+                haveIdIndexSpec || IndexDescriptor::isIdIndexPattern(it->getObjectField("key"));
+        }
+    }
+
+    // Copying in _id order means that how far the copy got is the last _id copied.
+    const bool checkpoint =
+        progress && haveIdIndexSpec && !opts.snapshot && !options["capped"].trueValue();
+
+    Database* db = dbHolder().openDb(txn, toDBName);
+
+    BSONObj resumeAfterId;
+    if (progress && db->getCollection(to_name)) {
+        if (checkpoint) {
+            resumeAfterId = progress->getLastId(txn, to_name);
+        }
+
+        if (resumeAfterId.isEmpty()) {
+            log() << "dropping " << to_name << ", which an earlier clone left incomplete";
+            MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                WriteUnitOfWork wunit(txn);
+                Status dropStatus = db->dropCollection(txn, to_name.ns());
+                if (!dropStatus.isOK()) {
+                    return dropStatus;
+                }
+                wunit.commit();
+            }
+            MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "dropCollection", to_name.ns());
+        }
+    }
+
+    if (resumeAfterId.isEmpty()) {
+        MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+            WriteUnitOfWork wunit(txn);
+
+            // we defer building id index for performance - building it in batch is much
+            // faster
+            Status createStatus = userCreateNS(txn, db, to_name.ns(), options, false);
+            if (!createStatus.isOK()) {
+                return createStatus;
+            }
+
+            wunit.commit();
+        }
+        MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createCollection", to_name.ns());
+    }
+
+    Collection* c = db->getCollection(to_name);
+    invariant(c);
+
+    // Commits the indexes built by 'indexer' from 'specs', and if 'done', records that the
+    // collection was cloned.
+    auto commitIndexes = [&](MultiIndexBlock* indexer, const vector<BSONObj>& specs, bool done) {
+        WriteUnitOfWork wunit(txn);
+        indexer->commit();
+        if (txn->writesAreReplicated()) {
+            const string systemIndexes = c->ns().getSystemIndexesCollection();
+            for (vector<BSONObj>::const_iterator it = specs.begin(); it != specs.end(); ++it) {
+                getGlobalServiceContext()->getOpObserver()->onCreateIndex(
+                    txn, systemIndexes.c_str(), *it);
+            }
+        }
+        if (done && progress) {
+            progress->setDone(txn, to_name);
+        }
+        wunit.commit();
+    };
+
+    // Finishes the index builds, either over the whole collection or over the documents
+    // inserted so far, and drops the documents with duplicate _ids. Those are copies of
+    // documents that moved during the scan. Any other unique index only tolerates duplicates
+    // among the documents that are dropped; every other violation fails the clone, as it would
+    // have when the indexes were built after the copy.
+    auto finishIndexes = [&](MultiIndexBlock* idIndexer,
+                             MultiIndexBlock* indexer,
+                             bool insertAll) -> Status {
+        set<RecordId> dups;
+        if (idIndexer) {
+            Status status = insertAll ? idIndexer->insertAllDocumentsInCollection(&dups)
+                                      : idIndexer->doneInserting(&dups);
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        if (indexer) {
+            set<RecordId> otherDups;
+            Status status = insertAll ? indexer->insertAllDocumentsInCollection(&otherDups)
+                                      : indexer->doneInserting(&otherDups);
+            if (!status.isOK()) {
+                return status;
+            }
+            if (!std::includes(dups.begin(), dups.end(), otherDups.begin(), otherDups.end())) {
+                return Status(ErrorCodes::DuplicateKey,
+                              str::stream() << "duplicate key in a unique index while cloning "
+                                            << to_name.ns());
+            }
+        }
+
+        // Must be done before the indexers are committed.
+        dropDuplicates(txn, c, dups);
+        return Status::OK();
+    };
+
+    // The _id index gets an indexer of its own, since only its duplicates are dropped.
+    unique_ptr<MultiIndexBlock> idIndexer;
+    unique_ptr<MultiIndexBlock> indexer;
+    vector<BSONObj> idIndexSpecs;
+    if (opts.syncIndexes) {
+        for (vector<BSONObj>::iterator it = indexesToBuild.begin(); it != indexesToBuild.end();
+             ++it) {
+            if (IndexDescriptor::isIdIndexPattern(it->getObjectField("key"))) {
+                idIndexSpecs.push_back(*it);
+                indexesToBuild.erase(it);
+                break;
+            }
+        }
+
+        // Like the data only clone below, always build an _id index.
+        if (idIndexSpecs.empty()) {
+            idIndexSpecs.push_back(c->getIndexCatalog()->getDefaultIdIndexSpec());
+        }
+
+        if (!resumeAfterId.isEmpty()) {
+            // The earlier clone didn't get as far as committing the indexes. Build them over
+            // the documents it copied, and index the rest of the documents as they are
+            // inserted.
+            MultiIndexBlock existing(txn, c);
+            existing.removeExistingIndexes(&idIndexSpecs);
+            existing.removeExistingIndexes(&indexesToBuild);
+        }
+
+        if (!idIndexSpecs.empty()) {
+            idIndexer.reset(new MultiIndexBlock(txn, c));
+            if (opts.mayBeInterrupted)
+                idIndexer->allowInterruption();
+            Status status = idIndexer->init(idIndexSpecs);
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        if (!indexesToBuild.empty()) {
+            indexer.reset(new MultiIndexBlock(txn, c));
+            if (opts.mayBeInterrupted)
+                indexer->allowInterruption();
+            Status status = indexer->init(indexesToBuild);
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        if (!resumeAfterId.isEmpty()) {
+            Status status = finishIndexes(idIndexer.get(), indexer.get(), true);
+            if (!status.isOK()) {
+                return status;
+            }
+            if (idIndexer) {
+                commitIndexes(idIndexer.get(), idIndexSpecs, false);
+            }
+            if (indexer) {
+                commitIndexes(indexer.get(), indexesToBuild, false);
+            }
+            idIndexer.reset();
+            indexer.reset();
+        }
+    }
+
+    LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
+    Query q;
+    if (opts.snapshot)
+        q.snapshot();
+    if (checkpoint) {
+        q.hint(BSON("_id" << 1));
+        if (!resumeAfterId.isEmpty()) {
+            log() << "resuming clone of " << from_name << " after " << resumeAfterId;
+            q.minKey(resumeAfterId);
+        }
+    }
+
+    copy(txn,
+         toDBName,
+         from_name,
+         options,
+         to_name,
+         masterSameProcess,
+         opts.slaveOk,
+         opts.mayYield,
+         opts.mayBeInterrupted,
+         q,
+         idIndexer.get(),
+         indexer.get(),
+         checkpoint ? progress : NULL,
+         resumeAfterId);
+
+    // Copy releases the lock, so we need to re-load the database. This should
+    // probably throw if the database has changed in between, but for now preserve
+    // the existing behaviour.
+    db = dbHolder().get(txn, toDBName);
+    uassert(18645, str::stream() << "database " << toDBName << " dropped during clone", db);
+
+    c = db->getCollection(to_name);
+    if (!resumeAfterId.isEmpty()) {
+        uassert(28729,
+                str::stream() << "collection " << to_name.ns() << " dropped during clone",
+                c);
+
+        WriteUnitOfWork wunit(txn);
+        progress->setDone(txn, to_name);
+        wunit.commit();
+    } else if (idIndexer) {
+        uassert(28731,
+                str::stream() << "collection " << to_name.ns() << " dropped during clone",
+                c);
+
+        // We need to drop objects with duplicate _ids because we didn't do a true
+        // snapshot and this is before applying oplog operations that occur during the
+        // initial sync.
+        Status status = finishIndexes(idIndexer.get(), indexer.get(), false);
+        if (!status.isOK()) {
+            return status;
+        }
+        if (indexer) {
+            commitIndexes(indexer.get(), indexesToBuild, false);
+        }
+        commitIndexes(idIndexer.get(), idIndexSpecs, true);
+    } else if (c && !c->getIndexCatalog()->haveIdIndex(txn)) {
+        // We need to drop objects with duplicate _ids because we didn't do a true
+        // snapshot and this is before applying oplog operations that occur during the
+        // initial sync.
+        set<RecordId> dups;
+
+        MultiIndexBlock indexer(txn, c);
+        if (opts.mayBeInterrupted)
+            indexer.allowInterruption();
+
+        uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
+        uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
+        dropDuplicates(txn, c, dups);
+
+        WriteUnitOfWork wunit(txn);
+        indexer.commit();
+        if (txn->writesAreReplicated()) {
+            getGlobalServiceContext()->getOpObserver()->onCreateIndex(
+                txn,
+                c->ns().getSystemIndexesCollection().c_str(),
+                c->getIndexCatalog()->getDefaultIdIndexSpec());
+        }
+        wunit.commit();
+    }
+
+    return Status::OK();
+}
+
+Status Cloner::cloneCollectionsInParallel(OperationContext* txn,
+                                          const string& toDBName,
+                                          const ConnectionString& source,
+                                          const list<BSONObj>& toClone,
+                                          const CloneOptions& opts) {
+    stdx::mutex mutex;
+    stdx::condition_variable workerDone;
+    list<BSONObj>::const_iterator next = toClone.begin();
+    Status firstError = Status::OK();
+
+    // The workers still running, and the operations they run under, so that an interrupt of
+    // 'txn' can be passed on to them
+    size_t runningWorkers = 0;
+    vector<OperationContext*> workerTxns;
+
+    const bool writesAreReplicated = txn->writesAreReplicated();
+    const bool validationDisabled = documentValidationDisabled(txn);
+
+    auto worker = [&](int workerNum) {
+        // Nothing may escape the thread, and the count of running workers must always go down
+        Status status = Status::OK();
+        try {
+            const std::string threadName = str::stream() << "cloner" << workerNum;
+            Client::initThread(threadName.c_str());
+            OperationContextImpl workerTxn;
+            workerTxn.setReplicatedWrites(writesAreReplicated);
+            documentValidationDisabled(&workerTxn) = validationDisabled;
+
+            {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                workerTxns.push_back(&workerTxn);
+            }
+            ON_BLOCK_EXIT([&] {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                workerTxns.erase(std::find(workerTxns.begin(), workerTxns.end(), &workerTxn));
+            });
+
+            Cloner cloner;
+            status = connectToSource(source, &cloner._conn);
+
+            while (status.isOK()) {
+                BSONObj collectionInfo;
+                {
+                    stdx::lock_guard<stdx::mutex> lk(mutex);
+                    if (!firstError.isOK() || next == toClone.end()) {
+                        break;
+                    }
+                    collectionInfo = *next++;
+                }
+
+                ScopedTransaction transaction(&workerTxn, MODE_IX);
+                Lock::DBLock dbWrite(workerTxn.lockState(), toDBName, MODE_X);
+                status = cloner.cloneCollection(&workerTxn, toDBName, collectionInfo, opts, false);
+            }
+        } catch (const DBException& ex) {
+            status = ex.toStatus();
+        } catch (const std::exception& ex) {
+            status = Status(ErrorCodes::UnknownError, ex.what());
+        } catch (...) {
+            status = Status(ErrorCodes::UnknownError, "unknown error while cloning");
+        }
+
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        if (!status.isOK() && firstError.isOK()) {
+            firstError = status;
+        }
+        runningWorkers--;
+        workerDone.notify_all();
+    };
+
+    const size_t numWorkers = std::min(static_cast<size_t>(opts.parallelCollections),
+                                       toClone.size());
+    log() << "cloning " << toClone.size() << " collections of " << opts.fromDB << " with "
+          << numWorkers << " threads";
+
+    {
+        // The workers lock the database themselves.
+        Lock::TempRelease tempRelease(txn->lockState());
+
+        vector<stdx::thread> workers;
+        runningWorkers = numWorkers;
+        for (size_t i = 0; i < numWorkers; ++i) {
+            workers.emplace_back(worker, i);
+        }
+
+        // Nothing checks 'txn' for interrupts while the workers run, so do that here.
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        bool interrupted = false;
+        while (runningWorkers > 0) {
+            workerDone.wait_for(lk, Milliseconds(100));
+            if (interrupted || !opts.mayBeInterrupted) {
+                continue;
+            }
+
+            const Status interruptStatus = txn->checkForInterruptNoAssert();
+            if (!interruptStatus.isOK()) {
+                interrupted = true;
+                if (firstError.isOK()) {
+                    firstError = interruptStatus;
+                }
+                for (OperationContext* workerTxn : workerTxns) {
+                    stdx::lock_guard<Client> clientLock(*workerTxn->getClient());
+                    workerTxn->markKilled();
+                }
+            }
+        }
+        lk.unlock();
+
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    }
+
+    return firstError;
+}
+
 Status Cloner::copyDb(OperationContext* txn,
                       const std::string& toDBName,
                       const string& masterHost,
@@ -479,19 +1041,10 @@ Status Cloner::copyDb(OperationContext* txn,
         if (_conn.get()) {
             // nothing to do
         } else if (!masterSameProcess) {
-            std::string errmsg;
-            unique_ptr<DBClientBase> con(cs.connect(errmsg));
-            if (!con.get()) {
-                return Status(ErrorCodes::HostUnreachable, errmsg);
-            }
-
-            if (getGlobalAuthorizationManager()->isAuthEnabled() &&
-                !authenticateInternalUser(con.get())) {
-                return Status(ErrorCodes::AuthenticationFailed,
-                              "Unable to authenticate as internal user");
+            Status status = connectToSource(cs, &_conn);
+            if (!status.isOK()) {
+                return status;
             }
-
-            _conn = std::move(con);
         } else {
             _conn.reset(new DBDirectClient(txn));
         }
@@ -567,99 +1120,23 @@ Status Cloner::copyDb(OperationContext* txn,
                 repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(toDBName));
 
     if (opts.syncData) {
-        for (list<BSONObj>::iterator i = toClone.begin(); i != toClone.end(); i++) {
-            BSONObj collection = *i;
-            LOG(2) << "  really will clone: " << collection << endl;
-            const char* collectionName = collection["name"].valuestr();
-            BSONObj options = collection.getObjectField("options");
-
-            const NamespaceString from_name(opts.fromDB, collectionName);
-            const NamespaceString to_name(toDBName, collectionName);
-
-            Database* db = dbHolder().openDb(txn, toDBName);
-
-            {
-                MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
-                    WriteUnitOfWork wunit(txn);
-
-                    // we defer building id index for performance - building it in batch is much
-                    // faster
-                    Status createStatus = userCreateNS(txn, db, to_name.ns(), options, false);
-                    if (!createStatus.isOK()) {
-                        return createStatus;
-                    }
-
-                    wunit.commit();
-                }
-                MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createCollection", to_name.ns());
-            }
-
-            LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
-            Query q;
-            if (opts.snapshot)
-                q.snapshot();
-
-            copy(txn,
-                 toDBName,
-                 from_name,
-                 options,
-                 to_name,
-                 masterSameProcess,
-                 opts.slaveOk,
-                 opts.mayYield,
-                 opts.mayBeInterrupted,
-                 q);
-
-            // Copy releases the lock, so we need to re-load the database. This should
-            // probably throw if the database has changed in between, but for now preserve
-            // the existing behaviour.
-            db = dbHolder().get(txn, toDBName);
-            uassert(18645, str::stream() << "database " << toDBName << " dropped during clone", db);
-
-            Collection* c = db->getCollection(to_name);
-            if (c && !c->getIndexCatalog()->haveIdIndex(txn)) {
-                // We need to drop objects with duplicate _ids because we didn't do a true
-                // snapshot and this is before applying oplog operations that occur during the
-                // initial sync.
-                set<RecordId> dups;
-
-                MultiIndexBlock indexer(txn, c);
-                if (opts.mayBeInterrupted)
-                    indexer.allowInterruption();
-
-                uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
-                uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
-
-                // This must be done before we commit the indexer. See the comment about
-                // dupsAllowed in IndexCatalog::_unindexRecord and SERVER-17487.
-                for (set<RecordId>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
-                    WriteUnitOfWork wunit(txn);
-                    BSONObj id;
-
-                    c->deleteDocument(
-                        txn, *it, true, true, txn->writesAreReplicated() ? &id : nullptr);
-                    wunit.commit();
-                }
-
-                if (!dups.empty()) {
-                    log() << "index build dropped: " << dups.size() << " dups";
-                }
-
-                WriteUnitOfWork wunit(txn);
-                indexer.commit();
-                if (txn->writesAreReplicated()) {
-                    getGlobalServiceContext()->getOpObserver()->onCreateIndex(
-                        txn,
-                        c->ns().getSystemIndexesCollection().c_str(),
-                        c->getIndexCatalog()->getDefaultIdIndexSpec());
+        if (opts.parallelCollections > 1 && !masterSameProcess && toClone.size() > 1) {
+            Status status = cloneCollectionsInParallel(txn, toDBName, cs, toClone, opts);
+            if (!status.isOK()) {
+                return status;
+            }
+        } else {
+            for (list<BSONObj>::iterator i = toClone.begin(); i != toClone.end(); i++) {
+                Status status = cloneCollection(txn, toDBName, *i, opts, masterSameProcess);
+                if (!status.isOK()) {
+                    return status;
                 }
-                wunit.commit();
             }
         }
     }
 
-    // now build the secondary indexes
-    if (opts.syncIndexes) {
+    // now build the secondary indexes, unless they were built while copying the data
+    if (opts.syncIndexes && !opts.syncData) {
         for (list<BSONObj>::iterator i = toClone.begin(); i != toClone.end(); i++) {
             BSONObj collection = *i;
             log() << "copying indexes for: " << collection;
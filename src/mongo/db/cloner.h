@@ -36,7 +36,10 @@
 namespace mongo {
 
 struct CloneOptions;
+class CloneProgress;
+class ConnectionString;
 class DBClientBase;
+class MultiIndexBlock;
 class NamespaceString;
 class OperationContext;
 
@@ -78,7 +81,11 @@ private:
               bool slaveOk,
               bool mayYield,
               bool mayBeInterrupted,
-              Query q);
+              Query q,
+              MultiIndexBlock* idIndexer,
+              MultiIndexBlock* indexer,
+              CloneProgress* progress,
+              const BSONObj& resumeAfterId);
 
     void copyIndexes(OperationContext* txn,
                      const std::string& toDBName,
@@ -90,16 +97,90 @@ private:
                      bool mayYield,
                      bool mayBeInterrupted);
 
+    /**
+     * Creates the collection described by the listCollections entry 'collectionInfo' in
+     * 'toDBName' and copies its documents. If 'opts.syncIndexes' is set, all of the source's
+     * indexes are built in the same pass; otherwise only the _id index is built, afterwards.
+     *
+     * With 'opts.progress', skips collections that an earlier clone finished, and continues
+     * the ones it copied part of from the last checkpointed _id where possible.
+     *
+     * Expects the target database to be locked in MODE_X.
+     */
+    Status cloneCollection(OperationContext* txn,
+                           const std::string& toDBName,
+                           const BSONObj& collectionInfo,
+                           const CloneOptions& opts,
+                           bool masterSameProcess);
+
+    /**
+     * Runs cloneCollection() for each entry in 'toClone' on up to 'opts.parallelCollections'
+     * threads, each with its own connection to 'source'. Returns the first error, after which
+     * no further collections are started.
+     *
+     * Only the network reads overlap: each worker takes the target database's MODE_X lock to
+     * insert a batch or to commit its indexes, so those writes are still serialized. Nor is
+     * the memory bounded beyond the number of threads; every collection in flight holds an
+     * external sorter, of up to 100MB, for each index being built.
+     *
+     * Expects the target database to be locked in MODE_X.
+     */
+    Status cloneCollectionsInParallel(OperationContext* txn,
+                                      const std::string& toDBName,
+                                      const ConnectionString& source,
+                                      const std::list<BSONObj>& toClone,
+                                      const CloneOptions& opts);
+
     struct Fun;
     std::unique_ptr<DBClientBase> _conn;
 };
 
+/**
+ * Durable record of how far a clone got, so that an interrupted clone can carry on where it
+ * left off instead of starting over. See repl::InitialSyncProgress.
+ *
+ * Collections that the source has an _id index for are copied in _id order, and the _id of the
+ * last document of each batch is recorded in the same unit of work as the batch.
+ */
+class CloneProgress {
+public:
+    virtual ~CloneProgress() = default;
+
+    /**
+     * Returns true if 'nss' was completely cloned, indexes included.
+     */
+    virtual bool isDone(OperationContext* txn, const NamespaceString& nss) = 0;
+
+    /**
+     * Returns the _id, as {_id: <value>}, of the last document copied into 'nss', or an empty
+     * object if there is none.
+     */
+    virtual BSONObj getLastId(OperationContext* txn, const NamespaceString& nss) = 0;
+
+    /**
+     * Called in the unit of work that inserts the batch of documents ending with 'lastId'.
+     */
+    virtual void setLastId(OperationContext* txn,
+                           const NamespaceString& nss,
+                           const BSONObj& lastId) = 0;
+
+    /**
+     * Called in the unit of work that commits the indexes of 'nss'.
+     */
+    virtual void setDone(OperationContext* txn, const NamespaceString& nss) = 0;
+};
+
 /**
  *  slaveOk     - if true it is ok if the source of the data is !ismaster.
  *  useReplAuth - use the credentials we normally use as a replication slave for the cloning
  *  snapshot    - use $snapshot mode for copying collections.  note this should not be used
  *                when it isn't required, as it will be slower.  for example,
  *                repairDatabase need not use it.
+ *  parallelCollections - how many collections to copy at once.  each extra collection is
+ *                copied over its own connection, authenticated as the internal user.  only
+ *                used when copying from another process.
+ *  progress    - if set, where to record and look up how far the clone got.  requires
+ *                syncIndexes.
  */
 struct CloneOptions {
     CloneOptions() {
@@ -111,6 +192,9 @@ struct CloneOptions {
 
         syncData = true;
         syncIndexes = true;
+
+        parallelCollections = 1;
+        progress = NULL;
     }
 
     std::string fromDB;
@@ -124,6 +208,9 @@ struct CloneOptions {
 
     bool syncData;
     bool syncIndexes;
+
+    int parallelCollections;
+    CloneProgress* progress;
 };
 
 }  // namespace mongo
@@ -30,6 +30,7 @@
 
 #define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kCommand
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -39,6 +40,7 @@
 #include "mongo/db/background.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
+#include "mongo/db/client.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/curop.h"
@@ -48,6 +50,7 @@
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/util/log.h"
+#include "mongo/util/progress_meter.h"
 
 namespace mongo {
 
@@ -83,7 +86,11 @@ public:
                 "  [paddingFactor:<num>], [paddingBytes:<num>] }\n"
                 "  force - allows to run on a replica set primary\n"
                 "  validate - check records are noncorrupt before adding to newly compacting "
-                "extents. slower but safer (defaults to true in this version)\n";
+                "extents. slower but safer (defaults to true in this version)\n"
+                "{ compact : <collection_name>, online : true, [batchSize:<num>] }\n"
+                "  online - move documents from the end of the collection into free space in "
+                "small batches, yielding locks in between. can run on a primary\n"
+                "  batchSize - documents to move each time the locks are taken (default 100)\n";
     }
     CompactCmd() : Command("compact") {}
 
@@ -94,9 +101,10 @@ public:
                      string& errmsg,
                      BSONObjBuilder& result) {
         const std::string nsToCompact = parseNsCollectionRequired(db, cmdObj);
+        const bool online = cmdObj["online"].trueValue();
 
         repl::ReplicationCoordinator* replCoord = repl::getGlobalReplicationCoordinator();
-        if (replCoord->getMemberState().primary() && !cmdObj["force"].trueValue()) {
+        if (replCoord->getMemberState().primary() && !online && !cmdObj["force"].trueValue()) {
             errmsg =
                 "will not run compact on an active replica set primary as this is a slow blocking "
                 "operation. use force:true to force";
@@ -116,6 +124,25 @@ public:
             return false;
         }
 
+        if (online) {
+            if (cmdObj.hasElement("preservePadding") || cmdObj.hasElement("paddingFactor") ||
+                cmdObj.hasElement("paddingBytes")) {
+                errmsg = "cannot specify padding for an online compact";
+                return false;
+            }
+
+            int batchSize = kDefaultOnlineBatchSize;
+            if (cmdObj.hasElement("batchSize")) {
+                batchSize = cmdObj["batchSize"].numberInt();
+                if (batchSize <= 0) {
+                    errmsg = "batchSize must be positive";
+                    return false;
+                }
+            }
+
+            return runOnline(txn, nss, batchSize, errmsg, result);
+        }
+
         CompactOptions compactOptions;
 
         if (cmdObj["preservePadding"].trueValue()) {
@@ -179,6 +206,98 @@ public:
 
         return true;
     }
+
+private:
+    static const int kDefaultOnlineBatchSize = 100;
+
+    /**
+     * Compacts 'nss' a batch of documents at a time, only holding the locks a write would for
+     * each batch, so other operations can run in between.
+     */
+    bool runOnline(OperationContext* txn,
+                   const NamespaceString& nss,
+                   int batchSize,
+                   string& errmsg,
+                   BSONObjBuilder& result) {
+        // Keeps index builds, drops and other compactions away while the locks are released.
+        std::unique_ptr<BackgroundOperation> backgroundOp;
+        long long numRecords = 0;
+        {
+            ScopedTransaction transaction(txn, MODE_IX);
+            AutoGetDb autoDb(txn, nss.db(), MODE_IX);
+            Lock::CollectionLock collLock(txn->lockState(), nss.ns(), MODE_IX);
+            Collection* collection = autoDb.getDb() ? autoDb.getDb()->getCollection(nss) : NULL;
+            if (!collection) {
+                errmsg = "namespace does not exist";
+                return false;
+            }
+            if (collection->isCapped()) {
+                errmsg = "cannot compact a capped collection";
+                return false;
+            }
+
+            BackgroundOperation::assertNoBgOpInProgForNs(nss.ns());
+            backgroundOp.reset(new BackgroundOperation(nss.ns()));
+            numRecords = collection->numRecords(txn);
+        }
+
+        log() << "compact " << nss.ns() << " begin, online, batchSize: " << batchSize;
+
+        // The total is only an upper bound, as documents are moved until there is no room left.
+        stdx::unique_lock<Client> lk(*txn->getClient());
+        ProgressMeterHolder pm(*txn->setMessage_inlock(
+            "compact online", "Online Compacting Progress (documents moved)", numRecords));
+        lk.unlock();
+
+        CompactStats stats;
+        Status status = Status::OK();
+        try {
+            bool done = false;
+            while (!done) {
+                txn->checkForInterrupt();
+
+                ScopedTransaction transaction(txn, MODE_IX);
+                AutoGetDb autoDb(txn, nss.db(), MODE_IX);
+                Lock::CollectionLock collLock(txn->lockState(), nss.ns(), MODE_IX);
+                Collection* collection =
+                    autoDb.getDb() ? autoDb.getDb()->getCollection(nss) : NULL;
+                if (!collection) {
+                    status = Status(ErrorCodes::NamespaceNotFound,
+                                    "collection was dropped during online compact");
+                    break;
+                }
+
+                const long long movedBefore = stats.documentsMoved;
+                StatusWith<bool> batch = collection->compactOnline(txn, batchSize, &stats);
+                if (!batch.isOK()) {
+                    status = batch.getStatus();
+                    break;
+                }
+                done = batch.getValue();
+                pm.hit(stats.documentsMoved - movedBefore);
+            }
+        } catch (const DBException& ex) {
+            status = ex.toStatus();
+        }
+
+        // Always let the collection put back anything it set aside, even when interrupted.
+        {
+            ScopedTransaction transaction(txn, MODE_IX);
+            AutoGetDb autoDb(txn, nss.db(), MODE_IX);
+            Lock::CollectionLock collLock(txn->lockState(), nss.ns(), MODE_IX);
+            Collection* collection = autoDb.getDb() ? autoDb.getDb()->getCollection(nss) : NULL;
+            if (collection)
+                collection->compactOnlineStop(txn);
+        }
+        pm.finished();
+
+        log() << "compact " << nss.ns() << " end, online, moved " << stats.documentsMoved
+              << " documents, freed " << stats.bytesFreed << " bytes: " << status;
+
+        result.appendNumber("documentsMoved", stats.documentsMoved);
+        result.appendNumber("bytesFreed", stats.bytesFreed);
+        return appendCommandStatus(result, status);
+    }
 };
 static CompactCmd compactCmd;
 }
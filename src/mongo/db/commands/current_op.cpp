@@ -125,6 +125,8 @@ public:
             infoBuilder.appendBool("active", static_cast<bool>(opCtx));
             if (opCtx) {
                 infoBuilder.append("opid", opCtx->getOpID());
+                infoBuilder.append("lockerId",
+                                   static_cast<long long>(opCtx->lockState()->getId()));
                 if (opCtx->isKillPending()) {
                     infoBuilder.append("killPending", true);
                 }
@@ -31,6 +31,7 @@
 #include "mongo/platform/basic.h"
 
 #include <memory>
+#include <snappy.h>
 #include <string>
 
 #include "mongo/base/disallow_copying.h"
@@ -329,7 +330,16 @@ public:
             CurOp::get(txn)->debug().cursorExhausted = true;
         }
 
-        appendGetMoreResponseObject(respondWithId, request.nss.ns(), nextBatch.arr(), &result);
+        if (request.compression) {
+            // The request was validated to ask for snappy, the only compression supported.
+            BSONArray batch = nextBatch.arr();
+            std::string compressed;
+            snappy::Compress(batch.objdata(), batch.objsize(), &compressed);
+            appendCompressedGetMoreResponseObject(
+                respondWithId, request.nss.ns(), compressed, &result);
+        } else {
+            appendGetMoreResponseObject(respondWithId, request.nss.ns(), nextBatch.arr(), &result);
+        }
 
         if (respondWithId) {
             cursorFreer.Dismiss();
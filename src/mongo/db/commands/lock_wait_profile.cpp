@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/concurrency/lock_wait_profiler.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+/**
+ * Reports the lock waits sampled by the LockWaitProfiler, that is which locker waited for which
+ * other locker on which resource and for how long. The locker ids match the "lockerId" field of
+ * currentOp, so that the operations involved can be found while the waits are still going on.
+ *
+ * {lockWaitProfile: 1, clear: true} also discards the samples after reporting them.
+ */
+class LockWaitProfileCommand : public Command {
+public:
+    LockWaitProfileCommand() : Command("lockWaitProfile") {}
+
+    bool isWriteCommandForConfigServer() const final {
+        return false;
+    }
+
+    bool slaveOk() const final {
+        return true;
+    }
+
+    bool adminOnly() const final {
+        return true;
+    }
+
+    void help(std::stringstream& help) const final {
+        help << "recently sampled lock waits and what they waited for, oldest first\n"
+             << "{ lockWaitProfile: 1, clear: <bool> }";
+    }
+
+    Status checkAuthForCommand(ClientBasic* client,
+                               const std::string& dbname,
+                               const BSONObj& cmdObj) final {
+        bool isAuthorized = AuthorizationSession::get(client)->isAuthorizedForActionsOnResource(
+            ResourcePattern::forClusterResource(), ActionType::inprog);
+        return isAuthorized ? Status::OK() : Status(ErrorCodes::Unauthorized, "Unauthorized");
+    }
+
+    bool run(OperationContext* txn,
+             const std::string& db,
+             BSONObj& cmdObj,
+             int options,
+             std::string& errmsg,
+             BSONObjBuilder& result) final {
+        LockWaitProfiler* profiler = getGlobalLockWaitProfiler();
+
+        const std::vector<LockWaitSample> samples = profiler->getSamples();
+        result.append("numRecorded", static_cast<long long>(profiler->getNumRecorded()));
+
+        BSONArrayBuilder samplesBuilder(result.subarrayStart("samples"));
+        for (size_t i = 0; i < samples.size(); i++) {
+            BSONObjBuilder sampleBuilder(samplesBuilder.subobjStart());
+            samples[i].report(&sampleBuilder);
+            sampleBuilder.done();
+        }
+        samplesBuilder.done();
+
+        if (cmdObj["clear"].trueValue()) {
+            profiler->clear();
+        }
+
+        return true;
+    }
+
+} lockWaitProfileCommand;
+
+}  // namespace mongo
@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/stats/slow_op_profiler.h"
+
+namespace mongo {
+
+/**
+ * Reports the slow operations kept by the SlowOpProfiler, in the format of system.profile
+ * documents. Operations are slow if they would be logged, that is if they took longer than
+ * slowms.
+ *
+ * {slowOps: 1, ns: <string>} only reports operations on the given namespace, and
+ * {slowOps: 1, clear: true} also discards the operations after reporting them.
+ */
+class SlowOpsCommand : public Command {
+public:
+    SlowOpsCommand() : Command("slowOps") {}
+
+    bool isWriteCommandForConfigServer() const final {
+        return false;
+    }
+
+    bool slaveOk() const final {
+        return true;
+    }
+
+    bool adminOnly() const final {
+        return true;
+    }
+
+    void help(std::stringstream& help) const final {
+        help << "recent operations which took longer than slowms, oldest first\n"
+             << "{ slowOps: 1, ns: <string>, clear: <bool> }";
+    }
+
+    Status checkAuthForCommand(ClientBasic* client,
+                               const std::string& dbname,
+                               const BSONObj& cmdObj) final {
+        bool isAuthorized = AuthorizationSession::get(client)->isAuthorizedForActionsOnResource(
+            ResourcePattern::forClusterResource(), ActionType::inprog);
+        return isAuthorized ? Status::OK() : Status(ErrorCodes::Unauthorized, "Unauthorized");
+    }
+
+    bool run(OperationContext* txn,
+             const std::string& db,
+             BSONObj& cmdObj,
+             int options,
+             std::string& errmsg,
+             BSONObjBuilder& result) final {
+        const BSONElement nsElt = cmdObj["ns"];
+        if (!nsElt.eoo() && nsElt.type() != String) {
+            errmsg = "ns must be a string";
+            return false;
+        }
+
+        SlowOpProfiler* profiler = getGlobalSlowOpProfiler();
+
+        const std::vector<BSONObj> ops = profiler->getOps();
+        result.append("numRecorded", static_cast<long long>(profiler->getNumRecorded()));
+
+        // Leave room for the rest of the reply; the most recent operations are the ones dropped
+        const int maxOpsSize = BSONObjMaxUserSize - 1024 * 1024;
+        bool truncated = false;
+
+        BSONArrayBuilder opsBuilder(result.subarrayStart("ops"));
+        for (size_t i = 0; i < ops.size(); i++) {
+            if (!nsElt.eoo() && ops[i]["ns"].str() != nsElt.str()) {
+                continue;
+            }
+
+            if (opsBuilder.len() + ops[i].objsize() > maxOpsSize) {
+                truncated = true;
+                break;
+            }
+
+            opsBuilder.append(ops[i]);
+        }
+        opsBuilder.done();
+
+        if (truncated) {
+            result.append("truncated", true);
+        }
+
+        if (cmdObj["clear"].trueValue()) {
+            profiler->clear();
+        }
+
+        return true;
+    }
+
+} slowOpsCommand;
+
+}  // namespace mongo
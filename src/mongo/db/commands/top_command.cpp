@@ -56,7 +56,8 @@ public:
         return false;
     }
     virtual void help(std::stringstream& help) const {
-        help << "usage by collection, in micros ";
+        help << "usage by collection, in micros\n"
+             << "{ top: 1, histograms: <bool> } also reports the latency histograms' buckets";
     }
     virtual void addRequiredPrivileges(const std::string& dbname,
                                        const BSONObj& cmdObj,
@@ -74,7 +75,8 @@ public:
         {
             BSONObjBuilder b(result.subobjStart("totals"));
             b.append("note", "all times in microseconds");
-            Top::get(txn->getClient()->getServiceContext()).append(b);
+            Top::get(txn->getClient()->getServiceContext())
+                .append(b, cmdObj["histograms"].trueValue());
             b.done();
         }
         return true;
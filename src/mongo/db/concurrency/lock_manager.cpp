@@ -154,6 +154,7 @@ struct LockHead {
 
         conversionsCount = 0;
         compatibleFirstCount = 0;
+        fastPathCount = 0;
     }
 
     /**
@@ -255,6 +256,34 @@ struct LockHead {
         }
     }
 
+    // Methods to account for requests granted through the FastPathLock, which are not on the
+    // granted queue, but must be counted as granted while the fast path is closed.
+    void incFastPathModeCount(LockMode mode, uint32_t count) {
+        if (count == 0) {
+            return;
+        }
+        if (grantedCounts[mode] == 0) {
+            invariant((grantedModes & modeMask(mode)) == 0);
+            grantedModes |= modeMask(mode);
+        }
+        grantedCounts[mode] += count;
+        fastPathCount += count;
+    }
+
+    void decFastPathModeCount(LockMode mode, uint32_t count) {
+        if (count == 0) {
+            return;
+        }
+        invariant(grantedCounts[mode] >= count);
+        invariant(fastPathCount >= count);
+        grantedCounts[mode] -= count;
+        fastPathCount -= count;
+        if (grantedCounts[mode] == 0) {
+            invariant((grantedModes & modeMask(mode)) == modeMask(mode));
+            grantedModes &= ~modeMask(mode);
+        }
+    }
+
     // Methods to maintain the conflict queue
     void incConflictModeCount(LockMode mode) {
         invariant(conflictCounts[mode] >= 0);
@@ -331,6 +360,14 @@ struct LockHead {
     // be switched to compatible-first. As long as this value is > 0, the policy will stay
     // compatible-first.
     uint32_t compatibleFirstCount;
+
+    //
+    // Fast path
+    //
+
+    // Counts the requests granted through the resource's FastPathLock, which are included in
+    // grantedCounts, but are on no list. Only non-zero while the fast path is closed.
+    uint32_t fastPathCount;
 };
 
 /**
@@ -378,6 +415,162 @@ struct PartitionedLockHead {
     LockRequestList grantedList;
 };
 
+/**
+ * The FastPathLock further optimizes intent requests on the global and database resources,
+ * which nearly every operation acquires. Rather than keeping a list of its requests, it only
+ * counts how many have been granted in each intent mode, in a single word, so that granting and
+ * releasing them is one atomic compare-and-swap, without taking any mutex.
+ *
+ * While the resource has requests in other modes, the fast path is closed and the requests it
+ * granted are counted on the LockHead instead, so that conflicting requests wait for them as for
+ * any other. Intent requests are then granted through the LockHead or its partitions, until one
+ * finds no conflicting modes there and reopens the fast path.
+ *
+ * A resource can only use the FastPathLock its hash maps to, and resources which find it
+ * claimed by another simply use the regular path. cleanupUnusedLocks() gives up the claim of
+ * any resource without fast path requests, like it frees unused LockHeads. Every such release
+ * bumps a generation number in 'state', so that a request which looked up the lock before can't
+ * be granted on it after it changes hands.
+ *
+ * Requests granted through the fast path are invisible to the DeadlockDetector, as they are on
+ * no list, and getBlocker() and dump() can only report how many there are. They are still kept
+ * by their Locker, so currentOp reports them like any other. Since intent modes are compatible
+ * with each other, such a request can only be part of a cycle with requests in other modes,
+ * which the detector only approximates anyway.
+ */
+struct FastPathLock {
+    // Layout of 'state': the number of MODE_IS requests in the low 24 bits, the number of
+    // MODE_IX requests in the next 24, the generation in the next 15 and the top bit set while
+    // closed.
+    static const uint64_t kCountMask = (1ULL << 24) - 1;
+    static const uint64_t kCountsMask = (1ULL << 48) - 1;
+    static const uint64_t kGeneration = 1ULL << 48;
+    static const uint64_t kClosed = 1ULL << 63;
+
+    static uint64_t unit(LockMode mode) {
+        return mode == MODE_IS ? 1ULL : (1ULL << 24);
+    }
+
+    static uint32_t count(uint64_t state, LockMode mode) {
+        return mode == MODE_IS ? (state & kCountMask) : ((state >> 24) & kCountMask);
+    }
+
+    /**
+     * Grants one more request on 'resId' in the given intent mode, unless the fast path is
+     * closed or the lock no longer belongs to 'resId'.
+     */
+    bool tryLock(ResourceId resId, LockMode mode) {
+        uint64_t current = state.load();
+        while (!(current & kClosed)) {
+            // Checked after loading the state, which changes before the lock is given up
+            if (resourceHash.load() != resId) {
+                return false;
+            }
+
+            const uint64_t previous = state.compareAndSwap(current, current + unit(mode));
+            if (previous == current) {
+                return true;
+            }
+            current = previous;
+        }
+        return false;
+    }
+
+    /**
+     * Changes the mode of a request granted through this lock from MODE_IS to MODE_IX, unless
+     * the fast path is closed.
+     */
+    bool tryConvert(LockMode mode, LockMode newMode) {
+        uint64_t current = state.load();
+        while (!(current & kClosed)) {
+            invariant(count(current, mode) > 0);
+            const uint64_t previous =
+                state.compareAndSwap(current, current - unit(mode) + unit(newMode));
+            if (previous == current) {
+                return true;
+            }
+            current = previous;
+        }
+        return false;
+    }
+
+    /**
+     * Releases one request in the given intent mode, unless the fast path is closed, in which
+     * case the request must be released through the LockHead.
+     */
+    bool tryUnlock(LockMode mode) {
+        uint64_t current = state.load();
+        while (!(current & kClosed)) {
+            invariant(count(current, mode) > 0);
+            const uint64_t previous = state.compareAndSwap(current, current - unit(mode));
+            if (previous == current) {
+                return true;
+            }
+            current = previous;
+        }
+        return false;
+    }
+
+    /**
+     * Closes the fast path and returns the state from before, from which the caller must
+     * account for the requests granted so far. The state can only change under the bucket
+     * mutex while closed.
+     */
+    uint64_t close() {
+        uint64_t current = state.load();
+        while (!(current & kClosed)) {
+            const uint64_t previous = state.compareAndSwap(current, current | kClosed);
+            if (previous == current) {
+                break;
+            }
+            current = previous;
+        }
+        return current;
+    }
+
+    /**
+     * Closes the fast path for good if no requests are granted through it, bumping the
+     * generation, so that the caller may give up the resource's claim on it. While closed, the
+     * state only changes under the bucket mutex, which the caller must hold.
+     */
+    bool tryRelease() {
+        uint64_t current = state.load();
+        while (!(current & kCountsMask)) {
+            const uint64_t generation = (current + kGeneration) & ~kClosed & ~kCountsMask;
+            const uint64_t previous = state.compareAndSwap(current, generation | kClosed);
+            if (previous == current) {
+                return true;
+            }
+            current = previous;
+        }
+        return false;
+    }
+
+    void newRequest(LockRequest* request, LockMode mode) {
+        request->lock = NULL;
+        request->partitionedLock = NULL;
+        request->fastPathLock = this;
+        request->recursiveCount = 1;
+        request->status = LockRequest::STATUS_GRANTED;
+        request->partitioned = false;
+        request->mode = mode;
+    }
+
+    // Full hash of the resource which claimed this lock, or zero if none did yet
+    AtomicUInt64 resourceHash;
+
+    // Counts of granted requests and the closed bit, see above
+    AtomicUInt64 state;
+
+    // The LockHead which accounts for the granted requests while closed. Only accessed under
+    // the bucket mutex.
+    LockHead* closedLock;
+
+    // Each FastPathLock is updated by every operation on its resource, so keep them from
+    // sharing cache lines.
+    char padding[64 - 2 * sizeof(AtomicUInt64) - sizeof(LockHead*)];
+};
+
 void LockHead::migratePartitionedLockHeads() {
     invariant(partitioned());
     // There can't be non-intent modes or conflicts when the lock is partitioned
@@ -420,9 +613,16 @@ const unsigned LockManager::_numLockBuckets(128);
 // The exact value doesn't appear very important, but should be power of two
 const unsigned LockManager::_numPartitions = 32;
 
+// Enough for the global resource and a good number of databases. Power of two, as above.
+const unsigned LockManager::_numFastPathLocks = 128;
+
 LockManager::LockManager() {
     _lockBuckets = new LockBucket[_numLockBuckets];
     _partitions = new Partition[_numPartitions];
+    _fastPathLocks = new FastPathLock[_numFastPathLocks];
+    for (unsigned i = 0; i < _numFastPathLocks; i++) {
+        _fastPathLocks[i].closedLock = NULL;
+    }
 }
 
 LockManager::~LockManager() {
@@ -435,6 +635,7 @@ LockManager::~LockManager() {
 
     delete[] _lockBuckets;
     delete[] _partitions;
+    delete[] _fastPathLocks;
 }
 
 LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mode) {
@@ -443,7 +644,18 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
 
     request->partitioned = (mode == MODE_IX || mode == MODE_IS);
 
-    // For intent modes, try the PartitionedLockHead
+    // For intent modes, try the FastPathLock first. Compatible-first requests need to be
+    // counted on the LockHead, so they can't use it.
+    FastPathLock* fastPathLock = NULL;
+    if (request->partitioned && !request->compatibleFirst) {
+        fastPathLock = _getFastPathLock(resId);
+        if (fastPathLock && fastPathLock->tryLock(resId, mode)) {
+            fastPathLock->newRequest(request, mode);
+            return LOCK_OK;
+        }
+    }
+
+    // Then try the PartitionedLockHead
     if (request->partitioned) {
         Partition* partition = _getPartition(request);
         stdx::lock_guard<SimpleMutex> scopedLock(partition->mutex);
@@ -468,6 +680,13 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
 
     // Start a partitioned lock if possible
     if (request->partitioned && !(lock->grantedModes & (~intentModes)) && !lock->conflictModes) {
+        // Nothing conflicts anymore, so the fast path can be reopened if it was closed.
+        if (fastPathLock && _reopenFastPath(lock, fastPathLock)) {
+            invariant(fastPathLock->tryLock(resId, mode));
+            fastPathLock->newRequest(request, mode);
+            return LOCK_OK;
+        }
+
         Partition* partition = _getPartition(request);
         stdx::lock_guard<SimpleMutex> scopedLock(partition->mutex);
         PartitionedLockHead* partitionedLock = partition->findOrInsert(resId);
@@ -477,7 +696,9 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
         return LOCK_OK;
     }
 
-    // For the first lock with a non-intent mode, migrate requests from partitioned lock heads
+    // For the first lock with a non-intent mode, stop using the fast path and migrate requests
+    // from partitioned lock heads
+    _closeFastPath(lock);
     if (lock->partitioned()) {
         lock->migratePartitionedLockHeads();
     }
@@ -503,6 +724,13 @@ LockResult LockManager::convert(ResourceId resId, LockRequest* request, LockMode
         return LOCK_OK;
     }
 
+    // A request granted through the fast path can go from MODE_IS to MODE_IX there as well
+    if (request->fastPathLock && newMode == MODE_IX &&
+        request->fastPathLock->tryConvert(request->mode, newMode)) {
+        request->mode = newMode;
+        return LOCK_OK;
+    }
+
     // TODO: For the time being we do not need conversions between unrelated lock modes (i.e.,
     // modes which both add and remove to the conflicts set), so these are not implemented yet
     // (e.g., S -> IX).
@@ -512,15 +740,33 @@ LockResult LockManager::convert(ResourceId resId, LockRequest* request, LockMode
     LockBucket* bucket = _getBucket(resId);
     stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
 
-    LockBucket::Map::iterator it = bucket->data.find(resId);
-    invariant(it != bucket->data.end());
-
-    LockHead* const lock = it->second;
+    LockHead* lock;
+    if (request->fastPathLock) {
+        // There may not be a LockHead yet if all requests went through the fast path
+        lock = bucket->findOrInsert(resId);
+    } else {
+        LockBucket::Map::iterator it = bucket->data.find(resId);
+        invariant(it != bucket->data.end());
+        lock = it->second;
+    }
 
+    _closeFastPath(lock);
     if (lock->partitioned()) {
         lock->migratePartitionedLockHeads();
     }
 
+    // Conversions are handled on the granted list, so move the request there. Its mode is
+    // already counted on the LockHead, now that the fast path is closed.
+    if (request->fastPathLock) {
+        request->fastPathLock->state.fetchAndSubtract(FastPathLock::unit(request->mode));
+        invariant(lock->fastPathCount > 0);
+        lock->fastPathCount--;
+
+        request->fastPathLock = NULL;
+        request->lock = lock;
+        lock->grantedList.push_back(request);
+    }
+
     // Construct granted mask without our current mode, so that it is not counted as
     // conflicting
     uint32_t grantedModesWithoutCurrentRequest = 0;
@@ -572,6 +818,31 @@ bool LockManager::unlock(LockRequest* request) {
         return false;
     }
 
+    if (request->fastPathLock) {
+        invariant(request->status == LockRequest::STATUS_GRANTED);
+        FastPathLock* fastPathLock = request->fastPathLock;
+        if (fastPathLock->tryUnlock(request->mode)) {
+            return true;
+        }
+
+        // The fast path is closed, so the request is counted on the LockHead. Only the bucket
+        // mutex keeps it closed, and the hash is all there is to find the bucket with.
+        LockBucket* bucket = &_lockBuckets[fastPathLock->resourceHash.load() % _numLockBuckets];
+        stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
+
+        if (fastPathLock->tryUnlock(request->mode)) {
+            // Reopened in the meantime
+            return true;
+        }
+
+        fastPathLock->state.fetchAndSubtract(FastPathLock::unit(request->mode));
+
+        LockHead* lock = fastPathLock->closedLock;
+        lock->decFastPathModeCount(request->mode, 1);
+        _onLockModeChanged(lock, lock->grantedCounts[request->mode] == 0);
+        return true;
+    }
+
     if (request->partitioned) {
         // Unlocking a lock that was acquired as partitioned. The lock request may since have
         // moved to the lock head, but there is no safe way to find out without synchronizing
@@ -679,6 +950,7 @@ void LockManager::cleanupUnusedLocks() {
                 invariant(lock->conflictList._back == NULL);
                 invariant(lock->conversionsCount == 0);
                 invariant(lock->compatibleFirstCount == 0);
+                invariant(lock->fastPathCount == 0);
 
                 bucket->data.erase(it++);
                 deletedLockHeads++;
@@ -688,6 +960,73 @@ void LockManager::cleanupUnusedLocks() {
             }
         }
     }
+
+    for (unsigned i = 0; i < _numFastPathLocks; i++) {
+        FastPathLock* fastPathLock = &_fastPathLocks[i];
+        const uint64_t hash = fastPathLock->resourceHash.load();
+        if (hash == 0) {
+            continue;
+        }
+
+        // Only the bucket mutex keeps a closed fast path from being reopened
+        LockBucket* bucket = &_lockBuckets[hash % _numLockBuckets];
+        stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
+        if (fastPathLock->tryRelease()) {
+            fastPathLock->closedLock = NULL;
+            fastPathLock->resourceHash.store(0);
+        }
+    }
+}
+
+bool LockManager::getBlocker(const LockRequest* request, LockerId* lockerId, LockMode* mode) {
+    // A waiting request is always on a LockHead, which can't go away while it is there
+    LockHead* lock = request->lock;
+    if (!lock) {
+        return false;
+    }
+
+    LockBucket* bucket = _getBucket(lock->resourceId);
+    stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
+
+    LockMode waitMode;
+    if (request->status == LockRequest::STATUS_WAITING) {
+        waitMode = request->mode;
+    } else if (request->status == LockRequest::STATUS_CONVERTING) {
+        waitMode = request->convertMode;
+    } else {
+        return false;
+    }
+
+    for (const LockRequest* iter = lock->grantedList._front; iter != NULL; iter = iter->next) {
+        if (iter != request && conflicts(waitMode, modeMask(iter->mode))) {
+            *lockerId = iter->locker->getId();
+            *mode = iter->mode;
+            return true;
+        }
+    }
+
+    if (lock->fastPathCount > 0) {
+        const LockMode fastPathModes[] = {MODE_IX, MODE_IS};
+        for (size_t i = 0; i < sizeof(fastPathModes) / sizeof(fastPathModes[0]); i++) {
+            const LockMode fastPathMode = fastPathModes[i];
+            if (lock->grantedCounts[fastPathMode] && conflicts(waitMode, modeMask(fastPathMode))) {
+                *lockerId = 0;
+                *mode = fastPathMode;
+                return true;
+            }
+        }
+    }
+
+    for (const LockRequest* iter = lock->conflictList._front; iter != request && iter != NULL;
+         iter = iter->next) {
+        if (conflicts(waitMode, modeMask(iter->mode))) {
+            *lockerId = iter->locker->getId();
+            *mode = iter->mode;
+            return true;
+        }
+    }
+
+    return false;
 }
 
 void LockManager::_onLockModeChanged(LockHead* lock, bool checkConflictQueue) {
@@ -781,7 +1120,8 @@ void LockManager::_onLockModeChanged(LockHead* lock, bool checkConflictQueue) {
 
     // This is a convenient place to check that the state of the two request queues is in sync
     // with the bitmask on the modes.
-    invariant((lock->grantedModes == 0) ^ (lock->grantedList._front != NULL));
+    invariant((lock->grantedModes == 0) ^
+              (lock->grantedList._front != NULL || lock->fastPathCount != 0));
     invariant((lock->conflictModes == 0) ^ (lock->conflictList._front != NULL));
 }
 
@@ -793,6 +1133,74 @@ LockManager::Partition* LockManager::_getPartition(LockRequest* request) const {
     return &_partitions[request->locker->getId() % _numPartitions];
 }
 
+FastPathLock* LockManager::_getFastPathLock(ResourceId resId) const {
+    const ResourceType type = resId.getType();
+    if (type != RESOURCE_GLOBAL && type != RESOURCE_DATABASE) {
+        return NULL;
+    }
+
+    // Only ever looking in one place keeps a resource from claiming two locks at once
+    FastPathLock* fastPathLock = &_fastPathLocks[resId % _numFastPathLocks];
+
+    uint64_t hash = fastPathLock->resourceHash.load();
+    if (hash == 0) {
+        // Unclaimed, so try to claim it. Someone else may have beaten us to it.
+        hash = fastPathLock->resourceHash.compareAndSwap(0, resId);
+        if (hash == 0) {
+            return fastPathLock;
+        }
+    }
+
+    return hash == resId ? fastPathLock : NULL;
+}
+
+void LockManager::_closeFastPath(LockHead* lock) {
+    FastPathLock* fastPathLock = _getFastPathLock(lock->resourceId);
+    if (!fastPathLock) {
+        return;
+    }
+
+    const uint64_t state = fastPathLock->close();
+    if (state & FastPathLock::kClosed) {
+        // Already accounted for, though the LockHead may have been recreated since if there
+        // were no requests left.
+        invariant(fastPathLock->closedLock == lock || lock->fastPathCount == 0);
+        fastPathLock->closedLock = lock;
+        return;
+    }
+
+    lock->incFastPathModeCount(MODE_IS, FastPathLock::count(state, MODE_IS));
+    lock->incFastPathModeCount(MODE_IX, FastPathLock::count(state, MODE_IX));
+    fastPathLock->closedLock = lock;
+}
+
+bool LockManager::_reopenFastPath(LockHead* lock, FastPathLock* fastPathLock) {
+    invariant(!(lock->grantedModes & ~intentModes) && !lock->conflictModes);
+
+    // The resource may have given up the lock since looking it up
+    if (fastPathLock->resourceHash.load() != lock->resourceId) {
+        return false;
+    }
+
+    const uint64_t state = fastPathLock->state.load();
+    if (!(state & FastPathLock::kClosed)) {
+        return true;
+    }
+
+    // If the LockHead was recreated since closing, there are no requests left to account for
+    if (fastPathLock->closedLock == lock) {
+        lock->decFastPathModeCount(MODE_IS, FastPathLock::count(state, MODE_IS));
+        lock->decFastPathModeCount(MODE_IX, FastPathLock::count(state, MODE_IX));
+    } else {
+        invariant((state & FastPathLock::kCountsMask) == 0);
+    }
+    invariant(lock->fastPathCount == 0);
+
+    fastPathLock->closedLock = NULL;
+    fastPathLock->state.store(state & ~FastPathLock::kClosed);
+    return true;
+}
+
 void LockManager::dump() const {
     log() << "Dumping LockManager @ " << static_cast<const void*>(this) << '\n';
 
@@ -804,6 +1212,19 @@ void LockManager::dump() const {
             _dumpBucket(bucket);
         }
     }
+
+    for (unsigned i = 0; i < _numFastPathLocks; i++) {
+        const FastPathLock* fastPathLock = &_fastPathLocks[i];
+        const uint64_t state = fastPathLock->state.load();
+
+        if (FastPathLock::count(state, MODE_IS) || FastPathLock::count(state, MODE_IX)) {
+            log() << "FastPathLock @ " << static_cast<const void*>(fastPathLock) << ": "
+                  << "ResourceHash = " << fastPathLock->resourceHash.load() << "; "
+                  << "IS = " << FastPathLock::count(state, MODE_IS) << "; "
+                  << "IX = " << FastPathLock::count(state, MODE_IX) << "; "
+                  << "Closed = " << bool(state & FastPathLock::kClosed) << "; " << '\n';
+        }
+    }
 }
 
 void LockManager::_dumpBucket(const LockBucket* bucket) const {
@@ -1075,6 +1496,8 @@ void LockRequest::initNew(Locker* locker, LockGrantNotification* notify) {
     recursiveCount = 0;
 
     lock = NULL;
+    partitionedLock = NULL;
+    fastPathLock = NULL;
     prev = NULL;
     next = NULL;
     status = STATUS_NEW;
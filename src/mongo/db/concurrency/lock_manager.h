@@ -110,12 +110,25 @@ public:
     void downgrade(LockRequest* request, LockMode newMode);
 
     /**
-     * Iterates through all buckets and deletes all locks, which have no requests on them. This
+     * Iterates through all buckets and deletes all locks, which have no requests on them, and
+     * frees the fast path locks of resources with no requests granted through them. This
      * call is kind of expensive and should only be used for reducing the memory footprint of
      * the lock manager.
      */
     void cleanupUnusedLocks();
 
+    /**
+     * Finds a request, which keeps a waiting or converting request from being granted. Granted
+     * requests are preferred over the ones queued ahead of it. Returns false if there is none,
+     * which means the request has been granted in the meantime.
+     *
+     * @param request Request, on which lock returned LOCK_WAITING or convert was called.
+     * @param lockerId Receives the id of the blocking request's locker, or zero if it was
+     *                  granted through the fast path.
+     * @param mode Receives the mode of the blocking request.
+     */
+    bool getBlocker(const LockRequest* request, LockerId* lockerId, LockMode* mode);
+
     /**
      * Dumps the contents of all locks to the log.
      */
@@ -160,6 +173,29 @@ private:
      */
     Partition* _getPartition(LockRequest* request) const;
 
+    /**
+     * Retrieves the fast path lock for intent modes on a resource, claiming it if no resource
+     * has yet. Returns NULL if the resource doesn't use the fast path or its lock is claimed by
+     * another. There is no need to hold a lock when calling this function.
+     */
+    FastPathLock* _getFastPathLock(ResourceId resId) const;
+
+    /**
+     * Stops granting requests for the lock's resource through the fast path, and accounts for
+     * the requests it already granted on the lock, so that conflicting requests wait for them.
+     *
+     * MUST be called under the lock bucket's mutex.
+     */
+    void _closeFastPath(LockHead* lock);
+
+    /**
+     * Undoes _closeFastPath. The lock must have no conflicting modes granted or pending.
+     * Returns false if the resource no longer owns the fast path lock.
+     *
+     * MUST be called under the lock bucket's mutex.
+     */
+    bool _reopenFastPath(LockHead* lock, FastPathLock* fastPathLock);
+
     /**
      * Prints the contents of a bucket to the log.
      */
@@ -183,6 +219,9 @@ private:
 
     static const unsigned _numPartitions;
     Partition* _partitions;
+
+    static const unsigned _numFastPathLocks;
+    FastPathLock* _fastPathLocks;
 };
 
 
@@ -40,6 +40,7 @@ namespace mongo {
 
 class Locker;
 
+struct FastPathLock;
 struct LockHead;
 struct PartitionedLockHead;
 
@@ -381,6 +382,11 @@ struct LockRequest {
     // only transition from 'partitionedLock' to 'lock', never the other way around.
     PartitionedLockHead* partitionedLock;
 
+    // Pointer to the fast path lock through which this request was granted, or null if it
+    // wasn't. Such requests are on no list, so 'lock' and 'partitionedLock' are both null. A
+    // request only leaves the fast path by moving to 'lock' when it is converted.
+    FastPathLock* fastPathLock;
+
     // The reason intrusive linked list is used instead of the std::list class is to allow
     // for entries to be removed from the middle of the list in O(1) time, if they are known
     // instead of having to search for them and we cannot persist iterators, because the list
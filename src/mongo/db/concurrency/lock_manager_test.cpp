@@ -816,4 +816,150 @@ TEST(LockManager, CompatibleFirstCancelWaiting) {
     ASSERT(lockMgr.unlock(&requestX));
 }
 
+TEST(LockManager, FastPathWaitsForIntentHolders) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl lockerIS;
+    LockRequestCombo requestIS(&lockerIS);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIS, MODE_IS));
+
+    MMAPV1LockerImpl lockerIX;
+    LockRequestCombo requestIX(&lockerIX);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIX, MODE_IX));
+
+    // Both are only counted on the fast path, but must still block the exclusive request
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+    ASSERT(lockMgr.unlock(&requestIS));
+    ASSERT(requestX.numNotifies == 0);
+
+    ASSERT(lockMgr.unlock(&requestIX));
+    ASSERT(requestX.numNotifies == 1);
+    ASSERT(requestX.lastResult == LOCK_OK);
+
+    // New intent requests now queue behind it
+    MMAPV1LockerImpl lockerPending;
+    LockRequestCombo requestPending(&lockerPending);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestPending, MODE_IS));
+
+    ASSERT(lockMgr.unlock(&requestX));
+    ASSERT(requestPending.numNotifies == 1);
+    ASSERT(lockMgr.unlock(&requestPending));
+
+    // With the conflict gone, intent requests are granted again, and the fast path reopened
+    // without leaking the counts of the requests above
+    MMAPV1LockerImpl lockerAgain;
+    LockRequestCombo requestAgain(&lockerAgain);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestAgain, MODE_IX));
+    ASSERT(lockMgr.unlock(&requestAgain));
+
+    MMAPV1LockerImpl lockerXAgain;
+    LockRequestCombo requestXAgain(&lockerXAgain);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestXAgain, MODE_X));
+    ASSERT(lockMgr.unlock(&requestXAgain));
+}
+
+TEST(LockManager, FastPathConvert) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_GLOBAL, 1);
+
+    MMAPV1LockerImpl locker1;
+    LockRequestCombo request1(&locker1);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IS));
+
+    MMAPV1LockerImpl locker2;
+    LockRequestCombo request2(&locker2);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_IS));
+
+    // Upgrading has to wait for the other intent holder
+    ASSERT(LOCK_WAITING == lockMgr.convert(resId, &request1, MODE_X));
+    ASSERT(request1.numNotifies == 0);
+
+    ASSERT(lockMgr.unlock(&request2));
+    ASSERT(request1.numNotifies == 1);
+    ASSERT(request1.mode == MODE_X);
+    ASSERT(request1.recursiveCount == 2);
+
+    ASSERT(!lockMgr.unlock(&request1));
+    ASSERT(lockMgr.unlock(&request1));
+}
+
+TEST(LockManager, FastPathConvertIntent) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl locker;
+    LockRequestCombo request(&locker);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request, MODE_IS));
+
+    // Acquiring it again in MODE_IX stays on the fast path
+    ASSERT(LOCK_OK == lockMgr.convert(resId, &request, MODE_IX));
+    ASSERT(request.fastPathLock != NULL);
+    ASSERT(request.mode == MODE_IX);
+    ASSERT(request.recursiveCount == 2);
+
+    // And is counted in the new mode
+    MMAPV1LockerImpl lockerS;
+    LockRequestCombo requestS(&lockerS);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestS, MODE_S));
+
+    ASSERT(!lockMgr.unlock(&request));
+    ASSERT(requestS.numNotifies == 0);
+    ASSERT(lockMgr.unlock(&request));
+    ASSERT(requestS.numNotifies == 1);
+    ASSERT(lockMgr.unlock(&requestS));
+}
+
+TEST(LockManager, FastPathLockIsFreedWhenUnused) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    // Find a database which maps to the same one of the 128 fast path locks
+    ResourceId otherResId;
+    for (int i = 0; otherResId % 128 != resId % 128; i++) {
+        otherResId = ResourceId(RESOURCE_DATABASE, "TestDB" + std::to_string(i));
+    }
+
+    MMAPV1LockerImpl locker;
+    LockRequestCombo request(&locker);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request, MODE_IX));
+    ASSERT(request.fastPathLock != NULL);
+
+    // Not freed while it has requests
+    lockMgr.cleanupUnusedLocks();
+
+    MMAPV1LockerImpl otherLocker;
+    LockRequestCombo otherRequest(&otherLocker);
+    ASSERT(LOCK_OK == lockMgr.lock(otherResId, &otherRequest, MODE_IX));
+    ASSERT(otherRequest.fastPathLock == NULL);
+    ASSERT(lockMgr.unlock(&otherRequest));
+
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+    ASSERT(lockMgr.unlock(&request));
+    ASSERT(requestX.numNotifies == 1);
+    ASSERT(lockMgr.unlock(&requestX));
+
+    // Once freed, the other database can claim it
+    lockMgr.cleanupUnusedLocks();
+
+    MMAPV1LockerImpl otherLockerAgain;
+    LockRequestCombo otherRequestAgain(&otherLockerAgain);
+    ASSERT(LOCK_OK == lockMgr.lock(otherResId, &otherRequestAgain, MODE_IX));
+    ASSERT(otherRequestAgain.fastPathLock != NULL);
+
+    // While the first one falls back to the regular path
+    MMAPV1LockerImpl lockerAgain;
+    LockRequestCombo requestAgain(&lockerAgain);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestAgain, MODE_IX));
+    ASSERT(requestAgain.fastPathLock == NULL);
+
+    ASSERT(lockMgr.unlock(&requestAgain));
+    ASSERT(lockMgr.unlock(&otherRequestAgain));
+}
+
 }  // namespace mongo
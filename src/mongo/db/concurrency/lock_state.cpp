@@ -34,6 +34,7 @@
 
 #include <vector>
 
+#include "mongo/db/concurrency/lock_wait_profiler.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/platform/compiler.h"
@@ -673,6 +674,16 @@ LockResult LockerImpl<IsForMMAPV1>::lockComplete(ResourceId resId,
 
     LockResult result;
 
+    // The blocker has to be sampled before waiting, as it is usually gone afterwards
+    LockWaitProfiler* const profiler = getGlobalLockWaitProfiler();
+    LockWaitSample sample;
+    bool sampled = false;
+    if (profiler->shouldSample()) {
+        LockRequestsMap::Iterator it = _requests.find(resId);
+        sampled = globalLockManager.getBlocker(it.objAddr(), &sample.holder, &sample.holderMode);
+        sample.startTime = Date_t::now();
+    }
+
     // Don't go sleeping without bound in order to be able to report long waits or wake up for
     // deadlock detection.
     unsigned waitTimeMs = std::min(timeoutMs, DeadlockTimeoutMs);
@@ -717,6 +728,15 @@ LockResult LockerImpl<IsForMMAPV1>::lockComplete(ResourceId resId,
         }
     }
 
+    if (sampled) {
+        sample.resourceId = resId;
+        sample.waiter = _id;
+        sample.waiterMode = mode;
+        sample.waitMicros = curTimeMicros64() - _requestStartTime;
+        sample.result = result;
+        profiler->record(sample);
+    }
+
     // Cleanup the state, since this is an unused lock now
     if (result != LOCK_OK) {
         LockRequestsMap::Iterator it = _requests.find(resId);
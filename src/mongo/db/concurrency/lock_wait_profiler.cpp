@@ -0,0 +1,142 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/concurrency/lock_wait_profiler.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+namespace {
+
+// Sample every this many lock waits. Zero disables sampling.
+MONGO_EXPORT_SERVER_PARAMETER(lockWaitProfilerSampleRate, int, 10);
+
+const char* lockResultName(LockResult result) {
+    switch (result) {
+        case LOCK_OK:
+            return "granted";
+        case LOCK_TIMEOUT:
+            return "timeout";
+        case LOCK_DEADLOCK:
+            return "deadlock";
+        default:
+            return "invalid";
+    }
+}
+
+void reportLocker(BSONObjBuilder* builder, const char* name, LockerId id, LockMode mode) {
+    BSONObjBuilder locker(builder->subobjStart(name));
+    locker.append("lockerId", static_cast<long long>(id));
+    locker.append("mode", modeName(mode));
+    locker.done();
+}
+
+LockWaitProfiler globalLockWaitProfiler;
+
+}  // namespace
+
+
+LockWaitSample::LockWaitSample()
+    : waiter(0),
+      waiterMode(MODE_NONE),
+      holder(0),
+      holderMode(MODE_NONE),
+      waitMicros(0),
+      result(LOCK_INVALID) {}
+
+void LockWaitSample::report(BSONObjBuilder* builder) const {
+    builder->append("startTime", startTime);
+    builder->append("resource", resourceId.toString());
+    builder->append("resourceType", resourceTypeName(resourceId.getType()));
+    reportLocker(builder, "waiter", waiter, waiterMode);
+    reportLocker(builder, "holder", holder, holderMode);
+    builder->append("waitMicros", static_cast<long long>(waitMicros));
+    builder->append("result", lockResultName(result));
+}
+
+
+const size_t LockWaitProfiler::kCapacity = 1024;
+
+LockWaitProfiler::LockWaitProfiler() : _numRecorded(0) {}
+
+bool LockWaitProfiler::shouldSample() {
+    const int sampleRate = lockWaitProfilerSampleRate;
+    if (sampleRate <= 0) {
+        return false;
+    }
+
+    return _numWaits.fetchAndAdd(1) % sampleRate == 0;
+}
+
+void LockWaitProfiler::record(const LockWaitSample& sample) {
+    stdx::lock_guard<SimpleMutex> lk(_mutex);
+
+    if (_samples.size() < kCapacity) {
+        _samples.push_back(sample);
+    } else {
+        _samples[_numRecorded % kCapacity] = sample;
+    }
+    _numRecorded++;
+}
+
+std::vector<LockWaitSample> LockWaitProfiler::getSamples() const {
+    stdx::lock_guard<SimpleMutex> lk(_mutex);
+
+    if (_samples.size() < kCapacity) {
+        return _samples;
+    }
+
+    // The buffer has wrapped, so the oldest sample is the next one to be replaced
+    const size_t oldest = _numRecorded % kCapacity;
+    std::vector<LockWaitSample> samples(_samples.begin() + oldest, _samples.end());
+    samples.insert(samples.end(), _samples.begin(), _samples.begin() + oldest);
+    return samples;
+}
+
+uint64_t LockWaitProfiler::getNumRecorded() const {
+    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    return _numRecorded;
+}
+
+void LockWaitProfiler::clear() {
+    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    _samples.clear();
+    _numRecorded = 0;
+}
+
+
+LockWaitProfiler* getGlobalLockWaitProfiler() {
+    return &globalLockWaitProfiler;
+}
+
+}  // namespace mongo
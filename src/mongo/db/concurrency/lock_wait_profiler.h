@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/concurrency/lock_manager_defs.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+
+/**
+ * A sampled lock wait, which is an edge of the wait-for graph at the time the wait started.
+ */
+struct LockWaitSample {
+    LockWaitSample();
+
+    void report(BSONObjBuilder* builder) const;
+
+    Date_t startTime;
+    ResourceId resourceId;
+
+    // The locker which waited and the mode it waited for
+    LockerId waiter;
+    LockMode waiterMode;
+
+    // A locker which held the resource in a conflicting mode, or was queued ahead of the waiter
+    // in one. The id is zero if the conflicting requests were granted through the lock
+    // manager's fast path, which doesn't track which lockers they belong to.
+    LockerId holder;
+    LockMode holderMode;
+
+    // How long the waiter waited and how the wait ended
+    uint64_t waitMicros;
+    LockResult result;
+};
+
+/**
+ * Samples lock waits and keeps the most recent samples in a fixed size ring buffer, so that
+ * lock convoys can be diagnosed after the fact. Only every lockWaitProfilerSampleRate-th wait is
+ * sampled, and waits are already the slow path, so this costs nothing for uncontended locks.
+ *
+ * Thread-safe.
+ */
+class LockWaitProfiler {
+    MONGO_DISALLOW_COPYING(LockWaitProfiler);
+
+public:
+    static const size_t kCapacity;
+
+    LockWaitProfiler();
+
+    /**
+     * Decides whether the wait which is about to start should be sampled.
+     */
+    bool shouldSample();
+
+    /**
+     * Adds a sample, replacing the oldest one if the buffer is full.
+     */
+    void record(const LockWaitSample& sample);
+
+    /**
+     * Returns the samples currently in the buffer, oldest first.
+     */
+    std::vector<LockWaitSample> getSamples() const;
+
+    /**
+     * Number of samples recorded since startup or the last call to clear, including those which
+     * have since been replaced.
+     */
+    uint64_t getNumRecorded() const;
+
+    void clear();
+
+private:
+    AtomicUInt64 _numWaits;
+
+    mutable SimpleMutex _mutex;
+
+    // Ring buffer of samples. _samples[_numRecorded % kCapacity] is the next one to replace.
+    std::vector<LockWaitSample> _samples;
+    uint64_t _numRecorded;
+};
+
+/**
+ * Retrieves the instance-wide lock wait profiler.
+ */
+LockWaitProfiler* getGlobalLockWaitProfiler();
+
+}  // namespace mongo
@@ -0,0 +1,130 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/concurrency/lock_manager_test_help.h"
+#include "mongo/db/concurrency/lock_wait_profiler.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+TEST(LockWaitProfiler, RingBuffer) {
+    LockWaitProfiler profiler;
+    ASSERT(profiler.getSamples().empty());
+
+    for (size_t i = 0; i < LockWaitProfiler::kCapacity + 10; i++) {
+        LockWaitSample sample;
+        sample.waiter = i;
+        profiler.record(sample);
+    }
+
+    // Only the most recent samples are kept, oldest first
+    const std::vector<LockWaitSample> samples = profiler.getSamples();
+    ASSERT_EQUALS(LockWaitProfiler::kCapacity, samples.size());
+    ASSERT_EQUALS(10U, samples.front().waiter);
+    ASSERT_EQUALS(LockWaitProfiler::kCapacity + 9, samples.back().waiter);
+    ASSERT_EQUALS(LockWaitProfiler::kCapacity + 10, profiler.getNumRecorded());
+
+    profiler.clear();
+    ASSERT(profiler.getSamples().empty());
+    ASSERT_EQUALS(0U, profiler.getNumRecorded());
+}
+
+TEST(LockWaitProfiler, GetBlocker) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
+
+    MMAPV1LockerImpl lockerS;
+    LockRequestCombo requestS(&lockerS);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestS, MODE_S));
+
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+    MMAPV1LockerImpl lockerIS;
+    LockRequestCombo requestIS(&lockerIS);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestIS, MODE_IS));
+
+    LockerId lockerId;
+    LockMode mode;
+
+    // X waits for the granted S
+    ASSERT(lockMgr.getBlocker(&requestX, &lockerId, &mode));
+    ASSERT_EQUALS(lockerS.getId(), lockerId);
+    ASSERT_EQUALS(MODE_S, mode);
+
+    // IS is compatible with S, but is queued behind the X
+    ASSERT(lockMgr.getBlocker(&requestIS, &lockerId, &mode));
+    ASSERT_EQUALS(lockerX.getId(), lockerId);
+    ASSERT_EQUALS(MODE_X, mode);
+
+    // Granted requests are not blocked by anything
+    ASSERT(!lockMgr.getBlocker(&requestS, &lockerId, &mode));
+
+    ASSERT(lockMgr.unlock(&requestS));
+    ASSERT(!lockMgr.getBlocker(&requestX, &lockerId, &mode));
+
+    ASSERT(lockMgr.unlock(&requestX));
+    ASSERT(lockMgr.unlock(&requestIS));
+}
+
+TEST(LockWaitProfiler, SamplesWaits) {
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("LockWaitProfiler.SamplesWaits"));
+
+    LockWaitProfiler* profiler = getGlobalLockWaitProfiler();
+    profiler->clear();
+
+    LockerForTests locker(MODE_IX);
+    ASSERT_EQUALS(LOCK_OK, locker.lock(resId, MODE_X));
+
+    // Wait often enough that at least one of the waits is sampled
+    for (int i = 0; i < 10; i++) {
+        LockerForTests lockerConflict(MODE_IX);
+        ASSERT_EQUALS(LOCK_WAITING, lockerConflict.lockBegin(resId, MODE_S));
+        ASSERT_EQUALS(LOCK_TIMEOUT, lockerConflict.lockComplete(resId, MODE_S, 1, false));
+    }
+
+    const std::vector<LockWaitSample> samples = profiler->getSamples();
+    ASSERT(!samples.empty());
+
+    const LockWaitSample& sample = samples.back();
+    ASSERT_EQUALS(resId, sample.resourceId);
+    ASSERT_EQUALS(MODE_S, sample.waiterMode);
+    ASSERT_EQUALS(locker.getId(), sample.holder);
+    ASSERT_EQUALS(MODE_X, sample.holderMode);
+    ASSERT_EQUALS(LOCK_TIMEOUT, sample.result);
+    ASSERT_GREATER_THAN(sample.waitMicros, 0U);
+
+    BSONObjBuilder builder;
+    sample.report(&builder);
+}
+
+}  // namespace mongo
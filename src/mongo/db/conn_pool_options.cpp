@@ -30,6 +30,8 @@
 
 #include "mongo/db/conn_pool_options.h"
 
+#include <limits>
+
 #include "mongo/base/init.h"
 #include "mongo/client/connpool.h"
 #include "mongo/client/global_conn_pool.h"
@@ -40,6 +42,9 @@ namespace mongo {
 
 int ConnPoolOptions::maxConnsPerHost(200);
 int ConnPoolOptions::maxShardedConnsPerHost(200);
+int ConnPoolOptions::maxInUseConnsPerHost(std::numeric_limits<int>::max());
+int ConnPoolOptions::maxShardedInUseConnsPerHost(std::numeric_limits<int>::max());
+int ConnPoolOptions::connWaitTimeoutMillis(30 * 1000);
 
 namespace {
 
@@ -57,6 +62,27 @@ ExportedServerParameter<int>  //
                                     true,
                                     false /* can't change at runtime */);
 
+ExportedServerParameter<int>  //
+    maxInUseConnsPerHostParameter(ServerParameterSet::getGlobal(),
+                                  "connPoolMaxInUseConnsPerHost",
+                                  &ConnPoolOptions::maxInUseConnsPerHost,
+                                  true,
+                                  false /* can't change at runtime */);
+
+ExportedServerParameter<int>  //
+    maxShardedInUseConnsPerHostParameter(ServerParameterSet::getGlobal(),
+                                         "connPoolMaxShardedInUseConnsPerHost",
+                                         &ConnPoolOptions::maxShardedInUseConnsPerHost,
+                                         true,
+                                         false /* can't change at runtime */);
+
+ExportedServerParameter<int>  //
+    connWaitTimeoutMillisParameter(ServerParameterSet::getGlobal(),
+                                   "connPoolWaitTimeoutMillis",
+                                   &ConnPoolOptions::connWaitTimeoutMillis,
+                                   true,
+                                   false /* can't change at runtime */);
+
 MONGO_INITIALIZER(InitializeConnectionPools)(InitializerContext* context) {
     // Initialize the sharded and unsharded outgoing connection pools
     // NOTES:
@@ -66,9 +92,13 @@ MONGO_INITIALIZER(InitializeConnectionPools)(InitializerContext* context) {
 
     globalConnPool.setName("connection pool");
     globalConnPool.setMaxPoolSize(ConnPoolOptions::maxConnsPerHost);
+    globalConnPool.setMaxInUse(ConnPoolOptions::maxInUseConnsPerHost,
+                               Milliseconds(ConnPoolOptions::connWaitTimeoutMillis));
 
     shardConnectionPool.setName("sharded connection pool");
     shardConnectionPool.setMaxPoolSize(ConnPoolOptions::maxShardedConnsPerHost);
+    shardConnectionPool.setMaxInUse(ConnPoolOptions::maxShardedInUseConnsPerHost,
+                                    Milliseconds(ConnPoolOptions::connWaitTimeoutMillis));
 
     return Status::OK();
 }
@@ -48,5 +48,22 @@ struct ConnPoolOptions {
      * Maximum connections per host the sharded conn pool should use
      */
     static int maxShardedConnsPerHost;
+
+    /**
+     * Maximum connections per host the connection pool may have in use at once. Like the pool
+     * size, this applies separately to each socket timeout a host is used with.
+     */
+    static int maxInUseConnsPerHost;
+
+    /**
+     * Maximum connections per host the sharded conn pool may have in use at once. Connections
+     * kept by a thread's ShardConnection cache between requests count as in use.
+     */
+    static int maxShardedInUseConnsPerHost;
+
+    /**
+     * How long to wait for a connection when a host has its maximum in use
+     */
+    static int connWaitTimeoutMillis;
 };
 }
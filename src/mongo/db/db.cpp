@@ -47,6 +47,7 @@
 #include "mongo/db/auth/auth_index_d.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
+#include "mongo/db/auth/user_cache_refresher_job.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_catalog_entry.h"
@@ -581,6 +582,8 @@ static void _initAndListen(int listenPort) {
 
     startClientCursorMonitor();
 
+    (new UserCacheRefresher(getGlobalAuthorizationManager()))->go();
+
     PeriodicTask::startRunningPeriodicTasks();
 
     logStartup();
@@ -81,6 +81,7 @@
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/latency_histogram.h"
 #include "mongo/db/storage/storage_engine.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/platform/atomic_word.h"
@@ -580,6 +581,8 @@ void assembleResponse(OperationContext* txn,
     currentOp.done();
     debug.executionTime = currentOp.totalTimeMillis();
 
+    recordGlobalOperationLatency(latencyTypeForOp(op, isCommand), currentOp.totalTimeMicros());
+
     logThreshold += currentOp.getExpectedLatencyMs();
 
     if (shouldLog || debug.executionTime > logThreshold) {
@@ -589,6 +592,16 @@ void assembleResponse(OperationContext* txn,
         MONGO_LOG_COMPONENT(0, responseComponent) << debug.report(currentOp, lockerInfo.stats);
     }
 
+    if (debug.executionTime > logThreshold) {
+        // Sampling a slow operation must not fail it after it has already completed
+        try {
+            recordSlowOp(txn);
+        } catch (const AssertionException& assertionEx) {
+            warning() << "Caught Assertion while trying to record slow op " << opToString(op)
+                      << " against " << currentOp.getNS() << ": " << assertionEx.toString();
+        }
+    }
+
     if (currentOp.shouldDBProfile(debug.executionTime)) {
         // Performance profiling is on
         if (txn->lockState()->isReadLocked()) {
@@ -41,6 +41,7 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/stats/slow_op_profiler.h"
 #include "mongo/util/log.h"
 #include "mongo/util/scopeguard.h"
 
@@ -77,15 +78,7 @@ void _appendUserInfo(const CurOp& c, BSONObjBuilder& builder, AuthorizationSessi
     builder.append("user", bestUser.getUser().empty() ? "" : bestUser.getFullName());
 }
 
-}  // namespace
-
-
-void profile(OperationContext* txn, int op) {
-    // Initialize with 1kb at start in order to avoid realloc later
-    BufBuilder profileBufBuilder(1024);
-
-    BSONObjBuilder b(profileBufBuilder);
-
+void _appendProfileInfo(OperationContext* txn, BSONObjBuilder& b) {
     {
         Locker::LockerInfo lockerInfo;
         txn->lockState()->getLockerInfo(&lockerInfo);
@@ -97,6 +90,17 @@ void profile(OperationContext* txn, int op) {
 
     AuthorizationSession* authSession = AuthorizationSession::get(txn->getClient());
     _appendUserInfo(*CurOp::get(txn), b, authSession);
+}
+
+}  // namespace
+
+
+void profile(OperationContext* txn, int op) {
+    // Initialize with 1kb at start in order to avoid realloc later
+    BufBuilder profileBufBuilder(1024);
+
+    BSONObjBuilder b(profileBufBuilder);
+    _appendProfileInfo(txn, b);
 
     const BSONObj p = b.done();
 
@@ -153,6 +157,25 @@ void profile(OperationContext* txn, int op) {
     }
 }
 
+void recordSlowOp(OperationContext* txn) {
+    SlowOpProfiler* profiler = getGlobalSlowOpProfiler();
+    if (!profiler->shouldSample()) {
+        return;
+    }
+
+    BufBuilder profileBufBuilder(1024);
+
+    BSONObjBuilder b(profileBufBuilder);
+    _appendProfileInfo(txn, b);
+
+    const OpDebug& debug = CurOp::get(txn)->debug();
+    if (!debug.planSummary.empty()) {
+        b.append("planSummary", debug.planSummary.toString());
+    }
+
+    profiler->record(b.done());
+}
+
 
 Status createProfileCollection(OperationContext* txn, Database* db) {
     invariant(txn->lockState()->isDbLockedForMode(db->name(), MODE_X));
@@ -40,6 +40,12 @@ class OperationContext;
  */
 void profile(OperationContext* txn, int op);
 
+/**
+ * Invoked for slow operations. Records the same document profile() would write into the
+ * in-memory SlowOpProfiler, without taking any locks, if it is sampled.
+ */
+void recordSlowOp(OperationContext* txn);
+
 /**
  * Pre-creates the profile collection for the specified database.
  */
@@ -31,6 +31,7 @@
 #include "mongo/platform/basic.h"
 
 #include <boost/intrusive_ptr.hpp>
+#include <cstdint>
 #include <unordered_set>
 #include <vector>
 
@@ -216,4 +217,92 @@ private:
     double _mean;
     double _m2;  // Running sum of squares of delta from mean. Named to match algorithm.
 };
+
+
+/**
+ * Estimates the number of distinct values with a HyperLogLog sketch. The estimate has a
+ * standard error of about 1.6%, and each group uses at most a few kilobytes no matter how many
+ * values it sees. Shard results are the sketches themselves, which merge without loss.
+ */
+class AccumulatorApproxCountDistinct final : public Accumulator {
+public:
+    static const int kPrecision = 12;
+    static const size_t kNumRegisters = size_t(1) << kPrecision;
+
+    AccumulatorApproxCountDistinct();
+
+    void processInternal(const Value& input, bool merging) final;
+    Value getValue(bool toBeMerged) const final;
+    const char* getOpName() const final;
+    void reset() final;
+
+    static boost::intrusive_ptr<Accumulator> create();
+
+private:
+    // Sparse form is used until it would be a quarter the size of the dense registers.
+    static const size_t kMaxSparseEntries = kNumRegisters / 16;
+
+    // A rank counts the leading zeros of the hash bits after the register index, plus one.
+    static const int kMaxRank = 64 - kPrecision + 1;
+
+    void setRegister(uint32_t index, uint8_t rank);
+    void convertToDense();
+    long long estimate() const;
+
+    // Until enough registers are set, only the nonzero ones are kept, sorted by index. After
+    // that _sparse is empty and _registers holds all kNumRegisters registers.
+    std::vector<uint32_t> _sparse;
+    std::vector<uint8_t> _registers;
+};
+
+
+/**
+ * Estimates the percentiles of numeric values with a t-digest. The result is a document with
+ * the minimum, maximum and the 25th, 50th, 75th, 90th, 95th and 99th percentiles. Accuracy is
+ * best near the tails, and each group keeps a bounded number of centroids no matter how many
+ * values it sees. Shard results are the digests themselves, which merge into the final digest.
+ */
+class AccumulatorApproxPercentiles final : public Accumulator {
+public:
+    // Larger values keep more centroids and give more accurate percentiles.
+    static const int kCompression = 100;
+
+    AccumulatorApproxPercentiles();
+
+    void processInternal(const Value& input, bool merging) final;
+    Value getValue(bool toBeMerged) const final;
+    const char* getOpName() const final;
+    void reset() final;
+
+    static boost::intrusive_ptr<Accumulator> create();
+
+private:
+    // Number of points buffered before they are merged into the centroids.
+    static const size_t kBufferSize = 5 * kCompression;
+
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    void add(double mean, double weight);
+
+    /**
+     * Merges the buffered points into the centroids, which are left sorted by mean.
+     */
+    void compress() const;
+
+    /**
+     * Returns the estimated value at quantile 'q', which must be in [0, 1]. Requires at least
+     * one value and no buffered points.
+     */
+    double quantile(double q) const;
+
+    // Both are compressed lazily by getValue().
+    mutable std::vector<Centroid> _centroids;
+    mutable std::vector<Centroid> _buffer;
+    double _totalWeight;
+    double _min;
+    double _max;
+};
 }
@@ -0,0 +1,233 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mongo/base/data_view.h"
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/platform/bits.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+
+namespace {
+const char registersName[] = "registers";
+const char sparseName[] = "sparse";
+
+/**
+ * Finalizer from MurmurHash3. Value::Hash is only meant for hash tables, so its low bits can be
+ * poorly distributed (small integers hash to themselves), but HyperLogLog needs all 64 bits to
+ * look random.
+ */
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Sparse entries pack a register index in the high bits and its rank in the low byte, so
+// sorting them orders by index.
+uint32_t sparseEntry(uint32_t index, uint8_t rank) {
+    return (index << 8) | rank;
+}
+uint32_t sparseIndex(uint32_t entry) {
+    return entry >> 8;
+}
+uint8_t sparseRank(uint32_t entry) {
+    return entry & 0xff;
+}
+}
+
+void AccumulatorApproxCountDistinct::processInternal(const Value& input, bool merging) {
+    if (!merging) {
+        // Like $addToSet, missing values are not counted.
+        if (input.missing())
+            return;
+
+        const uint64_t hash = mix(Value::Hash()(input));
+        const uint32_t index = hash >> (64 - kPrecision);
+        // The marker bit bounds the rank if all the remaining bits are zero.
+        const uint64_t remaining = (hash << kPrecision) | (1ULL << (kPrecision - 1));
+        setRegister(index, countLeadingZeros64(remaining) + 1);
+    } else {
+        // This is what getValue(true) produced below, but a merging $group can also be run by a
+        // client, so nothing in it is trusted.
+        uassert(28734,
+                str::stream() << "$approxCountDistinct can only merge an object, not "
+                              << typeName(input.getType()),
+                input.getType() == Object);
+
+        const auto uassertValidRegister = [](uint32_t index, uint8_t rank) {
+            uassert(28735,
+                    str::stream() << "$approxCountDistinct cannot merge register " << index
+                                  << " with rank " << int(rank),
+                    index < kNumRegisters && rank <= kMaxRank);
+        };
+
+        const Value registers = input[registersName];
+        if (!registers.missing()) {
+            uassert(28736,
+                    str::stream() << "$approxCountDistinct registers must be BinData of length "
+                                  << static_cast<int>(kNumRegisters),
+                    registers.getType() == BinData &&
+                        registers.getBinData().length == static_cast<int>(kNumRegisters));
+            if (_registers.empty())
+                convertToDense();
+            const uint8_t* data = static_cast<const uint8_t*>(registers.getBinData().data);
+            for (size_t i = 0; i < kNumRegisters; i++) {
+                uassertValidRegister(i, data[i]);
+                _registers[i] = std::max(_registers[i], data[i]);
+            }
+            return;
+        }
+
+        const Value sparse = input[sparseName];
+        uassert(28737,
+                "$approxCountDistinct sparse registers must be BinData of whole 32 bit entries",
+                sparse.getType() == BinData &&
+                    sparse.getBinData().length % sizeof(uint32_t) == 0);
+        const BSONBinData bytes = sparse.getBinData();
+        ConstDataView view(static_cast<const char*>(bytes.data));
+        for (size_t offset = 0; offset < size_t(bytes.length); offset += sizeof(uint32_t)) {
+            const uint32_t entry = view.read<LittleEndian<uint32_t>>(offset);
+            uassertValidRegister(sparseIndex(entry), sparseRank(entry));
+            setRegister(sparseIndex(entry), sparseRank(entry));
+        }
+    }
+}
+
+void AccumulatorApproxCountDistinct::setRegister(uint32_t index, uint8_t rank) {
+    if (!_registers.empty()) {
+        _registers[index] = std::max(_registers[index], rank);
+        return;
+    }
+
+    std::vector<uint32_t>::iterator it = std::lower_bound(
+        _sparse.begin(), _sparse.end(), sparseEntry(index, 0));
+    if (it != _sparse.end() && sparseIndex(*it) == index) {
+        if (sparseRank(*it) < rank)
+            *it = sparseEntry(index, rank);
+        return;
+    }
+
+    _sparse.insert(it, sparseEntry(index, rank));
+    if (_sparse.size() > kMaxSparseEntries) {
+        convertToDense();
+    } else {
+        _memUsageBytes = sizeof(*this) + _sparse.capacity() * sizeof(uint32_t);
+    }
+}
+
+void AccumulatorApproxCountDistinct::convertToDense() {
+    _registers.assign(kNumRegisters, 0);
+    for (size_t i = 0; i < _sparse.size(); i++) {
+        _registers[sparseIndex(_sparse[i])] = sparseRank(_sparse[i]);
+    }
+    std::vector<uint32_t>().swap(_sparse);
+
+    // The dense form has a fixed size so we never need to update this again.
+    _memUsageBytes = sizeof(*this) + kNumRegisters;
+}
+
+long long AccumulatorApproxCountDistinct::estimate() const {
+    const double m = kNumRegisters;
+
+    // Sum of 2^-register over all registers, and the number of registers still zero.
+    double sum = 0;
+    size_t zeros = 0;
+    if (_registers.empty()) {
+        zeros = kNumRegisters - _sparse.size();
+        sum = zeros;
+        for (size_t i = 0; i < _sparse.size(); i++) {
+            sum += std::ldexp(1.0, -sparseRank(_sparse[i]));
+        }
+    } else {
+        for (size_t i = 0; i < kNumRegisters; i++) {
+            sum += std::ldexp(1.0, -_registers[i]);
+            zeros += (_registers[i] == 0);
+        }
+    }
+
+    // This is the estimator from "HyperLogLog: the analysis of a near-optimal cardinality
+    // estimation algorithm" (Flajolet et al.). With 64 bit hashes no large range correction is
+    // needed, but small cardinalities are better served by linear counting.
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros != 0)
+        estimate = m * std::log(m / zeros);
+
+    return static_cast<long long>(estimate + 0.5);
+}
+
+Value AccumulatorApproxCountDistinct::getValue(bool toBeMerged) const {
+    if (!toBeMerged)
+        return Value(estimate());
+
+    if (!_registers.empty()) {
+        return Value(DOC(registersName << BSONBinData(_registers.data(),
+                                                      _registers.size(),
+                                                      BinDataGeneral)));
+    }
+
+    std::vector<char> bytes(_sparse.size() * sizeof(uint32_t));
+    DataView view(bytes.data());
+    for (size_t i = 0; i < _sparse.size(); i++) {
+        view.write<LittleEndian<uint32_t>>(_sparse[i], i * sizeof(uint32_t));
+    }
+    return Value(DOC(sparseName << BSONBinData(bytes.data(), bytes.size(), BinDataGeneral)));
+}
+
+AccumulatorApproxCountDistinct::AccumulatorApproxCountDistinct() {
+    _memUsageBytes = sizeof(*this);
+}
+
+void AccumulatorApproxCountDistinct::reset() {
+    std::vector<uint32_t>().swap(_sparse);
+    std::vector<uint8_t>().swap(_registers);
+    _memUsageBytes = sizeof(*this);
+}
+
+intrusive_ptr<Accumulator> AccumulatorApproxCountDistinct::create() {
+    return new AccumulatorApproxCountDistinct();
+}
+
+const char* AccumulatorApproxCountDistinct::getOpName() const {
+    return "$approxCountDistinct";
+}
+}
@@ -0,0 +1,219 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::numeric_limits;
+using std::vector;
+
+namespace {
+const char centroidsName[] = "centroids";
+const char minName[] = "min";
+const char maxName[] = "max";
+
+// The percentiles reported in the final result, after "min" and before "max".
+const struct {
+    const char* name;
+    double quantile;
+} kPercentiles[] = {
+    {"p25", 0.25}, {"p50", 0.5}, {"p75", 0.75}, {"p90", 0.9}, {"p95", 0.95}, {"p99", 0.99},
+};
+}
+
+void AccumulatorApproxPercentiles::processInternal(const Value& input, bool merging) {
+    if (!merging) {
+        // non numeric types have no impact on percentiles, and NaN has no place in the order
+        if (!input.numeric())
+            return;
+
+        const double val = input.getDouble();
+        if (std::isnan(val))
+            return;
+
+        add(val, 1);
+    } else {
+        // This is what getValue(true) produced below.
+        verify(input.getType() == Object);
+
+        // Centroids are stored flattened as [mean, weight, mean, weight, ...].
+        const vector<Value>& centroids = input[centroidsName].getArray();
+        verify(centroids.size() % 2 == 0);
+        if (centroids.empty())
+            return;  // This partition had no data to contribute.
+
+        for (size_t i = 0; i < centroids.size(); i += 2) {
+            add(centroids[i].getDouble(), centroids[i + 1].getDouble());
+        }
+        _min = std::min(_min, input[minName].getDouble());
+        _max = std::max(_max, input[maxName].getDouble());
+    }
+}
+
+void AccumulatorApproxPercentiles::add(double mean, double weight) {
+    _buffer.push_back(Centroid{mean, weight});
+    _totalWeight += weight;
+    _min = std::min(_min, mean);
+    _max = std::max(_max, mean);
+
+    if (_buffer.size() >= kBufferSize)
+        compress();
+
+    _memUsageBytes =
+        sizeof(*this) + (_centroids.capacity() + _buffer.capacity()) * sizeof(Centroid);
+}
+
+void AccumulatorApproxPercentiles::compress() const {
+    if (_buffer.empty())
+        return;
+
+    vector<Centroid> all;
+    all.reserve(_centroids.size() + _buffer.size());
+    all.insert(all.end(), _centroids.begin(), _centroids.end());
+    all.insert(all.end(), _buffer.begin(), _buffer.end());
+    std::sort(all.begin(), all.end(), [](const Centroid& lhs, const Centroid& rhs) {
+        return lhs.mean < rhs.mean;
+    });
+
+    // This is the merging variant of the t-digest from "Computing Extremely Accurate Quantiles
+    // Using t-Digests" (Dunning and Ertl). Neighbouring centroids are combined while the result
+    // stays under a size limit that shrinks towards the tails, which is what keeps extreme
+    // percentiles accurate.
+    vector<Centroid> merged;
+    Centroid current = all[0];
+    double weightSoFar = 0;
+    for (size_t i = 1; i < all.size(); i++) {
+        const double proposedWeight = current.weight + all[i].weight;
+        const double q = (weightSoFar + proposedWeight / 2) / _totalWeight;
+        const double maxWeight = 4 * _totalWeight * q * (1 - q) / kCompression;
+
+        if (proposedWeight <= maxWeight) {
+            current.mean += (all[i].mean - current.mean) * all[i].weight / proposedWeight;
+            current.weight = proposedWeight;
+        } else {
+            merged.push_back(current);
+            weightSoFar += current.weight;
+            current = all[i];
+        }
+    }
+    merged.push_back(current);
+
+    _centroids.swap(merged);
+    _buffer.clear();
+}
+
+double AccumulatorApproxPercentiles::quantile(double q) const {
+    dassert(_buffer.empty());
+    dassert(!_centroids.empty());
+
+    // Each centroid is treated as centered on its share of the cumulative weight, and values
+    // are interpolated linearly between neighbouring centers, or out to the min and max.
+    const double target = q * _totalWeight;
+
+    const Centroid& first = _centroids.front();
+    if (target <= first.weight / 2) {
+        return _min + (first.mean - _min) * (target / (first.weight / 2));
+    }
+
+    double weightSoFar = 0;
+    for (size_t i = 0; i + 1 < _centroids.size(); i++) {
+        const Centroid& left = _centroids[i];
+        const Centroid& right = _centroids[i + 1];
+        const double leftCenter = weightSoFar + left.weight / 2;
+        const double rightCenter = weightSoFar + left.weight + right.weight / 2;
+        if (target <= rightCenter) {
+            const double fraction = (target - leftCenter) / (rightCenter - leftCenter);
+            return left.mean + (right.mean - left.mean) * fraction;
+        }
+        weightSoFar += left.weight;
+    }
+
+    const Centroid& last = _centroids.back();
+    const double lastCenter = _totalWeight - last.weight / 2;
+    const double fraction = (target - lastCenter) / (last.weight / 2);
+    return std::min(_max, last.mean + (_max - last.mean) * fraction);
+}
+
+Value AccumulatorApproxPercentiles::getValue(bool toBeMerged) const {
+    compress();
+
+    if (!toBeMerged) {
+        if (_centroids.empty())
+            return Value(BSONNULL);  // percentiles not well defined in this case
+
+        MutableDocument out;
+        out.addField(minName, Value(_min));
+        for (size_t i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]); i++) {
+            out.addField(kPercentiles[i].name, Value(quantile(kPercentiles[i].quantile)));
+        }
+        out.addField(maxName, Value(_max));
+        return out.freezeToValue();
+    }
+
+    vector<Value> centroids;
+    centroids.reserve(_centroids.size() * 2);
+    for (size_t i = 0; i < _centroids.size(); i++) {
+        centroids.push_back(Value(_centroids[i].mean));
+        centroids.push_back(Value(_centroids[i].weight));
+    }
+    return Value(
+        DOC(centroidsName << Value(std::move(centroids)) << minName << _min << maxName << _max));
+}
+
+AccumulatorApproxPercentiles::AccumulatorApproxPercentiles() {
+    reset();
+}
+
+void AccumulatorApproxPercentiles::reset() {
+    vector<Centroid>().swap(_centroids);
+    vector<Centroid>().swap(_buffer);
+    _totalWeight = 0;
+    _min = numeric_limits<double>::infinity();
+    _max = -numeric_limits<double>::infinity();
+    _memUsageBytes = sizeof(*this);
+}
+
+intrusive_ptr<Accumulator> AccumulatorApproxPercentiles::create() {
+    return new AccumulatorApproxPercentiles();
+}
+
+const char* AccumulatorApproxPercentiles::getOpName() const {
+    return "$approxPercentiles";
+}
+}
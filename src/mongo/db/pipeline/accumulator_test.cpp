@@ -28,6 +28,7 @@
 
 #include "mongo/platform/basic.h"
 
+#include "mongo/base/data_view.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression_context.h"
@@ -1005,6 +1006,255 @@ private:
 
 }  // namespace Sum
 
+namespace ApproxCountDistinct {
+
+class Base : public AccumulatorTests::Base {
+protected:
+    void createAccumulator() {
+        _accumulator = AccumulatorApproxCountDistinct::create();
+        ASSERT_EQUALS(string("$approxCountDistinct"), _accumulator->getOpName());
+    }
+    Accumulator* accumulator() {
+        return _accumulator.get();
+    }
+    /** Asserts 'estimate' is within 'tolerance' (a fraction) of 'expected'. */
+    void assertClose(long long expected, const Value& estimate, double tolerance) {
+        ASSERT_EQUALS(NumberLong, estimate.getType());
+        ASSERT_LESS_THAN_OR_EQUALS(std::abs(double(estimate.getLong() - expected)),
+                                   expected * tolerance);
+    }
+
+private:
+    intrusive_ptr<Accumulator> _accumulator;
+};
+
+/** No documents evaluated. */
+class None : public Base {
+public:
+    void run() {
+        createAccumulator();
+        ASSERT_EQUALS(0, accumulator()->getValue(false).getLong());
+    }
+};
+
+/** Missing values are not counted, but null is. */
+class MissingAndNull : public Base {
+public:
+    void run() {
+        createAccumulator();
+        accumulator()->process(Value(), false);
+        ASSERT_EQUALS(0, accumulator()->getValue(false).getLong());
+        accumulator()->process(Value(BSONNULL), false);
+        ASSERT_EQUALS(1, accumulator()->getValue(false).getLong());
+    }
+};
+
+/** Equal numbers of different types are one value. */
+class NumericTypes : public Base {
+public:
+    void run() {
+        createAccumulator();
+        accumulator()->process(Value(1), false);
+        accumulator()->process(Value(1LL), false);
+        accumulator()->process(Value(1.0), false);
+        ASSERT_EQUALS(1, accumulator()->getValue(false).getLong());
+    }
+};
+
+/** Few distinct values are counted nearly exactly. */
+class Small : public Base {
+public:
+    void run() {
+        createAccumulator();
+        for (int i = 0; i < 200; i++) {
+            accumulator()->process(Value(i % 100), false);
+        }
+        assertClose(100, accumulator()->getValue(false), 0.02);
+    }
+};
+
+/** Many distinct values are estimated within a few standard errors. */
+class Large : public Base {
+public:
+    void run() {
+        createAccumulator();
+        for (int i = 0; i < 100000; i++) {
+            accumulator()->process(Value(std::string(str::stream() << "value" << i)), false);
+        }
+        assertClose(100000, accumulator()->getValue(false), 0.05);
+        // Memory use stays bounded by the dense registers.
+        const size_t maxBytes = sizeof(AccumulatorApproxCountDistinct) +
+            AccumulatorApproxCountDistinct::kNumRegisters;
+        ASSERT_LESS_THAN_OR_EQUALS(size_t(accumulator()->memUsageForSorter()), maxBytes);
+    }
+};
+
+/** Merging shard sketches loses nothing: the result is as if one accumulator saw everything. */
+class Merge : public Base {
+public:
+    void run() {
+        intrusive_ptr<Accumulator> whole = AccumulatorApproxCountDistinct::create();
+        intrusive_ptr<Accumulator> shardA = AccumulatorApproxCountDistinct::create();
+        intrusive_ptr<Accumulator> shardB = AccumulatorApproxCountDistinct::create();
+        intrusive_ptr<Accumulator> shardC = AccumulatorApproxCountDistinct::create();
+        for (int i = 0; i < 60000; i++) {
+            shardA->process(Value(i), false);
+            whole->process(Value(i), false);
+        }
+        for (int i = 40000; i < 100000; i++) {
+            shardB->process(Value(i), false);
+            whole->process(Value(i), false);
+        }
+        // Few values, so this shard sends its sketch in sparse form.
+        for (int i = 200000; i < 200010; i++) {
+            shardC->process(Value(i), false);
+            whole->process(Value(i), false);
+        }
+
+        createAccumulator();
+        accumulator()->process(shardC->getValue(true), true);
+        accumulator()->process(shardA->getValue(true), true);
+        accumulator()->process(shardB->getValue(true), true);
+        ASSERT_EQUALS(whole->getValue(false).getLong(), accumulator()->getValue(false).getLong());
+        assertClose(100010, accumulator()->getValue(false), 0.05);
+    }
+};
+
+/** Merging rejects sketches it could not have produced, rather than writing out of bounds. */
+class MergeInvalid : public Base {
+public:
+    void run() {
+        const uint32_t numRegisters = AccumulatorApproxCountDistinct::kNumRegisters;
+        // Entries are (register index << 8) | rank.
+        assertMergeFails(sparse({(numRegisters << 8) | 1}));
+        assertMergeFails(sparse({0xffffffff}));
+        assertMergeFails(sparse({0x100 | 64}));
+        assertMergeFails(Value(DOC("sparse" << BSONBinData("abc", 3, BinDataGeneral))));
+        assertMergeFails(Value(DOC("sparse" << 1)));
+        assertMergeFails(Value(DOC("registers" << BSONBinData("abc", 3, BinDataGeneral))));
+        assertMergeFails(Value(DOC("registers" << 1)));
+        assertMergeFails(Value(1));
+
+        // Once the registers are dense, an index past the end would have been written directly.
+        createAccumulator();
+        const std::vector<char> registers(numRegisters, 1);
+        accumulator()->process(
+            Value(DOC("registers" << BSONBinData(registers.data(), numRegisters, BinDataGeneral))),
+            true);
+        ASSERT_THROWS(accumulator()->process(sparse({(numRegisters << 8) | 1}), true),
+                      UserException);
+        ASSERT_THROWS(accumulator()->process(sparse({0xffffffff}), true), UserException);
+    }
+
+private:
+    static Value sparse(const std::vector<uint32_t>& entries) {
+        std::vector<char> bytes(entries.size() * sizeof(uint32_t));
+        DataView view(bytes.data());
+        for (size_t i = 0; i < entries.size(); i++) {
+            view.write<LittleEndian<uint32_t>>(entries[i], i * sizeof(uint32_t));
+        }
+        return Value(DOC("sparse" << BSONBinData(bytes.data(), bytes.size(), BinDataGeneral)));
+    }
+
+    void assertMergeFails(const Value& input) {
+        createAccumulator();
+        ASSERT_THROWS(accumulator()->process(input, true), UserException);
+    }
+};
+
+}  // namespace ApproxCountDistinct
+
+namespace ApproxPercentiles {
+
+class Base : public AccumulatorTests::Base {
+protected:
+    void createAccumulator() {
+        _accumulator = AccumulatorApproxPercentiles::create();
+        ASSERT_EQUALS(string("$approxPercentiles"), _accumulator->getOpName());
+    }
+    Accumulator* accumulator() {
+        return _accumulator.get();
+    }
+    /** Asserts the percentile 'name' in 'result' is within 'tolerance' of 'expected'. */
+    void assertClose(double expected, const Value& result, const char* name, double tolerance) {
+        ASSERT_EQUALS(Object, result.getType());
+        ASSERT_LESS_THAN_OR_EQUALS(std::abs(result[name].getDouble() - expected), tolerance);
+    }
+
+private:
+    intrusive_ptr<Accumulator> _accumulator;
+};
+
+/** No documents evaluated. */
+class None : public Base {
+public:
+    void run() {
+        createAccumulator();
+        ASSERT_EQUALS(jstNULL, accumulator()->getValue(false).getType());
+    }
+};
+
+/** Non numeric values are ignored, and one value is every percentile. */
+class OneValue : public Base {
+public:
+    void run() {
+        createAccumulator();
+        accumulator()->process(Value(), false);
+        accumulator()->process(Value(BSONNULL), false);
+        accumulator()->process(Value(StringData("x")), false);
+        accumulator()->process(Value(7), false);
+        assertBinaryEqual(BSON("min" << 7.0 << "p25" << 7.0 << "p50" << 7.0 << "p75" << 7.0
+                                     << "p90" << 7.0 << "p95" << 7.0 << "p99" << 7.0 << "max"
+                                     << 7.0),
+                          fromDocument(accumulator()->getValue(false).getDocument()));
+    }
+};
+
+/** Percentiles of a large uniform distribution. */
+class Uniform : public Base {
+public:
+    void run() {
+        createAccumulator();
+        // Visit 1..100000 out of order so the digest doesn't only see sorted input.
+        for (int i = 0; i < 100000; i++) {
+            accumulator()->process(Value((i * 7919) % 100000 + 1), false);
+        }
+        Value result = accumulator()->getValue(false);
+        assertClose(1, result, "min", 0);
+        assertClose(25000, result, "p25", 500);
+        assertClose(50000, result, "p50", 500);
+        assertClose(99000, result, "p99", 100);
+        assertClose(100000, result, "max", 0);
+        // The centroids, not the values, use memory.
+        ASSERT_LESS_THAN(accumulator()->memUsageForSorter(), 100 * 1000);
+    }
+};
+
+/** Digests from several shards merge into one. */
+class Merge : public Base {
+public:
+    void run() {
+        intrusive_ptr<Accumulator> shardA = AccumulatorApproxPercentiles::create();
+        intrusive_ptr<Accumulator> shardB = AccumulatorApproxPercentiles::create();
+        intrusive_ptr<Accumulator> empty = AccumulatorApproxPercentiles::create();
+        for (int i = 1; i <= 10000; i++) {
+            (i % 2 ? shardA : shardB)->process(Value(i), false);
+        }
+
+        createAccumulator();
+        accumulator()->process(shardA->getValue(true), true);
+        accumulator()->process(empty->getValue(true), true);
+        accumulator()->process(shardB->getValue(true), true);
+        Value result = accumulator()->getValue(false);
+        assertClose(1, result, "min", 0);
+        assertClose(5000, result, "p50", 100);
+        assertClose(9500, result, "p95", 50);
+        assertClose(10000, result, "max", 0);
+    }
+};
+
+}  // namespace ApproxPercentiles
+
 class All : public Suite {
 public:
     All() : Suite("accumulator") {}
@@ -1080,6 +1330,19 @@ public:
         add<Sum::IntNull>();
         add<Sum::IntUndefined>();
         add<Sum::NoOverflowBeforeDouble>();
+
+        add<ApproxCountDistinct::None>();
+        add<ApproxCountDistinct::MissingAndNull>();
+        add<ApproxCountDistinct::NumericTypes>();
+        add<ApproxCountDistinct::Small>();
+        add<ApproxCountDistinct::Large>();
+        add<ApproxCountDistinct::Merge>();
+        add<ApproxCountDistinct::MergeInvalid>();
+
+        add<ApproxPercentiles::None>();
+        add<ApproxPercentiles::OneValue>();
+        add<ApproxPercentiles::Uniform>();
+        add<ApproxPercentiles::Merge>();
     }
 };
 
@@ -119,17 +119,20 @@ boost::optional<ParsedDeps> DepsTracker::toParsedDeps() const {
 
 namespace {
 // Mutually recursive with arrayHelper
-Document documentHelper(const BSONObj& bson, const Document& neededFields);
+Document documentHelper(const BSONObj& bson, const Document& neededFields, size_t nNeeded);
 
 // Handles array-typed values for ParsedDeps::extractFields
 Value arrayHelper(const BSONObj& bson, const Document& neededFields) {
     BSONObjIterator it(bson);
 
+    // Each element of the array has to be visited, so count the needed subfields only once.
+    const size_t nNeeded = neededFields.size();
+
     vector<Value> values;
     while (it.more()) {
         BSONElement bsonElement(it.next());
         if (bsonElement.type() == Object) {
-            Document sub = documentHelper(bsonElement.embeddedObject(), neededFields);
+            Document sub = documentHelper(bsonElement.embeddedObject(), neededFields, nNeeded);
             values.push_back(Value(sub));
         }
 
@@ -142,11 +145,12 @@ Value arrayHelper(const BSONObj& bson, const Document& neededFields) {
 }
 
 // Handles object-typed values including the top-level for ParsedDeps::extractFields
-Document documentHelper(const BSONObj& bson, const Document& neededFields) {
-    MutableDocument md(neededFields.size());
+Document documentHelper(const BSONObj& bson, const Document& neededFields, size_t nNeeded) {
+    MutableDocument md(nNeeded);
 
+    size_t nFound = 0;
     BSONObjIterator it(bson);
-    while (it.more()) {
+    while (nFound < nNeeded && it.more()) {
         BSONElement bsonElement(it.next());
         StringData fieldName = bsonElement.fieldNameStringData();
         Value isNeeded = neededFields[fieldName];
@@ -154,21 +158,30 @@ Document documentHelper(const BSONObj& bson, const Document& neededFields) {
         if (isNeeded.missing())
             continue;
 
+        // Documents may contain duplicate field names. Only count the first occurrence so that a
+        // repeated field can't end the scan before every needed field has been seen.
+        const bool firstOccurrence = md.peek()[fieldName].missing();
+
         if (isNeeded.getType() == Bool) {
             md.addField(fieldName, Value(bsonElement));
+            nFound += firstOccurrence;
             continue;
         }
 
         dassert(isNeeded.getType() == Object);
 
         if (bsonElement.type() == Object) {
-            Document sub = documentHelper(bsonElement.embeddedObject(), isNeeded.getDocument());
+            const Document& neededSubfields = isNeeded.getDocument();
+            Document sub = documentHelper(
+                bsonElement.embeddedObject(), neededSubfields, neededSubfields.size());
             md.addField(fieldName, Value(sub));
+            nFound += firstOccurrence;
         }
 
         if (bsonElement.type() == Array) {
             md.addField(fieldName,
                         arrayHelper(bsonElement.embeddedObject(), isNeeded.getDocument()));
+            nFound += firstOccurrence;
         }
     }
 
@@ -177,6 +190,6 @@ Document documentHelper(const BSONObj& bson, const Document& neededFields) {
 }  // namespace
 
 Document ParsedDeps::extractFields(const BSONObj& input) const {
-    return documentHelper(input, _fields);
+    return documentHelper(input, _fields, _nFields);
 }
 }
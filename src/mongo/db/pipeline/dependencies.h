@@ -61,12 +61,18 @@ struct DepsTracker {
  */
 class ParsedDeps {
 public:
+    /**
+     * Returns a Document containing only the needed fields of 'input'. Scanning of each
+     * (sub)object stops as soon as all of the fields needed from it have been found, so the cost
+     * depends on the position of the last needed field rather than on the width of the input.
+     */
     Document extractFields(const BSONObj& input) const;
 
 private:
     friend struct DepsTracker;  // so it can call constructor
-    explicit ParsedDeps(const Document& fields) : _fields(fields) {}
+    explicit ParsedDeps(const Document& fields) : _fields(fields), _nFields(fields.size()) {}
 
     Document _fields;
+    size_t _nFields;  // Number of top-level fields in _fields.
 };
 }
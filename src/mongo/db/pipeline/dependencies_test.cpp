@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/pipeline/dependencies.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+ParsedDeps parsedDeps(const std::vector<std::string>& fields) {
+    DepsTracker deps;
+    deps.fields.insert(fields.begin(), fields.end());
+    boost::optional<ParsedDeps> parsed = deps.toParsedDeps();
+    ASSERT(parsed);
+    return *parsed;
+}
+
+void assertExtracts(const ParsedDeps& deps, const char* input, const char* expected) {
+    const BSONObj extracted = deps.extractFields(fromjson(input)).toBson();
+    ASSERT_EQUALS(fromjson(expected), extracted);
+}
+
+TEST(ParsedDepsTest, ExtractsOnlyNeededFields) {
+    ParsedDeps deps = parsedDeps({"a", "c"});
+    assertExtracts(deps, "{a: 1, b: 2, c: 3, d: 4}", "{a: 1, c: 3}");
+    assertExtracts(deps, "{d: 4, c: 3, b: 2}", "{c: 3}");
+    assertExtracts(deps, "{}", "{}");
+}
+
+TEST(ParsedDepsTest, StopsScanningOnceAllFieldsFound) {
+    // The repeated "a" comes after every needed field has been seen, so it is never visited.
+    ParsedDeps deps = parsedDeps({"a", "b"});
+    assertExtracts(deps, "{b: 1, a: 2, z: 3, a: 4}", "{b: 1, a: 2}");
+}
+
+TEST(ParsedDepsTest, DropsDuplicatesAfterLastNeededField) {
+    // Extraction used to copy every occurrence of a needed field, so the last duplicate was also
+    // extracted. Now only the occurrences seen before the scan ends are, and the first one wins.
+    ParsedDeps deps = parsedDeps({"a", "b"});
+    Document extracted = deps.extractFields(fromjson("{a: 1, b: 2, a: 3}"));
+    ASSERT_EQUALS(fromjson("{a: 1, b: 2}"), extracted.toBson());
+    ASSERT_EQUALS(Value(1), extracted["a"]);
+}
+
+TEST(ParsedDepsTest, DuplicateFieldDoesNotEndScanEarly) {
+    ParsedDeps deps = parsedDeps({"a", "b"});
+    assertExtracts(deps, "{a: 1, a: 2, b: 3}", "{a: 1, a: 2, b: 3}");
+}
+
+TEST(ParsedDepsTest, NestedFields) {
+    ParsedDeps deps = parsedDeps({"a.b", "c"});
+    assertExtracts(deps, "{a: {x: 1, b: 2, y: 3}, c: 4, d: 5}", "{a: {b: 2}, c: 4}");
+    assertExtracts(deps, "{a: [{b: 1, x: 1}, 5, {x: 2}], c: 4}", "{a: [{b: 1}, {}], c: 4}");
+    assertExtracts(deps, "{a: 1, c: 4}", "{c: 4}");
+}
+
+}  // namespace
+}  // namespace mongo
@@ -274,6 +274,12 @@ public:
          */
         virtual BSONObj insert(const NamespaceString& ns, const std::vector<BSONObj>& objs) = 0;
 
+        /**
+         * Returns the key pattern of an index on 'ns' that can answer any equality query on
+         * 'fieldPath', including one for null, or an empty object if there is no such index.
+         */
+        virtual BSONObj getEqualityIndex(const NamespaceString& ns, StringData fieldPath) = 0;
+
         // Add new methods as needed.
     };
 
@@ -507,6 +513,26 @@ public:
         _doingMerge = doingMerge;
     }
 
+    /**
+     * Returns the sort pattern under which all input documents with the same _id are adjacent:
+     * {a: 1} for an _id of "$a" and {a: 1, b: 1} for an _id of {x: "$a", y: "$b"}. Returns an
+     * empty object if the _id is not made up only of distinct field paths into the input
+     * document.
+     */
+    BSONObj getIdSortPattern() const;
+
+    /**
+     * Tell this source that its input arrives ordered by getIdSortPattern(). A streaming $group
+     * outputs each group as soon as the _id changes, so it only holds a single group in memory
+     * and never spills. Defaults to false.
+     *
+     * An array in the _id means the index providing the order is multikey, which it may have
+     * become since the plan was chosen. The $group then hashes the rest of its input instead.
+     */
+    void setStreaming(bool streaming) {
+        _streaming = streaming;
+    }
+
     /**
       Create a grouping DocumentSource from BSON.
 
@@ -543,6 +569,29 @@ private:
     void populate();
     bool populated;
 
+    /**
+     * getNext() for a streaming $group: accumulates the run of input documents sharing the _id
+     * of _firstDocOfNextGroup and returns it as a single group.
+     */
+    boost::optional<Document> getNextStreaming();
+
+    /**
+     * Whether the internal representation of a group key has an array in any of its fields.
+     */
+    bool idContainsArray(const Value& id) const;
+
+    /**
+     * Switches a streaming $group over to hashing, starting with the groups already in the map
+     * and _firstDocOfNextGroup, and returns the first hashed group.
+     */
+    boost::optional<Document> stopStreaming();
+
+    /**
+     * Replaces the _id and accumulator expressions with compiled versions. Called at the start of
+     * populate(), once no further optimizations can be applied to this stage.
+     */
+    void compileExpressions();
+
     /**
      * Parses the raw id expression into _idExpressions and possibly _idFieldNames.
      */
@@ -585,6 +634,7 @@ private:
 
     bool _doingMerge;
     bool _spilled;
+    bool _streaming;
     const bool _extSortAllowed;
     const int _maxMemoryUsageBytes;
     std::unique_ptr<Variables> _variables;
@@ -598,7 +648,11 @@ private:
     std::unique_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
     std::pair<Value, Value> _firstPartOfNextGroup;
     Value _currentId;
-    Accumulators _currentAccumulators;
+    Accumulators _currentAccumulators;  // also used when _streaming
+
+    // only used when _streaming
+    boost::optional<Document> _firstDocOfNextGroup;
+    Value _firstIdOfNextGroup;
 };
 
 
@@ -795,6 +849,9 @@ private:
     std::unique_ptr<Variables> _variables;
     boost::intrusive_ptr<ExpressionObject> pEO;
     BSONObj _raw;
+
+    // Set once pEO's fields have been compiled to ExpressionPrograms on the first getNext().
+    bool _compiled;
 };
 
 class DocumentSourceRedact final : public DocumentSource {
@@ -1144,4 +1201,106 @@ private:
     BSONObj cmdOutput;
     std::unique_ptr<BSONObjIterator> resultsIterator;  // iterator over cmdOutput["results"]
 };
+
+/**
+ * Joins each input document with the documents of another unsharded collection in the same
+ * database whose 'foreignField' equals the input's 'localField', placing the matches in an
+ * array named 'as'.
+ *
+ * If the foreign collection has an index answering equality on 'foreignField', each input
+ * document probes it with a query hinted to that index (an index nested loop join). Otherwise
+ * the foreign collection is read once into a hash table keyed on 'foreignField'. If that table
+ * outgrows the memory limit it is abandoned for a plain nested loop, which queries the foreign
+ * collection once per input document.
+ */
+class DocumentSourceLookUp final : public DocumentSource,
+                                   public SplittableDocumentSource,
+                                   public DocumentSourceNeedsMongod {
+public:
+    enum class Strategy { kUndecided, kIndexNestedLoop, kHash, kNestedLoop };
+
+    // virtuals from DocumentSource
+    boost::optional<Document> getNext() final;
+    const char* getSourceName() const final;
+    Value serialize(bool explain = false) const final;
+    GetDepsReturn getDependencies(DepsTracker* deps) const final;
+    void dispose() final;
+
+    // Virtuals for SplittableDocumentSource. The foreign collection only exists on the primary
+    // shard, so the join always runs in the merger.
+    boost::intrusive_ptr<DocumentSource> getShardSource() final {
+        return NULL;
+    }
+    boost::intrusive_ptr<DocumentSource> getMergeSource() final {
+        return this;
+    }
+
+    const NamespaceString& getFromNs() const {
+        return _fromNs;
+    }
+
+    Strategy getStrategy() const {
+        return _strategy;
+    }
+
+    static const char* strategyName(Strategy strategy);
+
+    static boost::intrusive_ptr<DocumentSource> createFromBson(
+        BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+private:
+    DocumentSourceLookUp(NamespaceString fromNs,
+                         std::string as,
+                         std::string localField,
+                         std::string foreignField,
+                         const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+    /**
+     * Picks the join strategy and, for a hash join, builds the hash table. Called on the first
+     * getNext().
+     */
+    void prepare();
+
+    /**
+     * Reads the foreign collection into _hashTable. Returns false, leaving the table empty, if
+     * it would use more than _maxMemoryUsageBytes.
+     */
+    bool buildHashTable();
+
+    /**
+     * The foreign documents joined to one input document, and their total size as BSON.
+     */
+    struct Matches {
+        std::vector<Value> docs;
+        long long bsonSize = 0;
+    };
+
+    /**
+     * Queries the foreign collection for the documents matching 'localValue', hinting
+     * _indexKeyPattern if it is not empty.
+     */
+    Matches queryForeign(const Value& localValue);
+
+    /**
+     * Uasserts that 'matches' can fit in an output document.
+     */
+    static void checkMatchesSize(const Matches& matches);
+
+    const NamespaceString _fromNs;
+    const FieldPath _as;
+    const FieldPath _localField;
+    const FieldPath _foreignField;
+    const int _maxMemoryUsageBytes;
+
+    Strategy _strategy;
+    BSONObj _indexKeyPattern;  // only used for kIndexNestedLoop
+
+    typedef std::unordered_map<Value, Matches, Value::Hash> HashTable;
+    HashTable _hashTable;  // only used for kHash
+
+    // Reported by explain.
+    long long _nProbes;
+    long long _nMatched;
+    long long _nForeignDocsRead;
+};
 }
@@ -35,6 +35,7 @@
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/value.h"
 
 namespace mongo {
@@ -53,6 +54,9 @@ const char* DocumentSourceGroup::getSourceName() const {
 boost::optional<Document> DocumentSourceGroup::getNext() {
     pExpCtx->checkForInterrupt();
 
+    if (_streaming)
+        return getNextStreaming();
+
     if (!populated)
         populate();
 
@@ -114,10 +118,115 @@ boost::optional<Document> DocumentSourceGroup::getNext() {
     }
 }
 
+boost::optional<Document> DocumentSourceGroup::getNextStreaming() {
+    const size_t numAccumulators = vpAccumulatorFactory.size();
+
+    if (!populated) {
+        compileExpressions();
+
+        _currentAccumulators.reserve(numAccumulators);
+        for (size_t i = 0; i < numAccumulators; i++) {
+            _currentAccumulators.push_back(vpAccumulatorFactory[i]());
+        }
+
+        _firstDocOfNextGroup = pSource->getNext();
+        if (_firstDocOfNextGroup) {
+            _variables->setRoot(*_firstDocOfNextGroup);
+            _firstIdOfNextGroup = computeId(_variables.get());
+        }
+        populated = true;
+
+        if (_firstDocOfNextGroup && idContainsArray(_firstIdOfNextGroup))
+            return stopStreaming();
+    }
+
+    if (!_firstDocOfNextGroup)
+        return boost::none;
+
+    for (size_t i = 0; i < numAccumulators; i++) {
+        _currentAccumulators[i]->reset();  // prep accumulators for a new group
+    }
+
+    /* treat missing values the same as NULL SERVER-4674 */
+    _currentId = _firstIdOfNextGroup.missing() ? Value(BSONNULL) : _firstIdOfNextGroup;
+
+    // On entry to each iteration, ROOT is set to _firstDocOfNextGroup, which belongs to the
+    // current group. At loop exit, it is the first document of the next group, if any.
+    while (true) {
+        // Only the current group is held, but it is held to the same limit as all of the groups
+        // of a hashed $group.
+        int memoryUsageBytes = _currentId.getApproximateSize();
+        for (size_t i = 0; i < numAccumulators; i++) {
+            _currentAccumulators[i]->process(vpExpression[i]->evaluate(_variables.get()),
+                                             _doingMerge);
+            memoryUsageBytes += _currentAccumulators[i]->memUsageForSorter();
+        }
+        _variables->clearRoot();
+
+        if (memoryUsageBytes > _maxMemoryUsageBytes) {
+            uassert(16945,
+                    "Exceeded memory limit for $group, but didn't allow external sort."
+                    " Pass allowDiskUse:true to opt in.",
+                    _extSortAllowed);
+            // Let the hashing path spill the group and carry on with the rest of the input.
+            groups[_currentId] = std::move(_currentAccumulators);
+            _currentAccumulators.clear();
+            _firstDocOfNextGroup = boost::none;
+            return stopStreaming();
+        }
+
+        _firstDocOfNextGroup = pSource->getNext();
+        if (!_firstDocOfNextGroup)
+            break;
+
+        _variables->setRoot(*_firstDocOfNextGroup);
+        _firstIdOfNextGroup = computeId(_variables.get());
+        if (idContainsArray(_firstIdOfNextGroup)) {
+            groups[_currentId] = std::move(_currentAccumulators);
+            _currentAccumulators.clear();
+            return stopStreaming();
+        }
+
+        const Value& id =
+            _firstIdOfNextGroup.missing() ? Value(BSONNULL) : _firstIdOfNextGroup;
+        if (Value::compare(id, _currentId) != 0)
+            break;
+    }
+
+    Document out = makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+
+    if (!_firstDocOfNextGroup)
+        dispose();
+
+    return out;
+}
+
+bool DocumentSourceGroup::idContainsArray(const Value& id) const {
+    if (_idExpressions.size() == 1)
+        return id.getType() == Array;
+
+    const vector<Value>& vals = id.getArray();
+    for (size_t i = 0; i < vals.size(); i++) {
+        if (vals[i].getType() == Array)
+            return true;
+    }
+    return false;
+}
+
+boost::optional<Document> DocumentSourceGroup::stopStreaming() {
+    // The groups already returned are complete: every document of theirs had a scalar key,
+    // and so came from the one contiguous range of index keys equal to it.
+    _streaming = false;
+    populated = false;
+    populate();
+    return getNext();
+}
+
 void DocumentSourceGroup::dispose() {
     // free our resources
     GroupsMap().swap(groups);
     _sorterIterator.reset();
+    _firstDocOfNextGroup = boost::none;
 
     // make us look done
     groupsIterator = groups.end();
@@ -173,6 +282,10 @@ Value DocumentSourceGroup::serialize(bool explain) const {
         insides["$doingMerge"] = Value(true);
     }
 
+    if (explain && _streaming) {
+        insides["$streaming"] = Value(true);
+    }
+
     return Value(DOC(getSourceName() << insides.freeze()));
 }
 
@@ -191,6 +304,29 @@ DocumentSource::GetDepsReturn DocumentSourceGroup::getDependencies(DepsTracker*
     return EXHAUSTIVE_ALL;
 }
 
+BSONObj DocumentSourceGroup::getIdSortPattern() const {
+    BSONObjBuilder pattern;
+    std::set<std::string> paths;
+    for (size_t i = 0; i < _idExpressions.size(); i++) {
+        const ExpressionFieldPath* fieldPath =
+            dynamic_cast<const ExpressionFieldPath*>(_idExpressions[i].get());
+
+        // Only plain paths into the input document have an index order. The first component of
+        // the FieldPath is the variable name, so $$ROOT on its own is ruled out here too.
+        if (!fieldPath || fieldPath->getVariableId() != Variables::ROOT_ID ||
+            fieldPath->getFieldPath().getPathLength() < 2) {
+            return BSONObj();
+        }
+
+        const std::string path = fieldPath->getFieldPath().tail().getPath(false);
+        if (!paths.insert(path).second)
+            return BSONObj();
+
+        pattern.append(path, 1);
+    }
+    return pattern.obj();
+}
+
 intrusive_ptr<DocumentSourceGroup> DocumentSourceGroup::create(
     const intrusive_ptr<ExpressionContext>& pExpCtx) {
     intrusive_ptr<DocumentSourceGroup> pSource(new DocumentSourceGroup(pExpCtx));
@@ -202,6 +338,7 @@ DocumentSourceGroup::DocumentSourceGroup(const intrusive_ptr<ExpressionContext>&
       populated(false),
       _doingMerge(false),
       _spilled(false),
+      _streaming(false),
       _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter),
       _maxMemoryUsageBytes(100 * 1024 * 1024) {}
 
@@ -229,6 +366,8 @@ static int GroupOpDescCmp(const void* pL, const void* pR) {
 */
 static const GroupOpDesc GroupOpTable[] = {
     {"$addToSet", AccumulatorAddToSet::create},
+    {"$approxCountDistinct", AccumulatorApproxCountDistinct::create},
+    {"$approxPercentiles", AccumulatorApproxPercentiles::create},
     {"$avg", AccumulatorAvg::create},
     {"$first", AccumulatorFirst::create},
     {"$last", AccumulatorLast::create},
@@ -341,16 +480,41 @@ public:
 };
 }
 
+void DocumentSourceGroup::compileExpressions() {
+    for (size_t i = 0; i < _idExpressions.size(); i++) {
+        _idExpressions[i] = ExpressionCompiled::compile(_idExpressions[i]);
+    }
+
+    for (size_t i = 0; i < vpExpression.size(); i++) {
+        vpExpression[i] = ExpressionCompiled::compile(vpExpression[i]);
+    }
+}
+
 void DocumentSourceGroup::populate() {
     const size_t numAccumulators = vpAccumulatorFactory.size();
     dassert(numAccumulators == vpExpression.size());
 
+    compileExpressions();
+
     // pushed to on spill()
     vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles;
     int memoryUsageBytes = 0;
 
+    // A streaming $group that stopped streaming hands over the group it was accumulating, if
+    // any, and the document it stopped at.
+    for (GroupsMap::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+        memoryUsageBytes += it->first.getApproximateSize();
+        for (size_t i = 0; i < it->second.size(); i++) {
+            memoryUsageBytes += it->second[i]->memUsageForSorter();
+        }
+    }
+    boost::optional<Document> input = std::move(_firstDocOfNextGroup);
+    _firstDocOfNextGroup = boost::none;
+    if (!input)
+        input = pSource->getNext();
+
     // This loop consumes all input from pSource and buckets it based on pIdExpression.
-    while (boost::optional<Document> input = pSource->getNext()) {
+    for (; input; input = pSource->getNext()) {
         if (memoryUsageBytes > _maxMemoryUsageBytes) {
             uassert(16945,
                     "Exceeded memory limit for $group, but didn't allow external sort."
@@ -0,0 +1,300 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source.h"
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::string;
+
+REGISTER_DOCUMENT_SOURCE(lookup, DocumentSourceLookUp::createFromBson);
+
+const char* DocumentSourceLookUp::getSourceName() const {
+    return "$lookup";
+}
+
+const char* DocumentSourceLookUp::strategyName(Strategy strategy) {
+    switch (strategy) {
+        case Strategy::kUndecided:
+            return "undecided";
+        case Strategy::kIndexNestedLoop:
+            return "indexNestedLoop";
+        case Strategy::kHash:
+            return "hash";
+        case Strategy::kNestedLoop:
+            return "nestedLoop";
+    }
+    MONGO_UNREACHABLE;
+}
+
+DocumentSourceLookUp::DocumentSourceLookUp(NamespaceString fromNs,
+                                           string as,
+                                           string localField,
+                                           string foreignField,
+                                           const intrusive_ptr<ExpressionContext>& pExpCtx)
+    : DocumentSource(pExpCtx),
+      _fromNs(std::move(fromNs)),
+      _as(std::move(as)),
+      _localField(std::move(localField)),
+      _foreignField(std::move(foreignField)),
+      _maxMemoryUsageBytes(100 * 1024 * 1024),
+      _strategy(Strategy::kUndecided),
+      _nProbes(0),
+      _nMatched(0),
+      _nForeignDocsRead(0) {}
+
+boost::optional<Document> DocumentSourceLookUp::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    if (_strategy == Strategy::kUndecided)
+        prepare();
+
+    boost::optional<Document> input = pSource->getNext();
+    if (!input)
+        return boost::none;
+
+    /* treat missing values the same as NULL, as an equality query would */
+    Value localValue = input->getNestedField(_localField);
+    if (localValue.missing())
+        localValue = Value(BSONNULL);
+
+    _nProbes++;
+
+    Matches matches;
+    if (_strategy == Strategy::kHash) {
+        HashTable::const_iterator it = _hashTable.find(localValue);
+        if (it != _hashTable.end())
+            matches = it->second;
+        checkMatchesSize(matches);
+    } else {
+        matches = queryForeign(localValue);
+    }
+    _nMatched += matches.docs.size();
+
+    MutableDocument output(std::move(*input));
+    output.setNestedField(_as, Value(std::move(matches.docs)));
+    return output.freeze();
+}
+
+void DocumentSourceLookUp::prepare() {
+    invariant(_mongod);
+
+    uassert(28722,
+            str::stream() << "namespace '" << _fromNs.ns()
+                          << "' is sharded so it can't be used for $lookup",
+            !_mongod->isSharded(_fromNs));
+
+    _indexKeyPattern = _mongod->getEqualityIndex(_fromNs, _foreignField.getPath(false));
+    if (!_indexKeyPattern.isEmpty()) {
+        _strategy = Strategy::kIndexNestedLoop;
+    } else if (buildHashTable()) {
+        _strategy = Strategy::kHash;
+    } else {
+        _strategy = Strategy::kNestedLoop;
+    }
+}
+
+namespace {
+/**
+ * Adds to 'keys' every value an equality query on 'path' would match in 'obj': the value at
+ * the path, including whole arrays, and the elements of any array found there.
+ */
+void addEqualityKeys(const BSONObj& obj, StringData path, BSONElementSet* keys) {
+    obj.getFieldsDotted(path, *keys, /*expandLastArray*/ false);
+    obj.getFieldsDotted(path, *keys, /*expandLastArray*/ true);
+}
+}
+
+bool DocumentSourceLookUp::buildHashTable() {
+    const string foreignPath = _foreignField.getPath(false);
+    const Value nullKey = Value(BSONNULL);
+    int memoryUsageBytes = 0;
+
+    // A query for null also matches a missing field, and an array element which lacks the rest
+    // of the path, so use one to find every foreign document a null or missing local value joins.
+    const BSONObj nullObj = BSON("" << BSONNULL);
+    EqualityMatchExpression matchesNull;
+    uassertStatusOK(matchesNull.init(foreignPath, nullObj.firstElement()));
+
+    std::unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_fromNs.ns(), Query());
+    while (cursor->more()) {
+        pExpCtx->checkForInterrupt();
+
+        const BSONObj foreign = cursor->nextSafe().getOwned();
+        _nForeignDocsRead++;
+
+        const Value foreignValue = Value(foreign);
+        memoryUsageBytes += foreignValue.getApproximateSize();
+
+        BSONElementSet keys;
+        addEqualityKeys(foreign, foreignPath, &keys);
+        bool hasNullKey = false;
+        for (BSONElementSet::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+            const Value key(*it);
+            memoryUsageBytes += key.getApproximateSize() + sizeof(Value);
+            Matches& matches = _hashTable[key];
+            matches.docs.push_back(foreignValue);
+            matches.bsonSize += foreign.objsize();
+            hasNullKey = hasNullKey || it->type() == jstNULL;
+        }
+        if (!hasNullKey && matchesNull.matchesBSON(foreign)) {
+            memoryUsageBytes += sizeof(Value);
+            Matches& matches = _hashTable[nullKey];
+            matches.docs.push_back(foreignValue);
+            matches.bsonSize += foreign.objsize();
+        }
+
+        if (memoryUsageBytes > _maxMemoryUsageBytes) {
+            HashTable().swap(_hashTable);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+DocumentSourceLookUp::Matches DocumentSourceLookUp::queryForeign(const Value& localValue) {
+    BSONObjBuilder query;
+    {
+        BSONObjBuilder equality(query.subobjStart(_foreignField.getPath(false)));
+        localValue.addToBsonObj(&equality, "$eq");
+    }
+
+    Query foreignQuery(query.obj());
+    if (_strategy == Strategy::kIndexNestedLoop)
+        foreignQuery.hint(_indexKeyPattern);
+
+    Matches matches;
+    std::unique_ptr<DBClientCursor> cursor =
+        _mongod->directClient()->query(_fromNs.ns(), foreignQuery);
+    while (cursor->more()) {
+        const BSONObj foreign = cursor->nextSafe().getOwned();
+        _nForeignDocsRead++;
+        matches.docs.push_back(Value(foreign));
+        matches.bsonSize += foreign.objsize();
+        checkMatchesSize(matches);
+    }
+    return matches;
+}
+
+void DocumentSourceLookUp::checkMatchesSize(const Matches& matches) {
+    uassert(28733,
+            str::stream() << "$lookup matched more than the maximum document size ("
+                          << BSONObjMaxUserSize / (1024 * 1024) << "MB)",
+            matches.bsonSize < BSONObjMaxUserSize);
+}
+
+void DocumentSourceLookUp::dispose() {
+    HashTable().swap(_hashTable);
+    pSource->dispose();
+}
+
+Value DocumentSourceLookUp::serialize(bool explain) const {
+    MutableDocument insides;
+    insides["from"] = Value(_fromNs.coll());
+    insides["as"] = Value(_as.getPath(false));
+    insides["localField"] = Value(_localField.getPath(false));
+    insides["foreignField"] = Value(_foreignField.getPath(false));
+
+    if (explain) {
+        Strategy strategy = _strategy;
+        BSONObj index = _indexKeyPattern;
+        if (strategy == Strategy::kUndecided && _mongod) {
+            // Not run yet, so report the strategy prepare() would start with.
+            index = _mongod->getEqualityIndex(_fromNs, _foreignField.getPath(false));
+            strategy = index.isEmpty() ? Strategy::kHash : Strategy::kIndexNestedLoop;
+        }
+        insides["strategy"] = Value(strategyName(strategy));
+        if (strategy == Strategy::kIndexNestedLoop)
+            insides["index"] = Value(index);
+        insides["probes"] = Value(_nProbes);
+        insides["matched"] = Value(_nMatched);
+        insides["foreignDocsRead"] = Value(_nForeignDocsRead);
+    }
+
+    return Value(DOC(getSourceName() << insides.freeze()));
+}
+
+DocumentSource::GetDepsReturn DocumentSourceLookUp::getDependencies(DepsTracker* deps) const {
+    deps->fields.insert(_localField.getPath(false));
+    return SEE_NEXT;
+}
+
+intrusive_ptr<DocumentSource> DocumentSourceLookUp::createFromBson(
+    BSONElement elem, const intrusive_ptr<ExpressionContext>& pExpCtx) {
+    uassert(28723,
+            str::stream() << "the $lookup specification must be an Object, not "
+                          << typeName(elem.type()),
+            elem.type() == Object);
+
+    string from;
+    string as;
+    string localField;
+    string foreignField;
+
+    BSONForEach(argument, elem.Obj()) {
+        const StringData argName = argument.fieldNameStringData();
+        uassert(28724,
+                str::stream() << "$lookup argument '" << argName << "' must be a string, is type "
+                              << typeName(argument.type()),
+                argument.type() == String);
+
+        if (argName == "from") {
+            from = argument.String();
+        } else if (argName == "as") {
+            as = argument.String();
+        } else if (argName == "localField") {
+            localField = argument.String();
+        } else if (argName == "foreignField") {
+            foreignField = argument.String();
+        } else {
+            uasserted(28725, str::stream() << "unknown argument to $lookup: " << argName);
+        }
+    }
+
+    uassert(28726,
+            "$lookup requires 'from', 'as', 'localField' and 'foreignField' to be specified",
+            !from.empty() && !as.empty() && !localField.empty() && !foreignField.empty());
+
+    NamespaceString fromNs(pExpCtx->ns.db(), from);
+    uassert(28727, "invalid $lookup namespace: " + fromNs.ns(), fromNs.isValid());
+
+    return new DocumentSourceLookUp(
+        std::move(fromNs), std::move(as), std::move(localField), std::move(foreignField), pExpCtx);
+}
+}
@@ -34,6 +34,7 @@
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/value.h"
 
 namespace mongo {
@@ -44,7 +45,7 @@ using std::vector;
 
 DocumentSourceProject::DocumentSourceProject(const intrusive_ptr<ExpressionContext>& pExpCtx,
                                              const intrusive_ptr<ExpressionObject>& exprObj)
-    : DocumentSource(pExpCtx), pEO(exprObj) {}
+    : DocumentSource(pExpCtx), pEO(exprObj), _compiled(false) {}
 
 REGISTER_DOCUMENT_SOURCE(project, DocumentSourceProject::createFromBson);
 
@@ -59,6 +60,11 @@ boost::optional<Document> DocumentSourceProject::getNext() {
     if (!input)
         return boost::none;
 
+    if (!_compiled) {
+        pEO->compileFields();
+        _compiled = true;
+    }
+
     /* create the result document */
     const size_t sizeHint = pEO->getSizeHint();
     MutableDocument out(sizeHint);
@@ -38,6 +38,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/util/string_map.h"
@@ -1159,6 +1160,13 @@ intrusive_ptr<Expression> ExpressionObject::optimize() {
     return intrusive_ptr<Expression>(this);
 }
 
+void ExpressionObject::compileFields() {
+    for (FieldMap::iterator it(_expressions.begin()); it != _expressions.end(); ++it) {
+        if (it->second)
+            it->second = ExpressionCompiled::compile(it->second);
+    }
+}
+
 bool ExpressionObject::isSimple() {
     for (FieldMap::iterator it(_expressions.begin()); it != _expressions.end(); ++it) {
         if (it->second && !it->second->isSimple())
@@ -333,6 +333,10 @@ public:
 
     static ExpressionVector parseArguments(BSONElement bsonExpr, const VariablesParseState& vps);
 
+    const ExpressionVector& getOperandList() const {
+        return vpOperand;
+    }
+
 protected:
     ExpressionNary() {}
 
@@ -462,6 +466,10 @@ public:
 
     explicit ExpressionCompare(CmpOp cmpOp);
 
+    CmpOp getCmpOp() const {
+        return cmpOp;
+    }
+
 private:
     CmpOp cmpOp;
 };
@@ -616,6 +624,10 @@ public:
         return _fieldPath;
     }
 
+    Variables::Id getVariableId() const {
+        return _variable;
+    }
+
 private:
     ExpressionFieldPath(const std::string& fieldPath, Variables::Id variable);
 
@@ -890,6 +902,15 @@ public:
         _excludeId = b;
     }
 
+    /**
+     * Replaces each computed field (recursing into nested ExpressionObjects) with an
+     * ExpressionCompiled wrapping the same expression. Inclusions are left untouched.
+     *
+     * Should only be called once the pipeline is finalized since the compiled expressions can
+     * no longer be optimized.
+     */
+    void compileFields();
+
 private:
     explicit ExpressionObject(bool atRoot);
 
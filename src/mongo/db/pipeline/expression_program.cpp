@@ -0,0 +1,578 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/expression_program.h"
+
+#include "mongo/db/pipeline/document.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+const uint32_t kUnpatched = uint32_t(-1);
+
+const char* opCodeName(ExpressionProgram::OpCode op) {
+    switch (op) {
+        case ExpressionProgram::kLoadConst:
+            return "LOAD_CONST";
+        case ExpressionProgram::kLoadRootField:
+            return "LOAD_ROOT_FIELD";
+        case ExpressionProgram::kEval:
+            return "EVAL";
+        case ExpressionProgram::kAdd:
+            return "ADD";
+        case ExpressionProgram::kMultiply:
+            return "MULTIPLY";
+        case ExpressionProgram::kSubtract:
+            return "SUBTRACT";
+        case ExpressionProgram::kDivide:
+            return "DIVIDE";
+        case ExpressionProgram::kCompare:
+            return "COMPARE";
+        case ExpressionProgram::kNot:
+            return "NOT";
+        case ExpressionProgram::kJump:
+            return "JUMP";
+        case ExpressionProgram::kJumpIfFalse:
+            return "JUMP_IF_FALSE";
+        case ExpressionProgram::kJumpIfTrue:
+            return "JUMP_IF_TRUE";
+        case ExpressionProgram::kJumpIfNotNullish:
+            return "JUMP_IF_NOT_NULLISH";
+        case ExpressionProgram::kJumpIfNotNumeric:
+            return "JUMP_IF_NOT_NUMERIC";
+    }
+    return "UNKNOWN";
+}
+
+/**
+ * A numeric Value unpacked into both of the representations the tree's arithmetic tracks. This is
+ * an inline equivalent of coerceToLong() and coerceToDouble() for operands already known to be
+ * numeric.
+ */
+struct Numeric {
+    explicit Numeric(const Value& val) : type(val.getType()) {
+        if (type == NumberDouble) {
+            doubleValue = val.getDouble();
+            longValue = static_cast<long long>(doubleValue);
+        } else {
+            longValue = val.getLong();
+            doubleValue = static_cast<double>(longValue);
+        }
+    }
+
+    BSONType type;
+    long long longValue;
+    double doubleValue;
+};
+
+/** Same as Value::getWidestNumeric() when both types are numeric. */
+inline BSONType widestNumeric(BSONType lType, BSONType rType) {
+    if (lType == NumberDouble || rType == NumberDouble)
+        return NumberDouble;
+    if (lType == NumberLong || rType == NumberLong)
+        return NumberLong;
+    return NumberInt;
+}
+
+/**
+ * Produces the same Value as the numeric branches of ExpressionAdd, ExpressionMultiply and
+ * ExpressionSubtract for a result of the given widest type.
+ */
+inline Value numericResult(BSONType type, long long longResult, double doubleResult) {
+    if (type == NumberDouble)
+        return Value(doubleResult);
+
+    const int intResult = longResult;
+    if (type == NumberLong || intResult != longResult)
+        return Value(longResult);
+    return Value(intResult);
+}
+
+/** Normalizes a Value::compare() result to -1, 0 or 1. */
+inline int normalizeCmp(int cmp) {
+    return cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+}
+
+/**
+ * Compares two values with a fast path for operands of the same integral type, which are by far
+ * the most common case in $group keys and $cond predicates.
+ */
+inline int compareValues(const Value& lhs, const Value& rhs) {
+    const BSONType lType = lhs.getType();
+    if (lType == rhs.getType()) {
+        if (lType == NumberInt) {
+            const int l = lhs.getInt();
+            const int r = rhs.getInt();
+            return (l > r) - (l < r);
+        }
+        if (lType == NumberLong) {
+            const long long l = lhs.getLong();
+            const long long r = rhs.getLong();
+            return (l > r) - (l < r);
+        }
+    }
+    return normalizeCmp(Value::compare(lhs, rhs));
+}
+
+inline Value compareResult(ExpressionCompare::CmpOp op, int cmp) {
+    switch (op) {
+        case ExpressionCompare::EQ:
+            return Value(cmp == 0);
+        case ExpressionCompare::NE:
+            return Value(cmp != 0);
+        case ExpressionCompare::GT:
+            return Value(cmp > 0);
+        case ExpressionCompare::GTE:
+            return Value(cmp >= 0);
+        case ExpressionCompare::LT:
+            return Value(cmp < 0);
+        case ExpressionCompare::LTE:
+            return Value(cmp <= 0);
+        case ExpressionCompare::CMP:
+            return Value(cmp);
+    }
+    MONGO_UNREACHABLE;
+}
+}  // namespace
+
+/* ----------------------- ExpressionProgram::Compiler ---------------------------- */
+
+/**
+ * Lowers an Expression tree into an ExpressionProgram.
+ *
+ * Registers are allocated in stack order: each node is compiled into a destination register and
+ * any temporaries it needs are released once the node has been emitted.
+ */
+class ExpressionProgram::Compiler {
+public:
+    explicit Compiler(ExpressionProgram* program) : _program(program) {}
+
+    void compile(const intrusive_ptr<Expression>& expr) {
+        const uint32_t result = allocate(1);
+        invariant(result == 0);
+        compileInto(expr, result);
+        _program->_registers.resize(_maxRegisters);
+    }
+
+private:
+    void compileInto(const intrusive_ptr<Expression>& expr, uint32_t dst) {
+        Expression* const node = expr.get();
+
+        if (auto constant = dynamic_cast<ExpressionConstant*>(node)) {
+            emit(kLoadConst, dst, addConstant(constant->getValue()));
+        } else if (auto fieldPath = dynamic_cast<ExpressionFieldPath*>(node)) {
+            compileFieldPath(expr, *fieldPath, dst);
+        } else if (auto add = dynamic_cast<ExpressionAdd*>(node)) {
+            compileGuardedArithmetic(expr, add->getOperandList(), kAdd, dst);
+        } else if (auto multiply = dynamic_cast<ExpressionMultiply*>(node)) {
+            compileGuardedArithmetic(expr, multiply->getOperandList(), kMultiply, dst);
+        } else if (auto subtract = dynamic_cast<ExpressionSubtract*>(node)) {
+            compileGuardedArithmetic(expr, subtract->getOperandList(), kSubtract, dst);
+        } else if (auto divide = dynamic_cast<ExpressionDivide*>(node)) {
+            compileGuardedArithmetic(expr, divide->getOperandList(), kDivide, dst);
+        } else if (auto compare = dynamic_cast<ExpressionCompare*>(node)) {
+            compileCompare(*compare, dst);
+        } else if (auto andExpr = dynamic_cast<ExpressionAnd*>(node)) {
+            compileShortCircuit(andExpr->getOperandList(), kJumpIfFalse, dst);
+        } else if (auto orExpr = dynamic_cast<ExpressionOr*>(node)) {
+            compileShortCircuit(orExpr->getOperandList(), kJumpIfTrue, dst);
+        } else if (auto notExpr = dynamic_cast<ExpressionNot*>(node)) {
+            compileInto(notExpr->getOperandList()[0], dst);
+            emit(kNot, dst, dst);
+        } else if (auto cond = dynamic_cast<ExpressionCond*>(node)) {
+            compileCond(cond->getOperandList(), dst);
+        } else if (auto ifNull = dynamic_cast<ExpressionIfNull*>(node)) {
+            compileIfNull(ifNull->getOperandList(), dst);
+        } else {
+            emitEval(expr, dst);
+        }
+    }
+
+    void compileFieldPath(const intrusive_ptr<Expression>& expr,
+                          const ExpressionFieldPath& fieldPath,
+                          uint32_t dst) {
+        // "$$ROOT.a" and "$a" (while CURRENT is ROOT) are a single lookup in the root document.
+        // Anything deeper has to handle traversal of arrays, so leave it to the tree.
+        if (fieldPath.getVariableId() == Variables::ROOT_ID &&
+            fieldPath.getFieldPath().getPathLength() == 2) {
+            _program->_fieldNames.push_back(fieldPath.getFieldPath().getFieldName(1));
+            emit(kLoadRootField, dst, _program->_fieldNames.size() - 1);
+            return;
+        }
+        emitEval(expr, dst);
+    }
+
+    /**
+     * Emits operands into consecutive temporaries, each followed by a numeric guard. A failed
+     * guard jumps to a full evaluation of the original node, which re-evaluates the operands and
+     * produces exactly the result or error the tree would have.
+     */
+    void compileGuardedArithmetic(const intrusive_ptr<Expression>& expr,
+                                  const vector<intrusive_ptr<Expression>>& operands,
+                                  OpCode op,
+                                  uint32_t dst) {
+        const uint32_t count = operands.size();
+        const uint32_t base = allocate(count);
+
+        vector<size_t> guards;
+        for (uint32_t i = 0; i < count; i++) {
+            compileInto(operands[i], base + i);
+
+            // Numeric constants can't fail the guard.
+            auto constant = dynamic_cast<ExpressionConstant*>(operands[i].get());
+            if (!constant || !constant->getValue().numeric())
+                guards.push_back(emit(kJumpIfNotNumeric, 0, base + i));
+        }
+
+        const uint32_t nodeIndex = addNode(expr);
+        if (op == kAdd || op == kMultiply) {
+            emit(op, dst, base, count);
+        } else {
+            invariant(count == 2);
+            emit(op, dst, base, base + 1, nodeIndex);
+        }
+        const size_t done = emit(kJump, 0);
+
+        for (size_t guard : guards)
+            patch(guard);
+        emit(kEval, dst, nodeIndex);
+        patch(done);
+
+        release(base);
+    }
+
+    void compileCompare(const ExpressionCompare& compare, uint32_t dst) {
+        const auto& operands = compare.getOperandList();
+        const uint32_t base = allocate(2);
+        compileInto(operands[0], base);
+        compileInto(operands[1], base + 1);
+        emit(kCompare, dst, base, base + 1, compare.getCmpOp());
+        release(base);
+    }
+
+    /**
+     * $and / $or: evaluate operands into 'dst' one at a time and stop as soon as one decides the
+     * result, exactly like the tree does.
+     */
+    void compileShortCircuit(const vector<intrusive_ptr<Expression>>& operands,
+                             OpCode jumpOp,
+                             uint32_t dst) {
+        const bool shortCircuitResult = (jumpOp == kJumpIfTrue);
+
+        vector<size_t> exits;
+        for (const auto& operand : operands) {
+            compileInto(operand, dst);
+            exits.push_back(emit(jumpOp, 0, dst));
+        }
+        emit(kLoadConst, dst, addConstant(Value(!shortCircuitResult)));
+        const size_t done = emit(kJump, 0);
+
+        for (size_t exit : exits)
+            patch(exit);
+        emit(kLoadConst, dst, addConstant(Value(shortCircuitResult)));
+        patch(done);
+    }
+
+    void compileCond(const vector<intrusive_ptr<Expression>>& operands, uint32_t dst) {
+        compileInto(operands[0], dst);
+        const size_t toElse = emit(kJumpIfFalse, 0, dst);
+        compileInto(operands[1], dst);
+        const size_t done = emit(kJump, 0);
+        patch(toElse);
+        compileInto(operands[2], dst);
+        patch(done);
+    }
+
+    void compileIfNull(const vector<intrusive_ptr<Expression>>& operands, uint32_t dst) {
+        compileInto(operands[0], dst);
+        const size_t done = emit(kJumpIfNotNullish, 0, dst);
+        compileInto(operands[1], dst);
+        patch(done);
+    }
+
+    void emitEval(const intrusive_ptr<Expression>& expr, uint32_t dst) {
+        emit(kEval, dst, addNode(expr));
+    }
+
+    size_t emit(OpCode op, uint32_t dst, uint32_t a = 0, uint32_t b = 0, uint32_t aux = 0) {
+        // Jump targets are filled in by patch() once they are known.
+        if (op >= kJump)
+            aux = kUnpatched;
+        _program->_code.push_back(Instruction{op, dst, a, b, aux});
+        return _program->_code.size() - 1;
+    }
+
+    /** Points the jump at 'index' to the next instruction to be emitted. */
+    void patch(size_t index) {
+        Instruction& jump = _program->_code[index];
+        invariant(jump.aux == kUnpatched);
+        jump.aux = _program->_code.size();
+    }
+
+    uint32_t addConstant(const Value& value) {
+        _program->_constants.push_back(value);
+        return _program->_constants.size() - 1;
+    }
+
+    uint32_t addNode(const intrusive_ptr<Expression>& expr) {
+        _program->_nodes.push_back(expr);
+        return _program->_nodes.size() - 1;
+    }
+
+    uint32_t allocate(uint32_t count) {
+        const uint32_t base = _nextRegister;
+        _nextRegister += count;
+        _maxRegisters = std::max(_maxRegisters, _nextRegister);
+        return base;
+    }
+
+    void release(uint32_t base) {
+        _nextRegister = base;
+    }
+
+    ExpressionProgram* const _program;
+    uint32_t _nextRegister = 0;
+    uint32_t _maxRegisters = 0;
+};
+
+/* -------------------------- ExpressionProgram ------------------------------ */
+
+unique_ptr<ExpressionProgram> ExpressionProgram::compile(const intrusive_ptr<Expression>& expr) {
+    unique_ptr<ExpressionProgram> program(new ExpressionProgram());
+    Compiler(program.get()).compile(expr);
+    return program;
+}
+
+Value ExpressionProgram::run(Variables* vars) const {
+    Value* const regs = _registers.data();
+    const Instruction* const code = _code.data();
+    const size_t end = _code.size();
+
+    size_t pc = 0;
+    while (pc < end) {
+        const Instruction& ins = code[pc++];
+        switch (ins.op) {
+            case kLoadConst:
+                regs[ins.dst] = _constants[ins.a];
+                break;
+
+            case kLoadRootField:
+                regs[ins.dst] = vars->getRoot()[_fieldNames[ins.a]];
+                break;
+
+            case kEval:
+                regs[ins.dst] = _nodes[ins.a]->evaluateInternal(vars);
+                break;
+
+            case kAdd: {
+                double doubleTotal = 0;
+                long long longTotal = 0;
+                BSONType totalType = NumberInt;
+                for (uint32_t i = 0; i < ins.b; i++) {
+                    const Numeric val(regs[ins.a + i]);
+                    totalType = widestNumeric(totalType, val.type);
+                    doubleTotal += val.doubleValue;
+                    longTotal += val.longValue;
+                }
+                regs[ins.dst] = numericResult(totalType, longTotal, doubleTotal);
+                break;
+            }
+
+            case kMultiply: {
+                double doubleProduct = 1;
+                long long longProduct = 1;
+                BSONType productType = NumberInt;
+                for (uint32_t i = 0; i < ins.b; i++) {
+                    const Numeric val(regs[ins.a + i]);
+                    productType = widestNumeric(productType, val.type);
+                    doubleProduct *= val.doubleValue;
+                    longProduct *= val.longValue;
+                }
+                regs[ins.dst] = numericResult(productType, longProduct, doubleProduct);
+                break;
+            }
+
+            case kSubtract: {
+                const Numeric lhs(regs[ins.a]);
+                const Numeric rhs(regs[ins.b]);
+                regs[ins.dst] = numericResult(widestNumeric(rhs.type, lhs.type),
+                                              lhs.longValue - rhs.longValue,
+                                              lhs.doubleValue - rhs.doubleValue);
+                break;
+            }
+
+            case kDivide: {
+                const double denom = regs[ins.b].getDouble();
+                if (denom == 0) {
+                    // Let the tree report the error.
+                    regs[ins.dst] = _nodes[ins.aux]->evaluateInternal(vars);
+                } else {
+                    regs[ins.dst] = Value(regs[ins.a].getDouble() / denom);
+                }
+                break;
+            }
+
+            case kCompare:
+                regs[ins.dst] = compareResult(static_cast<ExpressionCompare::CmpOp>(ins.aux),
+                                              compareValues(regs[ins.a], regs[ins.b]));
+                break;
+
+            case kNot:
+                regs[ins.dst] = Value(!regs[ins.a].coerceToBool());
+                break;
+
+            case kJump:
+                pc = ins.aux;
+                break;
+
+            case kJumpIfFalse:
+                if (!regs[ins.a].coerceToBool())
+                    pc = ins.aux;
+                break;
+
+            case kJumpIfTrue:
+                if (regs[ins.a].coerceToBool())
+                    pc = ins.aux;
+                break;
+
+            case kJumpIfNotNullish:
+                if (!regs[ins.a].nullish())
+                    pc = ins.aux;
+                break;
+
+            case kJumpIfNotNumeric:
+                if (!regs[ins.a].numeric())
+                    pc = ins.aux;
+                break;
+        }
+    }
+
+    // Moving the result out releases any reference the register held on the input document.
+    return std::move(regs[0]);
+}
+
+bool ExpressionProgram::isSpecialized() const {
+    for (const Instruction& ins : _code) {
+        if (ins.op != kLoadConst && ins.op != kLoadRootField && ins.op != kEval)
+            return true;
+    }
+    return false;
+}
+
+string ExpressionProgram::disassemble() const {
+    StringBuilder sb;
+    for (size_t pc = 0; pc < _code.size(); pc++) {
+        const Instruction& ins = _code[pc];
+        sb << pc << ": " << opCodeName(ins.op);
+        switch (ins.op) {
+            case kLoadConst:
+                sb << " r" << ins.dst << ", " << _constants[ins.a].toString();
+                break;
+            case kLoadRootField:
+                sb << " r" << ins.dst << ", $$ROOT." << _fieldNames[ins.a];
+                break;
+            case kEval:
+                sb << " r" << ins.dst << ", #" << ins.a;
+                break;
+            case kAdd:
+            case kMultiply:
+                sb << " r" << ins.dst << ", r" << ins.a << "..r" << (ins.a + ins.b - 1);
+                break;
+            case kSubtract:
+            case kDivide:
+            case kCompare:
+                sb << " r" << ins.dst << ", r" << ins.a << ", r" << ins.b;
+                break;
+            case kNot:
+                sb << " r" << ins.dst << ", r" << ins.a;
+                break;
+            case kJump:
+                sb << " @" << ins.aux;
+                break;
+            case kJumpIfFalse:
+            case kJumpIfTrue:
+            case kJumpIfNotNullish:
+            case kJumpIfNotNumeric:
+                sb << " r" << ins.a << ", @" << ins.aux;
+                break;
+        }
+        sb << '\n';
+    }
+    return sb.str();
+}
+
+/* -------------------------- ExpressionCompiled ------------------------------ */
+
+ExpressionCompiled::ExpressionCompiled(intrusive_ptr<Expression> original,
+                                       unique_ptr<ExpressionProgram> program)
+    : _original(std::move(original)), _program(std::move(program)) {}
+
+intrusive_ptr<Expression> ExpressionCompiled::compile(const intrusive_ptr<Expression>& expr) {
+    if (!expr || dynamic_cast<ExpressionCompiled*>(expr.get()))
+        return expr;
+
+    // Document expressions are compiled field by field so that addToDocument() still sees them.
+    if (auto exprObj = dynamic_cast<ExpressionObject*>(expr.get())) {
+        exprObj->compileFields();
+        return expr;
+    }
+
+    unique_ptr<ExpressionProgram> program = ExpressionProgram::compile(expr);
+    if (!program->isSpecialized())
+        return expr;
+
+    return new ExpressionCompiled(expr, std::move(program));
+}
+
+intrusive_ptr<Expression> ExpressionCompiled::optimize() {
+    // The original was already optimized before it was compiled.
+    return this;
+}
+
+void ExpressionCompiled::addDependencies(DepsTracker* deps, vector<string>* path) const {
+    _original->addDependencies(deps, path);
+}
+
+Value ExpressionCompiled::evaluateInternal(Variables* vars) const {
+    return _program->run(vars);
+}
+
+Value ExpressionCompiled::serialize(bool explain) const {
+    return _original->serialize(explain);
+}
+}
@@ -0,0 +1,164 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/platform/basic.h"
+
+#include <boost/intrusive_ptr.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+/**
+ * A flattened, register-based form of an Expression tree.
+ *
+ * The hot operators ($add, $subtract, $multiply, $divide, comparisons, $and, $or, $not, $cond,
+ * $ifNull, constants and top-level field paths) are lowered to opcodes operating on a small
+ * register file, which removes the virtual evaluateInternal() call and the temporary Value
+ * returned at every node. Arithmetic opcodes are specialized for numeric operands: each operand
+ * is guarded by a type check and any non-numeric input (dates, nulls, errors) falls back to
+ * evaluating the original subtree, so results and error codes are always identical to the tree.
+ * Operators without an opcode are evaluated through the tree as a single instruction.
+ *
+ * A program owns its register file and is therefore not safe to evaluate concurrently. This
+ * matches DocumentSources, which are only ever driven by a single thread.
+ */
+class ExpressionProgram {
+    MONGO_DISALLOW_COPYING(ExpressionProgram);
+
+public:
+    enum OpCode : uint8_t {
+        kLoadConst,         // regs[dst] = constants[a]
+        kLoadRootField,     // regs[dst] = ROOT[names[a]]
+        kEval,              // regs[dst] = nodes[a]->evaluateInternal(vars)
+        kAdd,               // regs[dst] = sum of b numeric registers starting at regs[a]
+        kMultiply,          // regs[dst] = product of b numeric registers starting at regs[a]
+        kSubtract,          // regs[dst] = regs[a] - regs[b], both numeric
+        kDivide,            // regs[dst] = regs[a] / regs[b], both numeric; nodes[aux] if b is 0
+        kCompare,           // regs[dst] = ExpressionCompare(aux)(regs[a], regs[b])
+        kNot,               // regs[dst] = !regs[a].coerceToBool()
+        kJump,              // pc = aux
+        kJumpIfFalse,       // if (!regs[a].coerceToBool()) pc = aux
+        kJumpIfTrue,        // if (regs[a].coerceToBool()) pc = aux
+        kJumpIfNotNullish,  // if (!regs[a].nullish()) pc = aux
+        kJumpIfNotNumeric,  // if (!regs[a].numeric()) pc = aux
+    };
+
+    struct Instruction {
+        OpCode op;
+        uint32_t dst;
+        uint32_t a;
+        uint32_t b;
+        uint32_t aux;
+    };
+
+    /**
+     * Compiles 'expr' into a program. 'expr' should already be optimized, since constant folding
+     * is left to Expression::optimize().
+     */
+    static std::unique_ptr<ExpressionProgram> compile(const boost::intrusive_ptr<Expression>& expr);
+
+    /**
+     * Runs the program with the given Variables (which hold ROOT and any $let/$map bindings).
+     */
+    Value run(Variables* vars) const;
+
+    /**
+     * Returns true if at least one operator was lowered to a specialized opcode, that is, if
+     * running the program does more than load a value or delegate to the tree.
+     */
+    bool isSpecialized() const;
+
+    const std::vector<Instruction>& getInstructions() const {
+        return _code;
+    }
+
+    size_t getNumRegisters() const {
+        return _registers.size();
+    }
+
+    /**
+     * Human readable listing of the program, one instruction per line. Only used for debugging
+     * and tests.
+     */
+    std::string disassemble() const;
+
+private:
+    class Compiler;
+
+    ExpressionProgram() = default;
+
+    std::vector<Instruction> _code;
+    std::vector<Value> _constants;
+    std::vector<std::string> _fieldNames;
+    std::vector<boost::intrusive_ptr<Expression>> _nodes;
+
+    // Scratch space reused across runs. Register 0 always holds the result.
+    mutable std::vector<Value> _registers;
+};
+
+/**
+ * An Expression backed by an ExpressionProgram.
+ *
+ * This is a drop-in replacement for the expression it was compiled from: serialization and
+ * dependency tracking are delegated to the original tree so explain output and dependency
+ * analysis are unchanged.
+ */
+class ExpressionCompiled final : public Expression {
+public:
+    boost::intrusive_ptr<Expression> optimize() final;
+    void addDependencies(DepsTracker* deps, std::vector<std::string>* path = NULL) const final;
+    Value evaluateInternal(Variables* vars) const final;
+    Value serialize(bool explain) const final;
+
+    /**
+     * Returns an ExpressionCompiled for 'expr', or 'expr' itself if compiling would not save any
+     * work (for example if it is a lone constant or field path, or is already compiled).
+     */
+    static boost::intrusive_ptr<Expression> compile(const boost::intrusive_ptr<Expression>& expr);
+
+    const ExpressionProgram& getProgram() const {
+        return *_program;
+    }
+
+private:
+    ExpressionCompiled(boost::intrusive_ptr<Expression> original,
+                       std::unique_ptr<ExpressionProgram> program);
+
+    const boost::intrusive_ptr<Expression> _original;
+    const std::unique_ptr<ExpressionProgram> _program;
+};
+}
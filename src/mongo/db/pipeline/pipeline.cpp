@@ -333,6 +333,15 @@ void Pipeline::addRequiredPrivileges(Command* commandTemplate,
             }
 
             out->push_back(Privilege(ResourcePattern::forExactNamespace(outputNs), actions));
+        } else if (str::equals(stage.firstElementFieldName(), "$lookup")) {
+            BSONElement spec = stage.firstElement();
+            BSONElement from = spec.type() == Object ? spec.Obj()["from"] : BSONElement();
+            if (from.type() == String) {
+                // Malformed specifications are reported when the stage is parsed.
+                NamespaceString fromNs(db, from.valueStringData());
+                out->push_back(
+                    Privilege(ResourcePattern::forExactNamespace(fromNs), ActionType::find));
+            }
         }
     }
 }
@@ -443,6 +452,17 @@ bool Pipeline::hasOutStage() const {
     return dynamic_cast<DocumentSourceOut*>(sources.back().get());
 }
 
+bool Pipeline::needsPrimaryShardMerger() const {
+    if (hasOutStage())
+        return true;
+
+    for (SourceContainer::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+        if (dynamic_cast<DocumentSourceLookUp*>(it->get()))
+            return true;
+    }
+    return false;
+}
+
 Document Pipeline::serialize() const {
     MutableDocument serialized;
     // create an array out of the pipeline operations
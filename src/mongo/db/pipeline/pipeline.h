@@ -93,6 +93,12 @@ public:
      */
     bool hasOutStage() const;
 
+    /**
+     * Returns true if the merging half of this pipeline must run on the primary shard of the
+     * database, because it writes a collection with $out or reads one with $lookup.
+     */
+    bool needsPrimaryShardMerger() const;
+
     /**
       Write the Pipeline as a BSONObj command.  This should be the
       inverse of parseCommand().
@@ -35,8 +35,13 @@
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/document_validation.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/exec/plan_stats.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/get_executor.h"
@@ -83,10 +88,109 @@ public:
         return _client.getLastErrorDetailed();
     }
 
+    BSONObj getEqualityIndex(const NamespaceString& ns, StringData fieldPath) final {
+        AutoGetCollectionForRead ctx(_ctx->opCtx, ns.ns());
+        Collection* collection = ctx.getCollection();
+        if (!collection)
+            return BSONObj();
+
+        IndexCatalog::IndexIterator it =
+            collection->getIndexCatalog()->getIndexIterator(_ctx->opCtx, false);
+        while (it.more()) {
+            const IndexDescriptor* desc = it.next();
+
+            // Sparse and partial indexes don't hold every document, so they can't answer a
+            // query for null or for values outside their filter.
+            if (desc->getAccessMethodName() != IndexNames::BTREE || desc->isSparse() ||
+                desc->isPartial())
+                continue;
+
+            if (fieldPath == desc->keyPattern().firstElementFieldName())
+                return desc->keyPattern().getOwned();
+        }
+        return BSONObj();
+    }
+
 private:
     intrusive_ptr<ExpressionContext> _ctx;
     DBDirectClient _client;
 };
+
+/**
+ * Returns true if 'a' and 'b' name the same field or one is a path through the other.
+ */
+bool pathsOverlap(StringData a, StringData b) {
+    if (a.size() > b.size())
+        std::swap(a, b);
+    return b.startsWith(a) && (a.size() == b.size() || b[a.size()] == '.');
+}
+
+/**
+ * Returns true if a multikey index includes any of the fields of 'sortPattern'. An index scan
+ * over such an index orders array values by their elements, so documents whose _id is an array
+ * would not arrive next to the other members of their group.
+ */
+bool multikeyIndexOnAnyField(OperationContext* txn,
+                             Collection* collection,
+                             const BSONObj& sortPattern) {
+    IndexCatalog::IndexIterator it =
+        collection->getIndexCatalog()->getIndexIterator(txn, /*includeUnfinishedIndexes*/ true);
+    while (it.more()) {
+        const IndexDescriptor* desc = it.next();
+        if (!desc->isMultikey(txn))
+            continue;
+
+        BSONForEach(indexField, desc->keyPattern()) {
+            BSONForEach(sortField, sortPattern) {
+                if (pathsOverlap(indexField.fieldNameStringData(), sortField.fieldNameStringData()))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Returns true if the plan rooted at 'root' returns documents in the order of 'sortPattern'
+ * because it is a single scan of an index whose key pattern starts with the sort pattern.
+ */
+bool planScansIndexInOrder(const PlanStage* root, const BSONObj& sortPattern) {
+    const PlanStage* stage = root;
+    while (stage->stageType() != STAGE_IXSCAN) {
+        switch (stage->stageType()) {
+            case STAGE_CACHED_PLAN:
+            case STAGE_FETCH:
+            case STAGE_KEEP_MUTATIONS:
+            case STAGE_MULTI_PLAN:
+            case STAGE_PROJECTION:
+            case STAGE_SHARDING_FILTER:
+            case STAGE_SUBPLAN:
+                break;
+            default:
+                return false;
+        }
+
+        // A MultiPlanStage that has chosen its plan only reports the winner.
+        const std::vector<PlanStage*> children = stage->getChildren();
+        if (children.size() != 1)
+            return false;
+        stage = children[0];
+    }
+
+    const IndexScanStats* stats = static_cast<const IndexScanStats*>(stage->getSpecificStats());
+    BSONObjIterator keyIt(stats->keyPattern);
+    BSONForEach(sortField, sortPattern) {
+        if (!keyIt.more())
+            return false;
+
+        const BSONElement keyField = keyIt.next();
+        if (keyField.fieldNameStringData() != sortField.fieldNameStringData() ||
+            !keyField.isNumber() ||
+            (keyField.number() * stats->direction > 0) != (sortField.number() > 0))
+            return false;
+    }
+    return true;
+}
 }
 
 shared_ptr<PlanExecutor> PipelineD::prepareCursorSource(
@@ -155,6 +259,25 @@ shared_ptr<PlanExecutor> PipelineD::prepareCursorSource(
         }
     }
 
+    /*
+      Look for an initial $group on plain field paths. If the PlanExecutor can return documents
+      in _id order using an index, each group is contiguous in the input and the $group can
+      stream its output instead of building a hash table of every group.
+    */
+    intrusive_ptr<DocumentSourceGroup> groupStage;
+    BSONObj groupSortObj;
+    if (!sortStage && !sources.empty() && collection) {
+        groupStage = dynamic_cast<DocumentSourceGroup*>(sources.front().get());
+        if (groupStage) {
+            groupSortObj = groupStage->getIdSortPattern();
+            // An index that becomes multikey once the scan is under way is caught by the
+            // $group itself, which then stops streaming.
+            if (!groupSortObj.isEmpty() &&
+                multikeyIndexOnAnyField(txn, collection, groupSortObj))
+                groupSortObj = BSONObj();
+        }
+    }
+
     // Create the PlanExecutor.
     //
     // If we try to create a PlanExecutor that includes both the match and the
@@ -204,6 +327,35 @@ shared_ptr<PlanExecutor> PipelineD::prepareCursorSource(
         }
     }
 
+    if (!groupSortObj.isEmpty()) {
+        // The $group can stream if the PlanExecutor returns documents in _id order. But planning
+        // for that order can pass over a more selective index for the $match, which costs more
+        // than the hash table saves. So with a $match, plan for the $match alone, and only stream
+        // if that plan happens to scan an index in _id order anyway.
+        const BSONObj planSortObj = queryObj.isEmpty() ? groupSortObj : BSONObj();
+        auto statusWithCQ = CanonicalQuery::canonicalize(
+            pExpCtx->ns.ns(), queryObj, planSortObj, projectionForQuery, whereCallback);
+
+        if (statusWithCQ.isOK()) {
+            auto statusWithPlanExecutor = getExecutor(txn,
+                                                      collection,
+                                                      std::move(statusWithCQ.getValue()),
+                                                      PlanExecutor::YIELD_AUTO,
+                                                      runnerOptions);
+            if (statusWithPlanExecutor.isOK()) {
+                exec = std::move(statusWithPlanExecutor.getValue());
+                if (queryObj.isEmpty() ||
+                    planScansIndexInOrder(exec->getRootStage(), groupSortObj)) {
+                    // success: The $group streams over the index order.
+                    sortObj = groupSortObj;
+                    sortInRunner = true;
+
+                    groupStage->setStreaming(true);
+                }
+            }
+        }
+    }
+
     if (!exec.get()) {
         const BSONObj noSort;
         auto statusWithCQ = CanonicalQuery::canonicalize(
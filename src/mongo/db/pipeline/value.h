@@ -147,6 +147,7 @@ public:
     Timestamp getTimestamp() const;
     const char* getRegex() const;
     const char* getRegexFlags() const;
+    BSONBinData getBinData() const;
     std::string getSymbol() const;
     std::string getCode() const;
     int getInt() const;
@@ -345,6 +346,12 @@ inline const char* Value::getRegexFlags() const {
     return flags;
 }
 
+inline BSONBinData Value::getBinData() const {
+    verify(getType() == BinData);
+    const StringData data = _storage.getString();
+    return BSONBinData(data.rawData(), data.size(), _storage.binDataType());
+}
+
 inline std::string Value::getSymbol() const {
     verify(getType() == Symbol);
     return _storage.getString().toString();
@@ -367,4 +374,15 @@ inline long long Value::getLong() const {
     verify(type == NumberLong);
     return _storage.longValue;
 }
+
+inline double Value::getDouble() const {
+    BSONType type = getType();
+    if (type == NumberInt)
+        return _storage.intValue;
+    if (type == NumberLong)
+        return static_cast<double>(_storage.longValue);
+
+    verify(type == NumberDouble);
+    return _storage.doubleValue;
+}
 };
@@ -56,4 +56,18 @@ void appendGetMoreResponseObject(long long cursorId,
     cursorObj.done();
 }
 
+void appendCompressedGetMoreResponseObject(long long cursorId,
+                                           StringData cursorNamespace,
+                                           StringData compressedNextBatch,
+                                           BSONObjBuilder* builder) {
+    BSONObjBuilder cursorObj(builder->subobjStart("cursor"));
+    cursorObj.append("id", cursorId);
+    cursorObj.append("ns", cursorNamespace);
+    cursorObj.appendBinData("nextBatchSnappy",
+                            compressedNextBatch.size(),
+                            BinDataGeneral,
+                            compressedNextBatch.rawData());
+    cursorObj.done();
+}
+
 }  // namespace mongo
@@ -62,4 +62,16 @@ void appendGetMoreResponseObject(long long cursorId,
                                  BSONArray nextBatch,
                                  BSONObjBuilder* builder);
 
+/**
+ * Like appendGetMoreResponseObject, for a getMore which asked for its batch to be compressed.
+ * 'compressedNextBatch' is the "nextBatch" array, as BSON, compressed with snappy.
+ *
+ * The response object has the following format:
+ *   { id: <NumberLong>, ns: <String>, nextBatchSnappy: <BinData> }.
+ */
+void appendCompressedGetMoreResponseObject(long long cursorId,
+                                           StringData cursorNamespace,
+                                           StringData compressedNextBatch,
+                                           BSONObjBuilder* builder);
+
 }  // namespace mongo
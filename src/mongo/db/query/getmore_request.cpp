@@ -47,16 +47,24 @@ const char kCollectionField[] = "collection";
 const char kBatchSizeField[] = "batchSize";
 const char kMaxTimeMSField[] = "maxTimeMS";
 const char kTermField[] = "term";
+const char kCompressionField[] = "compression";
 
 }  // namespace
 
+const char GetMoreRequest::kSnappyCompression[] = "snappy";
+
 GetMoreRequest::GetMoreRequest() : cursorid(0), batchSize(0) {}
 
 GetMoreRequest::GetMoreRequest(NamespaceString namespaceString,
                                CursorId id,
                                boost::optional<long long> sizeOfBatch,
-                               boost::optional<long long> term)
-    : nss(std::move(namespaceString)), cursorid(id), batchSize(sizeOfBatch), term(term) {}
+                               boost::optional<long long> term,
+                               boost::optional<std::string> compression)
+    : nss(std::move(namespaceString)),
+      cursorid(id),
+      batchSize(sizeOfBatch),
+      term(term),
+      compression(std::move(compression)) {}
 
 Status GetMoreRequest::isValid() const {
     if (!nss.isValid()) {
@@ -74,6 +82,11 @@ Status GetMoreRequest::isValid() const {
                                     << "but received: " << *batchSize);
     }
 
+    if (compression && *compression != kSnappyCompression) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Unsupported compression for getMore: " << *compression);
+    }
+
     return Status::OK();
 }
 
@@ -97,6 +110,7 @@ StatusWith<GetMoreRequest> GetMoreRequest::parseFromBSON(const std::string& dbna
     // Optional fields.
     boost::optional<long long> batchSize;
     boost::optional<long long> term;
+    boost::optional<std::string> compression;
 
     for (BSONElement el : cmdObj) {
         const char* fieldName = el.fieldName();
@@ -132,6 +146,13 @@ StatusWith<GetMoreRequest> GetMoreRequest::parseFromBSON(const std::string& dbna
                         str::stream() << "Field 'term' must be of type NumberLong in: " << cmdObj};
             }
             term = el.Long();
+        } else if (str::equals(fieldName, kCompressionField)) {
+            if (el.type() != BSONType::String) {
+                return {ErrorCodes::TypeMismatch,
+                        str::stream()
+                            << "Field 'compression' must be of type string in: " << cmdObj};
+            }
+            compression = el.String();
         } else if (!str::startsWith(fieldName, "$")) {
             return {ErrorCodes::FailedToParse,
                     str::stream() << "Failed to parse: " << cmdObj << ". "
@@ -149,7 +170,7 @@ StatusWith<GetMoreRequest> GetMoreRequest::parseFromBSON(const std::string& dbna
                 str::stream() << "Field 'collection' missing in: " << cmdObj};
     }
 
-    GetMoreRequest request(NamespaceString(*fullns), *cursorid, batchSize, term);
+    GetMoreRequest request(NamespaceString(*fullns), *cursorid, batchSize, term, compression);
     Status validStatus = request.isValid();
     if (!validStatus.isOK()) {
         return validStatus;
@@ -172,6 +193,10 @@ BSONObj GetMoreRequest::toBSON() const {
         builder.append(kTermField, *term);
     }
 
+    if (compression) {
+        builder.append(kCompressionField, *compression);
+    }
+
     return builder.obj();
 }
 
@@ -39,6 +39,8 @@
 namespace mongo {
 
 struct GetMoreRequest {
+    static const char kSnappyCompression[];
+
     /**
      * Construct an empty request.
      */
@@ -50,7 +52,8 @@ struct GetMoreRequest {
     GetMoreRequest(NamespaceString namespaceString,
                    CursorId id,
                    boost::optional<long long> sizeOfBatch,
-                   boost::optional<long long> term);
+                   boost::optional<long long> term,
+                   boost::optional<std::string> compression = boost::none);
 
     /**
      * Construct a GetMoreRequest from the command specification and db name.
@@ -76,6 +79,11 @@ struct GetMoreRequest {
     // Only internal queries from replication will typically have a term.
     const boost::optional<long long> term;
 
+    // How to compress the batch in the response, if at all. Only "snappy" is supported; the
+    // batch is then returned as snappy compressed BSON in 'cursor.nextBatchSnappy', rather than
+    // as 'cursor.nextBatch'. Used by replication to fetch the oplog.
+    const boost::optional<std::string> compression;
+
 private:
     /**
      * Returns a non-OK status if there are semantic errors in the parsed request
@@ -185,6 +185,39 @@ TEST(GetMoreRequestTest, parseFromBSONIgnoreMaxTimeMS) {
     ASSERT_EQUALS(CursorId(123), result.getValue().cursorid);
 }
 
+TEST(GetMoreRequestTest, parseFromBSONCompressionProvided) {
+    StatusWith<GetMoreRequest> result =
+        GetMoreRequest::parseFromBSON("db",
+                                      BSON("getMore" << CursorId(123) << "collection"
+                                                     << "coll"
+                                                     << "compression"
+                                                     << "snappy"));
+    ASSERT_OK(result.getStatus());
+    ASSERT(result.getValue().compression);
+    ASSERT_EQUALS(GetMoreRequest::kSnappyCompression, *result.getValue().compression);
+}
+
+TEST(GetMoreRequestTest, parseFromBSONCompressionNotString) {
+    StatusWith<GetMoreRequest> result =
+        GetMoreRequest::parseFromBSON("db",
+                                      BSON("getMore" << CursorId(123) << "collection"
+                                                     << "coll"
+                                                     << "compression" << 1));
+    ASSERT_NOT_OK(result.getStatus());
+    ASSERT_EQUALS(ErrorCodes::TypeMismatch, result.getStatus().code());
+}
+
+TEST(GetMoreRequestTest, parseFromBSONUnsupportedCompression) {
+    StatusWith<GetMoreRequest> result =
+        GetMoreRequest::parseFromBSON("db",
+                                      BSON("getMore" << CursorId(123) << "collection"
+                                                     << "coll"
+                                                     << "compression"
+                                                     << "zlib"));
+    ASSERT_NOT_OK(result.getStatus());
+    ASSERT_EQUALS(ErrorCodes::BadValue, result.getStatus().code());
+}
+
 TEST(GetMoreRequestTest, toBSONHasBatchSize) {
     GetMoreRequest request(NamespaceString("testdb.testcoll"), 123, 99, boost::none);
     BSONObj requestObj = request.toBSON();
@@ -211,4 +244,18 @@ TEST(GetMoreRequestTest, toBSONHasTerm) {
     ASSERT_EQ(requestObj, expectedRequest);
 }
 
+TEST(GetMoreRequestTest, toBSONHasCompression) {
+    GetMoreRequest request(NamespaceString("testdb.testcoll"),
+                           123,
+                           boost::none,
+                           boost::none,
+                           std::string(GetMoreRequest::kSnappyCompression));
+    BSONObj requestObj = request.toBSON();
+    BSONObj expectedRequest = BSON("getMore" << CursorId(123) << "collection"
+                                             << "testcoll"
+                                             << "compression"
+                                             << "snappy");
+    ASSERT_EQ(requestObj, expectedRequest);
+}
+
 }  // namespace
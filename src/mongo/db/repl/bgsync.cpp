@@ -33,6 +33,7 @@
 #include "mongo/db/repl/bgsync.h"
 
 #include "mongo/base/counter.h"
+#include "mongo/base/init.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/client.h"
 #include "mongo/db/commands/fsync.h"
@@ -40,7 +41,9 @@
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/getmore_request.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/oplog_batch_fetcher.h"
 #include "mongo/db/repl/oplog_interface_local.h"
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
@@ -48,7 +51,11 @@
 #include "mongo/db/repl/rollback_source_impl.h"
 #include "mongo/db/repl/rs_rollback.h"
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/latency_histogram_metric.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/db/wire_version.h"
+#include "mongo/executor/task_executor.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -63,8 +70,26 @@ namespace {
 const char hashFieldName[] = "h";
 int SleepToAllowBatchingMillis = 2;
 const int BatchIsSmallish = 40000;  // bytes
+
+const char kNoCompression[] = "none";
 }  // namespace
 
+// The largest number of oplog entries to fetch from the sync source at a time. 0 leaves it to
+// the sync source. Either way, a batch is at most 4MB.
+MONGO_EXPORT_SERVER_PARAMETER(replOplogFetchMaxEntriesPerBatch, int, 0);
+
+// Whether to ask the sync source to compress the oplog entries it returns, "none" or "snappy".
+// Sync sources which can't are asked for uncompressed entries instead.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replOplogFetchCompression, std::string, kNoCompression);
+MONGO_INITIALIZER(replOplogFetchCompression)(InitializerContext*) {
+    if (replOplogFetchCompression != kNoCompression &&
+        replOplogFetchCompression != GetMoreRequest::kSnappyCompression) {
+        return Status(ErrorCodes::BadValue,
+                      "unsupported oplog fetch compression: " + replOplogFetchCompression);
+    }
+    return Status::OK();
+}
+
 MONGO_FP_DECLARE(rsBgSyncProduce);
 MONGO_FP_DECLARE(stepDownWhileDrainingFailPoint);
 
@@ -81,6 +106,13 @@ static ServerStatusMetricField<Counter64> displayOpsRead("repl.network.ops", &op
 // The bytes read via the oplog reader
 static Counter64 networkByteStats;
 static ServerStatusMetricField<Counter64> displayBytesRead("repl.network.bytes", &networkByteStats);
+// The bytes read in compressed batches, as compressed; their uncompressed size is in the above
+static Counter64 networkCompressedByteStats;
+static ServerStatusMetricField<Counter64> displayCompressedBytesRead(
+    "repl.network.compressedBytes", &networkCompressedByteStats);
+
+// The round trip times of the find and getMore commands which fetch oplog entries
+static LatencyHistogramMetric getmoreLatency("repl.network.getmoreLatency");
 
 // The count of items in the buffer
 static Counter64 bufferCountGauge;
@@ -245,6 +277,13 @@ void BackgroundSync::_produce(OperationContext* txn, executor::TaskExecutor* tas
         _replCoord->signalUpstreamUpdater();
     }
 
+    // Sync sources which have the find and getMore commands are tailed with those, through the
+    // executor; the connection is kept for rollback.
+    if (taskExecutor && syncSourceReader.conn()->getMaxWireVersion() >= RELEASE_3_1_5) {
+        _fetchOplog(txn, taskExecutor, syncSourceReader, lastOpTimeFetched);
+        return;
+    }
+
     syncSourceReader.tailingQueryGTE(rsOplogName.c_str(), lastOpTimeFetched.getTimestamp());
 
     // if target cut connections between connecting and querying (for
@@ -253,7 +292,11 @@ void BackgroundSync::_produce(OperationContext* txn, executor::TaskExecutor* tas
         return;
     }
 
-    if (_rollbackIfNeeded(txn, syncSourceReader)) {
+    BSONObj firstOp;
+    if (syncSourceReader.more()) {
+        firstOp = syncSourceReader.nextSafe();
+    }
+    if (_rollbackIfNeeded(txn, syncSourceReader, firstOp)) {
         stop();
         return;
     }
@@ -328,35 +371,135 @@ void BackgroundSync::_produce(OperationContext* txn, executor::TaskExecutor* tas
 
         // At this point, we are guaranteed to have at least one thing to read out
         // of the oplogreader cursor.
-        BSONObj o = syncSourceReader.nextSafe().getOwned();
-        opsReadStats.increment();
+        _bufferOp(syncSourceReader.nextSafe().getOwned());
+    }
+}
+
+void BackgroundSync::_fetchOplog(OperationContext* txn,
+                                 executor::TaskExecutor* taskExecutor,
+                                 OplogReader& syncSourceReader,
+                                 const OpTime& lastOpTimeFetched) {
+    const HostAndPort source = syncSourceReader.getHost();
+    OplogBatchFetcher fetcher(taskExecutor,
+                              source,
+                              NamespaceString(rsOplogName),
+                              replOplogFetchCompression == GetMoreRequest::kSnappyCompression,
+                              replOplogFetchMaxEntriesPerBatch);
+
+    std::vector<BSONObj> ops;
+    int bytes = 0;
+    auto getBatch = [&] {
+        Status status = fetcher.getBatch(&ops, &bytes);
+        getmoreReplStats.recordMillis(fetcher.getElapsedMicros() / 1000);
+        getmoreLatency.record(fetcher.getElapsedMicros());
+        networkCompressedByteStats.increment(fetcher.getCompressedBytes());
+        return status;
+    };
+
+    Status status = fetcher.query(lastOpTimeFetched.getTimestamp());
+    if (status.isOK()) {
+        status = getBatch();
+    }
+    if (!status.isOK()) {
+        log() << "failed to query the oplog of " << source << ": " << status;
+        return;
+    }
+    networkByteStats.increment(bytes);
+
+    if (_rollbackIfNeeded(txn, syncSourceReader, ops.empty() ? BSONObj() : ops.front())) {
+        stop();
+        return;
+    }
 
-        if (MONGO_FAIL_POINT(stepDownWhileDrainingFailPoint)) {
-            sleepsecs(20);
+    // The first op is the last one we fetched.
+    size_t begin = 1;
+    while (!inShutdown()) {
+        // Ask for the next batch before buffering this one, so that the two overlap.
+        const bool haveCursor = fetcher.hasCursor();
+        if (haveCursor) {
+            if (bytes > 0 && bytes < BatchIsSmallish) {
+                // As with the legacy tailing query, wait a little when we are caught up, so
+                // that we don't get ops almost one at a time.
+                sleepmillis(SleepToAllowBatchingMillis);
+            }
+
+            status = fetcher.getMore();
+            if (!status.isOK()) {
+                log() << "failed to fetch oplog entries from " << source << ": " << status;
+                return;
+            }
         }
 
-        {
-            stdx::unique_lock<stdx::mutex> lock(_mutex);
-            _appliedBuffer = false;
+        for (size_t i = begin; i < ops.size(); ++i) {
+            // If we are transitioning to primary state, we need to leave
+            // this loop in order to go into bgsync-pause mode.
+            if (inShutdown() || _replCoord->isWaitingForApplierToDrain() ||
+                _replCoord->getMemberState().primary()) {
+                LOG(1) << "waiting for draining or we are primary, not adding more ops to buffer";
+                return;
+            }
+            _bufferOp(ops[i]);
         }
 
-        OCCASIONALLY {
-            LOG(2) << "bgsync buffer has " << _buffer.size() << " bytes";
+        if (!haveCursor) {
+            LOG(1) << "replSet end syncTail pass";
+            return;
         }
 
-        bufferCountGauge.increment();
-        bufferSizeGauge.increment(getSize(o));
-        _buffer.push(o);
+        status = getBatch();
+        if (!status.isOK()) {
+            log() << "failed to fetch oplog entries from " << source << ": " << status;
+            return;
+        }
+        networkByteStats.increment(bytes);
+        begin = 0;
 
-        {
+        if (_replCoord->isWaitingForApplierToDrain() || _replCoord->getMemberState().primary()) {
+            return;
+        }
+
+        // re-evaluate quality of sync target
+        if (_shouldChangeSyncSource(source)) {
+            return;
+        }
+
+        if (ops.empty()) {
             stdx::unique_lock<stdx::mutex> lock(_mutex);
-            _lastFetchedHash = o["h"].numberLong();
-            _lastOpTimeFetched = extractOpTime(o);
-            LOG(3) << "lastOpTimeFetched: " << _lastOpTimeFetched;
+            if (_pause) {
+                return;
+            }
         }
     }
 }
 
+void BackgroundSync::_bufferOp(const BSONObj& o) {
+    opsReadStats.increment();
+
+    if (MONGO_FAIL_POINT(stepDownWhileDrainingFailPoint)) {
+        sleepsecs(20);
+    }
+
+    {
+        stdx::unique_lock<stdx::mutex> lock(_mutex);
+        _appliedBuffer = false;
+    }
+
+    OCCASIONALLY {
+        LOG(2) << "bgsync buffer has " << _buffer.size() << " bytes";
+    }
+
+    bufferCountGauge.increment();
+    bufferSizeGauge.increment(getSize(o));
+    _buffer.push(o);
+
+    {
+        stdx::unique_lock<stdx::mutex> lock(_mutex);
+        _lastFetchedHash = o["h"].numberLong();
+        _lastOpTimeFetched = extractOpTime(o);
+        LOG(3) << "lastOpTimeFetched: " << _lastOpTimeFetched;
+    }
+}
+
 bool BackgroundSync::_shouldChangeSyncSource(const HostAndPort& syncSource) {
     // is it even still around?
     if (getSyncTarget().empty() || syncSource.empty()) {
@@ -388,7 +531,9 @@ void BackgroundSync::consume() {
     bufferSizeGauge.decrement(getSize(op));
 }
 
-bool BackgroundSync::_rollbackIfNeeded(OperationContext* txn, OplogReader& r) {
+bool BackgroundSync::_rollbackIfNeeded(OperationContext* txn,
+                                       OplogReader& r,
+                                       const BSONObj& firstOp) {
     string hn = r.conn()->getServerAddress();
 
     // Abort only when syncRollback detects we are in a unrecoverable state.
@@ -403,7 +548,7 @@ bool BackgroundSync::_rollbackIfNeeded(OperationContext* txn, OplogReader& r) {
         warning() << "rollback cannot proceed at this time (retrying later): " << status;
     };
 
-    if (!r.more()) {
+    if (firstOp.isEmpty()) {
         // The GTE query from upstream returns nothing, so we're ahead of the upstream.
         log() << "we are ahead of the sync source, will try to roll back";
         fassertRollbackStatusNoTrace(28656,
@@ -416,9 +561,8 @@ bool BackgroundSync::_rollbackIfNeeded(OperationContext* txn, OplogReader& r) {
         return true;
     }
 
-    BSONObj o = r.nextSafe();
-    OpTime opTime = extractOpTime(o);
-    long long hash = o["h"].numberLong();
+    OpTime opTime = extractOpTime(firstOp);
+    long long hash = firstOp["h"].numberLong();
     if (opTime != _lastOpTimeFetched || hash != _lastFetchedHash) {
         log() << "our last op time fetched: " << _lastOpTimeFetched;
         log() << "source's GTE: " << opTime;
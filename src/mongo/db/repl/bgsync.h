@@ -169,8 +169,17 @@ private:
     // Production thread
     void _producerThread(executor::TaskExecutor* taskExecutor);
     void _produce(OperationContext* txn, executor::TaskExecutor* taskExecutor);
-    // Checks the criteria for rolling back and executes a rollback if warranted.
-    bool _rollbackIfNeeded(OperationContext* txn, OplogReader& r);
+    // Tails the sync source's oplog with find and getMore commands run by 'taskExecutor',
+    // from 'lastOpTimeFetched', until the sync source should change or we should stop.
+    void _fetchOplog(OperationContext* txn,
+                     executor::TaskExecutor* taskExecutor,
+                     OplogReader& syncSourceReader,
+                     const OpTime& lastOpTimeFetched);
+    // Adds an op fetched from the sync source to the buffer.
+    void _bufferOp(const BSONObj& o);
+    // Checks the criteria for rolling back and executes a rollback if warranted. 'firstOp' is
+    // the first op the sync source has at or after our last fetched op, or empty if none.
+    bool _rollbackIfNeeded(OperationContext* txn, OplogReader& r, const BSONObj& firstOp);
 
     // Evaluate if the current sync target is still good
     bool _shouldChangeSyncSource(const HostAndPort& syncSource);
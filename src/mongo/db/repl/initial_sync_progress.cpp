@@ -0,0 +1,124 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/repl/initial_sync_progress.h"
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/concurrency/d_concurrency.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/operation_context.h"
+
+namespace mongo {
+namespace repl {
+
+namespace {
+const char* progressNS = "local.replset.initialSyncProgress";
+const char* startOpId = "startOp";
+
+BSONObj findProgressDoc(OperationContext* txn, StringData id) {
+    MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+        ScopedTransaction transaction(txn, MODE_IS);
+        Lock::DBLock dblk(txn->lockState(), "local", MODE_IS);
+        Lock::CollectionLock lk(txn->lockState(), progressNS, MODE_IS);
+
+        Database* db = dbHolder().get(txn, "local");
+        Collection* collection = db ? db->getCollection(progressNS) : NULL;
+        BSONObj doc;
+        if (collection && Helpers::findOne(txn, collection, BSON("_id" << id), doc, true)) {
+            return doc;
+        }
+        return BSONObj();
+    }
+    MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "findInitialSyncProgress", progressNS);
+}
+
+/**
+ * Callers retry write conflicts; setLastId() and setDone() are part of the unit of work that
+ * copies the data they describe.
+ */
+void putProgressDoc(OperationContext* txn, const BSONObj& doc) {
+    ScopedTransaction transaction(txn, MODE_IX);
+    Lock::DBLock dblk(txn->lockState(), "local", MODE_X);
+    Helpers::upsert(txn, progressNS, doc);
+}
+}  // namespace
+
+BSONObj InitialSyncProgress::getStartOp(OperationContext* txn) {
+    return findProgressDoc(txn, startOpId).getObjectField("op").getOwned();
+}
+
+void InitialSyncProgress::reset(OperationContext* txn, const BSONObj& startOp) {
+    MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+        ScopedTransaction transaction(txn, MODE_IX);
+        Lock::DBLock dblk(txn->lockState(), "local", MODE_X);
+        WriteUnitOfWork wunit(txn);
+        Helpers::emptyCollection(txn, progressNS);
+        Helpers::upsert(txn, progressNS, BSON("_id" << startOpId << "op" << startOp));
+        wunit.commit();
+    }
+    MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "resetInitialSyncProgress", progressNS);
+}
+
+void InitialSyncProgress::clear(OperationContext* txn) {
+    MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+        ScopedTransaction transaction(txn, MODE_IX);
+        Lock::DBLock dblk(txn->lockState(), "local", MODE_X);
+        WriteUnitOfWork wunit(txn);
+        Helpers::emptyCollection(txn, progressNS);
+        wunit.commit();
+    }
+    MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "clearInitialSyncProgress", progressNS);
+}
+
+bool InitialSyncProgress::isDone(OperationContext* txn, const NamespaceString& nss) {
+    return findProgressDoc(txn, nss.ns())["done"].trueValue();
+}
+
+BSONObj InitialSyncProgress::getLastId(OperationContext* txn, const NamespaceString& nss) {
+    return findProgressDoc(txn, nss.ns()).getObjectField("lastId").getOwned();
+}
+
+void InitialSyncProgress::setLastId(OperationContext* txn,
+                                    const NamespaceString& nss,
+                                    const BSONObj& lastId) {
+    putProgressDoc(txn, BSON("_id" << nss.ns() << "lastId" << lastId));
+}
+
+void InitialSyncProgress::setDone(OperationContext* txn, const NamespaceString& nss) {
+    putProgressDoc(txn, BSON("_id" << nss.ns() << "done" << true));
+}
+
+}  // namespace repl
+}  // namespace mongo
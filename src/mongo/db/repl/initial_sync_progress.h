@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/db/cloner.h"
+
+namespace mongo {
+namespace repl {
+
+/**
+ * Keeps the progress of initial sync in the local.replset.initialSyncProgress collection, so
+ * that a retry, after a failure or a restart, can carry on where the failed attempt left off
+ * rather than copying every collection again.
+ *
+ * The collection holds the oplog entry the sync started from, which is where oplog application
+ * starts once the clone is done, and a document per collection that has been cloned, or
+ * partly cloned, since then:
+ *
+ *     {_id: "startOp", op: <oplog entry>}
+ *     {_id: "<ns>", lastId: {_id: <last _id copied>}}
+ *     {_id: "<ns>", done: true}
+ *
+ * The progress is only meaningful while the initial sync flag (see minvalid.h) is set.
+ */
+class InitialSyncProgress : public CloneProgress {
+public:
+    /**
+     * Returns the oplog entry the initial sync whose progress is recorded started from, or an
+     * empty object if there is none.
+     */
+    static BSONObj getStartOp(OperationContext* txn);
+
+    /**
+     * Forgets all progress, and records that initial sync starts from 'startOp'.
+     */
+    static void reset(OperationContext* txn, const BSONObj& startOp);
+
+    /**
+     * Forgets all progress. Called once initial sync is complete.
+     */
+    static void clear(OperationContext* txn);
+
+    bool isDone(OperationContext* txn, const NamespaceString& nss) override;
+    BSONObj getLastId(OperationContext* txn, const NamespaceString& nss) override;
+    void setLastId(OperationContext* txn,
+                   const NamespaceString& nss,
+                   const BSONObj& lastId) override;
+    void setDone(OperationContext* txn, const NamespaceString& nss) override;
+};
+
+}  // namespace repl
+}  // namespace mongo
@@ -0,0 +1,249 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kReplication
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/repl/oplog_batch_fetcher.h"
+
+#include <snappy.h>
+#include <string>
+
+#include "mongo/bson/bson_validate.h"
+#include "mongo/db/query/getmore_request.h"
+#include "mongo/rpc/get_status_from_command_result.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+namespace repl {
+
+namespace {
+
+// Time limits for the find and awaitData getMore commands that tail the sync source's oplog,
+// and how much longer than that to wait for their responses.
+const int kOplogFindMaxTimeMS = 60 * 1000;
+const int kOplogGetMoreMaxTimeMS = 5 * 1000;
+const Milliseconds kOplogFetchNetworkTimeout(30 * 1000);
+
+}  // namespace
+
+OplogBatchFetcher::OplogBatchFetcher(executor::TaskExecutor* executor,
+                                     const HostAndPort& source,
+                                     const NamespaceString& nss,
+                                     bool compress,
+                                     int maxEntriesPerBatch)
+    : _executor(executor),
+      _source(source),
+      _nss(nss),
+      _maxEntriesPerBatch(maxEntriesPerBatch),
+      _compress(compress),
+      _cursorId(0),
+      _first(true),
+      _responseStatus(Status::OK()),
+      _elapsedMicros(0),
+      _compressedBytes(0) {}
+
+OplogBatchFetcher::~OplogBatchFetcher() {
+    DESTRUCTOR_GUARD(_cancel(););
+}
+
+Status OplogBatchFetcher::query(const Timestamp& start) {
+    BSONObjBuilder cmd;
+    cmd.append("find", _nss.coll());
+    cmd.append("filter", BSON("ts" << BSON("$gte" << start)));
+    cmd.append("tailable", true);
+    cmd.append("oplogReplay", true);
+    cmd.append("awaitData", true);
+    cmd.append("maxTimeMS", kOplogFindMaxTimeMS);
+    if (_maxEntriesPerBatch > 0) {
+        cmd.append("batchSize", _maxEntriesPerBatch);
+    }
+
+    _first = true;
+    return _schedule(cmd.obj(), Milliseconds(kOplogFindMaxTimeMS));
+}
+
+Status OplogBatchFetcher::getMore() {
+    invariant(_cursorId);
+    GetMoreRequest request(_nss,
+                           _cursorId,
+                           _maxEntriesPerBatch > 0
+                               ? boost::optional<long long>(_maxEntriesPerBatch)
+                               : boost::none,
+                           boost::none,
+                           _compress ? boost::optional<std::string>(
+                                           GetMoreRequest::kSnappyCompression)
+                                     : boost::none);
+    BSONObjBuilder cmd;
+    cmd.appendElements(request.toBSON());
+    cmd.append("maxTimeMS", kOplogGetMoreMaxTimeMS);
+
+    _first = false;
+    return _schedule(cmd.obj(), Milliseconds(kOplogGetMoreMaxTimeMS));
+}
+
+Status OplogBatchFetcher::getBatch(std::vector<BSONObj>* ops, int* bytes) {
+    invariant(_handle.isValid());
+    _executor->wait(_handle);
+    _handle = executor::TaskExecutor::CallbackHandle();
+    _compressedBytes = 0;
+
+    if (!_responseStatus.isOK()) {
+        return _responseStatus;
+    }
+
+    Status status = getStatusFromCommandResult(_response);
+    if (status == ErrorCodes::FailedToParse && _compress && !_first) {
+        // Compression is negotiated by asking for it; a sync source which doesn't know
+        // how rejects the getMore, without touching the cursor.
+        log() << "sync source " << _source << " can't compress oplog entries (" << status
+              << "), fetching them uncompressed";
+        _compress = false;
+        status = getMore();
+        if (!status.isOK()) {
+            return status;
+        }
+        return getBatch(ops, bytes);
+    }
+    if (!status.isOK()) {
+        return status;
+    }
+
+    return _parseBatch(ops, bytes);
+}
+
+Status OplogBatchFetcher::_schedule(const BSONObj& cmdObj, Milliseconds maxTime) {
+    _timer.reset();
+    StatusWith<executor::TaskExecutor::CallbackHandle> handle = _executor->scheduleRemoteCommand(
+        RemoteCommandRequest(_source,
+                             _nss.db().toString(),
+                             cmdObj,
+                             BSON("$secondaryOk" << 1),
+                             maxTime + kOplogFetchNetworkTimeout),
+        stdx::bind(&OplogBatchFetcher::_callback, this, stdx::placeholders::_1));
+    if (!handle.isOK()) {
+        return handle.getStatus();
+    }
+    _handle = handle.getValue();
+    return Status::OK();
+}
+
+void OplogBatchFetcher::_callback(const executor::TaskExecutor::RemoteCommandCallbackArgs& args) {
+    _elapsedMicros = _timer.micros();
+    if (args.response.isOK()) {
+        _responseStatus = Status::OK();
+        _response = args.response.getValue().data;
+    } else {
+        _responseStatus = args.response.getStatus();
+        _response = BSONObj();
+    }
+}
+
+Status OplogBatchFetcher::_parseBatch(std::vector<BSONObj>* ops, int* bytes) {
+    ops->clear();
+    *bytes = 0;
+
+    BSONElement cursorElement = _response["cursor"];
+    if (cursorElement.type() != Object) {
+        return Status(ErrorCodes::FailedToParse,
+                      str::stream() << "oplog query response has no cursor: " << _response);
+    }
+    BSONObj cursorObj = cursorElement.Obj();
+
+    BSONElement cursorIdElement = cursorObj["id"];
+    if (cursorIdElement.type() != NumberLong) {
+        return Status(ErrorCodes::FailedToParse,
+                      str::stream() << "oplog query response has no cursor id: " << _response);
+    }
+    _cursorId = cursorIdElement.numberLong();
+
+    std::string uncompressed;
+    BSONObj batch;
+    BSONElement compressedElement = cursorObj["nextBatchSnappy"];
+    if (!_first && compressedElement.type() == BinData) {
+        int length;
+        const char* data = compressedElement.binData(length);
+        if (!snappy::Uncompress(data, length, &uncompressed)) {
+            return Status(ErrorCodes::FailedToParse,
+                          "failed to uncompress oplog entries from the sync source");
+        }
+        Status status = validateBSON(uncompressed.data(), uncompressed.size());
+        if (!status.isOK()) {
+            return status;
+        }
+        batch = BSONObj(uncompressed.data());
+        _compressedBytes = length;
+    } else {
+        BSONElement batchElement = cursorObj[_first ? "firstBatch" : "nextBatch"];
+        if (batchElement.type() != Array) {
+            return Status(ErrorCodes::FailedToParse,
+                          str::stream() << "oplog query response has no batch: " << _response);
+        }
+        batch = batchElement.Obj();
+    }
+
+    for (BSONElement op : batch) {
+        if (op.type() != Object) {
+            return Status(ErrorCodes::FailedToParse,
+                          str::stream() << "found non-object " << op << " in oplog batch");
+        }
+        ops->push_back(op.Obj().getOwned());
+    }
+    *bytes = batch.objsize();
+    return Status::OK();
+}
+
+void OplogBatchFetcher::_cancel() {
+    if (_handle.isValid()) {
+        _executor->cancel(_handle);
+        _executor->wait(_handle);
+        _handle = executor::TaskExecutor::CallbackHandle();
+    }
+
+    if (_cursorId) {
+        // Like the Fetcher, don't wait for the cursor to be killed, nor retry; an abandoned
+        // cursor times out on the sync source.
+        _executor->scheduleRemoteCommand(
+            RemoteCommandRequest(_source,
+                                 _nss.db().toString(),
+                                 BSON("killCursors" << _nss.coll() << "cursors"
+                                                    << BSON_ARRAY(_cursorId))),
+            [](const executor::TaskExecutor::RemoteCommandCallbackArgs& args) {
+                if (!args.response.isOK()) {
+                    LOG(1) << "killCursors command failed: " << args.response.getStatus();
+                }
+            });
+        _cursorId = 0;
+    }
+}
+
+}  // namespace repl
+}  // namespace mongo
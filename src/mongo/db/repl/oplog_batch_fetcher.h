@@ -0,0 +1,145 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/bson/timestamp.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/executor/task_executor.h"
+#include "mongo/util/net/hostandport.h"
+#include "mongo/util/time_support.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+namespace repl {
+
+/**
+ * Tails the oplog of a sync source with the find and getMore commands, run by a task executor
+ * rather than on a connection of its own. There is at most one request outstanding: getMore()
+ * asks for the next batch and getBatch() waits for it, so that a batch can be buffered while the
+ * next one is on its way.
+ */
+class OplogBatchFetcher {
+    MONGO_DISALLOW_COPYING(OplogBatchFetcher);
+
+public:
+    /**
+     * Tails the oplog 'nss' on 'source', asking for at most 'maxEntriesPerBatch' entries at a
+     * time, or as many as fit in its getMore size limit if 0. If 'compress' is true, asks for
+     * snappy compressed batches until the source turns that down.
+     */
+    OplogBatchFetcher(executor::TaskExecutor* executor,
+                      const HostAndPort& source,
+                      const NamespaceString& nss,
+                      bool compress,
+                      int maxEntriesPerBatch);
+
+    ~OplogBatchFetcher();
+
+    /**
+     * Sends the query for the oplog entries from 'start' on.
+     */
+    Status query(const Timestamp& start);
+
+    /**
+     * Asks for the next batch. Requires a cursor.
+     */
+    Status getMore();
+
+    /**
+     * Waits for the response to the outstanding request, and replaces the contents of 'ops'
+     * with the oplog entries in it. Sets 'bytes' to their total size.
+     */
+    Status getBatch(std::vector<BSONObj>* ops, int* bytes);
+
+    /**
+     * Returns true if the sync source has kept the cursor open for more.
+     */
+    bool hasCursor() const {
+        return _cursorId != 0;
+    }
+
+    /**
+     * Returns whether batches are still asked for compressed.
+     */
+    bool isCompressing() const {
+        return _compress;
+    }
+
+    /**
+     * Returns the round trip time of the last response getBatch() waited for.
+     */
+    long long getElapsedMicros() const {
+        return _elapsedMicros;
+    }
+
+    /**
+     * Returns the compressed size of the last batch getBatch() returned, or 0 if it wasn't.
+     */
+    int getCompressedBytes() const {
+        return _compressedBytes;
+    }
+
+private:
+    Status _schedule(const BSONObj& cmdObj, Milliseconds maxTime);
+
+    // Runs on the executor; only stashes the response for getBatch().
+    void _callback(const executor::TaskExecutor::RemoteCommandCallbackArgs& args);
+
+    Status _parseBatch(std::vector<BSONObj>* ops, int* bytes);
+
+    void _cancel();
+
+    executor::TaskExecutor* const _executor;
+    const HostAndPort _source;
+    const NamespaceString _nss;
+    const int _maxEntriesPerBatch;
+    bool _compress;
+
+    long long _cursorId;
+    // Whether the outstanding or last request was the find.
+    bool _first;
+
+    executor::TaskExecutor::CallbackHandle _handle;
+    Timer _timer;
+
+    // Set by _callback.
+    Status _responseStatus;
+    BSONObj _response;
+    long long _elapsedMicros;
+
+    int _compressedBytes;
+};
+
+}  // namespace repl
+}  // namespace mongo
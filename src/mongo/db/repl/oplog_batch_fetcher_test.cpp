@@ -0,0 +1,235 @@
+/**
+ *    Copyright 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <snappy.h>
+#include <string>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/repl/oplog_batch_fetcher.h"
+#include "mongo/db/repl/replication_executor.h"
+#include "mongo/db/repl/replication_executor_test_fixture.h"
+#include "mongo/executor/network_interface_mock.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+using namespace mongo;
+using namespace mongo::repl;
+using executor::NetworkInterfaceMock;
+
+class OplogBatchFetcherTest : public ReplicationExecutorTest {
+protected:
+    void setUp() override;
+    void tearDown() override;
+
+    /**
+     * Answers the next request sent to the sync source with 'obj', and returns the command.
+     */
+    BSONObj respond(const BSONObj& obj);
+
+    /**
+     * Runs getBatch() on another thread, so that this one can answer any requests it sends.
+     */
+    void startGetBatch();
+    Status finishGetBatch();
+
+    /**
+     * Sends the query and hands out a batch with the entries in 'firstBatch', leaving the
+     * cursor open.
+     */
+    void query(const BSONArray& firstBatch);
+
+    std::unique_ptr<OplogBatchFetcher> fetcher;
+    std::vector<BSONObj> ops;
+    int bytes = 0;
+
+private:
+    stdx::thread _getBatchThread;
+    Status _getBatchStatus = getDetectableErrorStatus();
+};
+
+const long long kCursorId = 123;
+
+BSONObj makeCursorResponse(const char* batchName, const BSONArray& batch) {
+    return BSON("cursor" << BSON("id" << kCursorId << "ns"
+                                      << "local.oplog.rs" << batchName << batch) << "ok" << 1);
+}
+
+BSONObj makeCompressedResponse(const char* data, size_t length) {
+    std::string compressed;
+    snappy::Compress(data, length, &compressed);
+
+    BSONObjBuilder cursor;
+    cursor.append("id", kCursorId);
+    cursor.append("ns", "local.oplog.rs");
+    cursor.appendBinData("nextBatchSnappy", compressed.size(), BinDataGeneral, compressed.data());
+    return BSON("cursor" << cursor.obj() << "ok" << 1);
+}
+
+void OplogBatchFetcherTest::setUp() {
+    ReplicationExecutorTest::setUp();
+    fetcher.reset(new OplogBatchFetcher(&getReplExecutor(),
+                                        HostAndPort("h1"),
+                                        NamespaceString("local.oplog.rs"),
+                                        true,
+                                        0));
+    launchExecutorThread();
+}
+
+void OplogBatchFetcherTest::tearDown() {
+    // The fetcher's killCursors goes unanswered when the executor shuts down.
+    fetcher.reset();
+    ReplicationExecutorTest::tearDown();
+}
+
+BSONObj OplogBatchFetcherTest::respond(const BSONObj& obj) {
+    NetworkInterfaceMock* net = getNet();
+    NetworkInterfaceMock::NetworkOperationIterator noi = net->getNextReadyRequest();
+    const BSONObj cmdObj = noi->getRequest().cmdObj.getOwned();
+    net->scheduleResponse(noi, net->now(), RemoteCommandResponse(obj, BSONObj(), Milliseconds(0)));
+    net->runReadyNetworkOperations();
+    return cmdObj;
+}
+
+void OplogBatchFetcherTest::startGetBatch() {
+    _getBatchThread = stdx::thread([this] { _getBatchStatus = fetcher->getBatch(&ops, &bytes); });
+}
+
+Status OplogBatchFetcherTest::finishGetBatch() {
+    _getBatchThread.join();
+    return _getBatchStatus;
+}
+
+void OplogBatchFetcherTest::query(const BSONArray& firstBatch) {
+    ASSERT_OK(fetcher->query(Timestamp(1, 0)));
+    respond(makeCursorResponse("firstBatch", firstBatch));
+    startGetBatch();
+    ASSERT_OK(finishGetBatch());
+    ASSERT_TRUE(fetcher->hasCursor());
+}
+
+TEST_F(OplogBatchFetcherTest, QueryReturnsFirstBatch) {
+    ASSERT_OK(fetcher->query(Timestamp(1, 0)));
+    const BSONObj cmdObj =
+        respond(makeCursorResponse("firstBatch", BSON_ARRAY(BSON("ts" << Timestamp(1, 0)))));
+    ASSERT_EQUALS("oplog.rs", cmdObj["find"].str());
+    ASSERT_FALSE(cmdObj.hasField("batchSize"));
+
+    startGetBatch();
+    ASSERT_OK(finishGetBatch());
+    ASSERT_EQUALS(1U, ops.size());
+    ASSERT_EQUALS(Timestamp(1, 0), ops[0]["ts"].timestamp());
+    ASSERT_TRUE(fetcher->hasCursor());
+    ASSERT_EQUALS(0, fetcher->getCompressedBytes());
+}
+
+TEST_F(OplogBatchFetcherTest, GetMoreUncompressesBatch) {
+    query(BSONArray());
+
+    BSONArray batch = BSON_ARRAY(BSON("ts" << Timestamp(2, 0)) << BSON("ts" << Timestamp(3, 0)));
+    ASSERT_OK(fetcher->getMore());
+    const BSONObj cmdObj = respond(makeCompressedResponse(batch.objdata(), batch.objsize()));
+    ASSERT_EQUALS("snappy", cmdObj["compression"].str());
+
+    startGetBatch();
+    ASSERT_OK(finishGetBatch());
+    ASSERT_EQUALS(2U, ops.size());
+    ASSERT_EQUALS(Timestamp(3, 0), ops[1]["ts"].timestamp());
+    ASSERT_EQUALS(batch.objsize(), bytes);
+    ASSERT_GREATER_THAN(fetcher->getCompressedBytes(), 0);
+}
+
+TEST_F(OplogBatchFetcherTest, SourceWhichCannotCompressIsAskedAgainUncompressed) {
+    query(BSONArray());
+
+    ASSERT_OK(fetcher->getMore());
+    respond(BSON("ok" << 0 << "errmsg"
+                      << "unrecognized field 'compression'"
+                      << "code" << ErrorCodes::FailedToParse));
+
+    // The getMore is sent again without asking for compression while getBatch() waits.
+    startGetBatch();
+    const BSONObj cmdObj =
+        respond(makeCursorResponse("nextBatch", BSON_ARRAY(BSON("ts" << Timestamp(2, 0)))));
+    ASSERT_OK(finishGetBatch());
+    ASSERT_EQUALS(kCursorId, cmdObj["getMore"].numberLong());
+    ASSERT_FALSE(cmdObj.hasField("compression"));
+    ASSERT_EQUALS(1U, ops.size());
+    ASSERT_FALSE(fetcher->isCompressing());
+    ASSERT_EQUALS(0, fetcher->getCompressedBytes());
+
+    // And so are the ones after it.
+    ASSERT_OK(fetcher->getMore());
+    ASSERT_FALSE(respond(makeCursorResponse("nextBatch", BSONArray())).hasField("compression"));
+    startGetBatch();
+    ASSERT_OK(finishGetBatch());
+}
+
+TEST_F(OplogBatchFetcherTest, FindFailedToParseIsNotRetried) {
+    ASSERT_OK(fetcher->query(Timestamp(1, 0)));
+    respond(BSON("ok" << 0 << "errmsg"
+                      << "bad find"
+                      << "code" << ErrorCodes::FailedToParse));
+
+    startGetBatch();
+    ASSERT_EQUALS(ErrorCodes::FailedToParse, finishGetBatch());
+    ASSERT_TRUE(fetcher->isCompressing());
+}
+
+TEST_F(OplogBatchFetcherTest, BatchWhichFailsToUncompressIsRejected) {
+    query(BSONArray());
+
+    BSONObjBuilder cursor;
+    cursor.append("id", kCursorId);
+    cursor.append("ns", "local.oplog.rs");
+    cursor.appendBinData("nextBatchSnappy", 7, BinDataGeneral, "garbage");
+    ASSERT_OK(fetcher->getMore());
+    respond(BSON("cursor" << cursor.obj() << "ok" << 1));
+
+    startGetBatch();
+    ASSERT_EQUALS(ErrorCodes::FailedToParse, finishGetBatch());
+}
+
+TEST_F(OplogBatchFetcherTest, UncompressedBatchWhichIsNotBSONIsRejected) {
+    query(BSONArray());
+
+    // Valid snappy, but the size prefix claims more than was compressed.
+    const char notBSON[] = "\x40\x00\x00\x00\x03garbage";
+    ASSERT_OK(fetcher->getMore());
+    respond(makeCompressedResponse(notBSON, sizeof(notBSON)));
+
+    startGetBatch();
+    ASSERT_NOT_OK(finishGetBatch());
+    ASSERT_TRUE(ops.empty());
+}
+
+}  // namespace
@@ -35,7 +35,9 @@
 #include <algorithm>
 #include <limits>
 
+#include "mongo/base/counter.h"
 #include "mongo/base/status.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/global_timestamp.h"
 #include "mongo/db/index/index_descriptor.h"
@@ -65,6 +67,7 @@
 #include "mongo/db/repl/update_position_args.h"
 #include "mongo/db/repl/vote_requester.h"
 #include "mongo/db/server_options.h"
+#include "mongo/db/stats/latency_histogram_metric.h"
 #include "mongo/db/write_concern_options.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/util/assert_util.h"
@@ -139,7 +142,36 @@ struct ReplicationCoordinatorImpl::WaiterInfo {
     stdx::condition_variable* condVar;
 };
 
+struct ReplicationCoordinatorImpl::OpTimeWaiter {
+    /**
+     * Constructor registers the waiter under 'opTime' in 'map', and the destructor removes it.
+     */
+    OpTimeWaiter(OpTimeWaiterMap* _map,
+                 unsigned int _opID,
+                 const OpTime& opTime,
+                 stdx::condition_variable* _condVar)
+        : map(_map), opID(_opID), condVar(_condVar), position(map->emplace(opTime, this)) {}
+
+    ~OpTimeWaiter() {
+        map->erase(position);
+    }
+
+    OpTimeWaiterMap* const map;
+    const unsigned int opID;
+    stdx::condition_variable* const condVar;
+    const OpTimeWaiterMap::iterator position;
+};
+
 namespace {
+
+// Reads after an opTime which this node had already reached
+Counter64 readAfterOpTimeImmediateStats;
+ServerStatusMetricField<Counter64> displayReadAfterOpTimeImmediate(
+    "repl.readAfterOpTime.immediate", &readAfterOpTimeImmediateStats);
+
+// How long reads after an opTime which this node had yet to reach waited for it
+LatencyHistogramMetric readAfterOpTimeWaits("repl.readAfterOpTime.waits");
+
 ReplicationCoordinator::Mode getReplicationModeFromSettings(const ReplSettings& settings) {
     if (settings.usingReplSets()) {
         return ReplicationCoordinator::modeReplSet;
@@ -414,6 +446,9 @@ void ReplicationCoordinatorImpl::shutdown() {
             WaiterInfo* waiter = *it;
             waiter->condVar->notify_all();
         }
+        for (auto& opTimeWaiter : _opTimeWaiters) {
+            opTimeWaiter.second->condVar->notify_all();
+        }
     }
 
     // joining the replication executor is blocking so it must be run outside of the mutex
@@ -741,10 +776,9 @@ void ReplicationCoordinatorImpl::_setMyLastOptime_inlock(stdx::unique_lock<stdx:
         return;
     }
 
-    for (auto& opTimeWaiter : _opTimeWaiterList) {
-        if (*(opTimeWaiter->opTime) <= opTime) {
-            opTimeWaiter->condVar->notify_all();
-        }
+    for (auto it = _opTimeWaiters.begin(); it != _opTimeWaiters.end() && it->first <= opTime;
+         ++it) {
+        it->second->condVar->notify_all();
     }
 
     if (_getMemberState_inlock().primary()) {
@@ -787,6 +821,15 @@ ReadAfterOpTimeResponse ReplicationCoordinatorImpl::waitUntilOpTime(
     Timer timer;
     stdx::unique_lock<stdx::mutex> lock(_mutex);
 
+    if (ts <= _getMyLastOptime_inlock()) {
+        readAfterOpTimeImmediateStats.increment();
+        return ReadAfterOpTimeResponse(Status::OK(), Milliseconds(timer.millis()));
+    }
+
+    // Only woken when our last optime reaches 'ts', or to be interrupted.
+    stdx::condition_variable condVar;
+    OpTimeWaiter waiter(&_opTimeWaiters, txn->getOpID(), ts, &condVar);
+
     while (ts > _getMyLastOptime_inlock()) {
         Status interruptedStatus = txn->checkForInterruptNoAssert();
         if (!interruptedStatus.isOK()) {
@@ -798,13 +841,6 @@ ReadAfterOpTimeResponse ReplicationCoordinatorImpl::waitUntilOpTime(
                                            Milliseconds(timer.millis()));
         }
 
-        stdx::condition_variable condVar;
-        WaiterInfo waitInfo(&_opTimeWaiterList,
-                            txn->getOpID(),
-                            &ts,
-                            nullptr,  // Don't care about write concern.
-                            &condVar);
-
         if (CurOp::get(txn)->isMaxTimeSet()) {
             condVar.wait_for(lock, Microseconds(txn->getRemainingMaxTimeMicros()));
         } else {
@@ -812,7 +848,9 @@ ReadAfterOpTimeResponse ReplicationCoordinatorImpl::waitUntilOpTime(
         }
     }
 
-    return ReadAfterOpTimeResponse(Status::OK(), Milliseconds(timer.millis()));
+    const long long waitMicros = timer.micros();
+    readAfterOpTimeWaits.record(waitMicros);
+    return ReadAfterOpTimeResponse(Status::OK(), Milliseconds(waitMicros / 1000));
 }
 
 OpTime ReplicationCoordinatorImpl::_getMyLastOptime_inlock() const {
@@ -903,9 +941,9 @@ void ReplicationCoordinatorImpl::interrupt(unsigned opId) {
         }
     }
 
-    for (auto& opTimeWaiter : _opTimeWaiterList) {
-        if (opTimeWaiter->opID == opId) {
-            opTimeWaiter->condVar->notify_all();
+    for (auto& opTimeWaiter : _opTimeWaiters) {
+        if (opTimeWaiter.second->opID == opId) {
+            opTimeWaiter.second->condVar->notify_all();
             return;
         }
     }
@@ -925,8 +963,8 @@ void ReplicationCoordinatorImpl::interruptAll() {
         info->condVar->notify_all();
     }
 
-    for (auto& opTimeWaiter : _opTimeWaiterList) {
-        opTimeWaiter->condVar->notify_all();
+    for (auto& opTimeWaiter : _opTimeWaiters) {
+        opTimeWaiter.second->condVar->notify_all();
     }
 
     _replExecutor.scheduleWork(
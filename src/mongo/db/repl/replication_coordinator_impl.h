@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <map>
 #include <vector>
 #include <memory>
 
@@ -341,6 +342,10 @@ private:
     // Struct that holds information about clients waiting for replication.
     struct WaiterInfo;
 
+    // Struct that holds information about a client waiting for this node to reach an opTime.
+    struct OpTimeWaiter;
+    using OpTimeWaiterMap = std::multimap<OpTime, OpTimeWaiter*>;
+
     // Struct that holds information about nodes in this replication group, mainly used for
     // tracking replication progress for write concern satisfaction.
     struct SlaveInfo {
@@ -971,9 +976,9 @@ private:
     // WaiterInfos.
     std::vector<WaiterInfo*> _replicationWaiterList;  // (M)
 
-    // list of information about clients waiting for a particular opTime.
-    // Does *not* own the WaiterInfos.
-    std::vector<WaiterInfo*> _opTimeWaiterList;  // (M)
+    // clients waiting for a particular opTime, ordered by that opTime, so that advancing our
+    // last optime only has to look at the ones it releases.  Does *not* own the OpTimeWaiters.
+    OpTimeWaiterMap _opTimeWaiters;  // (M)
 
     // Set to true when we are in the process of shutting down replication.
     bool _inShutdown;  // (M)
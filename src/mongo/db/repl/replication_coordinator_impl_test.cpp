@@ -2201,6 +2201,36 @@ TEST_F(ReplCoordTest, ReadAfterDeferredEqualOpTime) {
     ASSERT_OK(result.getStatus());
 }
 
+TEST_F(ReplCoordTest, ReadAfterDeferredOpTimesReleasedInOrder) {
+    assertStartSuccess(BSON("_id"
+                            << "mySet"
+                            << "version" << 2 << "members" << BSON_ARRAY(BSON("host"
+                                                                              << "node1:12345"
+                                                                              << "_id" << 0))),
+                       HostAndPort("node1", 12345));
+
+    getReplCoord()->setMyLastOptime(OpTimeWithTermZero(0, 0));
+
+    auto waitUntil = [this](const OpTime& opTime) {
+        OperationContextNoop txn;
+        return getReplCoord()->waitUntilOpTime(&txn, ReadAfterOpTimeArgs(opTime));
+    };
+    auto earlierRead = stdx::async(stdx::launch::async, waitUntil, OpTimeWithTermZero(100, 0));
+    auto laterRead = stdx::async(stdx::launch::async, waitUntil, OpTimeWithTermZero(300, 0));
+
+    getReplCoord()->setMyLastOptime(OpTimeWithTermZero(200, 0));
+    auto result = earlierRead.get();
+    ASSERT_TRUE(result.didWait());
+    ASSERT_OK(result.getStatus());
+    ASSERT_TRUE(laterRead.wait_for(Milliseconds(50)) ==
+                stdx::future_status::timeout);
+
+    getReplCoord()->setMyLastOptime(OpTimeWithTermZero(300, 0));
+    result = laterRead.get();
+    ASSERT_TRUE(result.didWait());
+    ASSERT_OK(result.getStatus());
+}
+
 TEST_F(ReplCoordTest, MetadataWrongConfigVersion) {
     // Ensure that we do not process ReplicationMetadata when ConfigVersions do not match.
     assertStartSuccess(BSON("_id"
@@ -32,6 +32,9 @@
 
 #include "mongo/db/repl/roll_back_local_operations.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
@@ -57,6 +60,20 @@ long long getHash(const OplogInterface::Iterator::Value& oplogValue) {
     return getHash(oplogValue.first);
 }
 
+Status checkRollbackPeriod(const Timestamp& ourTime, const Timestamp& theirTime) {
+    long long diff = static_cast<long long>(ourTime.getSecs()) - theirTime.getSecs();
+    // diff could be positive, negative, or zero
+    log() << "rollback our last optime:   " << ourTime.toStringPretty();
+    log() << "rollback their last optime: " << theirTime.toStringPretty();
+    log() << "rollback diff in end of log times: " << diff << " seconds";
+    if (diff > 1800) {
+        severe() << "rollback too long a time period for a rollback.";
+        return Status(ErrorCodes::ExceededTimeLimit,
+                      "rollback error: not willing to roll back more than 30 minutes of data");
+    }
+    return Status::OK();
+}
+
 }  // namespace
 
 RollBackLocalOperations::RollBackLocalOperations(const OplogInterface& localOplog,
@@ -79,17 +96,9 @@ StatusWith<RollBackLocalOperations::RollbackCommonPoint> RollBackLocalOperations
         }
         _localOplogValue = result.getValue();
 
-        long long diff = static_cast<long long>(getTimestamp(_localOplogValue).getSecs()) -
-            getTimestamp(operation).getSecs();
-        // diff could be positive, negative, or zero
-        log() << "rollback our last optime:   " << getTimestamp(_localOplogValue).toStringPretty();
-        log() << "rollback their last optime: " << getTimestamp(operation).toStringPretty();
-        log() << "rollback diff in end of log times: " << diff << " seconds";
-        if (diff > 1800) {
-            severe() << "rollback too long a time period for a rollback.";
-            return StatusWith<RollbackCommonPoint>(
-                ErrorCodes::ExceededTimeLimit,
-                "rollback error: not willing to roll back more than 30 minutes of data");
+        auto status = checkRollbackPeriod(getTimestamp(_localOplogValue), getTimestamp(operation));
+        if (!status.isOK()) {
+            return status;
         }
     }
 
@@ -149,36 +158,128 @@ StatusWith<RollBackLocalOperations::RollbackCommonPoint> RollBackLocalOperations
     return RollbackCommonPoint(Timestamp(Seconds(1), 0), RecordId());
 }
 
-StatusWith<RollBackLocalOperations::RollbackCommonPoint> syncRollBackLocalOperations(
+StatusWith<RollBackLocalOperations::RollbackCommonPoint> searchRollBackLocalOperations(
     const OplogInterface& localOplog,
-    const OplogInterface& remoteOplog,
+    const BSONObj& remoteFirstOperation,
+    const BSONObj& remoteLastOperation,
+    const RollBackLocalOperations::FindRemoteOperationFn& findRemoteOperation,
     const RollBackLocalOperations::RollbackOperationFn& rollbackOperation) {
-    auto remoteIterator = remoteOplog.makeIterator();
-    auto remoteResult = remoteIterator->next();
-    if (!remoteResult.isOK()) {
-        return StatusWith<RollBackLocalOperations::RollbackCommonPoint>(
-            ErrorCodes::InvalidSyncSource, "remote oplog empty or unreadable");
+    using RollbackCommonPoint = RollBackLocalOperations::RollbackCommonPoint;
+    uassert(ErrorCodes::BadValue, "null find remote operation function", findRemoteOperation);
+    uassert(ErrorCodes::BadValue, "null roll back operation function", rollbackOperation);
+
+    if (remoteFirstOperation.isEmpty() || remoteLastOperation.isEmpty()) {
+        return StatusWith<RollbackCommonPoint>(ErrorCodes::InvalidSyncSource,
+                                               "remote oplog empty or unreadable");
+    }
+
+    auto localIterator = localOplog.makeIterator();
+    uassert(ErrorCodes::BadValue, "invalid local oplog iterator", localIterator);
+    auto localResult = localIterator->next();
+    if (!localResult.isOK()) {
+        return StatusWith<RollbackCommonPoint>(ErrorCodes::OplogStartMissing,
+                                               "no oplog during initsync");
+    }
+
+    auto status = checkRollbackPeriod(getTimestamp(localResult.getValue()),
+                                      getTimestamp(remoteLastOperation));
+    if (!status.isOK()) {
+        return status;
+    }
+
+    // The timestamps and hashes of the local operations read so far, newest first. Since both
+    // oplogs start out the same, the operations the remote oplog also has are a suffix of these,
+    // up to those older than the remote oplog goes back.
+    std::vector<std::pair<Timestamp, long long>> local;
+    local.emplace_back(getTimestamp(localResult.getValue()), getHash(localResult.getValue()));
+
+    const Timestamp remoteFirstTime = getTimestamp(remoteFirstOperation);
+    unsigned long long lookups = 0;
+    auto isCommon = [&](long long i) {
+        if (local[i].first < remoteFirstTime) {
+            // Can't tell; stop the search here, and fail below if this is where it ends up.
+            return true;
+        }
+        lookups++;
+        BSONObj remoteOperation = findRemoteOperation(local[i].first);
+        return !remoteOperation.isEmpty() && getHash(remoteOperation) == local[i].second;
+    };
+
+    // Look further and further back, doubling the distance each time, until we find a common
+    // operation. The newest common operation is then after 'notCommon' and no later than
+    // 'common'.
+    long long notCommon = -1;
+    long long common = 0;
+    long long distance = 1;
+    while (!isCommon(common)) {
+        notCommon = common;
+        const long long next = common + distance;
+        distance *= 2;
+        while (static_cast<long long>(local.size()) <= next) {
+            localResult = localIterator->next();
+            if (!localResult.isOK()) {
+                break;
+            }
+            local.emplace_back(getTimestamp(localResult.getValue()),
+                               getHash(localResult.getValue()));
+        }
+
+        common = std::min(next, static_cast<long long>(local.size()) - 1);
+        if (common == notCommon) {
+            severe() << "rollback error RS101 reached beginning of local oplog";
+            log() << "    scanned: " << local.size();
+            log() << "  theirTime: " << getTimestamp(remoteLastOperation).toStringLong();
+            log() << "  ourTime:   " << local.back().first.toStringLong();
+            return StatusWith<RollbackCommonPoint>(ErrorCodes::NoMatchingDocument,
+                                                   "RS101 reached beginning of local oplog [3]");
+        }
     }
 
-    RollBackLocalOperations finder(localOplog, rollbackOperation);
-    Timestamp theirTime;
-    while (remoteResult.isOK()) {
-        theirTime = remoteResult.getValue().first["ts"].timestamp();
-        BSONObj theirObj = remoteResult.getValue().first;
-        auto result = finder.onRemoteOperation(theirObj);
-        if (result.isOK()) {
-            return result.getValue();
-        } else if (result.getStatus().code() != ErrorCodes::NoSuchKey) {
-            return result;
+    while (common - notCommon > 1) {
+        const long long middle = notCommon + (common - notCommon) / 2;
+        if (isCommon(middle)) {
+            common = middle;
+        } else {
+            notCommon = middle;
         }
-        remoteResult = remoteIterator->next();
     }
 
-    severe() << "rollback error RS100 reached beginning of remote oplog";
-    log() << "  them:      " << remoteOplog.toString();
-    log() << "  theirTime: " << theirTime.toStringLong();
-    return StatusWith<RollBackLocalOperations::RollbackCommonPoint>(
-        ErrorCodes::NoMatchingDocument, "RS100 reached beginning of remote oplog [1]");
+    const Timestamp commonTime = local[common].first;
+    const long long commonHash = local[common].second;
+    if (commonTime < remoteFirstTime) {
+        severe() << "rollback error RS100 reached beginning of remote oplog";
+        log() << "  theirTime: " << remoteFirstTime.toStringLong();
+        log() << "  ourTime:   " << commonTime.toStringLong();
+        return StatusWith<RollbackCommonPoint>(ErrorCodes::NoMatchingDocument,
+                                               "RS100 reached beginning of remote oplog [2]");
+    }
+    LOG(1) << "rollback found common point " << commonTime.toStringPretty() << " after "
+           << lookups << " remote lookups";
+
+    // Now roll back the operations after the common point, newest first.
+    localIterator = localOplog.makeIterator();
+    for (long long i = 0;; i++) {
+        localResult = localIterator->next();
+        if (!localResult.isOK()) {
+            return StatusWith<RollbackCommonPoint>(ErrorCodes::UnrecoverableRollbackError,
+                                                   "local oplog changed during rollback");
+        }
+
+        const auto& localValue = localResult.getValue();
+        if (i == common) {
+            if (getTimestamp(localValue) != commonTime || getHash(localValue) != commonHash) {
+                return StatusWith<RollbackCommonPoint>(ErrorCodes::UnrecoverableRollbackError,
+                                                       "local oplog changed during rollback");
+            }
+            return RollbackCommonPoint(commonTime, localValue.second);
+        }
+
+        auto status = rollbackOperation(localValue.first);
+        if (!status.isOK()) {
+            invariant(ErrorCodes::NoSuchKey != status.code());
+            return status;
+        }
+    }
 }
 
 }  // namespace repl
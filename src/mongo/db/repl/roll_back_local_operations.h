@@ -51,6 +51,12 @@ public:
 
     using RollbackCommonPoint = std::pair<Timestamp, RecordId>;
 
+    /**
+     * Type of function to look up the remote operation with timestamp 'ts'.
+     * Returns an empty object if the remote oplog has no such operation.
+     */
+    using FindRemoteOperationFn = stdx::function<BSONObj(const Timestamp& ts)>;
+
     /**
      * Initializes rollback processor with a valid local oplog.
      * Whenever we encounter an operation in the local oplog that has to be rolled back,
@@ -83,10 +89,21 @@ private:
  * we will pass it to 'rollbackOperation' starting with the most recent operation.
  * It is up to 'rollbackOperation' to roll back this operation immediately or
  * process it for future use.
+ *
+ * Rather than reading the remote oplog backwards until it meets the local one, searches the
+ * local oplog for the newest operation which is also in the remote oplog, looking up candidates
+ * by timestamp with 'findRemoteOperation'. This takes O(log n) remote lookups, n being the
+ * number of local operations to roll back, and doesn't read any of the operations the remote
+ * oplog has past the common point.
+ *
+ * 'remoteFirstOperation' and 'remoteLastOperation' are the oldest and newest operations in the
+ * remote oplog.
  */
-StatusWith<RollBackLocalOperations::RollbackCommonPoint> syncRollBackLocalOperations(
+StatusWith<RollBackLocalOperations::RollbackCommonPoint> searchRollBackLocalOperations(
     const OplogInterface& localOplog,
-    const OplogInterface& remoteOplog,
+    const BSONObj& remoteFirstOperation,
+    const BSONObj& remoteLastOperation,
+    const RollBackLocalOperations::FindRemoteOperationFn& findRemoteOperation,
     const RollBackLocalOperations::RollbackOperationFn& rollbackOperation);
 
 }  // namespace repl
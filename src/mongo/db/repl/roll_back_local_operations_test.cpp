@@ -228,178 +228,183 @@ TEST(RollBackLocalOperationsTest, SameTimestampDifferentHashesEndOfLocalOplog) {
     ASSERT_EQUALS(ErrorCodes::NoMatchingDocument, result.getStatus().code());
 }
 
-TEST(SyncRollBackLocalOperationsTest, OplogStartMissing) {
+/**
+ * Returns a function to look up operations by timestamp in 'remoteOperations', counting the
+ * lookups in 'lookups'.
+ */
+RollBackLocalOperations::FindRemoteOperationFn makeFindRemoteOperation(
+    const OplogInterfaceMock::Operations& remoteOperations, int* lookups) {
+    return [remoteOperations, lookups](const Timestamp& ts) -> BSONObj {
+        (*lookups)++;
+        for (const auto& operation : remoteOperations) {
+            if (operation.first["ts"].timestamp() == ts) {
+                return operation.first;
+            }
+        }
+        return BSONObj();
+    };
+}
+
+TEST(SearchRollBackLocalOperationsTest, OplogStartMissing) {
+    int lookups = 0;
     ASSERT_EQUALS(ErrorCodes::OplogStartMissing,
-                  syncRollBackLocalOperations(OplogInterfaceMock(kEmptyMockOperations),
-                                              OplogInterfaceMock({makeOpAndRecordId(1, 0)}),
-                                              [](const BSONObj&) { return Status::OK(); })
+                  searchRollBackLocalOperations(
+                      OplogInterfaceMock(kEmptyMockOperations),
+                      makeOp(1, 0),
+                      makeOp(1, 0),
+                      makeFindRemoteOperation({makeOpAndRecordId(1, 0)}, &lookups),
+                      [](const BSONObj&) { return Status::OK(); })
                       .getStatus()
                       .code());
 }
 
-TEST(SyncRollBackLocalOperationsTest, RemoteOplogMissing) {
+TEST(SearchRollBackLocalOperationsTest, RemoteOplogMissing) {
+    int lookups = 0;
     ASSERT_EQUALS(ErrorCodes::InvalidSyncSource,
-                  syncRollBackLocalOperations(OplogInterfaceMock({makeOpAndRecordId(1, 0)}),
-                                              OplogInterfaceMock(kEmptyMockOperations),
-                                              [](const BSONObj&) { return Status::OK(); })
+                  searchRollBackLocalOperations(
+                      OplogInterfaceMock({makeOpAndRecordId(1, 0)}),
+                      BSONObj(),
+                      BSONObj(),
+                      makeFindRemoteOperation(kEmptyMockOperations, &lookups),
+                      [](const BSONObj&) { return Status::OK(); })
                       .getStatus()
                       .code());
 }
 
-TEST(SyncRollBackLocalOperationsTest, RollbackPeriodTooLong) {
+TEST(SearchRollBackLocalOperationsTest, RollbackPeriodTooLong) {
+    int lookups = 0;
     ASSERT_EQUALS(ErrorCodes::ExceededTimeLimit,
-                  syncRollBackLocalOperations(OplogInterfaceMock({makeOpAndRecordId(1802, 0)}),
-                                              OplogInterfaceMock({makeOpAndRecordId(1, 0)}),
-                                              [](const BSONObj&) { return Status::OK(); })
+                  searchRollBackLocalOperations(
+                      OplogInterfaceMock({makeOpAndRecordId(1802, 0)}),
+                      makeOp(1, 0),
+                      makeOp(1, 0),
+                      makeFindRemoteOperation({makeOpAndRecordId(1, 0)}, &lookups),
+                      [](const BSONObj&) { return Status::OK(); })
                       .getStatus()
                       .code());
 }
 
-TEST(SyncRollBackLocalOperationsTest, RollbackTwoOperations) {
+TEST(SearchRollBackLocalOperationsTest, BothOplogsAtCommonPoint) {
     auto commonOperation = makeOpAndRecordId(1, 1);
-    OplogInterfaceMock::Operations localOperations({
-        makeOpAndRecordId(3, 1), makeOpAndRecordId(2, 1), commonOperation,
-    });
-    auto i = localOperations.cbegin();
-    auto result = syncRollBackLocalOperations(OplogInterfaceMock(localOperations),
-                                              OplogInterfaceMock({commonOperation}),
-                                              [&](const BSONObj& operation) {
-                                                  ASSERT_EQUALS(i->first, operation);
-                                                  i++;
-                                                  return Status::OK();
-                                              });
+    int lookups = 0;
+    auto result =
+        searchRollBackLocalOperations(OplogInterfaceMock({commonOperation}),
+                                      commonOperation.first,
+                                      commonOperation.first,
+                                      makeFindRemoteOperation({commonOperation}, &lookups),
+                                      [&](const BSONObj& operation) {
+                                          FAIL("should not reach here");
+                                          return Status::OK();
+                                      });
     ASSERT_OK(result.getStatus());
     ASSERT_EQUALS(commonOperation.first["ts"].timestamp(), result.getValue().first);
     ASSERT_EQUALS(commonOperation.second, result.getValue().second);
-    ASSERT_FALSE(i == localOperations.cend());
-    ASSERT_EQUALS(commonOperation.first, i->first);
-    i++;
-    ASSERT_TRUE(i == localOperations.cend());
+    ASSERT_EQUALS(1, lookups);
 }
 
-TEST(SyncRollBackLocalOperationsTest, SkipOneRemoteOperation) {
+TEST(SearchRollBackLocalOperationsTest, RollbackManyOperations) {
+    // 1000 local operations past the common point, which the remote oplog has 1000 others past.
+    // The remote oplog goes back no further than the common point.
+    OplogInterfaceMock::Operations localOperations;
+    OplogInterfaceMock::Operations remoteOperations;
+    for (int i = 1000; i > 0; i--) {
+        localOperations.push_back(makeOpAndRecordId(2 * i + 1, 1));
+        remoteOperations.push_back(makeOpAndRecordId(2 * i, 2));
+    }
     auto commonOperation = makeOpAndRecordId(1, 1);
-    auto remoteOperation = makeOpAndRecordId(2, 1);
+    localOperations.push_back(commonOperation);
+    localOperations.push_back(makeOpAndRecordId(0, 1));
+    remoteOperations.push_back(commonOperation);
+
+    int lookups = 0;
+    auto i = localOperations.cbegin();
     auto result =
-        syncRollBackLocalOperations(OplogInterfaceMock({commonOperation}),
-                                    OplogInterfaceMock({remoteOperation, commonOperation}),
-                                    [&](const BSONObj& operation) {
-                                        FAIL("should not reach here");
-                                        return Status::OK();
-                                    });
+        searchRollBackLocalOperations(OplogInterfaceMock(localOperations),
+                                      remoteOperations.back().first,
+                                      remoteOperations.front().first,
+                                      makeFindRemoteOperation(remoteOperations, &lookups),
+                                      [&](const BSONObj& operation) {
+                                          ASSERT_EQUALS(i->first, operation);
+                                          i++;
+                                          return Status::OK();
+                                      });
     ASSERT_OK(result.getStatus());
     ASSERT_EQUALS(commonOperation.first["ts"].timestamp(), result.getValue().first);
     ASSERT_EQUALS(commonOperation.second, result.getValue().second);
+    ASSERT_FALSE(i == localOperations.cend());
+    ASSERT_EQUALS(commonOperation.first, i->first);
+    ASSERT_LESS_THAN(lookups, 25);
 }
 
-TEST(SyncRollBackLocalOperationsTest, SameTimestampDifferentHashes) {
+TEST(SearchRollBackLocalOperationsTest, SameTimestampDifferentHashes) {
     auto commonOperation = makeOpAndRecordId(1, 1);
-    auto localOperation = makeOpAndRecordId(1, 2);
-    auto remoteOperation = makeOpAndRecordId(1, 3);
+    auto localOperation = makeOpAndRecordId(2, 2);
+    auto remoteOperation = makeOpAndRecordId(2, 3);
     bool called = false;
-    auto result =
-        syncRollBackLocalOperations(OplogInterfaceMock({localOperation, commonOperation}),
-                                    OplogInterfaceMock({remoteOperation, commonOperation}),
-                                    [&](const BSONObj& operation) {
-                                        ASSERT_EQUALS(localOperation.first, operation);
-                                        called = true;
-                                        return Status::OK();
-                                    });
+    int lookups = 0;
+    auto result = searchRollBackLocalOperations(
+        OplogInterfaceMock({localOperation, commonOperation}),
+        commonOperation.first,
+        remoteOperation.first,
+        makeFindRemoteOperation({remoteOperation, commonOperation}, &lookups),
+        [&](const BSONObj& operation) {
+            ASSERT_EQUALS(localOperation.first, operation);
+            called = true;
+            return Status::OK();
+        });
     ASSERT_OK(result.getStatus());
     ASSERT_EQUALS(commonOperation.first["ts"].timestamp(), result.getValue().first);
     ASSERT_EQUALS(commonOperation.second, result.getValue().second);
     ASSERT_TRUE(called);
 }
 
-TEST(SyncRollBackLocalOperationsTest, SameTimestampEndOfLocalOplog) {
+TEST(SearchRollBackLocalOperationsTest, RollbackOperationFailed) {
     auto commonOperation = makeOpAndRecordId(1, 1);
-    auto localOperation = makeOpAndRecordId(1, 2);
-    auto remoteOperation = makeOpAndRecordId(1, 3);
-    bool called = false;
-    auto result =
-        syncRollBackLocalOperations(OplogInterfaceMock({localOperation}),
-                                    OplogInterfaceMock({remoteOperation, commonOperation}),
-                                    [&](const BSONObj& operation) {
-                                        ASSERT_EQUALS(localOperation.first, operation);
-                                        called = true;
-                                        return Status::OK();
-                                    });
-    ASSERT_EQUALS(ErrorCodes::NoMatchingDocument, result.getStatus().code());
-    ASSERT_STRING_CONTAINS(result.getStatus().reason(),
-                           "RS101 reached beginning of local oplog [1]");
-    ASSERT_TRUE(called);
-}
-
-TEST(SyncRollBackLocalOperationsTest, SameTimestampRollbackOperationFailed) {
-    auto commonOperation = makeOpAndRecordId(1, 1);
-    auto localOperation = makeOpAndRecordId(1, 2);
-    auto remoteOperation = makeOpAndRecordId(1, 3);
-    auto result = syncRollBackLocalOperations(
+    auto localOperation = makeOpAndRecordId(3, 1);
+    int lookups = 0;
+    auto result = searchRollBackLocalOperations(
         OplogInterfaceMock({localOperation, commonOperation}),
-        OplogInterfaceMock({remoteOperation, commonOperation}),
+        commonOperation.first,
+        commonOperation.first,
+        makeFindRemoteOperation({commonOperation}, &lookups),
         [&](const BSONObj& operation) { return Status(ErrorCodes::OperationFailed, ""); });
     ASSERT_EQUALS(ErrorCodes::OperationFailed, result.getStatus().code());
 }
 
-TEST(SyncRollBackLocalOperationsTest, SameTimestampEndOfRemoteOplog) {
-    auto commonOperation = makeOpAndRecordId(1, 1);
-    auto localOperation = makeOpAndRecordId(1, 2);
-    auto remoteOperation = makeOpAndRecordId(1, 3);
-    bool called = false;
-    auto result = syncRollBackLocalOperations(OplogInterfaceMock({localOperation, commonOperation}),
-                                              OplogInterfaceMock({remoteOperation}),
-                                              [&](const BSONObj& operation) {
-                                                  ASSERT_EQUALS(localOperation.first, operation);
-                                                  called = true;
-                                                  return Status::OK();
-                                              });
-    ASSERT_EQUALS(ErrorCodes::NoMatchingDocument, result.getStatus().code());
-    ASSERT_STRING_CONTAINS(result.getStatus().reason(), "RS100 reached beginning of remote oplog");
-    ASSERT_TRUE(called);
-}
-
-TEST(SyncRollBackLocalOperationsTest, DifferentTimestampEndOfLocalOplog) {
-    auto commonOperation = makeOpAndRecordId(1, 1);
+TEST(SearchRollBackLocalOperationsTest, EndOfLocalOplog) {
     auto localOperation = makeOpAndRecordId(3, 1);
     auto remoteOperation = makeOpAndRecordId(2, 1);
-    bool called = false;
-    auto result =
-        syncRollBackLocalOperations(OplogInterfaceMock({localOperation}),
-                                    OplogInterfaceMock({remoteOperation, commonOperation}),
-                                    [&](const BSONObj& operation) {
-                                        ASSERT_EQUALS(localOperation.first, operation);
-                                        called = true;
-                                        return Status::OK();
-                                    });
+    int lookups = 0;
+    auto result = searchRollBackLocalOperations(
+        OplogInterfaceMock({localOperation, makeOpAndRecordId(1, 2)}),
+        makeOp(1, 1),
+        remoteOperation.first,
+        makeFindRemoteOperation({remoteOperation, makeOpAndRecordId(1, 1)}, &lookups),
+        [&](const BSONObj& operation) {
+            FAIL("should not reach here");
+            return Status::OK();
+        });
     ASSERT_EQUALS(ErrorCodes::NoMatchingDocument, result.getStatus().code());
     ASSERT_STRING_CONTAINS(result.getStatus().reason(),
-                           "RS101 reached beginning of local oplog [2]");
-    ASSERT_TRUE(called);
+                           "RS101 reached beginning of local oplog [3]");
 }
 
-TEST(SyncRollBackLocalOperationsTest, DifferentTimestampRollbackOperationFailed) {
+TEST(SearchRollBackLocalOperationsTest, EndOfRemoteOplog) {
     auto localOperation = makeOpAndRecordId(3, 1);
-    auto remoteOperation = makeOpAndRecordId(2, 1);
-    auto result = syncRollBackLocalOperations(
-        OplogInterfaceMock({localOperation}),
-        OplogInterfaceMock({remoteOperation}),
-        [&](const BSONObj& operation) { return Status(ErrorCodes::OperationFailed, ""); });
-    ASSERT_EQUALS(ErrorCodes::OperationFailed, result.getStatus().code());
-}
-
-TEST(SyncRollBackLocalOperationsTest, DifferentTimestampEndOfRemoteOplog) {
-    auto commonOperation = makeOpAndRecordId(1, 1);
-    auto localOperation = makeOpAndRecordId(2, 1);
-    auto remoteOperation = makeOpAndRecordId(3, 1);
-    auto result = syncRollBackLocalOperations(OplogInterfaceMock({localOperation, commonOperation}),
-                                              OplogInterfaceMock({remoteOperation}),
-                                              [&](const BSONObj& operation) {
-                                                  FAIL("Should not reach here");
-                                                  return Status::OK();
-                                              });
+    auto remoteOperation = makeOpAndRecordId(3, 2);
+    int lookups = 0;
+    auto result = searchRollBackLocalOperations(
+        OplogInterfaceMock({localOperation, makeOpAndRecordId(2, 1), makeOpAndRecordId(1, 1)}),
+        remoteOperation.first,
+        makeOp(4, 1),
+        makeFindRemoteOperation({makeOpAndRecordId(4, 1), remoteOperation}, &lookups),
+        [&](const BSONObj& operation) {
+            FAIL("should not reach here");
+            return Status::OK();
+        });
     ASSERT_EQUALS(ErrorCodes::NoMatchingDocument, result.getStatus().code());
     ASSERT_STRING_CONTAINS(result.getStatus().reason(),
-                           "RS100 reached beginning of remote oplog [1]");
+                           "RS100 reached beginning of remote oplog [2]");
 }
 
 }  // namespace
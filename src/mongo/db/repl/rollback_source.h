@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "mongo/base/disallow_copying.h"
 #include "mongo/base/status_with.h"
 #include "mongo/db/jsobj.h"
@@ -69,9 +71,22 @@ public:
     virtual BSONObj getLastOperation() const = 0;
 
     /**
-     * Fetch a single document from the sync source.
+     * Returns first operation in oplog.
+     */
+    virtual BSONObj getFirstOperation() const = 0;
+
+    /**
+     * Returns the operation in the oplog with timestamp 'ts', or an empty object if there is
+     * none.
+     */
+    virtual BSONObj findOperation(const Timestamp& ts) const = 0;
+
+    /**
+     * Fetches the documents in 'nss' whose _id is in 'ids' from the sync source, in no
+     * particular order.
      */
-    virtual BSONObj findOne(const NamespaceString& nss, const BSONObj& filter) const = 0;
+    virtual std::vector<BSONObj> findByIds(const NamespaceString& nss,
+                                           const BSONArray& ids) const = 0;
 
     /**
      * Clones a single collection from the sync source.
@@ -59,8 +59,35 @@ BSONObj RollbackSourceImpl::getLastOperation() const {
     return _conn->findOne(_collectionName, query, 0, QueryOption_SlaveOk);
 }
 
-BSONObj RollbackSourceImpl::findOne(const NamespaceString& nss, const BSONObj& filter) const {
-    return _conn->findOne(nss.toString(), filter, NULL, QueryOption_SlaveOk).getOwned();
+BSONObj RollbackSourceImpl::getFirstOperation() const {
+    const Query query = Query().sort(BSON("$natural" << 1));
+    return _conn->findOne(_collectionName, query, 0, QueryOption_SlaveOk);
+}
+
+BSONObj RollbackSourceImpl::findOperation(const Timestamp& ts) const {
+    // A $gte query on ts lets the oplog be searched from the right place rather than scanned.
+    const Query query(BSON("ts" << BSON("$gte" << ts)));
+    const BSONObj fields = BSON("ts" << 1 << "h" << 1);
+    BSONObj operation = _conn->findOne(
+        _collectionName, query, &fields, QueryOption_SlaveOk | QueryOption_OplogReplay);
+    if (operation.isEmpty() || operation["ts"].timestamp() != ts) {
+        return BSONObj();
+    }
+    return operation.getOwned();
+}
+
+std::vector<BSONObj> RollbackSourceImpl::findByIds(const NamespaceString& nss,
+                                                   const BSONArray& ids) const {
+    const Query query(BSON("_id" << BSON("$in" << ids)));
+    std::unique_ptr<DBClientCursor> cursor =
+        _conn->query(nss.ns(), query, 0, 0, NULL, QueryOption_SlaveOk);
+    uassert(28732, str::stream() << "replSet rollback couldn't query " << nss.ns(), cursor.get());
+
+    std::vector<BSONObj> docs;
+    while (cursor->more()) {
+        docs.push_back(cursor->nextSafe().getOwned());
+    }
+    return docs;
 }
 
 void RollbackSourceImpl::copyCollectionFromRemote(OperationContext* txn,
@@ -53,7 +53,12 @@ public:
 
     BSONObj getLastOperation() const override;
 
-    BSONObj findOne(const NamespaceString& nss, const BSONObj& filter) const override;
+    BSONObj getFirstOperation() const override;
+
+    BSONObj findOperation(const Timestamp& ts) const override;
+
+    std::vector<BSONObj> findByIds(const NamespaceString& nss,
+                                   const BSONArray& ids) const override;
 
     void copyCollectionFromRemote(OperationContext* txn, const NamespaceString& nss) const override;
 
@@ -49,11 +49,13 @@
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/initial_sync.h"
+#include "mongo/db/repl/initial_sync_progress.h"
 #include "mongo/db/repl/minvalid.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/repl_client_info.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -69,6 +71,11 @@ using std::string;
 // Failpoint which fails initial sync and leaves on oplog entry in the buffer.
 MONGO_FP_DECLARE(failInitSyncWithBufferedEntriesLeft);
 
+// How many collections of a database initial sync copies at once. This overlaps the reads from
+// the sync source; the writes still take the database lock in turn, and each collection in
+// flight holds index build sorters of up to 100MB per index.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(initialSyncCollectionCloneThreads, int, 4);
+
 /**
  * Truncates the oplog (removes any documents) and resets internal variables that were
  * originally initialized or affected by using values from the oplog at startup time.  These
@@ -165,20 +172,24 @@ void checkAdminDatabasePostClone(OperationContext* txn, Database* adminDb) {
     }
 }
 
+/**
+ * Copies the documents and builds the indexes of every database in 'dbs', except local. The
+ * indexes are built while the documents are copied; secondaries ignore unique constraints other
+ * than _id's until the oplog has been applied, and documents with duplicate _ids are dropped.
+ *
+ * Collections that 'progress' says are done are skipped, and partly copied ones are continued.
+ */
 bool _initialSyncClone(OperationContext* txn,
                        Cloner& cloner,
                        const std::string& host,
                        const list<string>& dbs,
-                       bool dataPass) {
+                       InitialSyncProgress* progress) {
     for (list<string>::const_iterator i = dbs.begin(); i != dbs.end(); i++) {
         const string db = *i;
         if (db == "local")
             continue;
 
-        if (dataPass)
-            log() << "initial sync cloning db: " << db;
-        else
-            log() << "initial sync cloning indexes for : " << db;
+        log() << "initial sync cloning db: " << db;
 
         CloneOptions options;
         options.fromDB = db;
@@ -187,8 +198,10 @@ bool _initialSyncClone(OperationContext* txn,
         options.snapshot = false;
         options.mayYield = true;
         options.mayBeInterrupted = false;
-        options.syncData = dataPass;
-        options.syncIndexes = !dataPass;
+        options.syncData = true;
+        options.syncIndexes = true;
+        options.parallelCollections = std::max(1, initialSyncCollectionCloneThreads);
+        options.progress = progress;
 
         // Make database stable
         ScopedTransaction transaction(txn, MODE_IX);
@@ -196,8 +209,7 @@ bool _initialSyncClone(OperationContext* txn,
 
         Status status = cloner.copyDb(txn, db, host, options, NULL);
         if (!status.isOK()) {
-            log() << "initial sync: error while " << (dataPass ? "cloning " : "indexing ") << db
-                  << ".  " << status.toString();
+            log() << "initial sync: error while cloning " << db << ".  " << status.toString();
             return false;
         }
 
@@ -307,11 +319,47 @@ void _tryToApplyOpWithRetry(OperationContext* txn, SyncTail* init, const BSONObj
     }
 }
 
+/**
+ * Returns the oplog entry that an earlier, unfinished, initial sync started from, if it can be
+ * continued from the sync source 'r' is connected to; that is, if that entry is still in the
+ * source's oplog, so that the source has every operation since. Otherwise returns an empty
+ * object.
+ */
+BSONObj _getResumableStartOp(OperationContext* txn, OplogReader* r) {
+    if (!getInitialSyncFlag()) {
+        return BSONObj();
+    }
+
+    BSONObj startOp = InitialSyncProgress::getStartOp(txn);
+    if (startOp.isEmpty()) {
+        return BSONObj();
+    }
+
+    // With OplogReplay, a $gte query on ts starts near the op rather than scanning the oplog.
+    const Timestamp startTs = startOp["ts"].timestamp();
+    const BSONObj fields = BSON("ts" << 1 << "h" << 1);
+    BSONObj sourceOp = r->conn()->findOne(rsOplogName,
+                                          Query(BSON("ts" << BSON("$gte" << startTs))),
+                                          &fields,
+                                          QueryOption_SlaveOk | QueryOption_OplogReplay);
+    if (sourceOp.isEmpty() || sourceOp["ts"].timestamp() != startTs ||
+        sourceOp["h"].numberLong() != startOp["h"].numberLong()) {
+        log() << "initial sync can't resume from " << startTs << ", which "
+              << r->getHost() << " doesn't have, starting over";
+        return BSONObj();
+    }
+
+    return startOp;
+}
+
 /**
  * Do the initial sync for this member.  There are several steps to this process:
  *
  *     0. Add _initialSyncFlag to minValid collection to tell us to restart initial sync if we
  *        crash in the middle of this procedure
+ *        If the flag is already set, and the sync target still has the op the failed attempt
+ *        started from, continue that attempt instead: keep what it cloned, see
+ *        InitialSyncProgress, and start from the same op.
  *     1. Record start time.
  *     2. Clone.
  *     3. Set minValid1 to sync target's latest op time.
@@ -375,11 +423,20 @@ Status _initialSync() {
         return Status(ErrorCodes::InitialSyncFailure, msg);
     }
 
-    // Add field to minvalid document to tell us to restart initial sync if we crash
-    setInitialSyncFlag(&txn);
+    BSONObj startOp = _getResumableStartOp(&txn, &r);
+    if (!startOp.isEmpty()) {
+        log() << "initial sync resuming the attempt which started from "
+              << startOp["ts"].timestamp();
+        lastOp = startOp;
+    } else {
+        InitialSyncProgress::reset(&txn, lastOp);
 
-    log() << "initial sync drop all databases";
-    dropAllDatabasesExceptLocal(&txn);
+        // Add field to minvalid document to tell us to restart initial sync if we crash
+        setInitialSyncFlag(&txn);
+
+        log() << "initial sync drop all databases";
+        dropAllDatabasesExceptLocal(&txn);
+    }
 
     log() << "initial sync clone all databases";
 
@@ -393,7 +450,8 @@ Status _initialSync() {
     }
 
     Cloner cloner;
-    if (!_initialSyncClone(&txn, cloner, r.conn()->getServerAddress(), dbs, true)) {
+    InitialSyncProgress progress;
+    if (!_initialSyncClone(&txn, cloner, r.conn()->getServerAddress(), dbs, &progress)) {
         return Status(ErrorCodes::InitialSyncFailure, "initial sync failed data cloning");
     }
 
@@ -427,13 +485,6 @@ Status _initialSync() {
     }
     // data should now be consistent
 
-    msg = "initial sync building indexes";
-    log() << msg;
-    if (!_initialSyncClone(&txn, cloner, r.conn()->getServerAddress(), dbs, false)) {
-        return Status(ErrorCodes::InitialSyncFailure,
-                      str::stream() << "initial sync failed: " << msg);
-    }
-
     // WARNING: If the 3rd oplog sync step is removed we must reset minValid
     // to the last entry on the source server so that we don't come
     // out of recovering until we get there (since the previous steps
@@ -469,6 +520,7 @@ Status _initialSync() {
 
         // Clear the initial sync flag.
         clearInitialSyncFlag(&txn);
+        InitialSyncProgress::clear(&txn);
         BackgroundSync::get()->setInitialSyncRequestedFlag(false);
     }
 
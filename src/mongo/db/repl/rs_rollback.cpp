@@ -34,6 +34,7 @@
 #include "mongo/db/repl/rs_rollback.h"
 
 #include <memory>
+#include <vector>
 
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/auth/authorization_manager.h"
@@ -114,6 +115,10 @@ using std::pair;
 namespace repl {
 namespace {
 
+// Limits on the number and the total size of the _ids refetched from the sync source at a time.
+const size_t kRefetchBatchSize = 1000;
+const int kRefetchBatchBytes = 1024 * 1024;
+
 class RSFatalException : public std::exception {
 public:
     RSFatalException(std::string m = "replica set fatal exception") : msg(m) {}
@@ -272,26 +277,41 @@ void syncFixUp(OperationContext* txn,
 
     BSONObj newMinValid;
 
-    // fetch all the goodVersions of each document from current primary
-    DocID doc;
+    // fetch all the goodVersions of each document from current primary, a batch of documents
+    // in the same collection at a time
+    string ns;
     unsigned long long numFetched = 0;
     try {
-        for (set<DocID>::iterator it = fixUpInfo.toRefetch.begin(); it != fixUpInfo.toRefetch.end();
-             it++) {
-            doc = *it;
-
-            verify(!doc._id.eoo());
+        set<DocID>::const_iterator it = fixUpInfo.toRefetch.begin();
+        while (it != fixUpInfo.toRefetch.end()) {
+            ns = it->ns;
+
+            std::vector<DocID> batch;
+            BSONArrayBuilder ids;
+            while (it != fixUpInfo.toRefetch.end() && ns == it->ns &&
+                   batch.size() < kRefetchBatchSize && ids.len() < kRefetchBatchBytes) {
+                verify(!it->_id.eoo());
+                batch.push_back(*it);
+                ids.append(it->_id);
+                it++;
+            }
 
-            {
-                // TODO : slow.  lots of round trips.
-                numFetched++;
-                BSONObj good = rollbackSource.findOne(NamespaceString(doc.ns), doc._id.wrap());
+            std::vector<BSONObj> docs = rollbackSource.findByIds(NamespaceString(ns), ids.arr());
+            std::map<BSONElement, BSONObj, BSONElementCmpWithoutField> goodById;
+            for (const BSONObj& good : docs) {
                 totalSize += good.objsize();
                 uassert(13410, "replSet too much data to roll back", totalSize < 300 * 1024 * 1024);
+                goodById[good["_id"]] = good;
+            }
 
-                // note good might be eoo, indicating we should delete it
-                goodVersions.push_back(pair<DocID, BSONObj>(doc, good));
+            for (const DocID& doc : batch) {
+                auto good = goodById.find(doc._id);
+                // note a document the source doesn't have is left empty, indicating we should
+                // delete it
+                goodVersions.push_back(
+                    pair<DocID, BSONObj>(doc, good == goodById.end() ? BSONObj() : good->second));
             }
+            numFetched += batch.size();
         }
         newMinValid = rollbackSource.getLastOperation();
         if (newMinValid.isEmpty()) {
@@ -300,8 +320,8 @@ void syncFixUp(OperationContext* txn,
         }
     } catch (const DBException& e) {
         LOG(1) << "rollback re-get objects: " << e.toString();
-        error() << "rollback couldn't re-get ns:" << doc.ns << " _id:" << doc._id << ' '
-                << numFetched << '/' << fixUpInfo.toRefetch.size();
+        error() << "rollback couldn't re-get ns:" << ns << ' ' << numFetched << '/'
+                << fixUpInfo.toRefetch.size();
         throw e;
     }
 
@@ -696,8 +716,21 @@ Status _syncRollback(OperationContext* txn,
         try {
             auto processOperationForFixUp =
                 [&how](const BSONObj& operation) { return refetch(how, operation); };
-            auto res = syncRollBackLocalOperations(
-                localOplog, rollbackSource.getOplog(), processOperationForFixUp);
+            auto findRemoteOperation = [&rollbackSource](const Timestamp& ts) {
+                return rollbackSource.findOperation(ts);
+            };
+
+            BSONObj remoteLastOperation;
+            auto remoteResult = rollbackSource.getOplog().makeIterator()->next();
+            if (remoteResult.isOK()) {
+                remoteLastOperation = remoteResult.getValue().first;
+            }
+
+            auto res = searchRollBackLocalOperations(localOplog,
+                                                     rollbackSource.getFirstOperation(),
+                                                     remoteLastOperation,
+                                                     findRemoteOperation,
+                                                     processOperationForFixUp);
             if (!res.isOK()) {
                 switch (res.getStatus().code()) {
                     case ErrorCodes::OplogStartMissing:
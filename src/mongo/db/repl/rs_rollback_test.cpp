@@ -31,6 +31,7 @@
 #include <list>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
@@ -83,7 +84,10 @@ public:
     int getRollbackId() const override;
     const OplogInterface& getOplog() const override;
     BSONObj getLastOperation() const override;
-    BSONObj findOne(const NamespaceString& nss, const BSONObj& filter) const override;
+    BSONObj getFirstOperation() const override;
+    BSONObj findOperation(const Timestamp& ts) const override;
+    std::vector<BSONObj> findByIds(const NamespaceString& nss,
+                                   const BSONArray& ids) const override;
     void copyCollectionFromRemote(OperationContext* txn, const NamespaceString& nss) const override;
     StatusWith<BSONObj> getCollectionInfo(const NamespaceString& nss) const override;
 
@@ -109,10 +113,30 @@ BSONObj RollbackSourceMock::getLastOperation() const {
     return result.getValue().first;
 }
 
-BSONObj RollbackSourceMock::findOne(const NamespaceString& nss, const BSONObj& filter) const {
+BSONObj RollbackSourceMock::getFirstOperation() const {
+    BSONObj operation;
+    auto iter = _oplog->makeIterator();
+    for (auto result = iter->next(); result.isOK(); result = iter->next()) {
+        operation = result.getValue().first;
+    }
+    return operation;
+}
+
+BSONObj RollbackSourceMock::findOperation(const Timestamp& ts) const {
+    auto iter = _oplog->makeIterator();
+    for (auto result = iter->next(); result.isOK(); result = iter->next()) {
+        if (result.getValue().first["ts"].timestamp() == ts) {
+            return result.getValue().first;
+        }
+    }
     return BSONObj();
 }
 
+std::vector<BSONObj> RollbackSourceMock::findByIds(const NamespaceString& nss,
+                                                   const BSONArray& ids) const {
+    return std::vector<BSONObj>();
+}
+
 void RollbackSourceMock::copyCollectionFromRemote(OperationContext* txn,
                                                   const NamespaceString& nss) const {}
 
@@ -318,9 +342,14 @@ int _testRollBackDelete(OperationContext* txn,
             : RollbackSourceMock(std::move(oplog)),
               called(false),
               _documentAtSource(documentAtSource) {}
-        BSONObj findOne(const NamespaceString& nss, const BSONObj& filter) const {
+        std::vector<BSONObj> findByIds(const NamespaceString& nss,
+                                       const BSONArray& ids) const override {
             called = true;
-            return _documentAtSource;
+            std::vector<BSONObj> docs;
+            if (!_documentAtSource.isEmpty()) {
+                docs.push_back(_documentAtSource);
+            }
+            return docs;
         }
         mutable bool called;
 
@@ -379,6 +408,99 @@ TEST_F(RSRollbackTest, RollBackDeleteRestoreDocument) {
     ASSERT_EQUALS(1, _testRollBackDelete(_txn.get(), _coordinator, doc));
 }
 
+/**
+ * Test function to roll back 'numDeletes' delete operations of _ids 0 to numDeletes - 1 in one
+ * collection. The sync source has the documents with an even _id, and answers the queries by
+ * _id with them in reverse order. The size of each refetched batch is appended to 'batchSizes'.
+ * Returns number of records in collection after rolling back the delete operations.
+ */
+int _testRollBackDeletes(OperationContext* txn,
+                         ReplicationCoordinator* coordinator,
+                         int numDeletes,
+                         std::vector<int>* batchSizes) {
+    auto commonOperation =
+        std::make_pair(BSON("ts" << Timestamp(Seconds(1), 0) << "h" << 1LL), RecordId(1));
+    OplogInterfaceMock::Operations localOperations;
+    localOperations.push_front(commonOperation);
+    for (int i = 0; i < numDeletes; ++i) {
+        localOperations.push_front(
+            std::make_pair(BSON("ts" << Timestamp(Seconds(2), i) << "h" << 1LL << "op"
+                                     << "d"
+                                     << "ns"
+                                     << "test.t"
+                                     << "o" << BSON("_id" << i)),
+                           RecordId(i + 2)));
+    }
+    class RollbackSourceLocal : public RollbackSourceMock {
+    public:
+        RollbackSourceLocal(std::vector<int>* batchSizes, std::unique_ptr<OplogInterface> oplog)
+            : RollbackSourceMock(std::move(oplog)), _batchSizes(batchSizes) {}
+        std::vector<BSONObj> findByIds(const NamespaceString& nss,
+                                       const BSONArray& ids) const override {
+            ASSERT_EQUALS("test.t", nss.ns());
+            std::vector<BSONObj> docs;
+            int numIds = 0;
+            BSONForEach(id, ids) {
+                ++numIds;
+                if (id.numberInt() % 2 == 0) {
+                    docs.insert(docs.begin(), BSON("_id" << id.numberInt() << "a" << 1));
+                }
+            }
+            _batchSizes->push_back(numIds);
+            return docs;
+        }
+
+    private:
+        std::vector<int>* _batchSizes;
+    };
+    RollbackSourceLocal rollbackSource(batchSizes,
+                                       std::unique_ptr<OplogInterface>(new OplogInterfaceMock({
+                                           commonOperation,
+                                       })));
+    const BSONObj& lastOperation = localOperations.front().first;
+    OpTime opTime(lastOperation["ts"].timestamp(), lastOperation["h"].Long());
+    ASSERT_OK(syncRollback(txn,
+                           opTime,
+                           OplogInterfaceMock(localOperations),
+                           rollbackSource,
+                           coordinator,
+                           noSleep));
+
+    Lock::DBLock dbLock(txn->lockState(), "test", MODE_S);
+    Lock::CollectionLock collLock(txn->lockState(), "test.t", MODE_S);
+    auto db = dbHolder().get(txn, "test");
+    ASSERT_TRUE(db);
+    auto collection = db->getCollection("test.t");
+    ASSERT_TRUE(collection);
+    auto cursor = collection->getCursor(txn);
+    while (auto record = cursor->next()) {
+        const BSONObj doc = record->data.toBson();
+        ASSERT_EQUALS(0, doc["_id"].numberInt() % 2);
+        ASSERT_EQUALS(1, doc["a"].numberInt());
+    }
+    return collection->getRecordStore()->numRecords(txn);
+}
+
+TEST_F(RSRollbackTest, RollBackDeletesRefetchesDocumentsByIdInOneBatch) {
+    createOplog(_txn.get());
+    _createCollection(_txn.get(), "test.t", CollectionOptions());
+    std::vector<int> batchSizes;
+    ASSERT_EQUALS(3, _testRollBackDeletes(_txn.get(), _coordinator, 5, &batchSizes));
+    ASSERT_EQUALS(1U, batchSizes.size());
+    ASSERT_EQUALS(5, batchSizes[0]);
+}
+
+TEST_F(RSRollbackTest, RollBackDeletesRefetchesDocumentsByIdInBatchesOf1000) {
+    createOplog(_txn.get());
+    _createCollection(_txn.get(), "test.t", CollectionOptions());
+    std::vector<int> batchSizes;
+    ASSERT_EQUALS(1250, _testRollBackDeletes(_txn.get(), _coordinator, 2500, &batchSizes));
+    ASSERT_EQUALS(3U, batchSizes.size());
+    ASSERT_EQUALS(1000, batchSizes[0]);
+    ASSERT_EQUALS(1000, batchSizes[1]);
+    ASSERT_EQUALS(500, batchSizes[2]);
+}
+
 TEST_F(RSRollbackTest, RollbackUnknownCommand) {
     createOplog(_txn.get());
     auto commonOperation =
@@ -0,0 +1,257 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/stats/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/platform/bits.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/spin_lock.h"
+#include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+namespace {
+
+const char* const latencyTypeNames[] = {"reads", "writes", "commands"};
+
+static_assert(sizeof(latencyTypeNames) / sizeof(latencyTypeNames[0]) == kNumLatencyTypes,
+              "sizeof(latencyTypeNames) / sizeof(latencyTypeNames[0]) == kNumLatencyTypes");
+
+/**
+ * A thread's share of the instance-wide histograms. Its lock is only contended while they are
+ * being reported.
+ */
+struct ThreadLatencyHistograms {
+    ThreadLatencyHistograms();
+    ~ThreadLatencyHistograms();
+
+    SpinLock lock;
+    LatencyHistogram histograms[kNumLatencyTypes];
+};
+
+/**
+ * All threads' histograms, and what threads which exited left behind.
+ */
+struct LatencyHistogramsRegistry {
+    SimpleMutex mutex;
+    std::set<ThreadLatencyHistograms*> threads;
+    LatencyHistogram exited[kNumLatencyTypes];
+};
+
+// Never deleted, as threads may exit after static destructors ran
+LatencyHistogramsRegistry* const registry = new LatencyHistogramsRegistry();
+
+ThreadLatencyHistograms::ThreadLatencyHistograms() {
+    stdx::lock_guard<SimpleMutex> lk(registry->mutex);
+    registry->threads.insert(this);
+}
+
+ThreadLatencyHistograms::~ThreadLatencyHistograms() {
+    stdx::lock_guard<SimpleMutex> lk(registry->mutex);
+    registry->threads.erase(this);
+
+    scoped_spinlock threadLock(lock);
+    for (int i = 0; i < kNumLatencyTypes; i++) {
+        registry->exited[i].merge(histograms[i]);
+    }
+}
+
+}  // namespace
+
+TSP_DEFINE(ThreadLatencyHistograms, threadLatencyHistograms);
+
+
+const char* latencyTypeName(OperationLatencyType type) {
+    return latencyTypeNames[type];
+}
+
+OperationLatencyType latencyTypeForOp(int op, bool isCommand) {
+    switch (op) {
+        case dbQuery:
+            return isCommand ? kCommandLatency : kReadLatency;
+        case dbGetMore:
+            return kReadLatency;
+        case dbInsert:
+        case dbUpdate:
+        case dbDelete:
+            return kWriteLatency;
+        case dbCommand:
+            return kCommandLatency;
+        default:
+            return kNumLatencyTypes;
+    }
+}
+
+
+LatencyHistogram::LatencyHistogram() : _count(0), _totalMicros(0) {
+    std::fill(_buckets, _buckets + kNumBuckets, 0);
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& older, const LatencyHistogram& newer) {
+    _count = (newer._count >= older._count) ? (newer._count - older._count) : newer._count;
+    _totalMicros = (newer._totalMicros >= older._totalMicros)
+        ? (newer._totalMicros - older._totalMicros)
+        : newer._totalMicros;
+
+    for (int i = 0; i < kNumBuckets; i++) {
+        _buckets[i] = (newer._buckets[i] >= older._buckets[i])
+            ? (newer._buckets[i] - older._buckets[i])
+            : newer._buckets[i];
+    }
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    _buckets[bucketFor(micros)]++;
+    _count++;
+    _totalMicros += micros;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < kNumBuckets; i++) {
+        _buckets[i] += other._buckets[i];
+    }
+    _count += other._count;
+    _totalMicros += other._totalMicros;
+}
+
+uint64_t LatencyHistogram::getPercentile(double quantile) const {
+    if (_count == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = std::max<uint64_t>(1, std::ceil(quantile * _count));
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets - 1; i++) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            return bucketLowerBound(i + 1);
+        }
+    }
+
+    // The last bucket has no upper bound
+    return bucketLowerBound(kNumBuckets - 1);
+}
+
+void LatencyHistogram::append(BSONObjBuilder* builder, bool includeBuckets) const {
+    builder->append("ops", static_cast<long long>(_count));
+    builder->append("latency", static_cast<long long>(_totalMicros));
+    builder->append("p50", static_cast<long long>(getPercentile(0.5)));
+    builder->append("p95", static_cast<long long>(getPercentile(0.95)));
+    builder->append("p99", static_cast<long long>(getPercentile(0.99)));
+    builder->append("p999", static_cast<long long>(getPercentile(0.999)));
+
+    if (!includeBuckets) {
+        return;
+    }
+
+    BSONArrayBuilder buckets(builder->subarrayStart("histogram"));
+    for (int i = 0; i < kNumBuckets; i++) {
+        if (_buckets[i] == 0) {
+            continue;
+        }
+
+        BSONObjBuilder bucket(buckets.subobjStart());
+        bucket.append("micros", static_cast<long long>(bucketLowerBound(i)));
+        bucket.append("count", static_cast<long long>(_buckets[i]));
+        bucket.done();
+    }
+    buckets.done();
+}
+
+int LatencyHistogram::bucketFor(uint64_t micros) {
+    const uint64_t subBuckets = 1 << kSubBucketBits;
+    if (micros < subBuckets) {
+        return micros;
+    }
+
+    // The power of two selects a group of sub-buckets and the bits below the leading one select
+    // the sub-bucket within it.
+    const int exponent = 63 - countLeadingZeros64(micros);
+    const int group = exponent - kSubBucketBits + 1;
+    const int subBucket = (micros >> (exponent - kSubBucketBits)) & (subBuckets - 1);
+    return std::min((group << kSubBucketBits) + subBucket, kNumBuckets - 1);
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(int bucket) {
+    const int subBuckets = 1 << kSubBucketBits;
+    if (bucket < subBuckets) {
+        return bucket;
+    }
+
+    const int exponent = (bucket >> kSubBucketBits) + kSubBucketBits - 1;
+    const uint64_t subBucket = bucket & (subBuckets - 1);
+    return (subBuckets + subBucket) << (exponent - kSubBucketBits);
+}
+
+
+void recordGlobalOperationLatency(OperationLatencyType type, uint64_t micros) {
+    if (type == kNumLatencyTypes) {
+        return;
+    }
+
+    ThreadLatencyHistograms* thread = threadLatencyHistograms.getMake();
+    scoped_spinlock lk(thread->lock);
+    thread->histograms[type].record(micros);
+}
+
+void appendGlobalOperationLatencies(BSONObjBuilder* builder, bool includeBuckets) {
+    LatencyHistogram merged[kNumLatencyTypes];
+    {
+        stdx::lock_guard<SimpleMutex> lk(registry->mutex);
+        for (int i = 0; i < kNumLatencyTypes; i++) {
+            merged[i].merge(registry->exited[i]);
+        }
+
+        for (std::set<ThreadLatencyHistograms*>::const_iterator it = registry->threads.begin();
+             it != registry->threads.end();
+             ++it) {
+            scoped_spinlock threadLock((*it)->lock);
+            for (int i = 0; i < kNumLatencyTypes; i++) {
+                merged[i].merge((*it)->histograms[i]);
+            }
+        }
+    }
+
+    for (int i = 0; i < kNumLatencyTypes; i++) {
+        const OperationLatencyType type = static_cast<OperationLatencyType>(i);
+        BSONObjBuilder histogram(builder->subobjStart(latencyTypeName(type)));
+        merged[type].append(&histogram, includeBuckets);
+        histogram.done();
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace mongo {
+
+class BSONObjBuilder;
+
+/**
+ * The kinds of operations whose latencies are kept apart.
+ */
+enum OperationLatencyType {
+    kReadLatency,
+    kWriteLatency,
+    kCommandLatency,
+    kNumLatencyTypes,
+};
+
+/**
+ * Maps a wire protocol op to the kind of latency it is counted as, or kNumLatencyTypes for ops
+ * which are not counted, such as killCursors.
+ */
+OperationLatencyType latencyTypeForOp(int op, bool isCommand);
+
+/**
+ * Name under which latencies of the given kind are reported.
+ */
+const char* latencyTypeName(OperationLatencyType type);
+
+/**
+ * Counts latencies in logarithmic buckets, in the manner of HDR histograms: each power of two of
+ * microseconds is split into four equal sub-buckets, so percentiles are accurate to within 25%
+ * everywhere from a microsecond to over an hour, in a fixed number of buckets.
+ *
+ * Not thread-safe.
+ */
+class LatencyHistogram {
+public:
+    static const int kSubBucketBits = 2;
+    static const int kNumBuckets = 124;
+
+    LatencyHistogram();
+
+    /**
+     * Constructs the difference between two snapshots of the same histogram. Like Top's usage
+     * data, it is not accurate if the histogram was reset in between, but it is not negative.
+     */
+    LatencyHistogram(const LatencyHistogram& older, const LatencyHistogram& newer);
+
+    void record(uint64_t micros);
+
+    void merge(const LatencyHistogram& other);
+
+    uint64_t getCount() const {
+        return _count;
+    }
+
+    uint64_t getTotalMicros() const {
+        return _totalMicros;
+    }
+
+    /**
+     * Returns the upper bound of the bucket containing the given quantile, which must be
+     * between 0 and 1, or zero if nothing was recorded.
+     */
+    uint64_t getPercentile(double quantile) const;
+
+    /**
+     * Appends the count, total and the common percentiles and, if requested, the non-empty
+     * buckets as pairs of their lower bound and count.
+     */
+    void append(BSONObjBuilder* builder, bool includeBuckets) const;
+
+    static int bucketFor(uint64_t micros);
+    static uint64_t bucketLowerBound(int bucket);
+
+private:
+    uint64_t _buckets[kNumBuckets];
+    uint64_t _count;
+    uint64_t _totalMicros;
+};
+
+/**
+ * Records the latency of an operation in the instance-wide histograms. These are always on, so
+ * each thread records into histograms of its own, which are only merged when reported.
+ */
+void recordGlobalOperationLatency(OperationLatencyType type, uint64_t micros);
+
+/**
+ * Appends the instance-wide histograms as sub-objects named by latencyTypeName.
+ */
+void appendGlobalOperationLatencies(BSONObjBuilder* builder, bool includeBuckets);
+
+}  // namespace mongo
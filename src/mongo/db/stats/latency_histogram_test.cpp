@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <limits>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/stats/latency_histogram.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+
+namespace {
+
+using namespace mongo;
+
+TEST(LatencyHistogramTest, BucketBounds) {
+    for (uint64_t micros = 0; micros < 4; micros++) {
+        ASSERT_EQUALS(static_cast<int>(micros), LatencyHistogram::bucketFor(micros));
+    }
+
+    // Every bucket contains its own lower bound and ends where the next one starts.
+    for (int bucket = 0; bucket < LatencyHistogram::kNumBuckets - 1; bucket++) {
+        const uint64_t lower = LatencyHistogram::bucketLowerBound(bucket);
+        const uint64_t next = LatencyHistogram::bucketLowerBound(bucket + 1);
+        ASSERT_LESS_THAN(lower, next);
+        ASSERT_EQUALS(bucket, LatencyHistogram::bucketFor(lower));
+        ASSERT_EQUALS(bucket, LatencyHistogram::bucketFor(next - 1));
+    }
+
+    ASSERT_EQUALS(LatencyHistogram::kNumBuckets - 1,
+                  LatencyHistogram::bucketFor(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram histogram;
+    ASSERT_EQUALS(0U, histogram.getPercentile(0.5));
+
+    for (uint64_t micros = 1; micros <= 1000; micros++) {
+        histogram.record(micros);
+    }
+    ASSERT_EQUALS(1000U, histogram.getCount());
+    ASSERT_EQUALS(500500U, histogram.getTotalMicros());
+
+    // Reported percentiles are bucket upper bounds, so within 25% above the exact value.
+    const double quantiles[] = {0.01, 0.5, 0.95, 0.99, 0.999, 1};
+    for (double quantile : quantiles) {
+        const uint64_t exact = quantile * 1000;
+        const uint64_t reported = histogram.getPercentile(quantile);
+        ASSERT_GREATER_THAN(reported, exact);
+        ASSERT_LESS_THAN_OR_EQUALS(reported, exact + exact / 4 + 1);
+    }
+}
+
+TEST(LatencyHistogramTest, Diff) {
+    LatencyHistogram older;
+    older.record(10);
+    older.record(100);
+
+    LatencyHistogram newer(older);
+    newer.record(100);
+    newer.record(1000);
+
+    LatencyHistogram diff(older, newer);
+    ASSERT_EQUALS(2U, diff.getCount());
+    ASSERT_EQUALS(1100U, diff.getTotalMicros());
+    ASSERT_EQUALS(LatencyHistogram::bucketLowerBound(LatencyHistogram::bucketFor(100) + 1),
+                  diff.getPercentile(0.5));
+}
+
+TEST(LatencyHistogramTest, Append) {
+    LatencyHistogram histogram;
+    histogram.record(5);
+    histogram.record(5);
+
+    BSONObjBuilder withoutBuckets;
+    histogram.append(&withoutBuckets, false);
+    BSONObj obj = withoutBuckets.obj();
+    ASSERT_EQUALS(2, obj["ops"].numberLong());
+    ASSERT_EQUALS(10, obj["latency"].numberLong());
+    ASSERT_EQUALS(6, obj["p50"].numberLong());
+    ASSERT_FALSE(obj.hasField("histogram"));
+
+    BSONObjBuilder withBuckets;
+    histogram.append(&withBuckets, true);
+    obj = withBuckets.obj();
+    ASSERT_EQUALS(BSON_ARRAY(BSON("micros" << 5LL << "count" << 2LL)), obj["histogram"].Obj());
+}
+
+TEST(LatencyHistogramTest, OpTypes) {
+    ASSERT_EQUALS(kReadLatency, latencyTypeForOp(dbQuery, false));
+    ASSERT_EQUALS(kCommandLatency, latencyTypeForOp(dbQuery, true));
+    ASSERT_EQUALS(kReadLatency, latencyTypeForOp(dbGetMore, false));
+    ASSERT_EQUALS(kWriteLatency, latencyTypeForOp(dbInsert, false));
+    ASSERT_EQUALS(kCommandLatency, latencyTypeForOp(dbCommand, true));
+    ASSERT_EQUALS(kNumLatencyTypes, latencyTypeForOp(dbKillCursors, false));
+}
+
+TEST(LatencyHistogramTest, GlobalLatencies) {
+    BSONObjBuilder before;
+    appendGlobalOperationLatencies(&before, false);
+    const long long writesBefore = before.obj()["writes"]["ops"].numberLong();
+
+    recordGlobalOperationLatency(kWriteLatency, 100);
+    recordGlobalOperationLatency(kNumLatencyTypes, 100);
+
+    BSONObjBuilder after;
+    appendGlobalOperationLatencies(&after, false);
+    BSONObj obj = after.obj();
+    ASSERT_EQUALS(writesBefore + 1, obj["writes"]["ops"].numberLong());
+    ASSERT_TRUE(obj.hasField("reads"));
+    ASSERT_TRUE(obj.hasField("commands"));
+}
+
+}  // namespace
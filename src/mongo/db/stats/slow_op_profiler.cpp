@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/stats/slow_op_profiler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+namespace {
+
+// Record every this many slow operations. Zero disables recording.
+MONGO_EXPORT_SERVER_PARAMETER(slowOpProfilerSampleRate, int, 1);
+
+SlowOpProfiler globalSlowOpProfiler;
+
+}  // namespace
+
+
+// Entries are full profile documents, which can hold a query of up to 50KB, so this is kept
+// smaller than the lock wait profiler's buffer.
+const size_t SlowOpProfiler::kCapacity = 256;
+
+SlowOpProfiler::SlowOpProfiler() : _slots(new Slot[kCapacity]) {}
+
+bool SlowOpProfiler::shouldSample() {
+    const int sampleRate = slowOpProfilerSampleRate;
+    if (sampleRate <= 0) {
+        return false;
+    }
+
+    return _numSlowOps.fetchAndAdd(1) % sampleRate == 0;
+}
+
+void SlowOpProfiler::record(const BSONObj& op) {
+    BSONObj owned = op.getOwned();
+
+    const uint64_t seq = _numRecorded.fetchAndAdd(1);
+    Slot& slot = _slots[seq % kCapacity];
+    {
+        scoped_spinlock lk(slot.lock);
+
+        // A writer which lapped this one has already put a newer operation here
+        if (!slot.op.isEmpty() && slot.seq > seq) {
+            return;
+        }
+
+        slot.seq = seq;
+        slot.op.swap(owned);
+    }
+
+    // The replaced operation, if any, is freed here, outside of the slot's lock
+}
+
+std::vector<BSONObj> SlowOpProfiler::getOps() const {
+    std::vector<std::pair<uint64_t, BSONObj>> ops;
+    for (size_t i = 0; i < kCapacity; i++) {
+        Slot& slot = _slots[i];
+        scoped_spinlock lk(slot.lock);
+        if (!slot.op.isEmpty()) {
+            ops.push_back(std::make_pair(slot.seq, slot.op));
+        }
+    }
+
+    std::sort(ops.begin(),
+              ops.end(),
+              [](const std::pair<uint64_t, BSONObj>& lhs, const std::pair<uint64_t, BSONObj>& rhs) {
+                  return lhs.first < rhs.first;
+              });
+
+    std::vector<BSONObj> result;
+    result.reserve(ops.size());
+    for (size_t i = 0; i < ops.size(); i++) {
+        result.push_back(ops[i].second);
+    }
+    return result;
+}
+
+uint64_t SlowOpProfiler::getNumRecorded() const {
+    return _numRecorded.load();
+}
+
+void SlowOpProfiler::clear() {
+    for (size_t i = 0; i < kCapacity; i++) {
+        BSONObj cleared;
+        Slot& slot = _slots[i];
+        scoped_spinlock lk(slot.lock);
+        slot.op.swap(cleared);
+    }
+}
+
+
+SlowOpProfiler* getGlobalSlowOpProfiler() {
+    return &globalSlowOpProfiler;
+}
+
+}  // namespace mongo
@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/spin_lock.h"
+
+namespace mongo {
+
+/**
+ * Keeps the most recent slow operations in memory, as the documents the database profiler would
+ * have written to system.profile. Unlike the profiler, recording an operation takes no database
+ * locks and does no writes, so this is always on.
+ *
+ * The buffer is a fixed ring of slots, each with a lock of its own. Writers claim slots with an
+ * atomic counter, so concurrent writers only meet if the whole ring wraps around between them,
+ * and readers only hold each slot's lock long enough to copy out a reference to its document.
+ *
+ * Only every slowOpProfilerSampleRate-th slow operation is recorded.
+ *
+ * Thread-safe.
+ */
+class SlowOpProfiler {
+    MONGO_DISALLOW_COPYING(SlowOpProfiler);
+
+public:
+    static const size_t kCapacity;
+
+    SlowOpProfiler();
+
+    /**
+     * Decides whether the slow operation which just completed should be recorded.
+     */
+    bool shouldSample();
+
+    /**
+     * Adds an operation, replacing the oldest one if the buffer is full.
+     */
+    void record(const BSONObj& op);
+
+    /**
+     * Returns the operations currently in the buffer, oldest first.
+     */
+    std::vector<BSONObj> getOps() const;
+
+    /**
+     * Number of operations recorded since startup, including those which have since been
+     * replaced or cleared.
+     */
+    uint64_t getNumRecorded() const;
+
+    void clear();
+
+private:
+    struct Slot {
+        Slot() : seq(0) {}
+
+        SpinLock lock;
+
+        // Position of the operation in the order of record calls
+        uint64_t seq;
+        BSONObj op;
+    };
+
+    AtomicUInt64 _numSlowOps;
+    AtomicUInt64 _numRecorded;
+
+    // Operation number n goes to _slots[n % kCapacity]
+    std::unique_ptr<Slot[]> _slots;
+};
+
+/**
+ * Retrieves the instance-wide slow operation profiler.
+ */
+SlowOpProfiler* getGlobalSlowOpProfiler();
+
+}  // namespace mongo
@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/stats/slow_op_profiler.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+using namespace mongo;
+
+TEST(SlowOpProfilerTest, RecordsInOrder) {
+    SlowOpProfiler profiler;
+    ASSERT_TRUE(profiler.getOps().empty());
+
+    profiler.record(BSON("n" << 0));
+    profiler.record(BSON("n" << 1));
+
+    const std::vector<BSONObj> ops = profiler.getOps();
+    ASSERT_EQUALS(2U, ops.size());
+    ASSERT_EQUALS(BSON("n" << 0), ops[0]);
+    ASSERT_EQUALS(BSON("n" << 1), ops[1]);
+    ASSERT_EQUALS(2U, profiler.getNumRecorded());
+}
+
+TEST(SlowOpProfilerTest, Wraps) {
+    SlowOpProfiler profiler;
+
+    const int numOps = SlowOpProfiler::kCapacity + 10;
+    for (int i = 0; i < numOps; i++) {
+        profiler.record(BSON("n" << i));
+    }
+
+    const std::vector<BSONObj> ops = profiler.getOps();
+    ASSERT_EQUALS(SlowOpProfiler::kCapacity, ops.size());
+    ASSERT_EQUALS(BSON("n" << 10), ops.front());
+    ASSERT_EQUALS(BSON("n" << numOps - 1), ops.back());
+    ASSERT_EQUALS(static_cast<uint64_t>(numOps), profiler.getNumRecorded());
+}
+
+TEST(SlowOpProfilerTest, OwnsRecordedOps) {
+    SlowOpProfiler profiler;
+    {
+        BSONObjBuilder builder;
+        builder.append("n", 1);
+        BSONObj unowned(builder.asTempObj());
+        profiler.record(unowned);
+    }
+
+    ASSERT_EQUALS(BSON("n" << 1), profiler.getOps()[0]);
+}
+
+TEST(SlowOpProfilerTest, Clear) {
+    SlowOpProfiler profiler;
+    profiler.record(BSON("n" << 0));
+    profiler.clear();
+    ASSERT_TRUE(profiler.getOps().empty());
+
+    profiler.record(BSON("n" << 1));
+    const std::vector<BSONObj> ops = profiler.getOps();
+    ASSERT_EQUALS(1U, ops.size());
+    ASSERT_EQUALS(BSON("n" << 1), ops[0]);
+}
+
+TEST(SlowOpProfilerTest, SamplesEveryOpByDefault) {
+    SlowOpProfiler profiler;
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(profiler.shouldSample());
+    }
+}
+
+}  // namespace
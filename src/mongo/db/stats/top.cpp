@@ -66,7 +66,11 @@ Top::CollectionData::CollectionData(const CollectionData& older, const Collectio
       insert(older.insert, newer.insert),
       update(older.update, newer.update),
       remove(older.remove, newer.remove),
-      commands(older.commands, newer.commands) {}
+      commands(older.commands, newer.commands) {
+    for (int i = 0; i < kNumLatencyTypes; i++) {
+        latencies[i] = LatencyHistogram(older.latencies[i], newer.latencies[i]);
+    }
+}
 
 // static
 Top& Top::get(ServiceContext* service) {
@@ -132,6 +136,11 @@ void Top::_record(CollectionData& c, int op, int lockType, long long micros, boo
         default:
             log() << "unknown op in Top::record: " << op << endl;
     }
+
+    const OperationLatencyType latencyType = latencyTypeForOp(op, command);
+    if (latencyType != kNumLatencyTypes) {
+        c.latencies[latencyType].record(micros);
+    }
 }
 
 void Top::collectionDropped(StringData ns) {
@@ -145,12 +154,14 @@ void Top::cloneMap(Top::UsageMap& out) const {
     out = _usage;
 }
 
-void Top::append(BSONObjBuilder& b) {
+void Top::append(BSONObjBuilder& b, bool includeHistograms) {
     stdx::lock_guard<SimpleMutex> lk(_lock);
-    _appendToUsageMap(b, _usage);
+    _appendToUsageMap(b, _usage, includeHistograms);
 }
 
-void Top::_appendToUsageMap(BSONObjBuilder& b, const UsageMap& map) const {
+void Top::_appendToUsageMap(BSONObjBuilder& b,
+                            const UsageMap& map,
+                            bool includeHistograms) const {
     // pull all the names into a vector so we can sort them for the user
 
     vector<string> names;
@@ -177,6 +188,17 @@ void Top::_appendToUsageMap(BSONObjBuilder& b, const UsageMap& map) const {
         _appendStatsEntry(b, "remove", coll.remove);
         _appendStatsEntry(b, "commands", coll.commands);
 
+        {
+            BSONObjBuilder latencies(bb.subobjStart("latencies"));
+            for (int i = 0; i < kNumLatencyTypes; i++) {
+                const OperationLatencyType type = static_cast<OperationLatencyType>(i);
+                BSONObjBuilder histogram(latencies.subobjStart(latencyTypeName(type)));
+                coll.latencies[type].append(&histogram, includeHistograms);
+                histogram.done();
+            }
+            latencies.done();
+        }
+
         bb.done();
     }
 }
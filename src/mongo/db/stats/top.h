@@ -31,6 +31,7 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include "mongo/db/stats/latency_histogram.h"
 #include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/string_map.h"
 
@@ -77,18 +78,21 @@ public:
         UsageData update;
         UsageData remove;
         UsageData commands;
+
+        // Latencies by the kind of operation, indexed by OperationLatencyType
+        LatencyHistogram latencies[kNumLatencyTypes];
     };
 
     typedef StringMap<CollectionData> UsageMap;
 
 public:
     void record(StringData ns, int op, int lockType, long long micros, bool command);
-    void append(BSONObjBuilder& b);
+    void append(BSONObjBuilder& b, bool includeHistograms = false);
     void cloneMap(UsageMap& out) const;
     void collectionDropped(StringData ns);
 
 private:
-    void _appendToUsageMap(BSONObjBuilder& b, const UsageMap& map) const;
+    void _appendToUsageMap(BSONObjBuilder& b, const UsageMap& map, bool includeHistograms) const;
     void _appendStatsEntry(BSONObjBuilder& b, const char* statsName, const UsageData& map) const;
     void _record(CollectionData& c, int op, int lockType, long long micros, bool command);
 
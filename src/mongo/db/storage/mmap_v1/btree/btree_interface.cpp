@@ -33,6 +33,7 @@
 
 #include "mongo/db/operation_context.h"
 #include "mongo/db/storage/mmap_v1/btree/btree_logic.h"
+#include "mongo/db/storage/mmap_v1/readahead.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_base.h"
 #include "mongo/stdx/memory.h"
 
@@ -68,7 +69,9 @@ public:
                        RecordStore* recordStore,
                        SavedCursorRegistry* cursorRegistry,
                        const Ordering& ordering,
-                       const string& indexName) {
+                       const string& indexName,
+                       const ExtentManager* extentManager)
+        : _extentManager(extentManager) {
         _btree.reset(new BtreeLogic<OnDiskFormat>(
             headManager, recordStore, cursorRegistry, ordering, indexName));
     }
@@ -125,8 +128,15 @@ public:
 
     class Cursor final : public SortedDataInterface::Cursor {
     public:
-        Cursor(OperationContext* txn, const BtreeLogic<OnDiskFormat>* btree, bool forward)
-            : _txn(txn), _btree(btree), _direction(forward ? 1 : -1), _ofs(0) {}
+        Cursor(OperationContext* txn,
+               const BtreeLogic<OnDiskFormat>* btree,
+               const ExtentManager* extentManager,
+               bool forward)
+            : _txn(txn),
+              _btree(btree),
+              _direction(forward ? 1 : -1),
+              _ofs(0),
+              _readahead(extentManager) {}
 
         boost::optional<IndexKeyEntry> next(RequestedInfo parts) override {
             if (isEOF())
@@ -136,6 +146,7 @@ public:
                 _lastMoveWasRestore = false;
             } else {
                 _btree->advance(_txn, &_bucket, &_ofs, _direction);
+                _readahead.access(_bucket);
             }
 
             if (atEndPoint())
@@ -188,6 +199,7 @@ public:
                 _ofs = 0;
                 _btree->customLocate(_txn, &_bucket, &_ofs, seekPoint, _direction);
             }
+            _readahead.access(_bucket);
 
             _lastMoveWasRestore = false;
 
@@ -282,6 +294,8 @@ public:
 
         void locate(const BSONObj& key, const RecordId& loc) {
             _btree->locate(_txn, key, DiskLoc::fromRecordId(loc), _direction, &_ofs, &_bucket);
+            _readahead.reset();
+            _readahead.access(_bucket);
             if (atOrPastEndPointAfterSeeking())
                 markEOF();
         }
@@ -322,6 +336,9 @@ public:
         DiskLoc _bucket;
         int _ofs;
 
+        // Only helps when buckets are laid out in key order, as a bulk build leaves them.
+        Readahead _readahead;
+
         struct EndState {
             BSONObj key;
             bool inclusive;
@@ -342,7 +359,7 @@ public:
 
     virtual std::unique_ptr<SortedDataInterface::Cursor> newCursor(OperationContext* txn,
                                                                    bool isForward = true) const {
-        return stdx::make_unique<Cursor>(txn, _btree.get(), isForward);
+        return stdx::make_unique<Cursor>(txn, _btree.get(), _extentManager, isForward);
     }
 
     virtual Status initAsEmpty(OperationContext* txn) {
@@ -351,6 +368,7 @@ public:
 
 private:
     unique_ptr<BtreeLogic<OnDiskFormat>> _btree;
+    const ExtentManager* const _extentManager;  // not owned, may be NULL
 };
 }  // namespace
 
@@ -359,14 +377,15 @@ SortedDataInterface* getMMAPV1Interface(HeadManager* headManager,
                                         SavedCursorRegistry* cursorRegistry,
                                         const Ordering& ordering,
                                         const string& indexName,
-                                        int version) {
+                                        int version,
+                                        const ExtentManager* extentManager) {
     if (0 == version) {
         return new BtreeInterfaceImpl<BtreeLayoutV0>(
-            headManager, recordStore, cursorRegistry, ordering, indexName);
+            headManager, recordStore, cursorRegistry, ordering, indexName, extentManager);
     } else {
         invariant(1 == version);
         return new BtreeInterfaceImpl<BtreeLayoutV1>(
-            headManager, recordStore, cursorRegistry, ordering, indexName);
+            headManager, recordStore, cursorRegistry, ordering, indexName, extentManager);
     }
 }
 
@@ -39,6 +39,7 @@
 #pragma once
 
 namespace mongo {
+class ExtentManager;
 class SavedCursorRegistry;
 
 SortedDataInterface* getMMAPV1Interface(HeadManager* headManager,
@@ -46,5 +47,6 @@ SortedDataInterface* getMMAPV1Interface(HeadManager* headManager,
                                         SavedCursorRegistry* cursorRegistry,
                                         const Ordering& ordering,
                                         const std::string& indexName,
-                                        int version);
+                                        int version,
+                                        const ExtentManager* extentManager = NULL);
 }  // namespace mongo
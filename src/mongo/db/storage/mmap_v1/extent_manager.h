@@ -176,5 +176,12 @@ public:
      * Caller takes owernship of CacheHint
      */
     virtual CacheHint* cacheHint(const DiskLoc& extentLoc, const HintType& hint) = 0;
+
+    /**
+     * Tell the system that the 'length' bytes starting at 'loc' will be read soon, so it can
+     * start reading them in. Does not wait for the read. Any part of the range past the end of
+     * the file is ignored.
+     */
+    virtual void prefetch(const DiskLoc& loc, int length) const = 0;
 };
 }
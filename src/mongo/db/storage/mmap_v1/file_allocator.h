@@ -67,6 +67,18 @@ public:
 
     void waitUntilFinished() const;
 
+    /**
+     * Drops the queued allocations of files whose names start with 'prefix', and waits for
+     * such a file if it is being allocated right now. Allocations of other files carry on.
+     */
+    void dropPendingWithPrefix(const std::string& prefix);
+
+    /**
+     * Returns how long allocating a file of 'size' bytes is expected to take, based on how fast
+     * recent files were allocated, or 0 if no file has been allocated yet.
+     */
+    double estimateSecondsToAllocate(long size) const;
+
     static void ensureLength(int fd, long size);
 
     /** @return the singleton */
@@ -101,6 +113,10 @@ private:
 
     bool _failed;
 
+    // Moving average of allocation throughput, 0 until the first file is allocated. Guarded by
+    // _pendingMutex.
+    double _bytesPerSecond;
+
     static FileAllocator* _instance;
 };
 
@@ -59,6 +59,12 @@ private:
     unsigned _len;
 };
 
+/**
+ * Asks the OS to start reading [p, p + len) of a mapped file into memory, without waiting for
+ * it, so that a later access doesn't fault. p need not be page aligned.
+ */
+void prefetchRange(const void* p, size_t len);
+
 // lock order: lock dbMutex before this if you lock both
 class LockMongoFilesShared {
     friend class LockMongoFilesExclusive;
@@ -125,6 +125,7 @@ public:
 #if defined(__sun)
 MAdvise::MAdvise(void*, unsigned, Advice) {}
 MAdvise::~MAdvise() {}
+void prefetchRange(const void*, size_t) {}
 #else
 MAdvise::MAdvise(void* p, unsigned len, Advice a) {
     _p = _pageAlign(p);
@@ -148,6 +149,16 @@ MAdvise::MAdvise(void* p, unsigned len, Advice a) {
 MAdvise::~MAdvise() {
     madvise(_p, _len, MADV_NORMAL);
 }
+
+void prefetchRange(const void* p, size_t len) {
+    void* start = _pageAlign(const_cast<void*>(p));
+    len += reinterpret_cast<size_t>(p) - reinterpret_cast<size_t>(start);
+
+    // This is only a hint, so a failure just means the data will be faulted in as usual.
+    if (madvise(start, len, MADV_WILLNEED)) {
+        LOG(1) << "madvise(MADV_WILLNEED) failed: " << errnoWithDescription();
+    }
+}
 #endif
 
 void* MemoryMappedFile::map(const char* filename, unsigned long long& length, int options) {
@@ -724,7 +724,8 @@ IndexAccessMethod* MMAPV1DatabaseCatalogEntry::getIndex(OperationContext* txn,
                            &rs->savedCursors,
                            entry->ordering(),
                            entry->descriptor()->indexNamespace(),
-                           entry->descriptor()->version()));
+                           entry->descriptor()->version(),
+                           &_extentManager));
 
     if (IndexNames::HASHED == type)
         return new HashAccessMethod(entry, btree.release());
@@ -295,6 +295,8 @@ Status MMAPV1Engine::dropDatabase(OperationContext* txn, StringData db) {
     if (!status.isOK())
         return status;
 
+    // This also drops the database's files still queued for preallocation, which would
+    // otherwise be recreated after the delete.
     _deleteDataFiles(db.toString());
 
     return Status::OK();
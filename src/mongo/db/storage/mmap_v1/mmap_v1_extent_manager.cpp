@@ -37,6 +37,7 @@
 #include "mongo/base/counter.h"
 #include "mongo/db/audit.h"
 #include "mongo/db/client.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/mmap_v1/dur.h"
 #include "mongo/db/storage/mmap_v1/data_file.h"
@@ -48,6 +49,8 @@
 #include "mongo/db/storage/mmap_v1/mmap_v1_options.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/mmap_v1/file_allocator.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/file.h"
@@ -68,6 +71,18 @@ static const int kNeedsFetchFailFreq = 2;
 static Counter64 needsFetchFailCounter;
 MONGO_FP_DECLARE(recordNeedsFetchFail);
 
+// Pages requested ahead of time by readahead, and pages a reader found likely not to be in
+// memory when it got to them.
+static Counter64 prefetchedPagesCounter;
+static ServerStatusMetricField<Counter64> displayPrefetchedPages(
+    "storage.readahead.prefetchedPages", &prefetchedPagesCounter);
+static Counter64 faultedPagesCounter;
+static ServerStatusMetricField<Counter64> displayFaultedPages("storage.readahead.faultedPages",
+                                                              &faultedPagesCounter);
+
+// Upper bound on how many files past the last one in use a database keeps preallocated.
+MONGO_EXPORT_SERVER_PARAMETER(mmapv1MaxPreallocatedFiles, int, 3);
+
 // Used to make sure the compiler doesn't get too smart on us when we're
 // trying to touch records.
 volatile int __record_touch_dummy = 1;
@@ -112,7 +127,9 @@ MmapV1ExtentManager::MmapV1ExtentManager(StringData dbname, StringData path, boo
     : _dbname(dbname.toString()),
       _path(path.toString()),
       _directoryPerDB(directoryPerDB),
-      _rid(RESOURCE_METADATA, dbname) {
+      _rid(RESOURCE_METADATA, dbname),
+      _secondsPerFile(0),
+      _addedAFile(false) {
     StorageEngine* engine = getGlobalServiceContext()->getGlobalStorageEngine();
     invariant(engine->isMmapV1());
     MMAPV1Engine* mmapEngine = static_cast<MMAPV1Engine*>(engine);
@@ -247,18 +264,43 @@ DataFile* MmapV1ExtentManager::_addAFile(OperationContext* txn,
         _files.push_back(allocFile.release());
     }
 
+    if (_addedAFile) {
+        const double seconds = _sinceFileAdded.micros() / 1000000.0;
+        _secondsPerFile =
+            _secondsPerFile == 0 ? seconds : 0.75 * _secondsPerFile + 0.25 * seconds;
+    }
+    _addedAFile = true;
+    _sinceFileAdded.reset();
+
     // Preallocate is asynchronous
     if (preallocateNextFile) {
-        unique_ptr<DataFile> nextFile(new DataFile(allocFileId + 1));
-        const string nextFileName = _fileName(allocFileId + 1).string();
+        const int lookahead =
+            _preallocationLookahead(_files[allocFileId]->getHeader()->fileLength);
+        for (int i = 1; i <= lookahead && allocFileId + i < DiskLoc::MaxFiles; i++) {
+            unique_ptr<DataFile> nextFile(new DataFile(allocFileId + i));
+            const string nextFileName = _fileName(allocFileId + i).string();
 
-        nextFile->open(txn, nextFileName.c_str(), minSize, false);
+            nextFile->open(txn, nextFileName.c_str(), minSize, true);
+        }
     }
 
     // Returns the last file added
     return _files[allocFileId];
 }
 
+int MmapV1ExtentManager::_preallocationLookahead(long nextFileSize) const {
+    const int maxLookahead = std::max(1, mmapv1MaxPreallocatedFiles);
+    const double secondsToAllocate =
+        FileAllocator::get()->estimateSecondsToAllocate(nextFileSize);
+    if (_secondsPerFile == 0 || secondsToAllocate == 0)
+        return 1;
+
+    // Allocating a file takes secondsToAllocate, and the database needs one every
+    // _secondsPerFile, so that many requests have to be in flight for a writer never to wait.
+    const double needed = 1 + secondsToAllocate / _secondsPerFile;
+    return needed >= maxLookahead ? maxLookahead : static_cast<int>(needed);
+}
+
 int MmapV1ExtentManager::numFiles() const {
     return _files.size();
 }
@@ -305,6 +347,7 @@ std::unique_ptr<RecordFetcher> MmapV1ExtentManager::recordNeedsFetch(const DiskL
     }
 
     if (!_recordAccessTracker->checkAccessedAndMark(record)) {
+        faultedPagesCounter.increment();
         return stdx::make_unique<MmapV1RecordFetcher>(record);
     }
 
@@ -388,7 +431,8 @@ DiskLoc MmapV1ExtentManager::_createExtent(OperationContext* txn, int size, bool
     // no space in an existing file
     // allocate files until we either get one big enough or hit maxSize
     for (int i = 0; i < 8; i++) {
-        DataFile* f = _addAFile(txn, size, false);
+        // Files past the quota could never be used, so don't allocate them ahead of time.
+        DataFile* f = _addAFile(txn, size, !enforceQuota);
 
         if (f->getHeader()->unusedLength >= size) {
             return _createExtentInFile(txn, numFiles() - 1, f, size, enforceQuota);
@@ -632,6 +676,19 @@ ExtentManager::CacheHint* MmapV1ExtentManager::cacheHint(const DiskLoc& extentLo
     return new CacheHintMadvise(reinterpret_cast<void*>(e), e->length, MAdvise::Sequential);
 }
 
+void MmapV1ExtentManager::prefetch(const DiskLoc& loc, int length) const {
+    loc.assertOk();
+    const DataFile* df = _getOpenFile(loc.a());
+
+    const int fileLength = df->getHeader()->fileLength;
+    if (loc.getOfs() >= fileLength)
+        return;
+    length = std::min(length, fileLength - loc.getOfs());
+
+    prefetchRange(df->p() + loc.getOfs(), length);
+    prefetchedPagesCounter.increment((length + g_minOSPageSizeBytes - 1) / g_minOSPageSizeBytes);
+}
+
 MmapV1ExtentManager::FilesArray::~FilesArray() {
     for (int i = 0; i < size(); i++) {
         delete _files[i];
@@ -42,6 +42,7 @@
 #include "mongo/db/storage/mmap_v1/record_access_tracker.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/mutex.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -152,6 +153,8 @@ public:
 
     virtual CacheHint* cacheHint(const DiskLoc& extentLoc, const HintType& hint);
 
+    virtual void prefetch(const DiskLoc& loc, int length) const;
+
 private:
     /**
      * will return NULL if nothing suitable in free list
@@ -164,6 +167,12 @@ private:
 
     DataFile* _addAFile(OperationContext* txn, int sizeNeeded, bool preallocateNextFile);
 
+    /**
+     * How many files past the one just added to preallocate, so that the allocator stays ahead
+     * of the rate this database is growing at.
+     */
+    int _preallocationLookahead(long nextFileSize) const;
+
 
     /**
      * Shared record retrieval logic used by the public recordForV1() and likelyInPhysicalMem()
@@ -195,6 +204,12 @@ private:
     // engine is valid. Not owned here.
     RecordAccessTracker* _recordAccessTracker;
 
+    // Moving average of the time between files being added, 0 until two have been added. Only
+    // changed by _addAFile, which runs under the _rid lock.
+    double _secondsPerFile;
+    bool _addedAFile;
+    Timer _sinceFileAdded;
+
     /**
      * Simple wrapper around an array object to allow append-only modification of the array,
      * as well as concurrent read-accesses. This class has a minimal interface to keep
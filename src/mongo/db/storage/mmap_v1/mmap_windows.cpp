@@ -75,6 +75,9 @@ stdx::mutex mapViewMutex;
 MAdvise::MAdvise(void*, unsigned, Advice) {}
 MAdvise::~MAdvise() {}
 
+// PrefetchVirtualMemory is only available from Windows 8 and Server 2012 on.
+void prefetchRange(const void*, size_t) {}
+
 const unsigned long long memoryMappedFileLocationFloor = 256LL * 1024LL * 1024LL * 1024LL;
 static unsigned long long _nextMemoryMappedFileLocation = memoryMappedFileLocationFloor;
 
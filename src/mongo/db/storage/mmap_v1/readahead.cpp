@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/readahead.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/mmap_v1/extent_manager.h"
+
+namespace mongo {
+
+// 0 turns readahead off.
+MONGO_EXPORT_SERVER_PARAMETER(mmapv1ReadaheadMaxKB, int, 2048);
+
+const int Readahead::kMaxGap;
+const int Readahead::kMinSequential;
+const int Readahead::kMinWindow;
+
+Readahead::Readahead(const ExtentManager* em) : _em(em) {
+    reset();
+}
+
+void Readahead::reset() {
+    _restart(DiskLoc());
+}
+
+void Readahead::_restart(const DiskLoc& loc) {
+    _last = loc;
+    _direction = 0;
+    _sequential = loc.isNull() ? 0 : 1;
+    _window = kMinWindow;
+    _edge = -1;
+}
+
+void Readahead::access(const DiskLoc& loc) {
+    const int maxWindow = std::min(mmapv1ReadaheadMaxKB, 512 * 1024) * 1024;
+    if (!_em || maxWindow <= 0 || loc.isNull())
+        return;
+
+    if (_last.isNull() || loc.a() != _last.a()) {
+        _restart(loc);
+        return;
+    }
+
+    // Readers may report the same location several times, e.g. each key in a btree bucket.
+    const int delta = loc.getOfs() - _last.getOfs();
+    if (delta == 0)
+        return;
+
+    const int direction = delta > 0 ? 1 : -1;
+    if (std::abs(delta) > kMaxGap || (_direction != 0 && direction != _direction)) {
+        _restart(loc);
+        return;
+    }
+
+    _last = loc;
+    _direction = direction;
+    if (++_sequential < kMinSequential)
+        return;
+
+    _window = std::min(_window, maxWindow);
+
+    // Prefetch the next window once the scan is within half a window of the end of the last
+    // one, so the read has time to finish before the scan gets there.
+    const int ofs = loc.getOfs();
+    const int remaining = _edge == -1 ? 0 : (_direction == 1 ? _edge - ofs : ofs - _edge);
+    if (_edge != -1 && remaining >= _window / 2)
+        return;
+
+    int start;
+    int end;
+    if (_direction == 1) {
+        start = _edge == -1 ? ofs : std::max(ofs, _edge);
+        end = static_cast<int>(std::min(static_cast<long long>(ofs) + _window,
+                                        static_cast<long long>(std::numeric_limits<int>::max())));
+        _edge = end;
+    } else {
+        start = std::max(0, ofs - _window);
+        end = _edge == -1 ? ofs : std::min(ofs, _edge);
+        _edge = start;
+    }
+
+    if (end > start)
+        _em->prefetch(DiskLoc(loc.a(), start), end - start);
+
+    _window = std::min(_window * 2, maxWindow);
+}
+
+}  // namespace mongo
@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/storage/mmap_v1/diskloc.h"
+
+namespace mongo {
+
+class ExtentManager;
+
+/**
+ * Readahead policy for one scan over mmapv1 data, such as a collection scan or a btree cursor.
+ *
+ * Without it, a scan faults in its data one page at a time. This watches the locations the scan
+ * visits, and once they have moved steadily in one direction through a file, asks the
+ * ExtentManager to prefetch the range ahead of the scan. The window doubles each time the scan
+ * keeps up with it, up to the mmapv1ReadaheadMaxKB server parameter, and falls back to nothing
+ * as soon as the scan jumps around, as a btree cursor fetching documents does.
+ *
+ * Not thread safe; each scan has its own.
+ */
+class Readahead {
+    MONGO_DISALLOW_COPYING(Readahead);
+
+public:
+    // Locations at most this far apart count as continuing a sequential scan.
+    static const int kMaxGap = 128 * 1024;
+
+    // How many sequential locations in a row are needed before prefetching starts.
+    static const int kMinSequential = 4;
+
+    // The first window prefetched, which then doubles.
+    static const int kMinWindow = 128 * 1024;
+
+    /**
+     * @param em - does NOT take ownership, may be NULL to disable readahead
+     */
+    explicit Readahead(const ExtentManager* em);
+
+    /**
+     * Notes that the scan is about to read the data at 'loc', and prefetches what it is likely
+     * to read next.
+     */
+    void access(const DiskLoc& loc);
+
+    /**
+     * Forgets the scan's history, e.g. when it repositions.
+     */
+    void reset();
+
+    int window() const {
+        return _window;
+    }
+
+private:
+    void _restart(const DiskLoc& loc);
+
+    const ExtentManager* const _em;
+
+    DiskLoc _last;
+    int _direction;   // 1 or -1 once two locations have been seen, 0 before
+    int _sequential;  // number of locations in a row that followed _direction
+    int _window;
+
+    // Offset in _last's file up to which (going in _direction) data has been prefetched, or -1.
+    int _edge;
+};
+
+}  // namespace mongo
@@ -0,0 +1,135 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/readahead.h"
+
+#include "mongo/db/storage/mmap_v1/record_store_v1_test_help.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+const int kStride = 4096;
+
+TEST(Readahead, ForwardScanPrefetchesGrowingWindows) {
+    DummyExtentManager em;
+    Readahead readahead(&em);
+
+    for (int i = 0; i < Readahead::kMinSequential - 1; i++) {
+        readahead.access(DiskLoc(0, 1000 + i * kStride));
+    }
+    ASSERT(em.prefetches.empty());
+
+    int ofs = 1000 + (Readahead::kMinSequential - 1) * kStride;
+    readahead.access(DiskLoc(0, ofs));
+    ASSERT_EQUALS(1U, em.prefetches.size());
+    ASSERT_EQUALS(DiskLoc(0, ofs), em.prefetches[0].first);
+    ASSERT_EQUALS(Readahead::kMinWindow, em.prefetches[0].second);
+    const int edge = ofs + Readahead::kMinWindow;
+
+    // Nothing more until the scan is within half of the next window of the edge.
+    while (edge - (ofs + kStride) >= 2 * Readahead::kMinWindow / 2) {
+        ofs += kStride;
+        readahead.access(DiskLoc(0, ofs));
+    }
+    ASSERT_EQUALS(1U, em.prefetches.size());
+
+    ofs += kStride;
+    readahead.access(DiskLoc(0, ofs));
+    ASSERT_EQUALS(2U, em.prefetches.size());
+    ASSERT_EQUALS(DiskLoc(0, edge), em.prefetches[1].first);
+    ASSERT_EQUALS(ofs + 2 * Readahead::kMinWindow - edge, em.prefetches[1].second);
+    ASSERT_EQUALS(4 * Readahead::kMinWindow, readahead.window());
+}
+
+TEST(Readahead, BackwardScan) {
+    DummyExtentManager em;
+    Readahead readahead(&em);
+
+    const int start = 10 * 1024 * 1024;
+    for (int i = 0; i < Readahead::kMinSequential; i++) {
+        readahead.access(DiskLoc(0, start - i * kStride));
+    }
+    const int ofs = start - (Readahead::kMinSequential - 1) * kStride;
+    ASSERT_EQUALS(1U, em.prefetches.size());
+    ASSERT_EQUALS(DiskLoc(0, ofs - Readahead::kMinWindow), em.prefetches[0].first);
+    ASSERT_EQUALS(Readahead::kMinWindow, em.prefetches[0].second);
+}
+
+TEST(Readahead, RandomAccessDoesNotPrefetch) {
+    DummyExtentManager em;
+    Readahead readahead(&em);
+
+    // Alternating directions and long jumps both break the sequence.
+    const int offsets[] = {1000, 5000, 3000, 7000, 2000000, 2004000, 1000, 9000, 4000};
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        readahead.access(DiskLoc(0, offsets[i]));
+    }
+    ASSERT(em.prefetches.empty());
+    ASSERT_EQUALS(Readahead::kMinWindow, readahead.window());
+}
+
+TEST(Readahead, RepeatedLocationKeepsSequence) {
+    DummyExtentManager em;
+    Readahead readahead(&em);
+
+    for (int i = 0; i < Readahead::kMinSequential; i++) {
+        readahead.access(DiskLoc(0, 1000 + i * kStride));
+        readahead.access(DiskLoc(0, 1000 + i * kStride));
+    }
+    ASSERT_EQUALS(1U, em.prefetches.size());
+}
+
+TEST(Readahead, ChangingFilesRestarts) {
+    DummyExtentManager em;
+    Readahead readahead(&em);
+
+    for (int i = 0; i < Readahead::kMinSequential - 1; i++) {
+        readahead.access(DiskLoc(0, 1000 + i * kStride));
+    }
+    for (int i = 0; i < Readahead::kMinSequential - 1; i++) {
+        readahead.access(DiskLoc(1, 1000 + i * kStride));
+    }
+    ASSERT(em.prefetches.empty());
+
+    readahead.access(DiskLoc(1, 1000 + (Readahead::kMinSequential - 1) * kStride));
+    ASSERT_EQUALS(1U, em.prefetches.size());
+    ASSERT_EQUALS(1, em.prefetches[0].first.a());
+}
+
+TEST(Readahead, NoExtentManager) {
+    Readahead readahead(NULL);
+    for (int i = 0; i < 2 * Readahead::kMinSequential; i++) {
+        readahead.access(DiskLoc(0, 1000 + i * kStride));
+    }
+}
+
+}  // namespace
+}  // namespace mongo
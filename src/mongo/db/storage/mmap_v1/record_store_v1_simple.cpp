@@ -34,6 +34,8 @@
 
 #include "mongo/db/storage/mmap_v1/record_store_v1_simple.h"
 
+#include <algorithm>
+
 #include "mongo/base/counter.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/client.h"
@@ -44,6 +46,7 @@
 #include "mongo/db/storage/mmap_v1/record.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_simple_iterator.h"
+#include "mongo/platform/bits.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/log.h"
 #include "mongo/util/progress_meter.h"
@@ -75,13 +78,212 @@ SimpleRecordStoreV1::SimpleRecordStoreV1(OperationContext* txn,
                                          RecordStoreV1MetaData* details,
                                          ExtentManager* em,
                                          bool isSystemIndexes)
-    : RecordStoreV1Base(ns, details, em, isSystemIndexes) {
+    : RecordStoreV1Base(ns, details, em, isSystemIndexes),
+      _freeMapValid(false),
+      _freeMapInvalidatorRegistered(false),
+      _nonEmptyBuckets(0),
+      _nextBucketToTrack(0),
+      _numCoalesced(0) {
     invariant(!details->isCapped());
     _normalCollection = NamespaceString::normal(ns);
 }
 
 SimpleRecordStoreV1::~SimpleRecordStoreV1() {}
 
+namespace {
+// Each change to the deleted lists copies this many untracked records into the free map, from
+// the bucket being changed and from one other bucket, until the map mirrors all the lists.
+const int kFreeRecordsToTrackPerChange = 2;
+
+// Beyond this, deleted records are only put on the lists on disk, not tracked, so the free map
+// can't grow without bound.
+const size_t kMaxTrackedFreeRecords = 1000 * 1000;
+}
+
+/**
+ * The deleted lists on disk are restored when a unit of work rolls back, so the free map has
+ * to be rebuilt. One is registered per unit of work.
+ */
+class SimpleRecordStoreV1::FreeMapInvalidator : public RecoveryUnit::Change {
+public:
+    explicit FreeMapInvalidator(SimpleRecordStoreV1* rs) : _rs(rs) {}
+
+    virtual void commit() {
+        _rs->_freeMapInvalidatorRegistered = false;
+    }
+
+    virtual void rollback() {
+        _rs->_freeMapInvalidatorRegistered = false;
+        _rs->_resetFreeMap();
+    }
+
+private:
+    SimpleRecordStoreV1* const _rs;
+};
+
+/**
+ * Undoes a change to the extent being emptied by compactOnline().
+ */
+class SimpleRecordStoreV1::DrainingExtentRestorer : public RecoveryUnit::Change {
+public:
+    DrainingExtentRestorer(SimpleRecordStoreV1* rs, const DiskLoc& oldExtent)
+        : _rs(rs), _oldExtent(oldExtent) {}
+
+    virtual void commit() {}
+
+    virtual void rollback() {
+        _rs->_drainingExtent = _oldExtent;
+    }
+
+private:
+    SimpleRecordStoreV1* const _rs;
+    const DiskLoc _oldExtent;
+};
+
+void SimpleRecordStoreV1::_resetFreeMap() {
+    _freeMapValid = false;
+    _freeRecords.clear();
+    _trackedFreeLengths.clear();
+}
+
+void SimpleRecordStoreV1::_prepareFreeMap(OperationContext* txn) {
+    if (!_freeMapInvalidatorRegistered) {
+        txn->recoveryUnit()->registerChange(new FreeMapInvalidator(this));
+        _freeMapInvalidatorRegistered = true;
+    }
+
+    if (_freeMapValid)
+        return;
+
+    _freeRecords.clear();
+    _trackedFreeLengths.clear();
+    _nonEmptyBuckets = 0;
+    for (int b = 0; b < Buckets; b++) {
+        _firstTrackedFreeRecord[b] = DiskLoc();
+        _lastTrackedFreeRecord[b] = DiskLoc();
+        _untrackedFreeRecord[b] = _details->deletedListEntry(b);
+        _trackedFreeBytes[b] = 0;
+        _trackedFreeCount[b] = 0;
+        if (!_untrackedFreeRecord[b].isNull())
+            _nonEmptyBuckets |= 1u << b;
+    }
+    _freeMapValid = true;
+}
+
+void SimpleRecordStoreV1::_trackFreeRecords(int b, int count) {
+    for (int i = 0; i < count; i++) {
+        const DiskLoc loc = _untrackedFreeRecord[b];
+        if (loc.isNull())
+            return;
+
+        if (_freeRecords.count(loc)) {
+            // A cycle in the list. Leave the rest alone, as the code before the free map did.
+            warning() << "deleted record " << loc << " found twice in deleted list " << b
+                      << " of " << _ns;
+            _untrackedFreeRecord[b] = DiskLoc();
+            return;
+        }
+
+        const DeletedRecord* d = drec(loc);
+        FreeRecord& record = _freeRecords[loc];
+        record.bucket = b;
+        record.lengthWithHeaders = d->lengthWithHeaders();
+        record.extentOfs = d->extentOfs();
+        record.prev = _lastTrackedFreeRecord[b];
+        record.next = DiskLoc();
+
+        if (_lastTrackedFreeRecord[b].isNull()) {
+            _firstTrackedFreeRecord[b] = loc;
+        } else {
+            _freeRecords[_lastTrackedFreeRecord[b]].next = loc;
+        }
+        _lastTrackedFreeRecord[b] = loc;
+        _trackedFreeBytes[b] += record.lengthWithHeaders;
+        _trackedFreeCount[b]++;
+        _trackedFreeLengths[record.lengthWithHeaders]++;
+
+        _untrackedFreeRecord[b] = d->nextDeleted();
+    }
+}
+
+void SimpleRecordStoreV1::_pushFreeRecord(OperationContext* txn, const DiskLoc& loc) {
+    DeletedRecord* d = drec(loc);
+    const int b = bucket(d->lengthWithHeaders());
+    _nonEmptyBuckets |= 1u << b;
+
+    if (_freeRecords.size() >= kMaxTrackedFreeRecords) {
+        // Put it on disk only, as the first of the untracked records, after the tracked ones.
+        const DiskLoc last = _lastTrackedFreeRecord[b];
+        const DiskLoc next =
+            last.isNull() ? _details->deletedListEntry(b) : drec(last)->nextDeleted();
+        *txn->recoveryUnit()->writing(&d->nextDeleted()) = next;
+        if (last.isNull()) {
+            _details->setDeletedListEntry(txn, b, loc);
+        } else {
+            *txn->recoveryUnit()->writing(&drec(last)->nextDeleted()) = loc;
+        }
+        _untrackedFreeRecord[b] = loc;
+        return;
+    }
+
+    const DiskLoc oldHead = _firstTrackedFreeRecord[b].isNull() ? _untrackedFreeRecord[b]
+                                                                : _firstTrackedFreeRecord[b];
+    *txn->recoveryUnit()->writing(&d->nextDeleted()) = oldHead;
+    _details->setDeletedListEntry(txn, b, loc);
+
+    FreeRecord& record = _freeRecords[loc];
+    record.bucket = b;
+    record.lengthWithHeaders = d->lengthWithHeaders();
+    record.extentOfs = d->extentOfs();
+    record.prev = DiskLoc();
+    record.next = _firstTrackedFreeRecord[b];
+
+    if (_firstTrackedFreeRecord[b].isNull()) {
+        _lastTrackedFreeRecord[b] = loc;
+    } else {
+        _freeRecords[_firstTrackedFreeRecord[b]].prev = loc;
+    }
+    _firstTrackedFreeRecord[b] = loc;
+    _trackedFreeBytes[b] += record.lengthWithHeaders;
+    _trackedFreeCount[b]++;
+    _trackedFreeLengths[record.lengthWithHeaders]++;
+}
+
+void SimpleRecordStoreV1::_unlinkFreeRecord(OperationContext* txn, const DiskLoc& loc) {
+    std::map<DiskLoc, FreeRecord>::iterator it = _freeRecords.find(loc);
+    invariant(it != _freeRecords.end());
+    const FreeRecord record = it->second;
+    const int b = record.bucket;
+
+    // The last tracked record is followed on disk by the untracked ones.
+    const DiskLoc nextOnDisk = record.next.isNull() ? _untrackedFreeRecord[b] : record.next;
+    if (record.prev.isNull()) {
+        _details->setDeletedListEntry(txn, b, nextOnDisk);
+    } else {
+        *txn->recoveryUnit()->writing(&drec(record.prev)->nextDeleted()) = nextOnDisk;
+    }
+
+    if (record.prev.isNull()) {
+        _firstTrackedFreeRecord[b] = record.next;
+    } else {
+        _freeRecords[record.prev].next = record.next;
+    }
+    if (record.next.isNull()) {
+        _lastTrackedFreeRecord[b] = record.prev;
+    } else {
+        _freeRecords[record.next].prev = record.prev;
+    }
+    _freeRecords.erase(it);
+    _trackedFreeBytes[b] -= record.lengthWithHeaders;
+    _trackedFreeCount[b]--;
+    std::map<int, int>::iterator length = _trackedFreeLengths.find(record.lengthWithHeaders);
+    if (--length->second == 0)
+        _trackedFreeLengths.erase(length);
+
+    if (_firstTrackedFreeRecord[b].isNull() && _untrackedFreeRecord[b].isNull())
+        _nonEmptyBuckets &= ~(1u << b);
+}
+
 DiskLoc SimpleRecordStoreV1::_allocFromExistingExtents(OperationContext* txn, int lenToAllocRaw) {
     // Slowly drain the deletedListLegacyGrabBag by popping one record off and putting it in the
     // correct deleted list each time we try to allocate a new record. This ensures we won't
@@ -100,16 +302,25 @@ DiskLoc SimpleRecordStoreV1::_allocFromExistingExtents(OperationContext* txn, in
     const int lenToAlloc = (lenToAllocRaw + (4 - 1)) & ~(4 - 1);
 
     freelistAllocs.increment();
+    _prepareFreeMap(txn);
     DiskLoc loc;
     DeletedRecord* dr = NULL;
     {
-        int myBucket;
-        for (myBucket = bucket(lenToAlloc); myBucket < Buckets; myBucket++) {
-            // Only look at the first entry in each bucket. This works because we are either
-            // quantizing or allocating fixed-size blocks.
-            const DiskLoc head = _details->deletedListEntry(myBucket);
-            if (head.isNull())
+        // Only look at the first entry in each non-empty bucket. This works because we are
+        // either quantizing or allocating fixed-size blocks.
+        unsigned int candidates = _nonEmptyBuckets & ~((1u << bucket(lenToAlloc)) - 1);
+        while (candidates) {
+            const int myBucket = countTrailingZeros64(candidates);
+            candidates &= candidates - 1;
+
+            if (_firstTrackedFreeRecord[myBucket].isNull())
+                _trackFreeRecords(myBucket, 1);
+            const DiskLoc head = _firstTrackedFreeRecord[myBucket];
+            if (head.isNull()) {
+                // _trackFreeRecords() gave up on a list with a cycle before tracking anything.
+                _nonEmptyBuckets &= ~(1u << myBucket);
                 continue;
+            }
             DeletedRecord* const candidate = drec(head);
             if (candidate->lengthWithHeaders() >= lenToAlloc) {
                 loc = head;
@@ -122,7 +333,7 @@ DiskLoc SimpleRecordStoreV1::_allocFromExistingExtents(OperationContext* txn, in
             return DiskLoc();  // no space
 
         // Unlink ourself from the deleted list
-        _details->setDeletedListEntry(txn, myBucket, dr->nextDeleted());
+        _unlinkFreeRecord(txn, loc);
         *txn->recoveryUnit()->writing(&dr->nextDeleted()) = DiskLoc().setInvalid();  // defensive
     }
 
@@ -219,6 +430,8 @@ Status SimpleRecordStoreV1::truncate(OperationContext* txn) {
     *txn->recoveryUnit()->writing(&firstExt->firstRecord) = DiskLoc();
     *txn->recoveryUnit()->writing(&firstExt->lastRecord) = DiskLoc();
     _details->orphanDeletedList(txn);
+    _resetFreeMap();
+    _setDrainingExtent(txn, DiskLoc());
     addDeletedRec(txn, _findFirstSpot(txn, firstExtLoc, firstExt));
 
     // Make stats reflect that there are now no documents in this record store.
@@ -228,11 +441,90 @@ Status SimpleRecordStoreV1::truncate(OperationContext* txn) {
 }
 
 void SimpleRecordStoreV1::addDeletedRec(OperationContext* txn, const DiskLoc& dloc) {
-    DeletedRecord* d = drec(dloc);
+    if (_isInDrainingExtent(dloc)) {
+        // Left out so that compactOnline() doesn't move records back into this extent.
+        return;
+    }
+
+    _prepareFreeMap(txn);
 
-    int b = bucket(d->lengthWithHeaders());
-    *txn->recoveryUnit()->writing(&d->nextDeleted()) = _details->deletedListEntry(b);
-    _details->setDeletedListEntry(txn, b, dloc);
+    DiskLoc loc = dloc;
+    const int extentOfs = drec(dloc)->extentOfs();
+    int length = drec(dloc)->lengthWithHeaders();
+
+    // Coalesce with tracked deleted records right after and right before this one in the same
+    // extent, so that space freed in pieces can be reused for larger records.
+    std::map<DiskLoc, FreeRecord>::iterator it =
+        _freeRecords.find(DiskLoc(loc.a(), loc.getOfs() + length));
+    if (it != _freeRecords.end() && it->second.extentOfs == extentOfs) {
+        length += it->second.lengthWithHeaders;
+        _unlinkFreeRecord(txn, it->first);
+        _numCoalesced++;
+    }
+
+    it = _freeRecords.lower_bound(loc);
+    if (it != _freeRecords.begin()) {
+        --it;
+        if (it->first.a() == loc.a() &&
+            it->first.getOfs() + it->second.lengthWithHeaders == loc.getOfs() &&
+            it->second.extentOfs == extentOfs) {
+            loc = it->first;
+            length += it->second.lengthWithHeaders;
+            _unlinkFreeRecord(txn, loc);
+            _numCoalesced++;
+        }
+    }
+
+    if (length != drec(loc)->lengthWithHeaders())
+        txn->recoveryUnit()->writingInt(drec(loc)->lengthWithHeaders()) = length;
+    _pushFreeRecord(txn, loc);
+
+    // Keep copying the deleted lists into the free map, so more records can be coalesced.
+    if (_freeRecords.size() < kMaxTrackedFreeRecords) {
+        _trackFreeRecords(bucket(length), kFreeRecordsToTrackPerChange);
+        _trackFreeRecords(_nextBucketToTrack, kFreeRecordsToTrackPerChange);
+        _nextBucketToTrack = (_nextBucketToTrack + 1) % Buckets;
+    }
+}
+
+void SimpleRecordStoreV1::appendCustomStats(OperationContext* txn,
+                                            BSONObjBuilder* result,
+                                            double scale) const {
+    RecordStoreV1Base::appendCustomStats(txn, result, scale);
+
+    // Describes the deleted records the free map knows about. Until every list is tracked
+    // these only cover part of the free space.
+    BSONObjBuilder freeSpace(result->subobjStart("freeSpace"));
+    long long totalBytes = 0;
+    long long totalCount = 0;
+    const int largest = _trackedFreeLengths.empty() ? 0 : _trackedFreeLengths.rbegin()->first;
+    bool complete = _freeMapValid;
+    BSONArrayBuilder bucketsBuilder(freeSpace.subarrayStart("buckets"));
+    for (int b = 0; _freeMapValid && b < Buckets; b++) {
+        if (!_untrackedFreeRecord[b].isNull())
+            complete = false;
+        if (_trackedFreeCount[b] == 0)
+            continue;
+
+        totalBytes += _trackedFreeBytes[b];
+        totalCount += _trackedFreeCount[b];
+
+        BSONObjBuilder bucketBuilder(bucketsBuilder.subobjStart());
+        bucketBuilder.append("minSize", b == 0 ? 0 : bucketSizes[b - 1]);
+        bucketBuilder.appendNumber("count", _trackedFreeCount[b]);
+        bucketBuilder.appendNumber("size", static_cast<long long>(_trackedFreeBytes[b] / scale));
+    }
+    bucketsBuilder.doneFast();
+
+    freeSpace.appendBool("complete", complete);
+    freeSpace.appendNumber("count", totalCount);
+    freeSpace.appendNumber("size", static_cast<long long>(totalBytes / scale));
+    freeSpace.appendNumber("largest", static_cast<long long>(largest / scale));
+    // How much of the free space is unusable for a record as large as the largest free one.
+    freeSpace.append("fragmentation",
+                     totalBytes == 0 ? 0.0 : 1.0 - static_cast<double>(largest) / totalBytes);
+    freeSpace.appendNumber("coalesced", _numCoalesced);
+    freeSpace.doneFast();
 }
 
 std::unique_ptr<RecordCursor> SimpleRecordStoreV1::getCursor(OperationContext* txn,
@@ -447,6 +739,8 @@ Status SimpleRecordStoreV1::compact(OperationContext* txn,
         // failure mode as no data will be lost.
         log() << "compact orphan deleted lists" << endl;
         _details->orphanDeletedList(txn);
+        _resetFreeMap();
+        _setDrainingExtent(txn, DiskLoc());
 
         // Start over from scratch with our extent sizing and growth
         _details->setLastExtentSize(txn, 0);
@@ -480,4 +774,175 @@ Status SimpleRecordStoreV1::compact(OperationContext* txn,
 
     return Status::OK();
 }
+
+void SimpleRecordStoreV1::_setDrainingExtent(OperationContext* txn, const DiskLoc& extLoc) {
+    txn->recoveryUnit()->registerChange(new DrainingExtentRestorer(this, _drainingExtent));
+    _drainingExtent = extLoc;
+}
+
+bool SimpleRecordStoreV1::_isInDrainingExtent(const DiskLoc& loc) const {
+    return !_drainingExtent.isNull() && loc.a() == _drainingExtent.a() &&
+        drec(loc)->extentOfs() == _drainingExtent.getOfs();
+}
+
+void SimpleRecordStoreV1::_startDrainingExtent(OperationContext* txn, const DiskLoc& extLoc) {
+    _setDrainingExtent(txn, extLoc);
+
+    // The legacy grab bag isn't searched below, so empty it into the deleted lists first.
+    for (DiskLoc loc = _details->deletedListLegacyGrabBag(); !loc.isNull();
+         loc = _details->deletedListLegacyGrabBag()) {
+        _details->setDeletedListLegacyGrabBag(txn, drec(loc)->nextDeleted());
+        addDeletedRec(txn, loc);
+    }
+
+    // Unlink every deleted record in the extent. This walks the whole of every list once per
+    // extent, and the free map is simply rebuilt afterwards.
+    _resetFreeMap();
+    for (int b = 0; b < Buckets; b++) {
+        DiskLoc prev;
+        DiskLoc loc = _details->deletedListEntry(b);
+        while (!loc.isNull()) {
+            const DiskLoc next = drec(loc)->nextDeleted();
+            if (!_isInDrainingExtent(loc)) {
+                prev = loc;
+            } else if (prev.isNull()) {
+                _details->setDeletedListEntry(txn, b, next);
+            } else {
+                *txn->recoveryUnit()->writing(&drec(prev)->nextDeleted()) = next;
+            }
+            loc = next;
+        }
+    }
+}
+
+void SimpleRecordStoreV1::_stopDrainingExtent(OperationContext* txn) {
+    const DiskLoc extLoc = _drainingExtent;
+    Extent* const ext = _extentManager->getExtent(extLoc);
+    _setDrainingExtent(txn, DiskLoc());
+
+    // An extent holds nothing but records and deleted records, so the free space to put back
+    // is exactly the gaps between the records that are left.
+    std::vector<std::pair<int, int>> records;
+    for (DiskLoc loc = ext->firstRecord; !loc.isNull(); loc = getNextRecordInExtent(txn, loc)) {
+        records.push_back(std::make_pair(loc.getOfs(), recordFor(loc)->lengthWithHeaders()));
+    }
+    records.push_back(std::make_pair(extLoc.getOfs() + ext->length, 0));
+    std::sort(records.begin(), records.end());
+
+    int ofs = extLoc.getOfs() + Extent::HeaderSize();
+    for (size_t i = 0; i < records.size(); i++) {
+        const int gap = records[i].first - ofs;
+        if (gap >= bucketSizes[0]) {
+            const DiskLoc loc(extLoc.a(), ofs);
+            DeletedRecord* d = txn->recoveryUnit()->writing(drec(loc));
+            d->lengthWithHeaders() = gap;
+            d->extentOfs() = extLoc.getOfs();
+            d->nextDeleted().Null();
+            addDeletedRec(txn, loc);
+        }
+        ofs = records[i].first + records[i].second;
+    }
+}
+
+void SimpleRecordStoreV1::_freeDrainingExtent(OperationContext* txn) {
+    const DiskLoc extLoc = _drainingExtent;
+    Extent* const ext = _extentManager->getExtent(extLoc);
+    invariant(ext->firstRecord.isNull());
+    invariant(ext->lastRecord.isNull());
+
+    const DiskLoc prevLoc = ext->xprev;
+    const DiskLoc nextLoc = ext->xnext;
+    if (prevLoc.isNull()) {
+        _details->setFirstExtent(txn, nextLoc);
+    } else {
+        *txn->recoveryUnit()->writing(&_extentManager->getExtent(prevLoc)->xnext) = nextLoc;
+    }
+    if (nextLoc.isNull()) {
+        _details->setLastExtent(txn, prevLoc);
+    } else {
+        *txn->recoveryUnit()->writing(&_extentManager->getExtent(nextLoc)->xprev) = prevLoc;
+    }
+
+    _setDrainingExtent(txn, DiskLoc());
+    _extentManager->freeExtent(txn, extLoc);
+}
+
+Status SimpleRecordStoreV1::compactOnline(OperationContext* txn,
+                                          RecordStoreCompactAdaptor* adaptor,
+                                          UpdateNotifier* notifier,
+                                          int maxRecords,
+                                          CompactStats* stats,
+                                          bool* done) {
+    *done = false;
+
+    if (_drainingExtent.isNull()) {
+        // Records are only moved out of the last extent, and never out of the only one.
+        const DiskLoc lastExtLoc = _details->lastExtent(txn);
+        if (lastExtLoc == _details->firstExtent(txn)) {
+            *done = true;
+            return Status::OK();
+        }
+
+        WriteUnitOfWork wunit(txn);
+        _startDrainingExtent(txn, lastExtLoc);
+        wunit.commit();
+    }
+
+    // New extents may have been added after this one since it was picked, so it is not
+    // necessarily the last one any more.
+    Extent* const ext = _extentManager->getExtent(_drainingExtent);
+    for (int i = 0; i < maxRecords && !ext->lastRecord.isNull(); i++) {
+        WriteUnitOfWork wunit(txn);
+        const DiskLoc oldLoc = ext->lastRecord;
+        MmapV1RecordHeader* const oldRec = recordFor(oldLoc);
+
+        // Padding is recomputed as for a new insert, as compact() does by default.
+        const int lenWHdr =
+            adaptor->dataSize(oldRec->toRecordData()) + MmapV1RecordHeader::HeaderSize;
+        const int lenToAlloc = shouldPadInserts() ? quantizeAllocationSpace(lenWHdr) : lenWHdr;
+        const DiskLoc newLoc = _allocFromExistingExtents(txn, lenToAlloc);
+        if (newLoc.isNull()) {
+            // No room left anywhere else. The caller puts the rest of the extent back.
+            *done = true;
+            return Status::OK();
+        }
+
+        Status status = notifier->recordStoreGoingToMove(
+            txn, oldLoc.toRecordId(), oldRec->data(), oldRec->netLength());
+        if (!status.isOK())
+            return status;
+
+        MmapV1RecordHeader* newRec = recordFor(newLoc);
+        newRec =
+            reinterpret_cast<MmapV1RecordHeader*>(txn->recoveryUnit()->writingPtr(newRec, lenWHdr));
+        memcpy(newRec->data(), oldRec->data(), lenWHdr - MmapV1RecordHeader::HeaderSize);
+        _addRecordToRecListInExtent(txn, newRec, newLoc);
+        _details->incrementStats(txn, newRec->netLength(), 1);
+
+        deleteRecord(txn, oldLoc.toRecordId());
+
+        adaptor->inserted(newRec->toRecordData(), newLoc.toRecordId());
+        wunit.commit();
+        stats->documentsMoved++;
+    }
+
+    if (ext->firstRecord.isNull()) {
+        const int length = ext->length;
+        WriteUnitOfWork wunit(txn);
+        _freeDrainingExtent(txn);
+        wunit.commit();
+        stats->bytesFreed += length;
+    }
+
+    return Status::OK();
+}
+
+void SimpleRecordStoreV1::compactOnlineStop(OperationContext* txn) {
+    if (_drainingExtent.isNull())
+        return;
+
+    WriteUnitOfWork wunit(txn);
+    _stopDrainingExtent(txn);
+    wunit.commit();
+}
 }
@@ -30,6 +30,8 @@
 
 #pragma once
 
+#include <map>
+
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/storage/mmap_v1/diskloc.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_base.h"
@@ -74,6 +76,21 @@ public:
                            const CompactOptions* options,
                            CompactStats* stats);
 
+    virtual bool compactOnlineSupported() const {
+        return true;
+    }
+    virtual Status compactOnline(OperationContext* txn,
+                                 RecordStoreCompactAdaptor* adaptor,
+                                 UpdateNotifier* notifier,
+                                 int maxRecords,
+                                 CompactStats* stats,
+                                 bool* done);
+    virtual void compactOnlineStop(OperationContext* txn);
+
+    virtual void appendCustomStats(OperationContext* txn,
+                                   BSONObjBuilder* result,
+                                   double scale) const;
+
 protected:
     virtual bool isCapped() const {
         return false;
@@ -89,8 +106,72 @@ protected:
     virtual void addDeletedRec(OperationContext* txn, const DiskLoc& dloc);
 
 private:
+    /**
+     * An in memory copy of a deleted record in one of the deleted lists. Records in a list are
+     * linked in the same order as on disk.
+     */
+    struct FreeRecord {
+        int bucket;
+        int lengthWithHeaders;
+        int extentOfs;
+        DiskLoc prev;
+        DiskLoc next;
+    };
+
+    class FreeMapInvalidator;
+    class DrainingExtentRestorer;
+
     DiskLoc _allocFromExistingExtents(OperationContext* txn, int lengthWithHeaders);
 
+    /**
+     * Makes sure the free map reflects the deleted lists on disk, and arranges for it to be
+     * rebuilt if the current unit of work rolls back.
+     */
+    void _prepareFreeMap(OperationContext* txn);
+
+    /**
+     * Forgets everything in the free map. It is rebuilt from the deleted lists on next use.
+     */
+    void _resetFreeMap();
+
+    /**
+     * Copies up to 'count' more records of 'bucket' from disk into the free map.
+     */
+    void _trackFreeRecords(int bucket, int count);
+
+    /**
+     * Puts the deleted record at 'loc' at the head of its bucket, on disk and in the free map.
+     */
+    void _pushFreeRecord(OperationContext* txn, const DiskLoc& loc);
+
+    /**
+     * Unlinks the tracked deleted record at 'loc' from its bucket, on disk and in the free map.
+     */
+    void _unlinkFreeRecord(OperationContext* txn, const DiskLoc& loc);
+
+    /**
+     * Changes the extent compactOnline() is emptying, restoring the old one on rollback.
+     */
+    void _setDrainingExtent(OperationContext* txn, const DiskLoc& extLoc);
+
+    bool _isInDrainingExtent(const DiskLoc& loc) const;
+
+    /**
+     * Starts emptying the extent at 'extLoc', taking its free space out of the deleted lists.
+     */
+    void _startDrainingExtent(OperationContext* txn, const DiskLoc& extLoc);
+
+    /**
+     * Gives up on emptying the draining extent, putting its free space back on the deleted
+     * lists.
+     */
+    void _stopDrainingExtent(OperationContext* txn);
+
+    /**
+     * Unlinks the now empty draining extent and returns it to the ExtentManager.
+     */
+    void _freeDrainingExtent(OperationContext* txn);
+
     void _compactExtent(OperationContext* txn,
                         const DiskLoc diskloc,
                         int extentNumber,
@@ -100,6 +181,37 @@ private:
 
     bool _normalCollection;
 
+    // The free map mirrors a prefix of each deleted list on disk so that records can be
+    // unlinked from anywhere in a list, and so that deleted records which are next to each
+    // other in an extent can be found and coalesced. Lists are copied lazily, a few records at
+    // a time, starting from the records found at the heads when the map is built. The part of
+    // a list not copied yet starts at _untrackedFreeRecord.
+    bool _freeMapValid;
+    // Whether the current unit of work has a FreeMapInvalidator registered already.
+    bool _freeMapInvalidatorRegistered;
+    std::map<DiskLoc, FreeRecord> _freeRecords;
+    DiskLoc _firstTrackedFreeRecord[Buckets];
+    DiskLoc _lastTrackedFreeRecord[Buckets];
+    DiskLoc _untrackedFreeRecord[Buckets];
+    long long _trackedFreeBytes[Buckets];
+    int _trackedFreeCount[Buckets];
+    // How many tracked records there are of each length, so the largest is known without
+    // walking the lists.
+    std::map<int, int> _trackedFreeLengths;
+
+    // Bit i is set if bucket i isn't empty, tracked or not.
+    unsigned int _nonEmptyBuckets;
+
+    // The bucket whose untracked records are copied next, besides the one being used.
+    int _nextBucketToTrack;
+
+    long long _numCoalesced;
+
+    // The extent compactOnline() is moving records out of. Space freed in it is left off the
+    // deleted lists so nothing is moved back in, and is put back if the extent isn't freed.
+    // Like compact(), free space in it is leaked if the server stops before that happens.
+    DiskLoc _drainingExtent;
+
     friend class SimpleRecordStoreV1Iterator;
 };
 }
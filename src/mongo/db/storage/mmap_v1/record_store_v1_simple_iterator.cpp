@@ -42,7 +42,10 @@ namespace mongo {
 SimpleRecordStoreV1Iterator::SimpleRecordStoreV1Iterator(OperationContext* txn,
                                                          const SimpleRecordStoreV1* collection,
                                                          bool forward)
-    : _txn(txn), _recordStore(collection), _forward(forward) {
+    : _txn(txn),
+      _recordStore(collection),
+      _forward(forward),
+      _readahead(collection->_extentManager) {
     // Eagerly seek to first Record on creation since it is cheap.
     const ExtentManager* em = _recordStore->_extentManager;
     if (_recordStore->details()->firstExtent(txn).isNull()) {
@@ -74,6 +77,7 @@ SimpleRecordStoreV1Iterator::SimpleRecordStoreV1Iterator(OperationContext* txn,
         // valid e->xprev
         _curr = e->lastRecord;
     }
+    _readahead.access(_curr);
 }
 
 boost::optional<Record> SimpleRecordStoreV1Iterator::next() {
@@ -85,6 +89,7 @@ boost::optional<Record> SimpleRecordStoreV1Iterator::next() {
 }
 
 boost::optional<Record> SimpleRecordStoreV1Iterator::seekExact(const RecordId& id) {
+    _readahead.reset();
     _curr = DiskLoc::fromRecordId(id);
     advance();
     return {{id, _recordStore->RecordStore::dataFor(_txn, id)}};
@@ -98,6 +103,7 @@ void SimpleRecordStoreV1Iterator::advance() {
         } else {
             _curr = _recordStore->getPrevRecord(_txn, _curr);
         }
+        _readahead.access(_curr);
     }
 }
 
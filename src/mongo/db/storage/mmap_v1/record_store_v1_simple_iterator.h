@@ -29,6 +29,7 @@
 #pragma once
 
 #include "mongo/db/storage/mmap_v1/diskloc.h"
+#include "mongo/db/storage/mmap_v1/readahead.h"
 #include "mongo/db/storage/record_store.h"
 
 namespace mongo {
@@ -68,6 +69,7 @@ private:
     DiskLoc _curr;
     const SimpleRecordStoreV1* const _recordStore;
     const bool _forward;
+    Readahead _readahead;
 };
 
 }  // namespace mongo
@@ -30,6 +30,7 @@
 
 #include "mongo/db/storage/mmap_v1/record_store_v1_simple.h"
 
+#include "mongo/db/catalog/collection.h"
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/db/storage/mmap_v1/extent.h"
 #include "mongo/db/storage/mmap_v1/record.h"
@@ -41,6 +42,7 @@ using namespace mongo;
 namespace {
 
 using std::string;
+using std::vector;
 
 TEST(SimpleRecordStoreV1, quantizeAllocationSpaceSimple) {
     ASSERT_EQUALS(RecordStoreV1Base::quantizeAllocationSpace(33), 64);
@@ -399,6 +401,245 @@ TEST(SimpleRecordStoreV1, GrabBagIsPoppedEvenIfUnusable) {
     }
 }
 
+/**
+ * Deleting a record next to deleted records in the same extent merges them into one.
+ */
+TEST(SimpleRecordStoreV1, DeleteCoalescesAdjacentDeletedRecords) {
+    OperationContextNoop txn;
+    DummyExtentManager em;
+    DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData(false, 0);
+    SimpleRecordStoreV1 rs(&txn, "test.foo", md, &em, false);
+
+    {
+        LocAndSize recs[] = {{DiskLoc(0, 1000), 100},
+                             {DiskLoc(0, 1100), 100},
+                             {DiskLoc(0, 1200), 100},
+                             {DiskLoc(0, 1300), 100},
+                             {}};
+        LocAndSize drecs[] = {{}};
+        initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+
+    rs.deleteRecord(&txn, DiskLoc(0, 1100).toRecordId());
+    rs.deleteRecord(&txn, DiskLoc(0, 1000).toRecordId());  // merges with the next one
+    rs.deleteRecord(&txn, DiskLoc(0, 1200).toRecordId());  // merges with the previous one
+
+    {
+        LocAndSize recs[] = {{DiskLoc(0, 1300), 100}, {}};
+        LocAndSize drecs[] = {{DiskLoc(0, 1000), 300}, {}};
+        assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+
+    // The merged space can hold a record none of the pieces could.
+    BsonDocWriter docWriter(docForRecordSize(300), false);
+    StatusWith<RecordId> actualLocation = rs.insertRecord(&txn, &docWriter, false);
+    ASSERT_OK(actualLocation.getStatus());
+    ASSERT_EQUALS(DiskLoc(0, 1000), DiskLoc::fromRecordId(actualLocation.getValue()));
+}
+
+/**
+ * Deleted records in different files are never merged, even if their offsets line up.
+ */
+TEST(SimpleRecordStoreV1, DeleteDoesNotCoalesceAcrossFiles) {
+    OperationContextNoop txn;
+    DummyExtentManager em;
+    DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData(false, 0);
+    SimpleRecordStoreV1 rs(&txn, "test.foo", md, &em, false);
+
+    {
+        LocAndSize recs[] = {{DiskLoc(0, 1000), 100}, {DiskLoc(1, 1100), 100}, {}};
+        LocAndSize drecs[] = {{}};
+        initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+
+    rs.deleteRecord(&txn, DiskLoc(0, 1000).toRecordId());
+    rs.deleteRecord(&txn, DiskLoc(1, 1100).toRecordId());
+
+    {
+        LocAndSize recs[] = {{}};
+        LocAndSize drecs[] = {{DiskLoc(1, 1100), 100}, {DiskLoc(0, 1000), 100}, {}};
+        assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+}
+
+/**
+ * collStats reports the deleted records the record store knows about.
+ */
+TEST(SimpleRecordStoreV1, FreeSpaceStats) {
+    OperationContextNoop txn;
+    DummyExtentManager em;
+    DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData(false, 0);
+    SimpleRecordStoreV1 rs(&txn, "test.foo", md, &em, false);
+
+    {
+        LocAndSize recs[] = {{DiskLoc(0, 1000), 100},
+                             {DiskLoc(0, 1100), 100},
+                             {DiskLoc(0, 1200), 100},
+                             {DiskLoc(0, 1300), 1000},
+                             {}};
+        LocAndSize drecs[] = {{}};
+        initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+
+    rs.deleteRecord(&txn, DiskLoc(0, 1000).toRecordId());
+    rs.deleteRecord(&txn, DiskLoc(0, 1300).toRecordId());
+
+    BSONObjBuilder result;
+    rs.appendCustomStats(&txn, &result, 1);
+    BSONObj freeSpace = result.obj()["freeSpace"].Obj();
+
+    ASSERT_TRUE(freeSpace["complete"].trueValue());
+    ASSERT_EQUALS(2, freeSpace["count"].numberLong());
+    ASSERT_EQUALS(1100, freeSpace["size"].numberLong());
+    ASSERT_EQUALS(1000, freeSpace["largest"].numberLong());
+    ASSERT_APPROX_EQUAL(1.0 - 1000.0 / 1100, freeSpace["fragmentation"].numberDouble(), 1e-9);
+    ASSERT_EQUALS(0, freeSpace["coalesced"].numberLong());
+    ASSERT_EQUALS(2U, freeSpace["buckets"].Obj().nFields());
+
+    // Taking the largest record leaves the next largest.
+    BsonDocWriter docWriter(docForRecordSize(1000), false);
+    StatusWith<RecordId> inserted = rs.insertRecord(&txn, &docWriter, false);
+    ASSERT_OK(inserted.getStatus());
+    ASSERT_EQUALS(DiskLoc(0, 1300).toRecordId(), inserted.getValue());
+    BSONObjBuilder after;
+    rs.appendCustomStats(&txn, &after, 1);
+    ASSERT_EQUALS(100, after.obj()["freeSpace"]["largest"].numberLong());
+}
+
+/**
+ * Records what online compaction moved, as Collection would update its indexes.
+ */
+class RecordingCompactAdaptor : public RecordStoreCompactAdaptor, public UpdateNotifier {
+public:
+    virtual bool isDataValid(const RecordData& recData) {
+        return true;
+    }
+
+    virtual size_t dataSize(const RecordData& recData) {
+        return recData.size();
+    }
+
+    virtual void inserted(const RecordData& recData, const RecordId& newLocation) {
+        inserts.push_back(DiskLoc::fromRecordId(newLocation));
+    }
+
+    virtual Status recordStoreGoingToMove(OperationContext* txn,
+                                          const RecordId& oldLocation,
+                                          const char* oldBuffer,
+                                          size_t oldSize) {
+        moves.push_back(DiskLoc::fromRecordId(oldLocation));
+        return Status::OK();
+    }
+
+    virtual Status recordStoreGoingToUpdateInPlace(OperationContext* txn, const RecordId& loc) {
+        invariant(false);
+    }
+
+    vector<DiskLoc> moves;
+    vector<DiskLoc> inserts;
+};
+
+/**
+ * compactOnline() moves records out of the last extent into free space and frees the extent.
+ */
+TEST(SimpleRecordStoreV1, CompactOnlineFreesLastExtent) {
+    OperationContextNoop txn;
+    DummyExtentManager em;
+    DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData(false, 0);
+    md->setUserFlag(&txn, CollectionOptions::Flag_NoPadding);
+    SimpleRecordStoreV1 rs(&txn, "test.foo", md, &em, false);
+
+    {
+        LocAndSize recs[] = {{DiskLoc(0, 1000), 100},
+                             {DiskLoc(1, 1000), 100},
+                             {DiskLoc(1, 1100), 100},
+                             {}};
+        LocAndSize drecs[] = {{DiskLoc(0, 1100), 1000}, {DiskLoc(1, 1200), 1000}, {}};
+        initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+    const int lastExtentLength = em.getExtent(DiskLoc(1, 0))->length;
+
+    RecordingCompactAdaptor adaptor;
+    CompactStats stats;
+    bool done = true;
+    ASSERT_OK(rs.compactOnline(&txn, &adaptor, &adaptor, 10, &stats, &done));
+    ASSERT_FALSE(done);
+    ASSERT_EQUALS(2, stats.documentsMoved);
+    ASSERT_EQUALS(lastExtentLength, stats.bytesFreed);
+
+    // Records are moved from the end of the extent.
+    ASSERT_EQUALS(2U, adaptor.moves.size());
+    ASSERT_EQUALS(DiskLoc(1, 1100), adaptor.moves[0]);
+    ASSERT_EQUALS(DiskLoc(1, 1000), adaptor.moves[1]);
+    ASSERT_EQUALS(2U, adaptor.inserts.size());
+    ASSERT_EQUALS(DiskLoc(0, 1100), adaptor.inserts[0]);
+    ASSERT_EQUALS(DiskLoc(0, 1200), adaptor.inserts[1]);
+
+    // Nothing is left to move out of the only extent.
+    ASSERT_OK(rs.compactOnline(&txn, &adaptor, &adaptor, 10, &stats, &done));
+    ASSERT_TRUE(done);
+    rs.compactOnlineStop(&txn);
+
+    ASSERT_EQUALS(DiskLoc(0, 0), md->lastExtent(&txn));
+    {
+        LocAndSize recs[] = {
+            {DiskLoc(0, 1000), 100}, {DiskLoc(0, 1100), 100}, {DiskLoc(0, 1200), 100}, {}};
+        LocAndSize drecs[] = {{DiskLoc(0, 1300), 800}, {}};
+        assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+}
+
+/**
+ * If the records in the last extent don't all fit elsewhere, its free space is put back.
+ */
+TEST(SimpleRecordStoreV1, CompactOnlineStopsWhenOutOfRoom) {
+    OperationContextNoop txn;
+    DummyExtentManager em;
+    DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData(false, 0);
+    md->setUserFlag(&txn, CollectionOptions::Flag_NoPadding);
+    SimpleRecordStoreV1 rs(&txn, "test.foo", md, &em, false);
+
+    {
+        LocAndSize recs[] = {{DiskLoc(0, 1000), 100},
+                             {DiskLoc(1, 1000), 100},
+                             {DiskLoc(1, 1100), 100},
+                             {}};
+        LocAndSize drecs[] = {{DiskLoc(0, 1100), 150}, {DiskLoc(1, 1200), 500}, {}};
+        initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+    const int firstOfs = Extent::HeaderSize();
+    const int lastExtentLength = em.getExtent(DiskLoc(1, 0))->length;
+
+    RecordingCompactAdaptor adaptor;
+    CompactStats stats;
+    bool done = false;
+    ASSERT_OK(rs.compactOnline(&txn, &adaptor, &adaptor, 10, &stats, &done));
+    ASSERT_TRUE(done);
+    ASSERT_EQUALS(1, stats.documentsMoved);
+    ASSERT_EQUALS(0, stats.bytesFreed);
+    rs.compactOnlineStop(&txn);
+
+    {
+        LocAndSize recs[] = {
+            {DiskLoc(0, 1000), 100}, {DiskLoc(0, 1100), 100}, {DiskLoc(1, 1000), 100}, {}};
+        // All the space around the remaining record in the last extent is free again.
+        LocAndSize drecs[] = {{DiskLoc(0, 1200), 50},
+                              {DiskLoc(1, firstOfs), 1000 - firstOfs},
+                              {DiskLoc(1, 1100), lastExtentLength - 1100},
+                              {}};
+        assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+
+    // Once compaction stops, deleted records in the extent are merged and reused as usual.
+    rs.deleteRecord(&txn, DiskLoc(1, 1000).toRecordId());
+    {
+        LocAndSize recs[] = {{DiskLoc(0, 1000), 100}, {DiskLoc(0, 1100), 100}, {}};
+        LocAndSize drecs[] = {
+            {DiskLoc(0, 1200), 50}, {DiskLoc(1, firstOfs), lastExtentLength - firstOfs}, {}};
+        assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
+    }
+}
+
 // -----------------
 
 TEST(SimpleRecordStoreV1, FullSimple1) {
@@ -295,6 +295,10 @@ DummyExtentManager::CacheHint* DummyExtentManager::cacheHint(const DiskLoc& exte
     return new CacheHint();
 }
 
+void DummyExtentManager::prefetch(const DiskLoc& loc, int length) const {
+    prefetches.push_back(std::make_pair(loc, length));
+}
+
 namespace {
 void accumulateExtentSizeRequirements(const LocAndSize* las, std::map<int, size_t>* sizes) {
     if (!las)
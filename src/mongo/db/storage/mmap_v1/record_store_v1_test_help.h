@@ -141,6 +141,13 @@ public:
 
     virtual CacheHint* cacheHint(const DiskLoc& extentLoc, const HintType& hint);
 
+    /**
+     * Only records the request, in prefetches.
+     */
+    virtual void prefetch(const DiskLoc& loc, int length) const;
+
+    mutable std::vector<std::pair<DiskLoc, int>> prefetches;
+
 protected:
     struct ExtentInfo {
         char* data;
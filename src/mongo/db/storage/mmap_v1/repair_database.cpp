@@ -81,7 +81,8 @@ void _applyOpToDataFiles(const string& database,
 
 void _deleteDataFiles(const std::string& database) {
     if (storageGlobalParams.directoryperdb) {
-        FileAllocator::get()->waitUntilFinished();
+        FileAllocator::get()->dropPendingWithPrefix(
+            (Path(storageGlobalParams.dbpath) / database / (database + ".")).string());
         MONGO_ASSERT_ON_EXCEPTION_WITH_MSG(
             boost::filesystem::remove_all(boost::filesystem::path(storageGlobalParams.dbpath) /
                                           database),
@@ -202,13 +203,13 @@ void _applyOpToDataFiles(const string& database,
                          FileOp& fo,
                          bool afterAllocator,
                          const string& path) {
-    if (afterAllocator)
-        FileAllocator::get()->waitUntilFinished();
     string c = database;
     c += '.';
     boost::filesystem::path p(path);
     if (storageGlobalParams.directoryperdb)
         p /= database;
+    if (afterAllocator)
+        FileAllocator::get()->dropPendingWithPrefix((p / c).string());
     boost::filesystem::path q;
     q = p / (c + "ns");
     bool ok = false;
@@ -460,6 +460,43 @@ public:
         invariant(false);
     }
 
+    /**
+     * Does this RecordStore support compactOnline()?
+     *
+     * Only called if compactSupported() returns true.
+     */
+    virtual bool compactOnlineSupported() const {
+        return false;
+    }
+
+    /**
+     * Moves up to 'maxRecords' records from the end of the RecordStore into free space it
+     * already has, and gives back any storage that is left empty. Unlike compact(), this does
+     * a little work at a time so the caller can release its locks between calls.
+     *
+     * Each move is reported to 'notifier' before the old record is removed, and to
+     * 'adaptor->inserted()' after the new one is written, in the same unit of work.
+     * Sets '*done' once no more records can be moved without allocating storage.
+     *
+     * Only called if compactOnlineSupported() returns true. The caller must call
+     * compactOnlineStop() when it stops calling this, whether or not it was done.
+     */
+    virtual Status compactOnline(OperationContext* txn,
+                                 RecordStoreCompactAdaptor* adaptor,
+                                 UpdateNotifier* notifier,
+                                 int maxRecords,
+                                 CompactStats* stats,
+                                 bool* done) {
+        invariant(false);
+    }
+
+    /**
+     * Gives up anything compactOnline() set aside between calls.
+     */
+    virtual void compactOnlineStop(OperationContext* txn) {
+        invariant(false);
+    }
+
     /**
      * @param full - does more checks
      * @param scanData - scans each document
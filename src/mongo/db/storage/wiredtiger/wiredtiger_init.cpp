@@ -33,6 +33,7 @@
 
 #include "mongo/base/init.h"
 #include "mongo/db/catalog/collection_options.h"
+#include "mongo/db/client.h"
 #include "mongo/db/service_context_d.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/jsobj.h"
@@ -45,14 +46,37 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_index.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_parameters.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_server_status.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/util/background.h"
+#include "mongo/util/exit.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
 
 namespace {
+/**
+ * Periodically lets WiredTigerRecoveryUnit adjust the number of concurrent transactions.
+ */
+class WiredTigerTicketTuningThread : public BackgroundJob {
+public:
+    WiredTigerTicketTuningThread() : BackgroundJob(true /* deleteSelf */) {}
+
+    virtual std::string name() const {
+        return "WiredTigerTicketTuner";
+    }
+
+    virtual void run() {
+        Client::initThread(name().c_str());
+        while (!inShutdown()) {
+            sleepmillis(1000);
+            WiredTigerRecoveryUnit::tuneTickets();
+        }
+    }
+};
+
 class WiredTigerFactory : public StorageEngine::Factory {
 public:
     virtual ~WiredTigerFactory() {}
@@ -68,6 +92,7 @@ public:
         // Intentionally leaked.
         new WiredTigerServerStatusSection(kv);
         new WiredTigerEngineRuntimeConfigParameter(kv);
+        (new WiredTigerTicketTuningThread())->go();
 
         KVStorageEngineOptions options;
         options.directoryPerDB = params.directoryperdb;
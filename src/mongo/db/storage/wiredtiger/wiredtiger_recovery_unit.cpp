@@ -37,6 +37,7 @@
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_ticket_tuner.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
@@ -270,34 +271,95 @@ private:
     TicketHolder* _holder;
 };
 
-TicketHolder openWriteTransaction(128);
+// Transactions are admitted from two queues, so that operations which have already been
+// running for a while, like big scans yielding between batches, can't crowd out short ones.
+enum TicketQueue { kInteractiveQueue = 0, kLongRunningQueue = 1 };
+
+std::vector<TicketHolder::QueueOptions> ticketQueues() {
+    return {{"interactive", 4}, {"longRunning", 1}};
+}
+
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerLongRunningTransactionMillis, int, 100);
+
+TicketHolder openWriteTransaction(128, ticketQueues());
 TicketServerParameter openWriteTransactionParam(&openWriteTransaction,
                                                 "wiredTigerConcurrentWriteTransactions");
 
-TicketHolder openReadTransaction(128);
+TicketHolder openReadTransaction(128, ticketQueues());
 TicketServerParameter openReadTransactionParam(&openReadTransaction,
                                                "wiredTigerConcurrentReadTransactions");
+
+WiredTigerTicketTuner openWriteTransactionTuner(&openWriteTransaction);
+WiredTigerTicketTuner openReadTransactionTuner(&openReadTransaction);
+
+// When enabled, the ticket counts above are adjusted continuously within these bounds.
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveTransactions, bool, false);
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveTransactionsMin, int, 16);
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveTransactionsMax, int, 1024);
+
+void appendTicketStats(const TicketHolder& holder, BSONObjBuilder* b) {
+    b->append("out", holder.used());
+    b->append("available", holder.available());
+    b->append("totalTickets", holder.outof());
+
+    BSONObjBuilder queuesBuilder(b->subobjStart("queues"));
+    const std::vector<TicketHolder::QueueStats> stats = holder.getQueueStats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        const TicketHolder::QueueStats& queue = stats[i];
+        BSONObjBuilder queueBuilder(queuesBuilder.subobjStart(queue.name));
+        queueBuilder.append("weight", queue.weight);
+        queueBuilder.append("waiting", queue.waiting);
+        queueBuilder.append("admitted", queue.admitted);
+        queueBuilder.append("timedOut", queue.timedOut);
+        queueBuilder.append("totalWaitMicros", queue.totalWaitMicros);
+
+        // Only the buckets in use are reported, keyed by their upper bound. The last bucket
+        // has no upper bound.
+        BSONObjBuilder histogramBuilder(queueBuilder.subobjStart("waitMicros"));
+        for (int bucket = 0; bucket < TicketHolder::kNumWaitBuckets; bucket++) {
+            if (queue.waitMicrosHistogram[bucket] == 0)
+                continue;
+            const std::string name = bucket == TicketHolder::kNumWaitBuckets - 1
+                ? std::string("more")
+                : std::string(str::stream() << "lessThan" << (1LL << bucket));
+            histogramBuilder.append(name, queue.waitMicrosHistogram[bucket]);
+        }
+    }
+}
 }
 
 void WiredTigerRecoveryUnit::appendGlobalStats(BSONObjBuilder& b) {
     BSONObjBuilder bb(b.subobjStart("concurrentTransactions"));
+    bb.append("adaptive", wiredTigerAdaptiveTransactions);
     {
         BSONObjBuilder bbb(bb.subobjStart("write"));
-        bbb.append("out", openWriteTransaction.used());
-        bbb.append("available", openWriteTransaction.available());
-        bbb.append("totalTickets", openWriteTransaction.outof());
+        appendTicketStats(openWriteTransaction, &bbb);
+        BSONObjBuilder tunerBuilder(bbb.subobjStart("tuner"));
+        openWriteTransactionTuner.appendStats(&tunerBuilder);
+        tunerBuilder.done();
         bbb.done();
     }
     {
         BSONObjBuilder bbb(bb.subobjStart("read"));
-        bbb.append("out", openReadTransaction.used());
-        bbb.append("available", openReadTransaction.available());
-        bbb.append("totalTickets", openReadTransaction.outof());
+        appendTicketStats(openReadTransaction, &bbb);
+        BSONObjBuilder tunerBuilder(bbb.subobjStart("tuner"));
+        openReadTransactionTuner.appendStats(&tunerBuilder);
+        tunerBuilder.done();
         bbb.done();
     }
     bb.done();
 }
 
+void WiredTigerRecoveryUnit::tuneTickets() {
+    if (!wiredTigerAdaptiveTransactions)
+        return;
+
+    const int minTickets = wiredTigerAdaptiveTransactionsMin;
+    const int maxTickets = std::max(minTickets, int(wiredTigerAdaptiveTransactionsMax));
+    openWriteTransactionTuner.tune(minTickets, maxTickets);
+    openReadTransactionTuner.tune(minTickets, maxTickets);
+}
+
 void WiredTigerRecoveryUnit::_txnClose(bool commit) {
     invariant(_active);
     WT_SESSION* s = _session->getSession();
@@ -312,6 +374,13 @@ void WiredTigerRecoveryUnit::_txnClose(bool commit) {
     }
     _active = false;
     _myTransactionCount++;
+
+    if (_ticket.hasTicket()) {
+        WiredTigerTicketTuner* tuner = _ticket.holder() == &openWriteTransaction
+            ? &openWriteTransactionTuner
+            : &openReadTransactionTuner;
+        tuner->recordCompletion(_timer.micros());
+    }
     _ticket.reset(NULL);
 }
 
@@ -356,7 +425,25 @@ void WiredTigerRecoveryUnit::_getTicket(OperationContext* opCtx) {
 
     TicketHolder* holder = writeLocked ? &openWriteTransaction : &openReadTransaction;
 
-    holder->waitForTicket();
+    // The age of the recovery unit stands in for the age of the operation, since a cursor keeps
+    // its recovery unit across getMores.
+    const int queue = _age.millis() >= wiredTigerLongRunningTransactionMillis
+        ? kLongRunningQueue
+        : kInteractiveQueue;
+
+    Date_t deadline = Date_t::max();
+    if (opCtx) {
+        const uint64_t remainingMicros = opCtx->getRemainingMaxTimeMicros();
+        if (remainingMicros != 0)
+            deadline = Date_t::now() + Microseconds(remainingMicros);
+    }
+
+    if (!holder->waitForTicketUntil(queue, deadline)) {
+        // Out of time, so this throws, unless the operation can't be interrupted here, as inside
+        // a WriteUnitOfWork. The time limit is then of no further use, so wait without it.
+        opCtx->checkForInterrupt();
+        invariant(holder->waitForTicketUntil(queue, Date_t::max()));
+    }
     _ticket.reset(holder);
 }
 
@@ -107,6 +107,12 @@ public:
 
     static void appendGlobalStats(BSONObjBuilder& b);
 
+    /**
+     * Adjusts the number of concurrent transactions allowed, if wiredTigerAdaptiveTransactions
+     * is on. Called periodically.
+     */
+    static void tuneTickets();
+
     /**
      * Prepares this RU to be the basis for a named snapshot.
      *
@@ -131,6 +137,7 @@ private:
     uint64_t _myTransactionCount;
     bool _everStartedWrite;
     Timer _timer;
+    Timer _age;  // started when this recovery unit was created
     bool _currentlySquirreled;
     bool _syncing;
     RecordId _oplogReadTill;
@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_ticket_tuner.h"
+
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+const double WiredTigerTicketTuner::kLatencyTolerance = 2.0;
+const double WiredTigerTicketTuner::kDecreaseFactor = 0.9;
+const double WiredTigerTicketTuner::kBaselineDrift = 0.02;
+
+WiredTigerTicketTuner::WiredTigerTicketTuner(TicketHolder* holder)
+    : _holder(holder),
+      _lastCompleted(0),
+      _lastTotalMicros(0),
+      _lastWaited(0),
+      _latencyMicros(0),
+      _baselineMicros(0),
+      _completedPerSecond(0),
+      _numAdjustments(0) {}
+
+void WiredTigerTicketTuner::recordCompletion(long long micros) {
+    _completed.fetchAndAdd(1);
+    _totalMicros.fetchAndAdd(micros);
+}
+
+bool WiredTigerTicketTuner::_ticketsWereShort() {
+    const std::vector<TicketHolder::QueueStats> stats = _holder->getQueueStats();
+    long long waited = 0;
+    int waiting = 0;
+    for (size_t i = 0; i < stats.size(); i++) {
+        // Bucket 0 counts the admissions that didn't wait at all.
+        waited += stats[i].admitted - stats[i].waitMicrosHistogram[0];
+        waiting += stats[i].waiting;
+    }
+
+    const bool wereShort = waited != _lastWaited || waiting > 0;
+    _lastWaited = waited;
+    return wereShort;
+}
+
+void WiredTigerTicketTuner::tune(int minTickets, int maxTickets) {
+    const int current = _holder->outof();
+    int target = current;
+    const char* reason = NULL;
+
+    // Intervals with too few completions are merged into the next one.
+    const long long completed = _completed.load();
+    const long long intervalCompleted = completed - _lastCompleted;
+    if (intervalCompleted >= kMinSamples) {
+        const long long totalMicros = _totalMicros.load();
+        const long long intervalMicros = totalMicros - _lastTotalMicros;
+        const long long elapsedMicros = std::max(_intervalTimer.micros(), 1LL);
+        const bool ticketsWereShort = _ticketsWereShort();
+        _lastCompleted = completed;
+        _lastTotalMicros = totalMicros;
+        _intervalTimer.reset();
+
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _latencyMicros = intervalMicros / intervalCompleted;
+        _completedPerSecond = intervalCompleted * 1000 * 1000 / elapsedMicros;
+
+        if (_baselineMicros == 0) {
+            _baselineMicros = _latencyMicros;
+        } else {
+            const long long drifted = _baselineMicros * (1 + kBaselineDrift) + 1;
+            _baselineMicros = std::min(_latencyMicros, drifted);
+        }
+
+        if (_latencyMicros > _baselineMicros * kLatencyTolerance) {
+            target = static_cast<int>(current * kDecreaseFactor);
+            reason = "latency";
+        } else if (ticketsWereShort) {
+            target = current + kIncrease;
+            reason = "waiting";
+        }
+    }
+
+    // The bounds apply even without enough samples, so that changing them takes effect.
+    if (target < minTickets) {
+        target = minTickets;
+        reason = "bounds";
+    } else if (target > maxTickets) {
+        target = maxTickets;
+        reason = "bounds";
+    }
+
+    if (target == current)
+        return;
+
+    // Shrinking waits for the tickets being given up to be returned, so no lock is held here.
+    Status status = _holder->resize(target);
+    if (!status.isOK()) {
+        LOG(1) << "not adjusting tickets from " << current << " to " << target << ": " << status;
+        return;
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _numAdjustments++;
+    _history.push_back(Adjustment{Date_t::now(),
+                                  current,
+                                  target,
+                                  reason,
+                                  _latencyMicros,
+                                  _baselineMicros,
+                                  _completedPerSecond});
+    if (_history.size() > kMaxHistory)
+        _history.pop_front();
+}
+
+void WiredTigerTicketTuner::appendStats(BSONObjBuilder* b) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    b->append("latencyMicros", _latencyMicros);
+    b->append("baselineMicros", _baselineMicros);
+    b->append("completedPerSecond", _completedPerSecond);
+    b->append("adjustments", _numAdjustments);
+
+    BSONArrayBuilder historyBuilder(b->subarrayStart("history"));
+    for (size_t i = 0; i < _history.size(); i++) {
+        const Adjustment& adjustment = _history[i];
+        BSONObjBuilder adjustmentBuilder(historyBuilder.subobjStart());
+        adjustmentBuilder.append("when", adjustment.when);
+        adjustmentBuilder.append("from", adjustment.from);
+        adjustmentBuilder.append("to", adjustment.to);
+        adjustmentBuilder.append("reason", adjustment.reason);
+        adjustmentBuilder.append("latencyMicros", adjustment.latencyMicros);
+        adjustmentBuilder.append("baselineMicros", adjustment.baselineMicros);
+        adjustmentBuilder.append("completedPerSecond", adjustment.completedPerSecond);
+    }
+}
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/time_support.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+class TicketHolder;
+
+/**
+ * Adjusts the size of a TicketHolder based on how long tickets are held. It is an AIMD
+ * controller: while latency stays near the best seen recently and callers have to wait for
+ * tickets, the number of tickets grows by a constant. When latency rises well above that
+ * baseline, which happens once more concurrency only adds contention, the number of tickets
+ * shrinks by a fraction.
+ */
+class WiredTigerTicketTuner {
+    MONGO_DISALLOW_COPYING(WiredTigerTicketTuner);
+
+public:
+    // Tuning is skipped for intervals with fewer completions than this, as their latency is
+    // too noisy to act on.
+    static const int kMinSamples = 20;
+
+    // Latency this many times the baseline counts as overloaded.
+    static const double kLatencyTolerance;
+
+    // The fraction of tickets kept on overload, and the number added when tickets are short.
+    static const double kDecreaseFactor;
+    static const int kIncrease = 4;
+
+    // The baseline rises this much each interval it isn't beaten, so a workload that is
+    // permanently slower eventually becomes the new normal.
+    static const double kBaselineDrift;
+
+    // Number of adjustments kept for serverStatus.
+    static const size_t kMaxHistory = 16;
+
+    explicit WiredTigerTicketTuner(TicketHolder* holder);
+
+    /**
+     * Records that a ticket was held for 'micros'.
+     */
+    void recordCompletion(long long micros);
+
+    /**
+     * Looks at the completions since the last call and resizes the holder, keeping it within
+     * [minTickets, maxTickets].
+     */
+    void tune(int minTickets, int maxTickets);
+
+    void appendStats(BSONObjBuilder* b) const;
+
+private:
+    struct Adjustment {
+        Date_t when;
+        int from;
+        int to;
+        const char* reason;
+        long long latencyMicros;
+        long long baselineMicros;
+        long long completedPerSecond;
+    };
+
+    /**
+     * Returns whether any caller had to wait for a ticket since the last call.
+     */
+    bool _ticketsWereShort();
+
+    TicketHolder* const _holder;
+
+    AtomicInt64 _completed;
+    AtomicInt64 _totalMicros;
+
+    // Only used by tune(), which is only called from one thread.
+    long long _lastCompleted;
+    long long _lastTotalMicros;
+    long long _lastWaited;
+    Timer _intervalTimer;
+
+    // Guards the rest, which appendStats() reads.
+    mutable stdx::mutex _mutex;
+    long long _latencyMicros;
+    long long _baselineMicros;
+    long long _completedPerSecond;
+    long long _numAdjustments;
+    std::deque<Adjustment> _history;
+};
+}
@@ -0,0 +1,173 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_ticket_tuner.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+namespace {
+
+void recordCompletions(WiredTigerTicketTuner* tuner, int n, long long micros) {
+    for (int i = 0; i < n; i++) {
+        tuner->recordCompletion(micros);
+    }
+}
+
+BSONObj getStats(const WiredTigerTicketTuner& tuner) {
+    BSONObjBuilder b;
+    tuner.appendStats(&b);
+    return b.obj();
+}
+
+TEST(WiredTigerTicketTunerTest, TooFewSamples) {
+    TicketHolder holder(32);
+    WiredTigerTicketTuner tuner(&holder);
+
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples - 1, 100);
+    tuner.tune(5, 100);
+    ASSERT_EQUALS(32, holder.outof());
+    ASSERT_EQUALS(0, getStats(tuner)["latencyMicros"].numberLong());
+}
+
+TEST(WiredTigerTicketTunerTest, SteadyLatencyWithoutWaitingKeepsTickets) {
+    TicketHolder holder(32);
+    WiredTigerTicketTuner tuner(&holder);
+
+    for (int i = 0; i < 5; i++) {
+        recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 100);
+        tuner.tune(5, 100);
+    }
+    ASSERT_EQUALS(32, holder.outof());
+
+    BSONObj stats = getStats(tuner);
+    ASSERT_EQUALS(100, stats["latencyMicros"].numberLong());
+    ASSERT_EQUALS(100, stats["baselineMicros"].numberLong());
+    ASSERT_EQUALS(0, stats["adjustments"].numberLong());
+}
+
+TEST(WiredTigerTicketTunerTest, GrowsWhileCallersWait) {
+    TicketHolder holder(5);
+    WiredTigerTicketTuner tuner(&holder);
+    for (int i = 0; i < 5; i++) {
+        holder.waitForTicket();
+    }
+
+    stdx::thread waiter([&holder] {
+        holder.waitForTicket();
+        holder.release();
+    });
+    while (holder.getQueueStats()[0].waiting == 0) {
+        sleepmillis(1);
+    }
+
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 100);
+    tuner.tune(5, 100);
+    ASSERT_EQUALS(5 + WiredTigerTicketTuner::kIncrease, holder.outof());
+
+    // The new tickets let the waiter in.
+    waiter.join();
+    for (int i = 0; i < 5; i++) {
+        holder.release();
+    }
+
+    BSONObj stats = getStats(tuner);
+    ASSERT_EQUALS(1, stats["adjustments"].numberLong());
+    BSONObj adjustment = stats["history"].Array()[0].Obj();
+    ASSERT_EQUALS(5, adjustment["from"].numberInt());
+    ASSERT_EQUALS(5 + WiredTigerTicketTuner::kIncrease, adjustment["to"].numberInt());
+    ASSERT_EQUALS("waiting", adjustment["reason"].str());
+
+    // The next interval still sees the waiter being admitted, but after that nobody waited so
+    // there's no reason to grow further.
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 100);
+    tuner.tune(5, 100);
+    const int grown = holder.outof();
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 100);
+    tuner.tune(5, 100);
+    ASSERT_EQUALS(grown, holder.outof());
+}
+
+TEST(WiredTigerTicketTunerTest, ShrinksWhenLatencyRises) {
+    TicketHolder holder(50);
+    WiredTigerTicketTuner tuner(&holder);
+
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 100);
+    tuner.tune(5, 100);
+    ASSERT_EQUALS(50, holder.outof());
+
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 1000);
+    tuner.tune(5, 100);
+    ASSERT_EQUALS(45, holder.outof());
+
+    BSONObj adjustment = getStats(tuner)["history"].Array()[0].Obj();
+    ASSERT_EQUALS("latency", adjustment["reason"].str());
+    ASSERT_EQUALS(1000, adjustment["latencyMicros"].numberLong());
+    ASSERT_LESS_THAN(adjustment["baselineMicros"].numberLong(), 200);
+
+    // Latency that stays high becomes the new baseline, and shrinking stops.
+    for (int i = 0; i < 200; i++) {
+        recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 1000);
+        tuner.tune(5, 100);
+    }
+    const int settled = holder.outof();
+    ASSERT_GREATER_THAN_OR_EQUALS(settled, 5);
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 1000);
+    tuner.tune(5, 100);
+    ASSERT_EQUALS(settled, holder.outof());
+}
+
+TEST(WiredTigerTicketTunerTest, StaysWithinBounds) {
+    TicketHolder holder(50);
+    WiredTigerTicketTuner tuner(&holder);
+
+    tuner.tune(5, 20);
+    ASSERT_EQUALS(20, holder.outof());
+
+    tuner.tune(30, 40);
+    ASSERT_EQUALS(30, holder.outof());
+
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 100);
+    tuner.tune(30, 40);
+    recordCompletions(&tuner, WiredTigerTicketTuner::kMinSamples, 1000);
+    tuner.tune(30, 40);
+    ASSERT_EQUALS(30, holder.outof());
+
+    std::vector<BSONElement> history = getStats(tuner)["history"].Array();
+    ASSERT_EQUALS(2U, history.size());
+    ASSERT_EQUALS("bounds", history[0].Obj()["reason"].str());
+    ASSERT_EQUALS("bounds", history[1].Obj()["reason"].str());
+}
+}  // namespace
+}  // namespace mongo
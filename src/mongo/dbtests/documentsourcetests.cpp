@@ -1018,6 +1018,80 @@ public:
     }
 };
 
+/** A streaming $group outputs each run of equal _id values as soon as the _id changes. */
+class StreamingSortedInput : public Base {
+public:
+    void run() {
+        BSONObj sourceData = fromjson(
+            "{'':[{y:1},{x:null,y:2},{x:1,y:3},{x:1.0,y:4},{x:'a',y:5}]}");
+        intrusive_ptr<DocumentSourceBsonArray> source =
+            DocumentSourceBsonArray::create(sourceData.firstElement().Obj(), ctx());
+        createGroup(fromjson("{_id:'$x',list:{$push:'$y'}}"));
+        DocumentSourceGroup* streamingGroup = dynamic_cast<DocumentSourceGroup*>(group());
+        ASSERT(streamingGroup);
+        streamingGroup->setStreaming(true);
+        group()->setSource(source.get());
+
+        // Groups come out in input order rather than hash order.
+        ASSERT_EQUALS(fromjson("{_id:null,list:[1,2]}"), group()->getNext()->toBson());
+        ASSERT_EQUALS(fromjson("{_id:1,list:[3,4]}"), group()->getNext()->toBson());
+        ASSERT_EQUALS(fromjson("{_id:'a',list:[5]}"), group()->getNext()->toBson());
+        assertExhausted(group());
+    }
+};
+
+/** A streaming $group that meets an array _id hashes the rest of its input. */
+class StreamingArrayIdStopsStreaming : public Base {
+public:
+    void run() {
+        BSONObj sourceData = fromjson(
+            "{'':[{x:0,y:0},{x:1,y:1},{x:1,y:2},{x:[1,2],y:3},{x:1,y:4},{x:2,y:5}]}");
+        intrusive_ptr<DocumentSourceBsonArray> source =
+            DocumentSourceBsonArray::create(sourceData.firstElement().Obj(), ctx());
+        createGroup(fromjson("{_id:'$x',list:{$push:'$y'}}"));
+        DocumentSourceGroup* streamingGroup = dynamic_cast<DocumentSourceGroup*>(group());
+        ASSERT(streamingGroup);
+        streamingGroup->setStreaming(true);
+        group()->setSource(source.get());
+
+        // The group before the array is still streamed, the one being accumulated is not.
+        ASSERT_EQUALS(fromjson("{_id:0,list:[0]}"), group()->getNext()->toBson());
+        BSONObjSet rest;
+        while (boost::optional<Document> next = group()->getNext()) {
+            rest.insert(next->toBson());
+        }
+        BSONObjSet expected;
+        expected.insert(fromjson("{_id:1,list:[1,2,4]}"));
+        expected.insert(fromjson("{_id:[1,2],list:[3]}"));
+        expected.insert(fromjson("{_id:2,list:[5]}"));
+        ASSERT(expected == rest);
+    }
+};
+
+/** Only _id values made of distinct field paths have a sort pattern. */
+class IdSortPattern : public Base {
+public:
+    void run() {
+        ASSERT_EQUALS(BSON("x" << 1), sortPattern("{_id:'$x'}"));
+        ASSERT_EQUALS(BSON("x.y" << 1), sortPattern("{_id:'$x.y'}"));
+        ASSERT_EQUALS(BSON("x" << 1 << "y" << 1), sortPattern("{_id:{a:'$x',b:'$y'}}"));
+        ASSERT_EQUALS(BSON("x" << 1), sortPattern("{_id:'$$ROOT.x'}"));
+        ASSERT_EQUALS(BSONObj(), sortPattern("{_id:'$$ROOT'}"));
+        ASSERT_EQUALS(BSONObj(), sortPattern("{_id:null}"));
+        ASSERT_EQUALS(BSONObj(), sortPattern("{_id:{a:'$x',b:'$x'}}"));
+        ASSERT_EQUALS(BSONObj(), sortPattern("{_id:{a:'$x',b:{$add:['$y',1]}}}"));
+        ASSERT_EQUALS(BSONObj(), sortPattern("{_id:{$add:['$y',1]}}"));
+    }
+
+private:
+    BSONObj sortPattern(const char* spec) {
+        createGroup(fromjson(spec));
+        DocumentSourceGroup* groupStage = dynamic_cast<DocumentSourceGroup*>(group());
+        ASSERT(groupStage);
+        return groupStage->getIdSortPattern();
+    }
+};
+
 }  // namespace DocumentSourceGroup
 
 namespace DocumentSourceProject {
@@ -2040,6 +2114,9 @@ public:
         add<DocumentSourceGroup::Dependencies>();
         add<DocumentSourceGroup::StringConstantIdAndAccumulatorExpressions>();
         add<DocumentSourceGroup::ArrayConstantAccumulatorExpression>();
+        add<DocumentSourceGroup::StreamingSortedInput>();
+        add<DocumentSourceGroup::StreamingArrayIdStopsStreaming>();
+        add<DocumentSourceGroup::IdSortPattern>();
 
         add<DocumentSourceProject::Inclusion>();
         add<DocumentSourceProject::Optimize>();
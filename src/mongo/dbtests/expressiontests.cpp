@@ -32,7 +32,9 @@
 
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/util/timer.h"
 
 namespace ExpressionTests {
 
@@ -4033,6 +4035,229 @@ class Null : public ExpectedResultBase {
 
 }  // namespace AllAnyElements
 
+namespace Compiled {
+
+/**
+ * Parses spec(), compiles it, and checks that the compiled expression produces a result (or
+ * error code) binary equal to the tree's for each document in inputs().
+ */
+class ExpectedResultBase {
+public:
+    virtual ~ExpectedResultBase() {}
+    void run() {
+        BSONObj specObject = BSON("" << spec());
+        VariablesIdGenerator idGenerator;
+        VariablesParseState vps(&idGenerator);
+        intrusive_ptr<mongo::Expression> expression =
+            mongo::Expression::parseOperand(specObject.firstElement(), vps)->optimize();
+        intrusive_ptr<mongo::Expression> compiled = ExpressionCompiled::compile(expression);
+        ASSERT_EQUALS(expectCompiled(),
+                      dynamic_cast<ExpressionCompiled*>(compiled.get()) != NULL);
+
+        // Serialization is delegated to the original tree.
+        ASSERT_EQUALS(expressionToBson(expression), expressionToBson(compiled));
+
+        const BSONArray docs = inputs();
+        BSONForEach(input, docs) {
+            const Document doc = fromBson(input.Obj());
+            int treeCode = 0;
+            int compiledCode = 0;
+            BSONObj treeResult;
+            BSONObj compiledResult;
+            try {
+                treeResult = toBson(expression->evaluate(doc));
+            } catch (const UserException& e) {
+                treeCode = e.getCode();
+            }
+            try {
+                compiledResult = toBson(compiled->evaluate(doc));
+            } catch (const UserException& e) {
+                compiledCode = e.getCode();
+            }
+            ASSERT_EQUALS(treeCode, compiledCode);
+            assertBinaryEqual(treeResult, compiledResult);
+        }
+    }
+
+protected:
+    virtual BSONObj spec() = 0;
+    virtual BSONArray inputs() {
+        return BSON_ARRAY(BSON("a" << 1 << "b" << 2)
+                          << BSON("a" << 5LL << "b" << 2.5)
+                          << BSON("a" << numeric_limits<int>::max() << "b" << 1)
+                          << BSON("a" << Date_t::fromMillisSinceEpoch(1000) << "b" << 7)
+                          << BSON("a" << BSONNULL << "b" << 0)
+                          << BSON("b"
+                                  << "str")
+                          << BSONObj());
+    }
+    virtual bool expectCompiled() {
+        return true;
+    }
+};
+
+class Add : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$add" << BSON_ARRAY("$a"
+                                         << "$b" << 1));
+    }
+};
+
+class AddOverflowsToLong : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$add" << BSON_ARRAY("$a" << numeric_limits<int>::max()));
+    }
+};
+
+/** A null first operand must stop evaluation before the failing second operand is reached. */
+class AddNullSkipsLaterOperands : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$add" << BSON_ARRAY("$a" << BSON("$divide" << BSON_ARRAY(1 << "$b"))));
+    }
+};
+
+class Subtract : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$subtract" << BSON_ARRAY("$a"
+                                              << "$b"));
+    }
+};
+
+class Multiply : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$multiply" << BSON_ARRAY("$a"
+                                              << "$b" << 3));
+    }
+};
+
+class Divide : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$divide" << BSON_ARRAY("$a"
+                                            << "$b"));
+    }
+};
+
+class Compare : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$cmp" << BSON_ARRAY("$a"
+                                         << "$b"));
+    }
+};
+
+class CondAndOr : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$cond" << BSON_ARRAY(
+                        BSON("$or" << BSON_ARRAY(BSON("$gt" << BSON_ARRAY("$a"
+                                                                          << "$b"))
+                                                 << BSON("$and" << BSON_ARRAY("$a"
+                                                                              << BSON("$not"
+                                                                                      << "$b")))))
+                        << "yes"
+                        << "no"));
+    }
+};
+
+class IfNull : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$ifNull" << BSON_ARRAY("$a" << BSON("$add" << BSON_ARRAY("$b" << 1))));
+    }
+};
+
+/** Dotted paths may traverse arrays, so they are evaluated by the tree inside the program. */
+class NestedFieldPath : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$add" << BSON_ARRAY("$a.b" << 1));
+    }
+    BSONArray inputs() {
+        return BSON_ARRAY(BSON("a" << BSON("b" << 2))
+                          << BSON("a" << BSON_ARRAY(BSON("b" << 1) << BSON("b" << 2))));
+    }
+};
+
+/** A single operand $and optimizes to a bool coercion, which has no opcode of its own. */
+class NothingToLower : public ExpectedResultBase {
+    BSONObj spec() {
+        return BSON("$and" << BSON_ARRAY("$a"));
+    }
+    bool expectCompiled() {
+        return false;
+    }
+};
+
+/** Compiling a $project-style ExpressionObject compiles its computed fields in place. */
+class ObjectFields {
+public:
+    void run() {
+        intrusive_ptr<ExpressionObject> object = ExpressionObject::createRoot();
+        object->includePath("a");
+        object->addField(mongo::FieldPath("sum"),
+                         ExpressionCompiled::compile(ExpressionAdd::parse(
+                             BSON("$add" << BSON_ARRAY("$a"
+                                                       << "$b")).firstElement(),
+                             parseState())));
+        ASSERT(ExpressionCompiled::compile(object) == object);
+
+        MutableDocument result;
+        Variables vars(0, fromBson(BSON("_id" << 0 << "a" << 1 << "b" << 2)));
+        object->addToDocument(result, vars.getRoot(), &vars);
+        assertBinaryEqual(BSON("_id" << 0 << "a" << 1 << "sum" << 3), toBson(result.freeze()));
+    }
+
+private:
+    VariablesParseState parseState() {
+        return VariablesParseState(&_idGenerator);
+    }
+    VariablesIdGenerator _idGenerator;
+};
+
+/** Logs the time taken to evaluate a typical $group/$project expression both ways. */
+class EvaluationSpeed {
+public:
+    void run() {
+        BSONObj specObject = BSON(
+            "" << BSON("$cond" << BSON_ARRAY(BSON("$gte" << BSON_ARRAY("$qty" << 100))
+                                             << BSON("$multiply" << BSON_ARRAY("$price"
+                                                                               << "$qty" << 0.9))
+                                             << BSON("$multiply" << BSON_ARRAY("$price"
+                                                                               << "$qty")))));
+        VariablesIdGenerator idGenerator;
+        VariablesParseState vps(&idGenerator);
+        intrusive_ptr<mongo::Expression> expression =
+            mongo::Expression::parseOperand(specObject.firstElement(), vps)->optimize();
+        intrusive_ptr<mongo::Expression> compiled = ExpressionCompiled::compile(expression);
+
+        vector<Document> docs;
+        for (int i = 0; i < 1000; i++) {
+            docs.push_back(fromBson(BSON("price" << (i % 17 + 0.5) << "qty" << (i % 200))));
+        }
+
+        Variables vars(idGenerator.getIdCount());
+        const int iterations = 200;
+        long long treeMicros = time(expression, &vars, docs, iterations);
+        long long compiledMicros = time(compiled, &vars, docs, iterations);
+        mongo::unittest::log() << "expression evaluation over " << iterations * docs.size()
+                               << " documents: tree " << treeMicros << "us, compiled "
+                               << compiledMicros << "us";
+    }
+
+private:
+    static long long time(const intrusive_ptr<mongo::Expression>& expr,
+                          Variables* vars,
+                          const vector<Document>& docs,
+                          int iterations) {
+        Timer t;
+        for (int i = 0; i < iterations; i++) {
+            for (size_t j = 0; j < docs.size(); j++) {
+                vars->setRoot(docs[j]);
+                expr->evaluate(vars);
+            }
+        }
+        return t.micros();
+    }
+};
+
+}  // namespace Compiled
+
 class All : public Suite {
 public:
     All() : Suite("expression") {}
@@ -4335,6 +4560,20 @@ public:
         add<AllAnyElements::TrueViaInt>();
         add<AllAnyElements::FalseViaInt>();
         add<AllAnyElements::Null>();
+
+        add<Compiled::Add>();
+        add<Compiled::AddOverflowsToLong>();
+        add<Compiled::AddNullSkipsLaterOperands>();
+        add<Compiled::Subtract>();
+        add<Compiled::Multiply>();
+        add<Compiled::Divide>();
+        add<Compiled::Compare>();
+        add<Compiled::CondAndOr>();
+        add<Compiled::IfNull>();
+        add<Compiled::NestedFieldPath>();
+        add<Compiled::NothingToLower>();
+        add<Compiled::ObjectFields>();
+        add<Compiled::EvaluationSpeed>();
     }
 };
 
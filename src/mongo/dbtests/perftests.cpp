@@ -49,7 +49,10 @@
 #include <fstream>
 #include <mutex>
 
+#include "mongo/client/scram_sha1_client_cache.h"
+#include "mongo/client/scram_sha1_client_test_utils.h"
 #include "mongo/config.h"
+#include "mongo/crypto/mechanism_scram.h"
 #include "mongo/db/client.h"
 #include "mongo/db/concurrency/lock_state.h"
 #include "mongo/db/db.h"
@@ -71,6 +74,7 @@
 #include "mongo/util/checksum.h"
 #include "mongo/util/fail_point.h"
 #include "mongo/util/log.h"
+#include "mongo/util/password_digest.h"
 #include "mongo/util/timer.h"
 #include "mongo/util/version.h"
 
@@ -523,6 +527,45 @@ public:
     }
 };
 
+/**
+ * Client side SCRAM-SHA-1 handshakes against a simulated server, which is what a mongos or a
+ * driver pays per new connection. Measures handshakes per second.
+ */
+class SCRAMClientHandshake : public NonDurTest {
+public:
+    SCRAMClientHandshake()
+        : _digest(createPasswordDigest("perftest", "pencil")),
+          _creds(scram::generateCredentials(_digest, 10000)) {}
+    string name() {
+        return "SCRAMClientHandshake";
+    }
+    virtual unsigned batchSize() {
+        return 10;
+    }
+    void timed() {
+        ASSERT_OK(runSCRAMSHA1Conversation("perftest", _digest, _creds));
+    }
+
+private:
+    const string _digest;
+    const BSONObj _creds;
+};
+
+/**
+ * As SCRAMClientHandshake, but deriving the client keys every time, as every handshake did
+ * before the client cached them.
+ */
+class SCRAMClientHandshakeNoCache : public SCRAMClientHandshake {
+public:
+    string name() {
+        return "SCRAMClientHandshakeNoCache";
+    }
+    void timed() {
+        getGlobalSCRAMSHA1ClientCache()->clear();
+        SCRAMClientHandshake::timed();
+    }
+};
+
 class KeyTest : public B {
 public:
     KeyV1Owned a, b, c;
@@ -835,6 +878,33 @@ public:
     }
 };
 
+// Global and database intent locks, as taken by every CRUD operation on the same database
+class dblockerIX : public locker_test {
+public:
+    dblockerIX(LockMode m = MODE_IX, LockMode gm = MODE_IX) : locker_test(m, gm) {}
+    virtual string name() {
+        return (str::stream() << "dblocker" << lockMode);
+    }
+
+    virtual void prep() {
+        resId.reset(new ResourceId(RESOURCE_DATABASE, std::string("TestDB")));
+        locker.reset(new MMAPV1LockerImpl());
+    }
+
+    virtual void prepThreaded() {
+        resId.reset(new ResourceId(RESOURCE_DATABASE, std::string("TestDB")));
+        id.reset(new int);
+        lock.lock();
+        lock.unlock();
+        locker.reset(new MMAPV1LockerImpl());
+    }
+};
+
+class dblockerIS : public dblockerIX {
+public:
+    dblockerIS() : dblockerIX(MODE_IS, MODE_IS) {}
+};
+
 class locker_test_uncontested : public locker_test {
 public:
     locker_test_uncontested(LockMode m = MODE_IX, LockMode gm = MODE_IX) : locker_test(m, gm) {}
@@ -1678,6 +1748,8 @@ public:
             add<wlock>();
             add<glockerIX>();
             add<glockerIS>();
+            add<dblockerIX>();
+            add<dblockerIS>();
             add<locker_contestedX>();
             add<locker_uncontestedX>();
             add<locker_contestedS>();
@@ -1700,6 +1772,8 @@ public:
             add<BSONIter>();
             add<BSONGetFields1>();
             add<BSONGetFields2>();
+            add<SCRAMClientHandshake>();
+            add<SCRAMClientHandshakeNoCache>();
             // add< TaskQueueTest >();
             add<InsertDup>();
             add<Insert1>();
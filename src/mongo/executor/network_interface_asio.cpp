@@ -34,28 +34,61 @@
 
 #include <utility>
 
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/latency_histogram_metric.h"
 #include "mongo/stdx/chrono.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/sock.h"
 
 namespace mongo {
 namespace executor {
 
-NetworkInterfaceASIO::NetworkInterfaceASIO()
+namespace {
+const auto kCanceledStatus = Status(ErrorCodes::CallbackCanceled, "Callback canceled");
+
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asioReactorThreads, int, 1);
+
+// How often the reactor is checked for the delay between posting a handler and running it
+const auto kReactorProbeInterval = stdx::chrono::milliseconds(100);
+
+LatencyHistogramMetric reactorLatency("network.asio.reactorLatency");
+}  // namespace
+
+NetworkInterfaceASIO::NetworkInterfaceASIO() : NetworkInterfaceASIO(asioReactorThreads) {}
+
+NetworkInterfaceASIO::NetworkInterfaceASIO(int numReactorThreads)
     : _io_service(),
-      _resolver(_io_service),
+      _numReactorThreads(numReactorThreads),
       _state(State::kReady),
       _isExecutorRunnable(false),
+      _connPoolMaintenanceTimer(_io_service),
+      _reactorProbeTimer(_io_service),
       _numOps(0) {
-    _connPool = stdx::make_unique<ConnectionPool>(kMessagingPortKeepOpen);
+    uassert(28728, "asioReactorThreads must be at least 1", _numReactorThreads >= 1);
 }
 
 std::string NetworkInterfaceASIO::getDiagnosticString() {
+    size_t numIdle = 0;
+    size_t numCheckedOut = 0;
+    size_t numWaiting = 0;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_connPoolMutex);
+        for (const auto& pool : _connPool) {
+            numIdle += pool.second.idle.size();
+            numCheckedOut += pool.second.checkedOut;
+            numWaiting += pool.second.waiters.size();
+        }
+    }
+
     str::stream output;
     output << "NetworkInterfaceASIO";
     output << " inShutdown: " << inShutdown();
     output << " _numOps: " << _numOps.loadRelaxed();
+    output << " reactor threads: " << _numReactorThreads;
+    output << " connections idle: " << numIdle << " in use: " << numCheckedOut
+           << " waiting for one: " << numWaiting;
     return output;
 }
 
@@ -64,17 +97,42 @@ std::string NetworkInterfaceASIO::getHostName() {
 }
 
 void NetworkInterfaceASIO::startup() {
-    _serviceRunner = stdx::thread([this]() {
-        asio::io_service::work work(_io_service);
-        _io_service.run();
-    });
+    _scheduleConnectionPoolMaintenance();
+    _scheduleReactorProbe();
+    for (int i = 0; i < _numReactorThreads; i++) {
+        _serviceRunners.emplace_back([this]() {
+            asio::io_service::work work(_io_service);
+            _io_service.run();
+        });
+    }
     _state.store(State::kRunning);
 }
 
 void NetworkInterfaceASIO::shutdown() {
     _state.store(State::kShutdown);
     _io_service.stop();
-    _serviceRunner.join();
+    for (auto& runner : _serviceRunners) {
+        runner.join();
+    }
+}
+
+void NetworkInterfaceASIO::_scheduleReactorProbe() {
+    _reactorProbeTimer.expires_after(kReactorProbeInterval);
+    _reactorProbeTimer.async_wait([this](std::error_code ec) {
+        if (ec) {
+            return;
+        }
+
+        // The time a freshly posted handler waits to run is how far behind the reactor threads
+        // are.
+        const auto posted = stdx::chrono::steady_clock::now();
+        asio::post(_io_service, [this, posted]() {
+            const auto delay = stdx::chrono::duration_cast<stdx::chrono::microseconds>(
+                stdx::chrono::steady_clock::now() - posted);
+            reactorLatency.record(delay.count());
+            _scheduleReactorProbe();
+        });
+    });
 }
 
 void NetworkInterfaceASIO::waitForWork() {
@@ -118,8 +176,8 @@ Date_t NetworkInterfaceASIO::now() {
 void NetworkInterfaceASIO::startCommand(const TaskExecutor::CallbackHandle& cbHandle,
                                         const RemoteCommandRequest& request,
                                         const RemoteCommandCompletionFn& onFinish) {
-    auto ownedOp =
-        stdx::make_unique<AsyncOp>(cbHandle, request, onFinish, now(), _numOps.fetchAndAdd(1));
+    auto ownedOp = stdx::make_unique<AsyncOp>(
+        &_io_service, cbHandle, request, onFinish, now(), _numOps.fetchAndAdd(1));
 
     AsyncOp* op = ownedOp.get();
 
@@ -128,14 +186,26 @@ void NetworkInterfaceASIO::startCommand(const TaskExecutor::CallbackHandle& cbHa
         _inProgress.emplace(op, std::move(ownedOp));
     }
 
-    asio::post(_io_service, [this, op]() { _asyncRunCommand(op); });
+    op->strand().post([this, op]() { _asyncRunCommand(op); });
 }
 
 void NetworkInterfaceASIO::cancelCommand(const TaskExecutor::CallbackHandle& cbHandle) {
     stdx::lock_guard<stdx::mutex> lk(_inProgressMutex);
     for (auto iter = _inProgress.begin(); iter != _inProgress.end(); ++iter) {
         if (iter->first->cbHandle() == cbHandle) {
-            iter->first->cancel();
+            AsyncOp* op = iter->first;
+            op->cancel();
+
+            // Operations running on a connection notice the cancellation in their next callback,
+            // but those waiting for a connection have no callback to come.
+            bool wasWaiting;
+            {
+                stdx::lock_guard<stdx::mutex> poolLk(_connPoolMutex);
+                wasWaiting = _removeWaiter_inlock(op);
+            }
+            if (wasWaiting) {
+                op->strand().post([this, op]() { _completeOperation(op, kCanceledStatus); });
+            }
             break;
         }
     }
@@ -30,20 +30,25 @@
 
 #include <asio.hpp>
 #include <boost/optional.hpp>
+#include <deque>
+#include <list>
 #include <memory>
 #include <string>
 #include <system_error>
 #include <unordered_map>
+#include <vector>
 
 #include "mongo/base/status.h"
-#include "mongo/client/connection_pool.h"
+#include "mongo/base/status_with.h"
 #include "mongo/client/remote_command_runner.h"
 #include "mongo/executor/network_interface.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/rpc/protocol.h"
 #include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/stdx/thread.h"
+#include "mongo/util/net/hostandport.h"
 #include "mongo/util/net/message.h"
 
 namespace mongo {
@@ -52,10 +57,26 @@ namespace executor {
 /**
  * Implementation of the replication system's network interface using Christopher
  * Kohlhoff's ASIO library instead of existing MongoDB networking primitives.
+ *
+ * Connections are kept in a pool per host. New ones are set up without blocking any thread:
+ * connecting, the isMaster handshake and authentication as the internal user all run on the
+ * io_service. Each host has at most asioMaxConnectionsPerHost connections, operations beyond
+ * that wait for one to be returned, and idle connections are closed after
+ * asioConnectionIdleTimeoutSecs, down to asioMinConnectionsPerHost.
+ *
+ * The io_service may run on several threads. Each operation's handlers go through a strand of
+ * its own, so they never run concurrently, and as an operation has its connection to itself
+ * until it completes, neither do those of a connection.
  */
 class NetworkInterfaceASIO final : public NetworkInterface {
 public:
+    /**
+     * Runs the io_service on asioReactorThreads threads.
+     */
     NetworkInterfaceASIO();
+
+    explicit NetworkInterfaceASIO(int numReactorThreads);
+
     std::string getDiagnosticString() override;
     std::string getHostName() override;
     void startup() override;
@@ -75,6 +96,12 @@ private:
     using ResponseStatus = TaskExecutor::ResponseStatus;
     using NetworkInterface::RemoteCommandCompletionFn;
 
+    /**
+     * Handles the reply to a command run while setting up a connection, or the error which
+     * prevented the reply from being parsed.
+     */
+    using ConnectionCommandHandler = stdx::function<void(const StatusWith<BSONObj>&)>;
+
     enum class State { kReady, kRunning, kShutdown };
 
     /**
@@ -84,15 +111,25 @@ private:
     public:
         AsyncConnection(asio::ip::tcp::socket&& sock, rpc::ProtocolSet serverProtocols);
 
-        AsyncConnection(asio::ip::tcp::socket&& sock,
-                        rpc::ProtocolSet serverProtocols,
-                        boost::optional<ConnectionPool::ConnectionPtr>&& bootstrapConn);
-
         asio::ip::tcp::socket& sock();
 
         rpc::ProtocolSet serverProtocols() const;
         rpc::ProtocolSet clientProtocols() const;
 
+        void setServerProtocols(rpc::ProtocolSet protocols);
+
+        /**
+         * When the connection was last returned to the pool.
+         */
+        Date_t lastUsed() const;
+        void setLastUsed(Date_t now);
+
+        /**
+         * Checks, without blocking, that an idle connection was not closed by the other side
+         * and has no unexpected data waiting to be read.
+         */
+        bool isStillConnected();
+
 // Explicit move construction and assignment to support MSVC
 #if defined(_MSC_VER) && _MSC_VER < 1900
         AsyncConnection(AsyncConnection&&);
@@ -108,12 +145,7 @@ private:
         rpc::ProtocolSet _serverProtocols;
         rpc::ProtocolSet _clientProtocols{rpc::supports::kAll};
 
-        /**
-         * The bootstrap connection we use to run auth. This will eventually go away when we finish
-         * implementing async auth, but for now we need to keep it alive so that the socket it
-         * creates stays open.
-         */
-        boost::optional<ConnectionPool::ConnectionPtr> _bootstrapConn;
+        Date_t _lastUsed;
     };
 
     /**
@@ -121,7 +153,8 @@ private:
      */
     class AsyncOp {
     public:
-        AsyncOp(const TaskExecutor::CallbackHandle& cbHandle,
+        AsyncOp(asio::io_service* service,
+                const TaskExecutor::CallbackHandle& cbHandle,
                 const RemoteCommandRequest& request,
                 const RemoteCommandCompletionFn& onFinish,
                 Date_t now,
@@ -129,6 +162,11 @@ private:
 
         std::string toString() const;
 
+        /**
+         * All of the operation's handlers must be dispatched through its strand.
+         */
+        asio::io_service::strand& strand();
+
         void cancel();
         bool canceled() const;
 
@@ -136,9 +174,46 @@ private:
 
         AsyncConnection* connection();
 
-        void connect(ConnectionPool* const pool, asio::io_service* service, Date_t now);
         void setConnection(AsyncConnection&& conn);
-        bool connected() const;
+        bool hasConnection() const;
+
+        /**
+         * Takes the connection away from the operation, so that it can be returned to the pool.
+         */
+        AsyncConnection releaseConnection();
+
+        /**
+         * The operation was allowed to open a new connection to its target.
+         */
+        void setConnecting();
+
+        /**
+         * The operation's connection is ready for its command, whether it was just opened or
+         * taken from the pool.
+         */
+        void setConnected();
+
+        /**
+         * The whole reply to the operation's command was read, so its connection can be reused.
+         */
+        void setReplyReceived();
+
+        /**
+         * Whether the operation holds one of its target's connection pool slots, for a
+         * connection it is opening or using.
+         */
+        bool checkedOut() const;
+
+        bool canReuseConnection() const;
+
+        /**
+         * Commands run while setting up the connection, such as isMaster and authentication,
+         * use the same messages as the operation's own command, but their replies go to the
+         * given handler rather than completing the operation.
+         */
+        void beginConnectionCommand(Message&& toSend, ConnectionCommandHandler handler);
+        bool inConnectionCommand() const;
+        ConnectionCommandHandler endConnectionCommand();
 
         void finish(const TaskExecutor::ResponseStatus& status);
 
@@ -161,12 +236,14 @@ private:
     private:
         enum class OpState {
             kReady,
-            kConnectionAcquired,
-            kConnectionVerified,
+            kConnecting,
             kConnected,
+            kReplyReceived,
             kCompleted
         };
 
+        asio::io_service::strand _strand;
+
         // Information describing an in-flight command.
         TaskExecutor::CallbackHandle _cbHandle;
         RemoteCommandRequest _request;
@@ -197,9 +274,29 @@ private:
         Message _toRecv;
         MSGHEADER::Value _header;
 
+        ConnectionCommandHandler _connectionCommandHandler;
+
         const int _id;
     };
 
+    /**
+     * The connections to one host, and the operations waiting for one.
+     */
+    struct HostConnectionPool {
+        struct Waiter {
+            AsyncOp* op;
+            Date_t since;
+        };
+
+        // Most recently used first
+        std::list<AsyncConnection> idle;
+
+        // Connections being opened or in use by an operation
+        size_t checkedOut = 0;
+
+        std::deque<Waiter> waiters;
+    };
+
     void _asyncRunCommand(AsyncOp* op);
 
     std::unique_ptr<Message> _messageFromRequest(const RemoteCommandRequest& request,
@@ -207,16 +304,28 @@ private:
 
     void _asyncSendSimpleMessage(AsyncOp* op, const asio::const_buffer& buf);
 
+    // Connection pool
+    void _getConnection(AsyncOp* op);
+    void _releaseConnection(AsyncOp* op);
+    bool _removeWaiter_inlock(AsyncOp* op);
+    void _scheduleConnectionPoolMaintenance();
+    void _maintainConnectionPool();
+
     // Connection
     void _connectASIO(AsyncOp* op);
-    void _connectWithDBClientConnection(AsyncOp* op);
     void _setupSocket(AsyncOp* op, const asio::ip::tcp::resolver::iterator& endpoints);
-    void _authenticate(AsyncOp* op);
     void _sslHandshake(AsyncOp* op);
+    void _runIsMaster(AsyncOp* op);
+    void _authenticate(AsyncOp* op);
+    void _runConnectionCommand(AsyncOp* op,
+                               const std::string& dbname,
+                               const BSONObj& cmdObj,
+                               ConnectionCommandHandler handler);
 
     // Communication state machine
     void _beginCommunication(AsyncOp* op);
     void _completedWriteCallback(AsyncOp* op);
+    void _completedConnectionCommand(AsyncOp* op);
     void _networkErrorCallback(AsyncOp* op, const std::error_code& ec);
 
     void _completeOperation(AsyncOp* op, const TaskExecutor::ResponseStatus& resp);
@@ -227,10 +336,13 @@ private:
 
     void _signalWorkAvailable_inlock();
 
+    // Reactor latency probes
+    void _scheduleReactorProbe();
+
     asio::io_service _io_service;
-    stdx::thread _serviceRunner;
 
-    asio::ip::tcp::resolver _resolver;
+    const int _numReactorThreads;
+    std::vector<stdx::thread> _serviceRunners;
 
     std::atomic<State> _state;
 
@@ -241,7 +353,13 @@ private:
     bool _isExecutorRunnable;
     stdx::condition_variable _isExecutorRunnableCondition;
 
-    std::unique_ptr<ConnectionPool> _connPool;
+    // Must not be acquired before _inProgressMutex
+    stdx::mutex _connPoolMutex;
+    std::unordered_map<HostAndPort, HostConnectionPool> _connPool;
+
+    asio::steady_timer _connPoolMaintenanceTimer;
+
+    asio::steady_timer _reactorProbeTimer;
 
     AtomicUInt64 _numOps;
 };
@@ -32,12 +32,293 @@
 
 #include "mongo/executor/network_interface_asio.h"
 
+#include <memory>
+#include <string>
+
+#include "mongo/bson/util/bson_extract.h"
+#include "mongo/client/sasl_client_authenticate.h"
+#include "mongo/client/sasl_client_session.h"
+#include "mongo/db/auth/authorization_manager.h"
+#include "mongo/db/auth/authorization_manager_global.h"
+#include "mongo/db/auth/internal_user_auth.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/rpc/get_status_from_command_result.h"
+#include "mongo/util/log.h"
+#include "mongo/util/md5.hpp"
+#include "mongo/util/password_digest.h"
+
 namespace mongo {
 namespace executor {
 
+namespace {
+
+using CommandReplyHandler = stdx::function<void(const StatusWith<BSONObj>&)>;
+
+/**
+ * Runs a command on the connection being authenticated.
+ */
+using RunCommandFn =
+    stdx::function<void(const std::string& dbname, const BSONObj& cmdObj, CommandReplyHandler)>;
+
+using AuthCompletionFn = stdx::function<void(const Status&)>;
+
+/**
+ * Takes the next step of a SASL conversation, given the server's last reply, which is what
+ * saslClientAuthenticate() does in a loop.
+ */
+void saslStep(const RunCommandFn& runCommand,
+              const std::shared_ptr<SaslClientSession>& session,
+              const std::string& targetDatabase,
+              const BSONObj& commandPrefix,
+              const BSONObj& input,
+              const AuthCompletionFn& onFinish) {
+    if (session->isDone()) {
+        if (!input[saslCommandDoneFieldName].trueValue()) {
+            return onFinish(Status(ErrorCodes::ProtocolError, "Client finished before server."));
+        }
+        return onFinish(Status::OK());
+    }
+
+    std::string payload;
+    BSONType type;
+    Status status = saslExtractPayload(input, &payload, &type);
+    if (!status.isOK()) {
+        return onFinish(status);
+    }
+
+    std::string responsePayload;
+    status = session->step(payload, &responsePayload);
+    if (!status.isOK()) {
+        return onFinish(status);
+    }
+
+    BSONObjBuilder commandBuilder;
+    commandBuilder.appendElements(commandPrefix);
+    commandBuilder.appendBinData(saslCommandPayloadFieldName,
+                                 int(responsePayload.size()),
+                                 BinDataGeneral,
+                                 responsePayload.c_str());
+    BSONElement conversationId = input[saslCommandConversationIdFieldName];
+    if (!conversationId.eoo()) {
+        commandBuilder.append(conversationId);
+    }
+
+    runCommand(
+        targetDatabase,
+        commandBuilder.obj(),
+        [runCommand, session, targetDatabase, onFinish](const StatusWith<BSONObj>& reply) {
+            if (!reply.isOK()) {
+                return onFinish(reply.getStatus());
+            }
+
+            // Like saslClientAuthenticate(), treat a non-zero code as a failure even with ok: 1,
+            // which is how old servers reported them.
+            const BSONObj& replyObj = reply.getValue();
+            ErrorCodes::Error code =
+                ErrorCodes::fromInt(replyObj[saslCommandCodeFieldName].numberInt());
+            if (!replyObj["ok"].trueValue() || code != ErrorCodes::OK) {
+                if (code == ErrorCodes::OK) {
+                    code = ErrorCodes::UnknownError;
+                }
+                return onFinish(Status(code, replyObj[saslCommandErrmsgFieldName].str()));
+            }
+
+            saslStep(runCommand,
+                     session,
+                     targetDatabase,
+                     BSON(saslContinueCommandName << 1),
+                     replyObj.getOwned(),
+                     onFinish);
+        });
+}
+
+void authenticateSasl(const RunCommandFn& runCommand,
+                      const std::string& hostname,
+                      const std::string& mechanism,
+                      const BSONObj& params,
+                      const AuthCompletionFn& onFinish) {
+    std::string targetDatabase;
+    Status status = bsonExtractStringFieldWithDefault(
+        params, saslCommandUserDBFieldName, saslDefaultDBName, &targetDatabase);
+    if (!status.isOK()) {
+        return onFinish(status);
+    }
+
+    std::shared_ptr<SaslClientSession> session(SaslClientSession::create(mechanism));
+    status = saslConfigureClientSession(session.get(), hostname, targetDatabase, params);
+    if (!status.isOK()) {
+        return onFinish(status);
+    }
+
+    saslStep(runCommand,
+             session,
+             targetDatabase,
+             BSON(saslStartCommandName << 1 << saslCommandMechanismFieldName << mechanism),
+             BSON(saslCommandPayloadFieldName << ""),
+             onFinish);
+}
+
+/**
+ * MONGODB-CR, which servers older than 3.0 expect, and which the internal user falls back to.
+ */
+void authenticateMongoCR(const RunCommandFn& runCommand,
+                         const BSONObj& params,
+                         const AuthCompletionFn& onFinish) {
+    std::string dbname;
+    std::string user;
+    std::string password;
+    bool digestPassword;
+
+    Status status = bsonExtractStringField(params, saslCommandUserDBFieldName, &dbname);
+    if (status.isOK()) {
+        status = bsonExtractStringField(params, saslCommandUserFieldName, &user);
+    }
+    if (status.isOK()) {
+        status = bsonExtractStringField(params, saslCommandPasswordFieldName, &password);
+    }
+    if (status.isOK()) {
+        status = bsonExtractBooleanFieldWithDefault(
+            params, saslCommandDigestPasswordFieldName, true, &digestPassword);
+    }
+    if (!status.isOK()) {
+        return onFinish(status);
+    }
+
+    if (digestPassword) {
+        password = createPasswordDigest(user, password);
+    }
+
+    runCommand(dbname,
+               BSON("getnonce" << 1),
+               [runCommand, dbname, user, password, onFinish](const StatusWith<BSONObj>& reply) {
+                   if (!reply.isOK()) {
+                       return onFinish(reply.getStatus());
+                   }
+
+                   Status status = getStatusFromCommandResult(reply.getValue());
+                   if (!status.isOK()) {
+                       return onFinish(status);
+                   }
+
+                   std::string nonce;
+                   status = bsonExtractStringField(reply.getValue(), "nonce", &nonce);
+                   if (!status.isOK()) {
+                       return onFinish(status);
+                   }
+
+                   BSONObj authCmd =
+                       BSON("authenticate" << 1 << "nonce" << nonce << "user" << user << "key"
+                                           << md5simpledigest(nonce + user + password));
+                   runCommand(dbname, authCmd, [onFinish](const StatusWith<BSONObj>& reply) {
+                       if (!reply.isOK()) {
+                           return onFinish(reply.getStatus());
+                       }
+                       onFinish(getStatusFromCommandResult(reply.getValue()));
+                   });
+               });
+}
+
+void authenticateX509(const RunCommandFn& runCommand,
+                      const BSONObj& params,
+                      const AuthCompletionFn& onFinish) {
+    std::string dbname;
+    std::string user;
+    Status status = bsonExtractStringField(params, saslCommandUserDBFieldName, &dbname);
+    if (status.isOK()) {
+        status = bsonExtractStringField(params, saslCommandUserFieldName, &user);
+    }
+    if (!status.isOK()) {
+        return onFinish(status);
+    }
+
+    runCommand(dbname,
+               BSON("authenticate" << 1 << "mechanism"
+                                   << "MONGODB-X509"
+                                   << "user" << user),
+               [onFinish](const StatusWith<BSONObj>& reply) {
+                   if (!reply.isOK()) {
+                       return onFinish(reply.getStatus());
+                   }
+                   onFinish(getStatusFromCommandResult(reply.getValue()));
+               });
+}
+
+/**
+ * The asynchronous counterpart of DBClientWithCommands::_auth().
+ */
+void authenticate(const RunCommandFn& runCommand,
+                  const std::string& hostname,
+                  const BSONObj& params,
+                  const AuthCompletionFn& onFinish) {
+    std::string mechanism;
+    Status status = bsonExtractStringField(params, saslCommandMechanismFieldName, &mechanism);
+    if (!status.isOK()) {
+        return onFinish(status);
+    }
+
+    if (mechanism == "MONGODB-CR") {
+        authenticateMongoCR(runCommand, params, onFinish);
+    } else if (mechanism == "MONGODB-X509") {
+        authenticateX509(runCommand, params, onFinish);
+    } else {
+        authenticateSasl(runCommand, hostname, mechanism, params, onFinish);
+    }
+}
+
+}  // namespace
+
 void NetworkInterfaceASIO::_authenticate(AsyncOp* op) {
-    // TODO: Implement asynchronous authentication, SERVER-19155
-    asio::post(_io_service, [this, op]() { _beginCommunication(op); });
+    auto authenticated = [this, op]() {
+        op->setConnected();
+        _beginCommunication(op);
+    };
+
+    if (!getGlobalAuthorizationManager()->isAuthEnabled()) {
+        return authenticated();
+    }
+
+    if (!isInternalAuthSet()) {
+        return _completeOperation(
+            op,
+            Status(ErrorCodes::AuthenticationFailed,
+                   "Missing credentials for authenticating as internal user"));
+    }
+
+    RunCommandFn runCommand = [this, op](
+        const std::string& dbname, const BSONObj& cmdObj, CommandReplyHandler handler) {
+        _runConnectionCommand(op, dbname, cmdObj, std::move(handler));
+    };
+
+    const std::string hostname = op->request().target.host();
+    const BSONObj params = getInternalUserAuthParamsWithFallback();
+
+    authenticate(
+        runCommand,
+        hostname,
+        params,
+        [this, op, authenticated, runCommand, hostname, params](const Status& status) {
+            if (status.isOK()) {
+                return authenticated();
+            }
+
+            // Like DBClientWithCommands::auth(), fall back to MONGODB-CR if the server does not
+            // support the preferred mechanism.
+            const BSONObj fallbackParams = getFallbackAuthParams(params);
+            if (fallbackParams.isEmpty() ||
+                (status != ErrorCodes::BadValue && status != ErrorCodes::CommandNotFound)) {
+                return _completeOperation(op, status);
+            }
+
+            authenticate(runCommand,
+                         hostname,
+                         fallbackParams,
+                         [this, op, authenticated](const Status& status) {
+                             if (!status.isOK()) {
+                                 return _completeOperation(op, status);
+                             }
+                             authenticated();
+                         });
+        });
 }
 
 }  // namespace executor
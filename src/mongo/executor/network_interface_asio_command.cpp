@@ -37,6 +37,7 @@
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/rpc/factory.h"
+#include "mongo/rpc/reply_interface.h"
 #include "mongo/rpc/request_builder_interface.h"
 #include "mongo/util/log.h"
 #include "mongo/util/assert_util.h"
@@ -56,8 +57,9 @@ void NetworkInterfaceASIO::_asyncRunCommand(AsyncOp* op) {
         return;
     }
 
-    // _connect...() will continue the state machine.
-    _connectWithDBClientConnection(op);
+    // Either takes a pooled connection and begins communication, or opens a new one, or waits
+    // for one to be returned to the pool.
+    _getConnection(op);
 }
 
 std::unique_ptr<Message> NetworkInterfaceASIO::_messageFromRequest(
@@ -79,10 +81,24 @@ std::unique_ptr<Message> NetworkInterfaceASIO::_messageFromRequest(
     return toSend;
 }
 
+void NetworkInterfaceASIO::_runConnectionCommand(AsyncOp* op,
+                                                 const std::string& dbname,
+                                                 const BSONObj& cmdObj,
+                                                 ConnectionCommandHandler handler) {
+    // The server's protocols are not known until it has answered isMaster, and all servers
+    // accept commands over OP_QUERY.
+    auto toSend = _messageFromRequest(RemoteCommandRequest(op->request().target, dbname, cmdObj),
+                                      rpc::Protocol::kOpQuery);
+    op->beginConnectionCommand(std::move(*toSend), std::move(handler));
+
+    asio::const_buffer buf(op->toSend()->buf(), op->toSend()->size());
+    return _asyncSendSimpleMessage(op, buf);
+}
+
 void NetworkInterfaceASIO::_asyncSendSimpleMessage(AsyncOp* op, const asio::const_buffer& buf) {
     asio::async_write(op->connection()->sock(),
                       asio::buffer(buf),
-                      [this, op](std::error_code ec, std::size_t bytes) {
+                      op->strand().wrap([this, op](std::error_code ec, std::size_t bytes) {
 
                           if (op->canceled()) {
                               return _completeOperation(op, kCanceledStatus);
@@ -93,7 +109,7 @@ void NetworkInterfaceASIO::_asyncSendSimpleMessage(AsyncOp* op, const asio::cons
                           }
 
                           _receiveResponse(op);
-                      });
+                      }));
 }
 
 void NetworkInterfaceASIO::_beginCommunication(AsyncOp* op) {
@@ -123,6 +139,13 @@ void NetworkInterfaceASIO::_beginCommunication(AsyncOp* op) {
 }
 
 void NetworkInterfaceASIO::_completedWriteCallback(AsyncOp* op) {
+    if (op->inConnectionCommand()) {
+        return _completedConnectionCommand(op);
+    }
+
+    // Nothing more will arrive on the connection for this operation, so it can be reused
+    op->setReplyReceived();
+
     // If we were told to send an empty message, toRecv will be empty here.
 
     // TODO: handle metadata readers
@@ -157,6 +180,20 @@ void NetworkInterfaceASIO::_completedWriteCallback(AsyncOp* op) {
     }
 }
 
+void NetworkInterfaceASIO::_completedConnectionCommand(AsyncOp* op) {
+    StatusWith<BSONObj> reply = [op]() -> StatusWith<BSONObj> {
+        try {
+            return rpc::makeReply(op->toRecv())->getCommandReply().getOwned();
+        } catch (...) {
+            // makeReply can throw if the reply was invalid.
+            return exceptionToStatus();
+        }
+    }();
+
+    // The handler may start the next command on the connection
+    op->endConnectionCommand()(reply);
+}
+
 void NetworkInterfaceASIO::_networkErrorCallback(AsyncOp* op, const std::error_code& ec) {
     LOG(3) << "networking error occurred";
     _completeOperation(op, Status(ErrorCodes::HostUnreachable, ec.message()));
@@ -165,6 +202,8 @@ void NetworkInterfaceASIO::_networkErrorCallback(AsyncOp* op, const std::error_c
 // NOTE: This method may only be called by ASIO threads
 // (do not call from methods entered by ReplicationExecutor threads)
 void NetworkInterfaceASIO::_completeOperation(AsyncOp* op, const ResponseStatus& resp) {
+    _releaseConnection(op);
+
     op->finish(resp);
 
     {
@@ -180,7 +219,7 @@ void NetworkInterfaceASIO::_completeOperation(AsyncOp* op, const ResponseStatus&
 void NetworkInterfaceASIO::_recvMessageHeader(AsyncOp* op) {
     asio::async_read(op->connection()->sock(),
                      asio::buffer(reinterpret_cast<char*>(op->header()), sizeof(MSGHEADER::Value)),
-                     [this, op](asio::error_code ec, size_t bytes) {
+                     op->strand().wrap([this, op](asio::error_code ec, size_t bytes) {
 
                          if (op->canceled()) {
                              return _completeOperation(op, kCanceledStatus);
@@ -191,7 +230,7 @@ void NetworkInterfaceASIO::_recvMessageHeader(AsyncOp* op) {
                              return _networkErrorCallback(op, ec);
                          }
                          _recvMessageBody(op);
-                     });
+                     }));
 }
 
 void NetworkInterfaceASIO::_recvMessageBody(AsyncOp* op) {
@@ -238,7 +277,7 @@ void NetworkInterfaceASIO::_recvMessageBody(AsyncOp* op) {
     // receive remaining data into md->data
     asio::async_read(op->connection()->sock(),
                      asio::buffer(mdView.data(), bodyLength),
-                     [this, op, mdView](asio::error_code ec, size_t bytes) {
+                     op->strand().wrap([this, op, mdView](asio::error_code ec, size_t bytes) {
 
                          if (op->canceled()) {
                              return _completeOperation(op, kCanceledStatus);
@@ -250,7 +289,7 @@ void NetworkInterfaceASIO::_recvMessageBody(AsyncOp* op) {
                          }
 
                          return _completedWriteCallback(op);
-                     });
+                     }));
 }
 
 void NetworkInterfaceASIO::_receiveResponse(AsyncOp* op) {
@@ -32,10 +32,12 @@
 
 #include "mongo/executor/network_interface_asio.h"
 
+#include <memory>
 #include <utility>
 
+#include "mongo/db/jsobj.h"
+#include "mongo/rpc/get_status_from_command_result.h"
 #include "mongo/util/log.h"
-#include "mongo/util/net/sock.h"
 
 namespace mongo {
 namespace executor {
@@ -44,31 +46,40 @@ using asio::ip::tcp;
 
 namespace {
 const auto kCanceledStatus = Status(ErrorCodes::CallbackCanceled, "Callback canceled");
+
+// How long to wait for the TCP connection to be established, before the handshake
+const Seconds kConnectTimeout(10);
+
+/**
+ * Bounds the time a connection attempt may take. The handlers of the timer and of the connect
+ * may run in either order, though never at the same time as both go through the operation's
+ * strand, so the timer checks connectDone before touching the operation.
+ */
+struct ConnectTimeout {
+    explicit ConnectTimeout(asio::io_service& service) : timer(service) {}
+
+    asio::steady_timer timer;
+    bool connectDone = false;
+};
 }  // namespace
 
 NetworkInterfaceASIO::AsyncConnection::AsyncConnection(asio::ip::tcp::socket&& sock,
                                                        rpc::ProtocolSet protocols)
-    : AsyncConnection(std::move(sock), protocols, boost::none) {}
-
-NetworkInterfaceASIO::AsyncConnection::AsyncConnection(
-    asio::ip::tcp::socket&& sock,
-    rpc::ProtocolSet protocols,
-    boost::optional<ConnectionPool::ConnectionPtr>&& bootstrapConn)
-    : _sock(std::move(sock)),
-      _serverProtocols(protocols),
-      _bootstrapConn(std::move(bootstrapConn)) {}
+    : _sock(std::move(sock)), _serverProtocols(protocols) {}
 
 #if defined(_MSC_VER) && _MSC_VER < 1900
 NetworkInterfaceASIO::AsyncConnection::AsyncConnection(AsyncConnection&& other)
     : _sock(std::move(other._sock)),
       _serverProtocols(other._serverProtocols),
-      _clientProtocols(other._clientProtocols) {}
+      _clientProtocols(other._clientProtocols),
+      _lastUsed(other._lastUsed) {}
 
 NetworkInterfaceASIO::AsyncConnection& NetworkInterfaceASIO::AsyncConnection::operator=(
     AsyncConnection&& other) {
     _sock = std::move(other._sock);
     _serverProtocols = other._serverProtocols;
     _clientProtocols = other._clientProtocols;
+    _lastUsed = other._lastUsed;
     return *this;
 }
 #endif
@@ -85,13 +96,48 @@ rpc::ProtocolSet NetworkInterfaceASIO::AsyncConnection::clientProtocols() const
     return _clientProtocols;
 }
 
+void NetworkInterfaceASIO::AsyncConnection::setServerProtocols(rpc::ProtocolSet protocols) {
+    _serverProtocols = protocols;
+}
+
+Date_t NetworkInterfaceASIO::AsyncConnection::lastUsed() const {
+    return _lastUsed;
+}
+
+void NetworkInterfaceASIO::AsyncConnection::setLastUsed(Date_t now) {
+    _lastUsed = now;
+}
+
+bool NetworkInterfaceASIO::AsyncConnection::isStillConnected() {
+    if (!_sock.is_open()) {
+        return false;
+    }
+
+    // This only affects synchronous calls, such as the peek below, not the asynchronous ones
+    // the connection is otherwise used with.
+    std::error_code ec;
+    _sock.non_blocking(true, ec);
+    if (ec) {
+        return false;
+    }
+
+    // Nothing should be sent to an idle connection, so reading anything, even the end of the
+    // stream, means it can't be used.
+    char buf;
+    _sock.receive(asio::buffer(&buf, 1), tcp::socket::message_peek, ec);
+    return ec == asio::error::would_block;
+}
+
 void NetworkInterfaceASIO::_connectASIO(AsyncOp* op) {
     tcp::resolver::query query(op->request().target.host(),
                                std::to_string(op->request().target.port()));
+    // Resolvers may not be shared between threads, so each resolution gets its own.
     // TODO: Investigate how we might hint or use shortcuts to resolve when possible.
-    _resolver.async_resolve(
+    auto resolver = std::make_shared<tcp::resolver>(_io_service);
+    resolver->async_resolve(
         query,
-        [this, op](std::error_code ec, asio::ip::basic_resolver_iterator<tcp> endpoints) {
+        op->strand().wrap([this, op, resolver](std::error_code ec,
+                                               asio::ip::basic_resolver_iterator<tcp> endpoints) {
             if (ec) {
                 LOG(3) << "could not resolve address " << op->request().target.host() << ":"
                        << std::to_string(op->request().target.port()) << ", " << ec.message();
@@ -102,59 +148,37 @@ void NetworkInterfaceASIO::_connectASIO(AsyncOp* op) {
                 return _completeOperation(op, kCanceledStatus);
 
             _setupSocket(op, endpoints);
-        });
-}
-
-void NetworkInterfaceASIO::_connectWithDBClientConnection(AsyncOp* op) {
-    // connect in a separate thread to avoid blocking the rest of the system
-    stdx::thread t([this, op]() {
-        try {
-            // The call to connect() will throw if:
-            // - we cannot get a new connection from the pool
-            // - we get a connection from the pool, but cannot use it
-            // - we fail to transfer the connection's socket to an ASIO wrapper
-            op->connect(_connPool.get(), &_io_service, now());
-        } catch (...) {
-            LOG(3) << "failed to connect, posting mock completion";
-
-            if (inShutdown()) {
-                return;
-            }
-
-            auto status = exceptionToStatus();
-
-            asio::post(_io_service,
-                       [this, op, status]() {
-
-                           if (op->canceled()) {
-                               return _completeOperation(op, kCanceledStatus);
-                           }
-
-                           return _completeOperation(op, status);
-                       });
-            return;
-        }
-
-        // send control back to main thread(pool)
-        asio::post(_io_service, [this, op]() { _beginCommunication(op); });
-    });
-
-    t.detach();
+        }));
 }
 
 void NetworkInterfaceASIO::_setupSocket(AsyncOp* op, const tcp::resolver::iterator& endpoints) {
     tcp::socket sock(_io_service);
-    AsyncConnection conn(std::move(sock), rpc::supports::kOpQueryOnly);
 
-    // TODO: Consider moving this call to post-auth so we only assign completed connections.
+    // The server's protocols are known once it has answered isMaster
+    AsyncConnection conn(std::move(sock), rpc::supports::kOpQueryOnly);
     op->setConnection(std::move(conn));
 
+    // Closing the socket makes the pending connect fail
+    auto timeout = std::make_shared<ConnectTimeout>(_io_service);
+    timeout->timer.expires_after(kConnectTimeout);
+    timeout->timer.async_wait(op->strand().wrap([op, timeout](std::error_code ec) {
+        if (!ec && !timeout->connectDone) {
+            LOG(3) << "timed out connecting to " << op->request().target;
+            std::error_code ignored;
+            op->connection()->sock().close(ignored);
+        }
+    }));
+
     asio::async_connect(op->connection()->sock(),
                         std::move(endpoints),
-                        [this, op](std::error_code ec, tcp::resolver::iterator iter) {
+                        op->strand().wrap([this, op, timeout](std::error_code ec,
+                                                              tcp::resolver::iterator iter) {
+                            timeout->connectDone = true;
+                            timeout->timer.cancel();
+
                             if (ec) {
-                                LOG(3) << "could not connect to host at " << iter->host_name()
-                                       << ":" << iter->endpoint().port() << ", " << ec.message();
+                                LOG(3) << "could not connect to host at "
+                                       << op->request().target << ", " << ec.message();
                                 return _networkErrorCallback(op, ec);
                             }
 
@@ -162,7 +186,29 @@ void NetworkInterfaceASIO::_setupSocket(AsyncOp* op, const tcp::resolver::iterat
                                 return _completeOperation(op, kCanceledStatus);
 
                             _sslHandshake(op);
-                        });
+                        }));
+}
+
+void NetworkInterfaceASIO::_runIsMaster(AsyncOp* op) {
+    _runConnectionCommand(
+        op, "admin", BSON("isMaster" << 1), [this, op](const StatusWith<BSONObj>& reply) {
+            if (!reply.isOK()) {
+                return _completeOperation(op, reply.getStatus());
+            }
+
+            Status status = getStatusFromCommandResult(reply.getValue());
+            if (!status.isOK()) {
+                return _completeOperation(op, status);
+            }
+
+            auto protocols = rpc::parseProtocolSetFromIsMasterReply(reply.getValue());
+            if (!protocols.isOK()) {
+                return _completeOperation(op, protocols.getStatus());
+            }
+
+            op->connection()->setServerProtocols(protocols.getValue());
+            _authenticate(op);
+        });
 }
 
 }  // namespace executor
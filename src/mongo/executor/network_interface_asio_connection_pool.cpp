@@ -0,0 +1,245 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kExecutor
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/executor/network_interface_asio.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+namespace executor {
+
+namespace {
+
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asioMinConnectionsPerHost, int, 1);
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asioMaxConnectionsPerHost, int, 200);
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asioConnectionIdleTimeoutSecs, int, 300);
+
+// How often idle connections are expired and waiting operations timed out
+const Seconds kMaintenanceInterval(1);
+
+Counter64 connectionsCreated;
+Counter64 connectionsReused;
+Counter64 connectionsExpired;
+Counter64 waits;
+Counter64 waitMillis;
+Counter64 waitTimeouts;
+
+ServerStatusMetricField<Counter64> displayConnectionsCreated("network.asio.connectionPool.created",
+                                                            &connectionsCreated);
+ServerStatusMetricField<Counter64> displayConnectionsReused("network.asio.connectionPool.reused",
+                                                           &connectionsReused);
+ServerStatusMetricField<Counter64> displayConnectionsExpired(
+    "network.asio.connectionPool.idleExpired", &connectionsExpired);
+ServerStatusMetricField<Counter64> displayWaits("network.asio.connectionPool.waits", &waits);
+ServerStatusMetricField<Counter64> displayWaitMillis("network.asio.connectionPool.waitMillis",
+                                                     &waitMillis);
+ServerStatusMetricField<Counter64> displayWaitTimeouts("network.asio.connectionPool.waitTimeouts",
+                                                       &waitTimeouts);
+
+}  // namespace
+
+void NetworkInterfaceASIO::_getConnection(AsyncOp* op) {
+    const size_t maxConnections = std::max(asioMaxConnectionsPerHost, 1);
+
+    stdx::unique_lock<stdx::mutex> lk(_connPoolMutex);
+    HostConnectionPool& pool = _connPool[op->request().target];
+
+    while (!pool.idle.empty()) {
+        AsyncConnection conn(std::move(pool.idle.front()));
+        pool.idle.pop_front();
+
+        if (!conn.isStillConnected()) {
+            LOG(3) << "dropping pooled connection to " << op->request().target
+                   << " which was closed";
+            continue;
+        }
+
+        pool.checkedOut++;
+        lk.unlock();
+
+        connectionsReused.increment();
+        op->setConnection(std::move(conn));
+        op->setConnected();
+        return _beginCommunication(op);
+    }
+
+    if (pool.checkedOut < maxConnections) {
+        pool.checkedOut++;
+        lk.unlock();
+
+        connectionsCreated.increment();
+        op->setConnecting();
+        return _connectASIO(op);
+    }
+
+    // _releaseConnection() will continue the state machine.
+    pool.waiters.push_back(HostConnectionPool::Waiter{op, now()});
+    waits.increment();
+}
+
+void NetworkInterfaceASIO::_releaseConnection(AsyncOp* op) {
+    if (!op->checkedOut()) {
+        return;
+    }
+
+    // Connections in an unknown state, for instance because a reply is still on its way, are
+    // closed along with the operation.
+    boost::optional<AsyncConnection> conn;
+    if (op->canReuseConnection() && !inShutdown()) {
+        conn.emplace(op->releaseConnection());
+    }
+
+    HostConnectionPool::Waiter next;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_connPoolMutex);
+        HostConnectionPool& pool = _connPool[op->request().target];
+
+        if (pool.waiters.empty()) {
+            pool.checkedOut--;
+            if (conn) {
+                conn->setLastUsed(now());
+                pool.idle.push_front(std::move(*conn));
+            }
+            return;
+        }
+
+        next = pool.waiters.front();
+        pool.waiters.pop_front();
+    }
+
+    waitMillis.increment(durationCount<Milliseconds>(now() - next.since));
+
+    // The waiter takes over the pool slot, with the connection if it can be reused, or else to
+    // open a new one.
+    if (conn) {
+        connectionsReused.increment();
+        next.op->setConnection(std::move(*conn));
+        next.op->setConnected();
+        next.op->strand().post([this, next]() { _beginCommunication(next.op); });
+    } else {
+        connectionsCreated.increment();
+        next.op->setConnecting();
+        next.op->strand().post([this, next]() { _connectASIO(next.op); });
+    }
+}
+
+bool NetworkInterfaceASIO::_removeWaiter_inlock(AsyncOp* op) {
+    auto poolIter = _connPool.find(op->request().target);
+    if (poolIter == _connPool.end()) {
+        return false;
+    }
+
+    std::deque<HostConnectionPool::Waiter>& waiters = poolIter->second.waiters;
+    for (auto iter = waiters.begin(); iter != waiters.end(); ++iter) {
+        if (iter->op == op) {
+            waiters.erase(iter);
+            return true;
+        }
+    }
+    return false;
+}
+
+void NetworkInterfaceASIO::_scheduleConnectionPoolMaintenance() {
+    _connPoolMaintenanceTimer.expires_after(kMaintenanceInterval);
+    _connPoolMaintenanceTimer.async_wait([this](std::error_code ec) {
+        if (ec || inShutdown()) {
+            return;
+        }
+
+        _maintainConnectionPool();
+        _scheduleConnectionPoolMaintenance();
+    });
+}
+
+void NetworkInterfaceASIO::_maintainConnectionPool() {
+    const Date_t now = this->now();
+    const Seconds idleTimeout(asioConnectionIdleTimeoutSecs);
+    const size_t minConnections = std::max(asioMinConnectionsPerHost, 0);
+
+    // Closed and completed outside of the lock
+    std::list<AsyncConnection> expired;
+    std::vector<AsyncOp*> timedOut;
+
+    {
+        stdx::lock_guard<stdx::mutex> lk(_connPoolMutex);
+        for (auto poolIter = _connPool.begin(); poolIter != _connPool.end();) {
+            HostConnectionPool& pool = poolIter->second;
+
+            // The least recently used connections are at the back
+            while (!pool.idle.empty() && pool.idle.size() + pool.checkedOut > minConnections &&
+                   now - pool.idle.back().lastUsed() >= idleTimeout) {
+                expired.splice(expired.end(), pool.idle, std::prev(pool.idle.end()));
+            }
+
+            for (auto iter = pool.waiters.begin(); iter != pool.waiters.end();) {
+                const RemoteCommandRequest& request = iter->op->request();
+                if (request.timeout != RemoteCommandRequest::kNoTimeout &&
+                    now - iter->since >= request.timeout) {
+                    timedOut.push_back(iter->op);
+                    iter = pool.waiters.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+
+            if (pool.idle.empty() && pool.checkedOut == 0 && pool.waiters.empty()) {
+                poolIter = _connPool.erase(poolIter);
+            } else {
+                ++poolIter;
+            }
+        }
+    }
+
+    connectionsExpired.increment(expired.size());
+    expired.clear();
+
+    for (AsyncOp* op : timedOut) {
+        waitTimeouts.increment();
+        op->strand().post([this, op]() {
+            _completeOperation(op,
+                               Status(ErrorCodes::ExceededTimeLimit,
+                                      str::stream() << "Timed out waiting for a connection to "
+                                                    << op->request().target.toString()));
+        });
+    }
+}
+
+}  // namespace executor
+}  // namespace mongo
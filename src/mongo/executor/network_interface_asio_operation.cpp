@@ -35,14 +35,14 @@
 namespace mongo {
 namespace executor {
 
-using asio::ip::tcp;
-
-NetworkInterfaceASIO::AsyncOp::AsyncOp(const TaskExecutor::CallbackHandle& cbHandle,
+NetworkInterfaceASIO::AsyncOp::AsyncOp(asio::io_service* service,
+                                       const TaskExecutor::CallbackHandle& cbHandle,
                                        const RemoteCommandRequest& request,
                                        const RemoteCommandCompletionFn& onFinish,
                                        Date_t now,
                                        int id)
-    : _cbHandle(cbHandle),
+    : _strand(*service),
+      _cbHandle(cbHandle),
       _request(request),
       _onFinish(onFinish),
       _start(now),
@@ -57,12 +57,12 @@ std::string NetworkInterfaceASIO::AsyncOp::toString() const {
     output << ", state: ";
     if (_state == OpState::kReady) {
         output << "kReady";
-    } else if (_state == OpState::kConnectionAcquired) {
-        output << "kConnectionAcquired";
-    } else if (_state == OpState::kConnectionVerified) {
-        output << "kConnectionVerified";
+    } else if (_state == OpState::kConnecting) {
+        output << "kConnecting";
     } else if (_state == OpState::kConnected) {
         output << "kConnected";
+    } else if (_state == OpState::kReplyReceived) {
+        output << "kReplyReceived";
     } else if (_state == OpState::kCompleted) {
         output << "kCompleted";
     } else {
@@ -73,6 +73,10 @@ std::string NetworkInterfaceASIO::AsyncOp::toString() const {
     return output;
 }
 
+asio::io_service::strand& NetworkInterfaceASIO::AsyncOp::strand() {
+    return _strand;
+}
+
 void NetworkInterfaceASIO::AsyncOp::cancel() {
     // An operation may be in mid-flight when it is canceled, so we
     // do not disconnect immediately upon cancellation.
@@ -87,46 +91,74 @@ const TaskExecutor::CallbackHandle& NetworkInterfaceASIO::AsyncOp::cbHandle() co
     return _cbHandle;
 }
 
-void NetworkInterfaceASIO::AsyncOp::connect(ConnectionPool* const pool,
-                                            asio::io_service* service,
-                                            Date_t now) {
-    // TODO(amidvidy): why is this hardcoded to 1 second? That seems too low.
-    ConnectionPool::ConnectionPtr conn(pool, _request.target, now, Milliseconds(1000));
-
-    _state = OpState::kConnectionAcquired;
+NetworkInterfaceASIO::AsyncConnection* NetworkInterfaceASIO::AsyncOp::connection() {
+    invariant(_connection.is_initialized());
+    return _connection.get_ptr();
+}
 
-    // TODO: Add a case here for unix domain sockets.
-    int protocol = conn.get()->port().localAddr().getType();
-    if (protocol != AF_INET && protocol != AF_INET6) {
-        throw SocketException(SocketException::CONNECT_ERROR, "Unsupported family");
-    }
+void NetworkInterfaceASIO::AsyncOp::setConnection(AsyncConnection&& conn) {
+    invariant(!_connection.is_initialized());
+    _connection = std::move(conn);
+}
 
-    _state = OpState::kConnectionVerified;
+bool NetworkInterfaceASIO::AsyncOp::hasConnection() const {
+    return _connection.is_initialized();
+}
 
-    tcp::socket sock{
-        *service, protocol == AF_INET ? tcp::v4() : tcp::v6(), conn.get()->port().psock->rawFD()};
+NetworkInterfaceASIO::AsyncConnection NetworkInterfaceASIO::AsyncOp::releaseConnection() {
+    invariant(_connection.is_initialized());
+    AsyncConnection conn(std::move(*_connection));
+    _connection = boost::none;
+    return conn;
+}
 
-    _connection.emplace(std::move(sock), conn.get()->getServerRPCProtocols(), std::move(conn));
+void NetworkInterfaceASIO::AsyncOp::setConnecting() {
+    invariant(_state == OpState::kReady);
+    _state = OpState::kConnecting;
+}
 
+void NetworkInterfaceASIO::AsyncOp::setConnected() {
+    invariant(_state == OpState::kReady || _state == OpState::kConnecting);
     _state = OpState::kConnected;
 }
 
-NetworkInterfaceASIO::AsyncConnection* NetworkInterfaceASIO::AsyncOp::connection() {
-    invariant(_connection.is_initialized());
-    return _connection.get_ptr();
+void NetworkInterfaceASIO::AsyncOp::setReplyReceived() {
+    invariant(_state == OpState::kConnected);
+    _state = OpState::kReplyReceived;
 }
 
-void NetworkInterfaceASIO::AsyncOp::setConnection(AsyncConnection&& conn) {
-    invariant(!_connection.is_initialized());
-    _connection = std::move(conn);
-    _state = OpState::kConnected;
+bool NetworkInterfaceASIO::AsyncOp::checkedOut() const {
+    return _state == OpState::kConnecting || _state == OpState::kConnected ||
+        _state == OpState::kReplyReceived;
 }
 
-bool NetworkInterfaceASIO::AsyncOp::connected() const {
-    return (_state == OpState::kConnected ||
-            // NOTE: if we fail at kConnectionVerified,
-            // ASIO will have closed the socket, don't disconnect
-            _state == OpState::kConnectionAcquired);
+bool NetworkInterfaceASIO::AsyncOp::canReuseConnection() const {
+    return _state == OpState::kReplyReceived && _connection.is_initialized();
+}
+
+void NetworkInterfaceASIO::AsyncOp::beginConnectionCommand(Message&& toSend,
+                                                           ConnectionCommandHandler handler) {
+    invariant(_state == OpState::kConnecting);
+    invariant(!_connectionCommandHandler);
+    setToSend(std::move(toSend));
+    _connectionCommandHandler = std::move(handler);
+}
+
+bool NetworkInterfaceASIO::AsyncOp::inConnectionCommand() const {
+    return static_cast<bool>(_connectionCommandHandler);
+}
+
+NetworkInterfaceASIO::ConnectionCommandHandler
+NetworkInterfaceASIO::AsyncOp::endConnectionCommand() {
+    invariant(_connectionCommandHandler);
+
+    // Make way for the next command on the connection
+    _toSend = boost::none;
+    _toRecv.reset();
+
+    ConnectionCommandHandler handler;
+    handler.swap(_connectionCommandHandler);
+    return handler;
 }
 
 void NetworkInterfaceASIO::AsyncOp::finish(const ResponseStatus& status) {
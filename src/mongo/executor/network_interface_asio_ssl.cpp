@@ -37,7 +37,7 @@ namespace executor {
 
 void NetworkInterfaceASIO::_sslHandshake(AsyncOp* op) {
     // TODO: Implement asynchronous SSL, SERVER-19221
-    _authenticate(op);
+    _runIsMaster(op);
 }
 
 }  // namespace executor
@@ -164,6 +164,8 @@ void DBClientMultiCommand::sendAll() {
                 // invalidate other connections which might be bad.  But if the connection
                 // doesn't seem bad, don't send it back, because we don't want to reuse it.
                 if (!command->conn->isFailed()) {
+                    shardConnectionPool.decrementEgress(command->endpoint.toString(),
+                                                        command->conn);
                     delete command->conn;
                 } else {
                     shardConnectionPool.release(command->endpoint.toString(), command->conn);
@@ -208,6 +210,7 @@ Status DBClientMultiCommand::recvAny(ConnectionString* endpoint, BSONSerializabl
         // invalidate other connections which might be bad.  But if the connection doesn't seem
         // bad, don't send it back, because we don't want to reuse it.
         if (!command->conn->isFailed()) {
+            shardConnectionPool.decrementEgress(command->endpoint.toString(), command->conn);
             delete command->conn;
         } else {
             shardConnectionPool.release(command->endpoint.toString(), command->conn);
@@ -227,8 +230,11 @@ DBClientMultiCommand::~DBClientMultiCommand() {
          ++it) {
         PendingCommand* command = *it;
 
-        if (NULL != command->conn)
+        if (NULL != command->conn) {
+            // The pool still counts the connection as checked out.
+            shardConnectionPool.decrementEgress(command->endpoint.toString(), command->conn);
             delete command->conn;
+        }
         delete command;
         command = NULL;
     }
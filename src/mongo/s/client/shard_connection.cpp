@@ -140,6 +140,9 @@ public:
         // May be read concurrently, but only written from
         // this thread.
         long long created;
+
+        // Kept for the next request of this thread. Still counts as in use in
+        // shardConnectionPool, against the limit on connections in use per host.
         DBClientBase* avail;
     };
 
@@ -182,6 +185,7 @@ public:
                         versionManager.resetShardVersionCB(ss->avail);
                     }
 
+                    shardConnectionPool.decrementEgress(addr, ss->avail);
                     delete ss->avail;
                 } else {
                     release(addr, ss->avail);
@@ -215,8 +219,14 @@ public:
             c.reset(s->avail);
             s->avail = 0;
 
-            // May throw an exception
-            shardConnectionPool.onHandedOut(c.get());
+            // May throw an exception, in which case the connection is destroyed and must no
+            // longer count as in use
+            try {
+                shardConnectionPool.onHandedOut(c.get());
+            } catch (...) {
+                shardConnectionPool.decrementEgress(addr, c.get());
+                throw;
+            }
         } else {
             c.reset(shardConnectionPool.get(addr));
 
@@ -244,6 +254,7 @@ public:
             }
 
             if (!isConnGood) {
+                shardConnectionPool.decrementEgress(addr, s->avail);
                 delete s->avail;
                 s->avail = NULL;
             }
@@ -354,6 +365,7 @@ public:
     void clearPool() {
         for (HostMap::iterator iter = _hosts.begin(); iter != _hosts.end(); ++iter) {
             if (iter->second->avail != NULL) {
+                shardConnectionPool.decrementEgress(iter->first, iter->second->avail);
                 delete iter->second->avail;
             }
             delete iter->second;
@@ -479,6 +491,7 @@ void ShardConnection::kill() {
             // Let the pool know about the bad connection and also delegate disposal to it.
             ClientConnections::threadInstance()->done(_cs.toString(), _conn);
         } else {
+            shardConnectionPool.decrementEgress(_cs.toString(), _conn);
             delete _conn;
         }
 
@@ -133,9 +133,9 @@ public:
             chunkMgr->getShardKeyPattern().extractShardKeyFromQuery(firstMatchQuery));
 
         // Don't need to split pipeline if the first $match is an exact match on shard key, but
-        // we can't send the entire pipeline to one shard if there is a $out stage, since that
-        // shard may not be the primary shard for the database.
-        bool needSplit = shardKeyMatches.isEmpty() || pipeline->hasOutStage();
+        // we can't send the entire pipeline to one shard if there is a $out or $lookup stage,
+        // since that shard may not be the primary shard for the database.
+        bool needSplit = shardKeyMatches.isEmpty() || pipeline->needsPrimaryShardMerger();
 
         // Split the pipeline into pieces for mongod(s) and this mongos. If needSplit is true,
         // 'pipeline' will become the merger side.
@@ -46,6 +46,7 @@
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/auth/authz_manager_external_state_s.h"
 #include "mongo/db/auth/user_cache_invalidator_job.h"
+#include "mongo/db/auth/user_cache_refresher_job.h"
 #include "mongo/db/client.h"
 #include "mongo/db/dbwebserver.h"
 #include "mongo/db/initialize_server_global_state.h"
@@ -177,6 +178,7 @@ void start(const MessageServer::Options& opts) {
     cursorCache.startTimeoutThread();
     UserCacheInvalidator cacheInvalidatorThread(getGlobalAuthorizationManager());
     cacheInvalidatorThread.go();
+    (new UserCacheRefresher(getGlobalAuthorizationManager()))->go();
 
     PeriodicTask::startRunningPeriodicTasks();
 
@@ -33,8 +33,10 @@
 
 #include <iostream>
 
+#include "mongo/platform/bits.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -47,17 +49,30 @@ void _check(int ret) {
     severe() << "error in Ticketholder: " << errnoWithDescription(err);
     fassertFailed(28604);
 }
+
+bool decrementIfPositive(AtomicInt32* counter) {
+    int value = counter->load();
+    while (value > 0) {
+        const int previous = counter->compareAndSwap(value, value - 1);
+        if (previous == value)
+            return true;
+        value = previous;
+    }
+    return false;
+}
 }
 
-TicketHolder::TicketHolder(int num) : _outof(num) {
+TicketHolder::TicketHolder(int num, std::vector<QueueOptions> queues)
+    : _currentPass(0), _outof(num) {
     _check(sem_init(&_sem, 0, num));
+    _initQueues(std::move(queues));
 }
 
 TicketHolder::~TicketHolder() {
     _check(sem_destroy(&_sem));
 }
 
-bool TicketHolder::tryAcquire() {
+bool TicketHolder::_acquireFree() {
     while (0 != sem_trywait(&_sem)) {
         switch (errno) {
             case EAGAIN:
@@ -71,18 +86,11 @@ bool TicketHolder::tryAcquire() {
     return true;
 }
 
-void TicketHolder::waitForTicket() {
-    while (0 != sem_wait(&_sem)) {
-        switch (errno) {
-            case EINTR:
-                break;
-            default:
-                _check(-1);
-        }
-    }
-}
+void TicketHolder::_releaseFree() {
+    // Tickets the holder shrank below while they were in use are retired instead of returned.
+    if (decrementIfPositive(&_toRetire))
+        return;
 
-void TicketHolder::release() {
     _check(sem_post(&_sem));
 }
 
@@ -99,12 +107,18 @@ Status TicketHolder::resize(int newSize) {
                                     << "; given " << newSize);
 
     while (_outof.load() < newSize) {
-        release();
+        // Growing first keeps tickets that were due to be retired.
+        if (!decrementIfPositive(&_toRetire))
+            release();
         _outof.fetchAndAdd(1);
     }
 
+    // Shrinking takes free tickets out of the pool, without waiting in a queue or counting as
+    // an admission. Tickets in use are retired when they are released, so this doesn't wait
+    // for busy operations either.
     while (_outof.load() > newSize) {
-        waitForTicket();
+        if (!_acquireFree())
+            _toRetire.fetchAndAdd(1);
         _outof.subtractAndFetch(1);
     }
 
@@ -119,7 +133,7 @@ int TicketHolder::available() const {
 }
 
 int TicketHolder::used() const {
-    return outof() - available();
+    return outof() + _toRetire.load() - available();
 }
 
 int TicketHolder::outof() const {
@@ -128,50 +142,52 @@ int TicketHolder::outof() const {
 
 #else
 
-TicketHolder::TicketHolder(int num) : _outof(num), _num(num) {}
+TicketHolder::TicketHolder(int num, std::vector<QueueOptions> queues)
+    : _currentPass(0), _outof(num), _num(num) {
+    _initQueues(std::move(queues));
+}
 
 TicketHolder::~TicketHolder() = default;
 
-bool TicketHolder::tryAcquire() {
+bool TicketHolder::_acquireFree() {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
-    return _tryAcquire();
+    if (_num <= 0) {
+        if (_num < 0) {
+            std::cerr << "DISASTER! in TicketHolder" << std::endl;
+        }
+        return false;
+    }
+    _num--;
+    return true;
 }
 
-void TicketHolder::waitForTicket() {
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
-
-    while (!_tryAcquire()) {
-        _newTicket.wait(lk);
-    }
+void TicketHolder::_releaseFree() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _num++;
 }
 
-void TicketHolder::release() {
+Status TicketHolder::resize(int newSize) {
     {
         stdx::lock_guard<stdx::mutex> lk(_mutex);
-        _num++;
-    }
-    _newTicket.notify_one();
-}
 
-Status TicketHolder::resize(int newSize) {
-    stdx::lock_guard<stdx::mutex> lk(_mutex);
+        int used = _outof.load() - _num;
+        if (used > newSize) {
+            std::stringstream ss;
+            ss << "can't resize since we're using (" << used << ") "
+               << "more than newSize(" << newSize << ")";
 
-    int used = _outof.load() - _num;
-    if (used > newSize) {
-        std::stringstream ss;
-        ss << "can't resize since we're using (" << used << ") "
-           << "more than newSize(" << newSize << ")";
+            std::string errmsg = ss.str();
+            log() << errmsg;
+            return Status(ErrorCodes::BadValue, errmsg);
+        }
 
-        std::string errmsg = ss.str();
-        log() << errmsg;
-        return Status(ErrorCodes::BadValue, errmsg);
+        _outof.store(newSize);
+        _num = _outof.load() - used;
     }
 
-    _outof.store(newSize);
-    _num = _outof.load() - used;
-
-    // Potentially wasteful, but easier to see is correct
-    _newTicket.notify_all();
+    // Any new tickets go to the waiters first. This has to happen without _mutex held since
+    // _queueMutex comes first in the lock order.
+    _grantToWaiters();
     return Status::OK();
 }
 
@@ -187,15 +203,180 @@ int TicketHolder::outof() const {
     return _outof.load();
 }
 
-bool TicketHolder::_tryAcquire() {
-    if (_num <= 0) {
-        if (_num < 0) {
-            std::cerr << "DISASTER! in TicketHolder" << std::endl;
-        }
+#endif
+
+namespace {
+// A waiter whose deadline is this close is served ahead of the fair sharing order, rather than
+// risk timing out behind waiters that could afford to wait longer.
+const Milliseconds kUrgentDeadlineWindow(10);
+
+const char kDefaultQueueName[] = "default";
+}
+
+TicketHolder::Queue::Queue(std::string name, int weight)
+    : name(std::move(name)), weight(weight), pass(0) {
+    for (int i = 0; i < kNumWaitBuckets; i++) {
+        waitMicrosHistogram[i].store(0);
+    }
+}
+
+TicketHolder::TicketHolder(int num) : TicketHolder(num, {{kDefaultQueueName, 1}}) {}
+
+void TicketHolder::_initQueues(std::vector<QueueOptions> queues) {
+    invariant(!queues.empty());
+    for (size_t i = 0; i < queues.size(); i++) {
+        invariant(queues[i].weight > 0);
+        _queues.emplace_back(new Queue(std::move(queues[i].name), queues[i].weight));
+    }
+}
+
+bool TicketHolder::tryAcquire() {
+    if (!_acquireFree())
         return false;
+    _recordWait(_queues.front().get(), 0);
+    return true;
+}
+
+void TicketHolder::waitForTicket() {
+    bool acquired = waitForTicketUntil(0, Date_t::max());
+    invariant(acquired);
+}
+
+bool TicketHolder::waitForTicketUntil(int queueId, Date_t deadline) {
+    invariant(queueId >= 0 && size_t(queueId) < _queues.size());
+    Queue* queue = _queues[queueId].get();
+
+    // Only skip the queues when nobody is in them, so a steady stream of arrivals can't keep
+    // overtaking the waiters.
+    if (_numWaiters.load() == 0 && _acquireFree()) {
+        _recordWait(queue, 0);
+        return true;
     }
-    _num--;
+
+    Timer timer;
+    Waiter waiter(deadline);
+
+    stdx::unique_lock<stdx::mutex> lk(_queueMutex);
+
+    // Registering as a waiter before retrying means a ticket released after the retry fails
+    // will see us in release() and be handed over.
+    _numWaiters.fetchAndAdd(1);
+    if (_acquireFree()) {
+        _numWaiters.subtractAndFetch(1);
+        lk.unlock();
+        _recordWait(queue, timer.micros());
+        return true;
+    }
+
+    if (queue->waiters.empty())
+        queue->pass = std::max(queue->pass, _currentPass);
+    std::list<Waiter*>::iterator position = queue->waiters.insert(queue->waiters.end(), &waiter);
+
+    if (deadline == Date_t::max()) {
+        waiter.cv.wait(lk, [&waiter] { return waiter.granted; });
+    } else {
+        waiter.cv.wait_until(
+            lk, deadline.toSystemTimePoint(), [&waiter] { return waiter.granted; });
+    }
+
+    if (!waiter.granted) {
+        queue->waiters.erase(position);
+        _numWaiters.subtractAndFetch(1);
+        queue->timedOut.fetchAndAdd(1);
+        return false;
+    }
+
+    // Whoever granted the ticket already took us off the queue.
+    lk.unlock();
+    _recordWait(queue, timer.micros());
     return true;
 }
-#endif
+
+void TicketHolder::release() {
+    _releaseFree();
+
+    // A waiter registers before its last attempt to take a free ticket, so either it got the
+    // ticket we just put back or we see it here.
+    if (_numWaiters.load() > 0)
+        _grantToWaiters();
+}
+
+void TicketHolder::_grantToWaiters() {
+    stdx::lock_guard<stdx::mutex> lk(_queueMutex);
+
+    while (_numWaiters.load() > 0) {
+        if (!_acquireFree())
+            return;
+
+        Queue* queue = _nextQueue_inlock(Date_t::now());
+        invariant(queue);
+
+        Waiter* waiter = queue->waiters.front();
+        queue->waiters.pop_front();
+        _numWaiters.subtractAndFetch(1);
+
+        _currentPass = queue->pass;
+        queue->pass += 1.0 / queue->weight;
+
+        waiter->granted = true;
+        waiter->cv.notify_one();
+    }
+}
+
+TicketHolder::Queue* TicketHolder::_nextQueue_inlock(Date_t now) {
+    Queue* fairest = NULL;
+    Queue* mostUrgent = NULL;
+    for (size_t i = 0; i < _queues.size(); i++) {
+        Queue* queue = _queues[i].get();
+        if (queue->waiters.empty())
+            continue;
+
+        if (!fairest || queue->pass < fairest->pass)
+            fairest = queue;
+
+        const Date_t deadline = queue->waiters.front()->deadline;
+        if (deadline != Date_t::max() && deadline - now <= kUrgentDeadlineWindow) {
+            if (!mostUrgent || deadline < mostUrgent->waiters.front()->deadline)
+                mostUrgent = queue;
+        }
+    }
+    return mostUrgent ? mostUrgent : fairest;
+}
+
+void TicketHolder::_recordWait(Queue* queue, long long waitMicros) {
+    // The bucket is the number of bits needed to represent the wait.
+    int bucket = waitMicros <= 0 ? 0 : 64 - countLeadingZeros64(waitMicros);
+    if (bucket >= kNumWaitBuckets)
+        bucket = kNumWaitBuckets - 1;
+
+    queue->waitMicrosHistogram[bucket].fetchAndAdd(1);
+    if (waitMicros > 0)
+        queue->totalWaitMicros.fetchAndAdd(waitMicros);
+}
+
+std::vector<TicketHolder::QueueStats> TicketHolder::getQueueStats() const {
+    std::vector<QueueStats> stats;
+    for (size_t i = 0; i < _queues.size(); i++) {
+        const Queue& queue = *_queues[i];
+
+        QueueStats queueStats;
+        queueStats.name = queue.name;
+        queueStats.weight = queue.weight;
+        queueStats.admitted = 0;
+        for (int bucket = 0; bucket < kNumWaitBuckets; bucket++) {
+            queueStats.waitMicrosHistogram[bucket] = queue.waitMicrosHistogram[bucket].load();
+            queueStats.admitted += queueStats.waitMicrosHistogram[bucket];
+        }
+        queueStats.timedOut = queue.timedOut.load();
+        queueStats.totalWaitMicros = queue.totalWaitMicros.load();
+        stats.push_back(queueStats);
+    }
+
+    // The waiter lists can only be read under the mutex.
+    stdx::lock_guard<stdx::mutex> lk(_queueMutex);
+    for (size_t i = 0; i < _queues.size(); i++) {
+        stats[i].waiting = _queues[i]->waiters.size();
+    }
+    return stats;
+}
 }
@@ -30,26 +30,87 @@
 #include <semaphore.h>
 #endif
 
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
+/**
+ * Hands out a fixed number of tickets. Callers that can't get a ticket right away wait in one of
+ * the holder's admission queues. When a ticket is released it goes to the head of a queue chosen
+ * by weighted fair sharing, so a queue full of long running operations can't starve the others.
+ * Within a queue waiters are served in FIFO order, except that a waiter about to reach its
+ * deadline is served ahead of the fairness order.
+ */
 class TicketHolder {
     MONGO_DISALLOW_COPYING(TicketHolder);
 
 public:
+    struct QueueOptions {
+        std::string name;
+        int weight;  // relative share of contended tickets
+    };
+
+    /**
+     * Wait times are counted in power of two buckets of microseconds. Bucket i counts waits
+     * shorter than 2^i micros that don't fit in bucket i - 1. The last bucket counts everything
+     * longer.
+     */
+    static const int kNumWaitBuckets = 24;
+
+    struct QueueStats {
+        std::string name;
+        int weight;
+        int waiting;
+        long long admitted;
+        long long timedOut;
+        long long totalWaitMicros;
+        long long waitMicrosHistogram[kNumWaitBuckets];
+    };
+
+    /**
+     * A holder with a single queue, named "default".
+     */
     explicit TicketHolder(int num);
+
+    /**
+     * Queues are identified by their position in 'queues'.
+     */
+    TicketHolder(int num, std::vector<QueueOptions> queues);
+
     ~TicketHolder();
 
+    /**
+     * Takes a ticket if one is free, without waiting or being counted in any queue.
+     */
     bool tryAcquire();
 
+    /**
+     * Waits in the first queue for as long as it takes to get a ticket.
+     */
     void waitForTicket();
 
+    /**
+     * Waits in 'queue' until a ticket is available or 'deadline' passes. Returns false if the
+     * deadline passed first. Pass Date_t::max() to wait indefinitely.
+     */
+    bool waitForTicketUntil(int queue, Date_t deadline);
+
     void release();
 
+    /**
+     * Changes the number of tickets. On Linux, shrinking doesn't wait for tickets in use: they
+     * are retired as they are released.
+     */
     Status resize(int newSize);
 
     int available() const;
@@ -58,20 +119,77 @@ public:
 
     int outof() const;
 
+    std::vector<QueueStats> getQueueStats() const;
+
 private:
+    struct Waiter {
+        explicit Waiter(Date_t deadline) : deadline(deadline), granted(false) {}
+
+        const Date_t deadline;
+        bool granted;
+        stdx::condition_variable cv;
+    };
+
+    struct Queue {
+        Queue(std::string name, int weight);
+
+        const std::string name;
+        const int weight;
+
+        // Virtual time of this queue for weighted fair sharing. It advances by 1/weight each
+        // time the queue is served, and the waiting queue with the lowest pass goes next.
+        double pass;
+
+        std::list<Waiter*> waiters;
+
+        AtomicInt64 timedOut;
+        AtomicInt64 totalWaitMicros;
+        AtomicInt64 waitMicrosHistogram[kNumWaitBuckets];
+    };
+
+    void _initQueues(std::vector<QueueOptions> queues);
+
+    void _recordWait(Queue* queue, long long waitMicros);
+
+    /**
+     * Hands free tickets to waiters until one or the other runs out.
+     */
+    void _grantToWaiters();
+
+    Queue* _nextQueue_inlock(Date_t now);
+
+    // Acquires and releases tickets in the pool of free tickets, ignoring the queues.
+    bool _acquireFree();
+    void _releaseFree();
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+
+    // Guards the queues, their waiters and _currentPass. If a platform mutex is also needed,
+    // this one must be taken first.
+    mutable stdx::mutex _queueMutex;
+
+    // Number of queued waiters across all queues. It is only changed under _queueMutex, but
+    // release() reads it without the mutex so it can skip the queues when nobody waits.
+    AtomicInt32 _numWaiters;
+
+    // Pass of the queue served most recently. A queue that starts waiting begins no earlier
+    // than this, so it can't make up for time it didn't need tickets.
+    double _currentPass;
+
 #if defined(__linux__)
     mutable sem_t _sem;
 
     // You can read _outof without a lock, but have to hold _resizeMutex to change.
     AtomicInt32 _outof;
     stdx::mutex _resizeMutex;
-#else
-    bool _tryAcquire();
 
+    // Tickets that were in use when the holder shrank past them. Each one is retired when it is
+    // released rather than returned to the pool. Only resize() adds to it.
+    AtomicInt32 _toRetire;
+#else
     AtomicInt32 _outof;
     int _num;
     stdx::mutex _mutex;
-    stdx::condition_variable _newTicket;
 #endif
 };
 
@@ -111,6 +229,10 @@ public:
         return _holder != NULL;
     }
 
+    TicketHolder* holder() const {
+        return _holder;
+    }
+
     void reset(TicketHolder* holder = NULL) {
         if (_holder) {
             _holder->release();
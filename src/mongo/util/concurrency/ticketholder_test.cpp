@@ -0,0 +1,227 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/time_support.h"
+
+namespace {
+
+using mongo::Date_t;
+using mongo::Milliseconds;
+using mongo::TicketHolder;
+
+namespace stdx = mongo::stdx;
+
+/**
+ * Waits until 'queue' of 'holder' has 'waiting' waiters.
+ */
+void waitForWaiters(const TicketHolder& holder, int queue, int waiting) {
+    while (holder.getQueueStats()[queue].waiting != waiting) {
+        mongo::sleepmillis(1);
+    }
+}
+
+/**
+ * Starts threads that each wait for a ticket from 'holder', record their id in the order they
+ * were admitted, and then release the ticket.
+ */
+class Admissions {
+public:
+    explicit Admissions(TicketHolder* holder) : _holder(holder) {}
+
+    ~Admissions() {
+        for (size_t i = 0; i < _threads.size(); i++) {
+            _threads[i].join();
+        }
+    }
+
+    /**
+     * Starts a waiter in 'queue' and returns once it is waiting there.
+     */
+    void startWaiter(int queue, int id) {
+        const int waiting = _holder->getQueueStats()[queue].waiting;
+        _threads.emplace_back([this, queue, id] {
+            ASSERT(_holder->waitForTicketUntil(queue, Date_t::max()));
+            {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                _order.push_back(id);
+            }
+            _holder->release();
+        });
+        waitForWaiters(*_holder, queue, waiting + 1);
+    }
+
+    std::vector<int> join() {
+        for (size_t i = 0; i < _threads.size(); i++) {
+            _threads[i].join();
+        }
+        _threads.clear();
+        return _order;
+    }
+
+private:
+    TicketHolder* _holder;
+    std::vector<stdx::thread> _threads;
+    stdx::mutex _mutex;
+    std::vector<int> _order;
+};
+
+TEST(TicketHolderTest, AcquireAndRelease) {
+    TicketHolder holder(2);
+    ASSERT_EQUALS(2, holder.available());
+
+    ASSERT(holder.tryAcquire());
+    holder.waitForTicket();
+    ASSERT_EQUALS(0, holder.available());
+    ASSERT_EQUALS(2, holder.used());
+    ASSERT_FALSE(holder.tryAcquire());
+
+    holder.release();
+    holder.release();
+    ASSERT_EQUALS(2, holder.available());
+
+    const std::vector<TicketHolder::QueueStats> stats = holder.getQueueStats();
+    ASSERT_EQUALS(1U, stats.size());
+    ASSERT_EQUALS("default", stats[0].name);
+    ASSERT_EQUALS(2, stats[0].admitted);
+    ASSERT_EQUALS(2, stats[0].waitMicrosHistogram[0]);
+    ASSERT_EQUALS(0, stats[0].totalWaitMicros);
+}
+
+TEST(TicketHolderTest, WaitersInAQueueAreAdmittedInOrder) {
+    TicketHolder holder(1);
+    holder.waitForTicket();
+
+    Admissions admissions(&holder);
+    for (int id = 0; id < 5; id++) {
+        admissions.startWaiter(0, id);
+    }
+    holder.release();
+
+    ASSERT(admissions.join() == std::vector<int>({0, 1, 2, 3, 4}));
+    ASSERT_EQUALS(1, holder.available());
+
+    const TicketHolder::QueueStats stats = holder.getQueueStats()[0];
+    ASSERT_EQUALS(6, stats.admitted);
+    ASSERT_EQUALS(0, stats.waiting);
+    ASSERT_GREATER_THAN(stats.totalWaitMicros, 0);
+}
+
+TEST(TicketHolderTest, QueuesShareTicketsByWeight) {
+    TicketHolder holder(1, {{"heavy", 3}, {"light", 1}});
+    holder.waitForTicket();
+
+    // The light queue starts waiting first, but the heavy queue gets three tickets for each
+    // one the light queue gets. Ties go to the earlier queue.
+    Admissions admissions(&holder);
+    for (int id = 0; id < 4; id++) {
+        admissions.startWaiter(1, 10 + id);
+    }
+    for (int id = 0; id < 4; id++) {
+        admissions.startWaiter(0, id);
+    }
+    holder.release();
+
+    ASSERT(admissions.join() == std::vector<int>({0, 10, 1, 2, 3, 11, 12, 13}));
+}
+
+TEST(TicketHolderTest, WaitTimesOutAtDeadline) {
+    TicketHolder holder(1);
+    holder.waitForTicket();
+
+    ASSERT_FALSE(holder.waitForTicketUntil(0, Date_t::now() + Milliseconds(10)));
+
+    TicketHolder::QueueStats stats = holder.getQueueStats()[0];
+    ASSERT_EQUALS(1, stats.timedOut);
+    ASSERT_EQUALS(0, stats.waiting);
+
+    // The ticket isn't handed to the waiter that gave up.
+    holder.release();
+    ASSERT_EQUALS(1, holder.available());
+    ASSERT(holder.waitForTicketUntil(0, Date_t::now() + Milliseconds(10)));
+    holder.release();
+}
+
+TEST(TicketHolderTest, ResizeAdmitsWaiters) {
+    TicketHolder holder(5);
+    for (int i = 0; i < 5; i++) {
+        holder.waitForTicket();
+    }
+
+    Admissions admissions(&holder);
+    admissions.startWaiter(0, 0);
+    admissions.startWaiter(0, 1);
+    ASSERT_OK(holder.resize(6));
+
+    ASSERT(admissions.join() == std::vector<int>({0, 1}));
+    for (int i = 0; i < 5; i++) {
+        holder.release();
+    }
+    ASSERT_EQUALS(6, holder.available());
+}
+
+#if defined(__linux__)
+TEST(TicketHolderTest, ShrinkRetiresTicketsInUseWithoutWaiting) {
+    TicketHolder holder(7);
+    for (int i = 0; i < 7; i++) {
+        holder.waitForTicket();
+    }
+    holder.release();
+
+    // The free ticket is taken from the pool, and one in use is to be retired.
+    ASSERT_OK(holder.resize(5));
+    ASSERT_EQUALS(5, holder.outof());
+    ASSERT_EQUALS(6, holder.used());
+    ASSERT_EQUALS(0, holder.available());
+
+    // Growing keeps a ticket that was to be retired rather than adding one.
+    ASSERT_OK(holder.resize(6));
+    ASSERT_EQUALS(6, holder.used());
+    ASSERT_EQUALS(0, holder.available());
+
+    ASSERT_OK(holder.resize(5));
+    holder.release();
+    ASSERT_EQUALS(5, holder.used());
+    ASSERT_EQUALS(0, holder.available());
+    for (int i = 0; i < 5; i++) {
+        holder.release();
+    }
+    ASSERT_EQUALS(5, holder.available());
+
+    // Resizing doesn't count as admissions.
+    ASSERT_EQUALS(7, holder.getQueueStats()[0].admitted);
+}
+#endif
+}